@@ -29,7 +29,8 @@ public:
     }
 
     /**
-     * Updates the position of vertices of this cube.
+     * Updates the position of vertices of this cube. Note that the GPU data are shared by all copies of the cube, use
+     * @link Geometry::clone first if the copies should stay unchanged.
      *
      * @param 	left_top_front	  	The left top front point.
      * @param 	right_top_front   	The right top front point.
@@ -46,7 +47,12 @@ public:
         std::array<float, cube_vertices_count * 14> vertices =
             generate_custom_cube_vertices(left_top_front, right_top_front, left_bottom_front, right_bottom_front, left_top_back,
                                           right_top_back, left_bottom_back, right_bottom_back);
-        glNamedBufferSubData(vertex_buffer, 0, cube_vertices_count * sizeof(float) * 14, vertices.data());
+        if (resource) {
+            resource->arena->upload(resource->vertex_allocation, 0, cube_vertices_count * sizeof(float) * 14, vertices.data());
+        }
+        if (!interleaved_vertices.empty()) {
+            std::copy(vertices.begin(), vertices.end(), interleaved_vertices.begin());
+        }
     }
 
     /**
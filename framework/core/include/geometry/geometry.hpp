@@ -1,21 +1,55 @@
 #pragma once
 
 #include "geometry_base.hpp"
+#include "geometry_resource.hpp"
 #include "glad.h"
 #include "glm/glm.hpp"
+#include "mesh_optimizer.hpp"
+#include "meshlet_builder.hpp"
 #include "model_ubo.hpp"
 #include "program.hpp"
 #include <filesystem>
+#include <span>
 #include <vector>
 
 /**
- * The implementation of the Geometry_Base class providing the
+ * The implementation of the Geometry_Base class providing the OpenGL 4.5 objects. The vertices and indices are not
+ * stored in separate buffers, they are sub-allocated from a shared @link BufferArena, so the geometry is only a view
+ * (arena, offsets, counts) into a few large buffers.
+ * <p>
+ * The GPU data are held by a reference-counted @link GeometryResource. Copying a geometry is cheap since the copies
+ * share the resource (and thus the GPU memory); use @link Geometry::clone to create an independent duplicate.
  *
  * @author	<a href="mailto:jan.byska@gmail.com">Jan Byška</a>
  * @author	<a href="mailto:matus.talcik@gmail.com">Matúš Talčík</a>
  */
 class Geometry : public Geometry_Base {
 
+  public:
+    /** The efficiency of the post-transform vertex cache for a level of detail loaded by @link Geometry::from_file. */
+    struct VertexCacheReport {
+        /** The statistics of the triangle order of the file (or of the simplification for the coarser levels). */
+        MeshOptimizer::VertexCacheStatistics before;
+        /** The statistics of the reordered triangles, i.e., of the order that is drawn. */
+        MeshOptimizer::VertexCacheStatistics after;
+    };
+
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+  protected:
+    /** The GPU data shared by all copies of this geometry. */
+    std::shared_ptr<GeometryResource> resource;
+
+    /** The generation of the arena for which the buffers and offsets of this geometry were queried. */
+    mutable uint64_t arena_generation = UINT64_MAX;
+
+    /** The number of meshlets stored in the GPU buffer (see @link set_meshlets). */
+    GLsizei meshlet_count = 0;
+
+    /** The vertex cache efficiency of each level of detail, empty for geometries not loaded from a file. */
+    std::vector<VertexCacheReport> vertex_cache_reports{};
+
     // ----------------------------------------------------------------------------
     // Constructors
     // ----------------------------------------------------------------------------
@@ -37,38 +71,73 @@ class Geometry : public Geometry_Base {
      * @param 	tex_coord_loc 	    The location of texture coordinates vertex attribute for the VAO (use -1 if not necessary).
      * @param 	tangent_loc   	    The location of tangent vertex attribute for the VAO (use -1 if not necessary).
      * @param 	bitangent_loc 	    The location of bitangent vertex attribute for the VAO (use -1 if not necessary).
+     * @param 	residency 	    The policy determining where the data are kept (see @link Residency).
+     * @param 	vertex_format 	    The layout of the vertices in the GPU buffer (see @link VertexFormat).
      */
     Geometry(GLenum mode, int vertex_buffer_size, int vertices_count, const float* vertices, int indices_count,
              const unsigned int* indices, GLint position_loc = DEFAULT_POSITION_LOC, GLint normal_loc = DEFAULT_NORMAL_LOC,
              GLint tex_coord_loc = DEFAULT_TEX_COORD_LOC, GLint tangent_loc = DEFAULT_TANGENT_LOC,
-             GLint bitangent_loc = DEFAULT_BITANGENT_LOC);
+             GLint bitangent_loc = DEFAULT_BITANGENT_LOC, Residency residency = Residency::GPU_ONLY,
+             VertexFormat vertex_format = VertexFormat::FLOAT);
 
+    /**
+     * Creates a @link Geometry object from interleaved vertices. The vectors are moved into the geometry, so pass them
+     * using std::move to avoid copying the data; with @link Residency::GPU_ONLY they are released after the upload.
+     *
+     * @param 	mode				The mode that will be used for rendering the geometry.
+     * @param 	elements_per_vertex	The number of elements (floats) per vertex.
+     * @param 	interleaved_vertices	The interleaved vertices.
+     * @param 	indices				The indices (may be empty).
+     * @param 	residency			The policy determining where the data are kept (see @link Residency).
+     * @param 	vertex_format		The layout of the vertices in the GPU buffer (see @link VertexFormat).
+     */
     Geometry(GLenum mode, int elements_per_vertex, std::vector<float> interleaved_vertices, std::vector<uint32_t> indices = {},
              GLint position_loc = DEFAULT_POSITION_LOC, GLint normal_loc = DEFAULT_NORMAL_LOC,
              GLint tex_coord_loc = DEFAULT_TEX_COORD_LOC, GLint tangent_loc = DEFAULT_TANGENT_LOC,
-             GLint bitangent_loc = DEFAULT_BITANGENT_LOC);
+             GLint bitangent_loc = DEFAULT_BITANGENT_LOC, Residency residency = Residency::GPU_ONLY,
+             VertexFormat vertex_format = VertexFormat::FLOAT);
 
-    Geometry(GLenum mode, std::vector<float> positions, std::vector<float> normals, std::vector<float> tex_coords,
-             std::vector<float> tangents = {}, std::vector<float> bitangents = {}, std::vector<uint32_t> indices = {},
+    /**
+     * Creates a @link Geometry object from separate vertex attributes. The attributes are only read (the spans may
+     * refer to vectors or static arrays) and interleaved into a buffer of the exact size.
+     *
+     * @param 	residency	 	The policy determining where the data are kept (see @link Residency).
+     * @param 	vertex_format	The layout of the vertices in the GPU buffer (see @link VertexFormat).
+     */
+    Geometry(GLenum mode, std::span<const float> positions, std::span<const float> normals, std::span<const float> tex_coords,
+             std::span<const float> tangents = {}, std::span<const float> bitangents = {}, std::span<const uint32_t> indices = {},
              GLint position_loc = DEFAULT_POSITION_LOC, GLint normal_loc = DEFAULT_NORMAL_LOC,
              GLint tex_coord_loc = DEFAULT_TEX_COORD_LOC, GLint tangent_loc = DEFAULT_TANGENT_LOC,
-             GLint bitangent_loc = DEFAULT_BITANGENT_LOC);
+             GLint bitangent_loc = DEFAULT_BITANGENT_LOC, Residency residency = Residency::GPU_ONLY,
+             VertexFormat vertex_format = VertexFormat::FLOAT);
 
-    static Geometry from_file(std::filesystem::path file_path);
+    /**
+     * Loads a geometry from an OBJ file. Vertices shared by several faces are welded, so the geometry is indexed. The
+     * geometry is centered and scaled to fit into a unit box and its most detailed level is split into meshlets.
+     * <p>
+     * All objects and material groups of the file are loaded into the same buffers, each becomes one of the
+     * {@link submeshes} (drawn by @link draw_submesh or @link draw_submeshes) and the names of their materials are
+     * stored in {@link materials}.
+     *
+     * @param 	file_path	 	The path to the file.
+     * @param 	residency	 	The policy determining where the data are kept (see @link Residency).
+     * @param 	vertex_format	The layout of the vertices in the GPU buffer (see @link VertexFormat).
+     * @param 	lod_count	 	The number of levels of detail to generate (see @link MeshSimplifier::build_lods),
+     * 							1 means no simplification.
+     */
+    static Geometry from_file(std::filesystem::path file_path, Residency residency = Residency::GPU_ONLY,
+                              VertexFormat vertex_format = VertexFormat::FLOAT, int lod_count = 1);
 
     /**
-     * Creates a new @link Geometry object from another geometry performing a deep copy.
+     * Creates a new @link Geometry object from another geometry. The copy shares the GPU data with the other geometry.
      *
      * @param 	other	The other geometry.
      */
     Geometry(const Geometry& other);
 
-    Geometry(Geometry&& other) : Geometry() { swap(*this, other); };
+    Geometry(Geometry&& other) noexcept : Geometry() { swap(*this, other); };
 
-    /**
-     * Destroys this @link Geometry. Note that we do not delete the OpenGL counterparts in order to avoid problems when
-     * the object is copied locally and then it goes out of scope.
-     */
+    /** Destroys this @link Geometry. The GPU data are released together with the last geometry sharing them. */
     virtual ~Geometry();
 
     // ----------------------------------------------------------------------------
@@ -88,10 +157,77 @@ class Geometry : public Geometry_Base {
         return *this;
     };
 
+    friend void swap(Geometry& first, Geometry& second) noexcept {
+        using std::swap;
+
+        swap(static_cast<Geometry_Base&>(first), static_cast<Geometry_Base&>(second));
+        swap(first.resource, second.resource);
+        swap(first.arena_generation, second.arena_generation);
+        swap(first.meshlet_count, second.meshlet_count);
+        swap(first.vertex_cache_reports, second.vertex_cache_reports);
+    }
+
     // ----------------------------------------------------------------------------
     // Methods
     // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Creates an independent copy of this geometry, i.e., a geometry with its own copy of the GPU data. This is needed
+     * only when the data of one of the copies are going to be modified (e.g., @link Cube::update).
+     *
+     * @return	The deep copy of this geometry.
+     */
+    Geometry clone() const;
+
+    /** @copydoc Geometry_Base::validate_vao */
+    void validate_vao() const override;
+
+    /**
+     * Uploads the meshlets of the geometry, they are used by @link MeshletCuller to draw only the visible parts of the
+     * geometry. Replaces the previous meshlets (if any); ignored for geometries without GPU data.
+     *
+     * @param 	meshlets	The meshlets, their index ranges refer to the index buffer of this geometry.
+     */
+    void set_meshlets(std::span<const Meshlet> meshlets);
+
+    /** Returns the number of meshlets of this geometry (0 if the geometry was not split into meshlets). */
+    GLsizei get_meshlet_count() const { return meshlet_count; }
+
+    /**
+     * Returns the vertex cache efficiency of the levels of detail before and after @link from_file reordered their
+     * triangles, ordered from the most detailed level; empty for geometries not loaded from a file.
+     */
+    std::span<const VertexCacheReport> get_vertex_cache_reports() const { return vertex_cache_reports; }
+
+    /** Returns the current range of the buffer with the meshlets. */
+    BufferArena::Range get_meshlet_range() const;
+
+    /** Returns the size (in bytes) of the GPU data of this geometry, i.e., of its vertices, indices, and meshlets. */
+    GLsizeiptr get_memory_size() const;
+
   private:
+    /**
+     * Allocates the vertices and indices in the default arena (converted to the @link vertex_format) and initializes
+     * the VAO (unless the residency is @link Residency::CPU_ONLY). Then keeps or releases the CPU copy of the data
+     * according to the residency.
+     *
+     * @param 	vertices	The interleaved float vertices ({@link elements_per_vertex} * {@link draw_arrays_count} values).
+     * @param 	indices 	The indices ({@link draw_elements_count} values), may be null.
+     */
+    void init_buffers(const float* vertices, const uint32_t* indices);
+
     /** Initialize Vertex Array Object for the geometry. */
     void init_vao();
+
+    /** Sets the vertex attributes of the VAO for the @link VertexFormat::QUANTIZED layout. */
+    void init_quantized_attributes();
+
+    /** Returns the offset (in bytes) of the @link QuantizationConstants within the vertex allocation. */
+    GLsizeiptr get_quantization_constants_offset() const;
+
+    /**
+     * Queries the current ranges of the allocations. The shared VAO is updated if it refers to an older arena
+     * generation.
+     */
+    void update_bindings() const;
 };
@@ -1,8 +1,54 @@
 ﻿#pragma once
 
 #include "glad.h"
+#include "utils/frame_counters.hpp"
+#include "vertex_quantization.hpp"
+#include <span>
+#include <string>
 #include <vector>
 
+/**
+ * The policy determining where the data of a geometry live after its construction.
+ * <p>
+ * Most geometries are only drawn, so their vertices are released from RAM right after they are uploaded into the GPU
+ * buffers. Geometries used also by the CPU (e.g., for collisions or picking) keep a copy of the vertices and indices,
+ * geometries used only by the CPU do not create any OpenGL objects at all.
+ */
+enum class Residency {
+    /** The data are uploaded to the GPU and the CPU copy is released. */
+    GPU_ONLY,
+    /** The data are uploaded to the GPU and the CPU copy is kept in {@link Geometry_Base::interleaved_vertices} and {@link Geometry_Base::indices}. */
+    CPU_AND_GPU,
+    /** The data are kept only in {@link Geometry_Base::interleaved_vertices} and {@link Geometry_Base::indices}, the geometry cannot be drawn. */
+    CPU_ONLY
+};
+
+/** The range of indices forming a single level of detail of a geometry. */
+struct LevelOfDetail {
+    /** The first index of the level within the index buffer. */
+    GLsizei first_index = 0;
+    /** The number of indices of the level. */
+    GLsizei index_count = 0;
+    /** The upper bound of the deviation (in object space units) of the level from the original geometry. */
+    float error = 0.0f;
+};
+
+/**
+ * A part of a geometry drawn with its own material, e.g., an object or a material group of an OBJ file. The submeshes
+ * share the vertex and index buffers of the geometry, so drawing them needs only one VAO bind.
+ */
+struct Submesh {
+    /** The name of the part (e.g., the OBJ object or group). */
+    std::string name;
+    /** The index of the material of the part into {@link Geometry_Base::materials}, -1 if the part has no material. */
+    int material_id = -1;
+    /**
+     * The index ranges of the part within each level of detail of the geometry ordered from the most detailed one. The
+     * parts are simplified separately, so every level keeps the split into the parts.
+     */
+    std::vector<LevelOfDetail> lods{};
+};
+
 /**
  * This is a base class for all geometry classes that wraps buffers and vertex array objects for geometries.
  * <p>
@@ -44,6 +90,10 @@ public:
     static const int DEFAULT_TANGENT_LOC = 3;
     /** The default location of bitangent vertex attribute. */
     static const int DEFAULT_BITANGENT_LOC = 4;
+    /** The location of the attribute with the scale decoding quantized positions (see @link QuantizationConstants). */
+    static const int QUANTIZATION_SCALE_LOC = 6;
+    /** The location of the attribute with the offset decoding quantized positions (see @link QuantizationConstants). */
+    static const int QUANTIZATION_OFFSET_LOC = 7;
 
     // ----------------------------------------------------------------------------
     // Variables
@@ -58,9 +108,36 @@ public:
     /** The vertex buffer stride, i.e., the spacing of the elements in the array.*/
     GLsizei vertex_buffer_stride = 0;
 
-    /** The buffer storing the interleaved data for the vertices. */
+    /** The policy determining if the data are kept in RAM, in the GPU buffers, or in both. */
+    Residency residency = Residency::GPU_ONLY;
+
+    /**
+     * The CPU copy of the interleaved data for the vertices. The vector is empty for geometries with
+     * {@link Residency::GPU_ONLY} residency once the data are uploaded.
+     */
     std::vector<float> interleaved_vertices{};
 
+    /** The CPU copy of the indices, empty for geometries with {@link Residency::GPU_ONLY} residency. */
+    std::vector<uint32_t> indices{};
+
+    /** The layout of the vertices in the GPU buffer. The CPU copy always uses the float layout. */
+    VertexFormat vertex_format = VertexFormat::FLOAT;
+
+    /** The type of the indices in the GPU buffer, GL_UNSIGNED_INT or GL_UNSIGNED_SHORT. */
+    GLenum index_type = GL_UNSIGNED_INT;
+
+    /**
+     * The levels of detail ordered from the most detailed one. The levels share the vertices and their indices are
+     * stored one after another in the index buffer. Empty for geometries without levels of detail.
+     */
+    std::vector<LevelOfDetail> lods{};
+
+    /** The parts of the geometry with their own materials (e.g., of an OBJ file), empty for generated geometries. */
+    std::vector<Submesh> submeshes{};
+
+    /** The names of the materials referenced by {@link Submesh::material_id}. */
+    std::vector<std::string> materials{};
+
     /** The number of elements (floats) per vertex. */
     int elements_per_vertex = 0;
 
@@ -76,11 +153,21 @@ public:
     /** The Vertex Array Object that describes how the vertex attributes are stored. */
     GLuint vao = 0;
 
-    /** The OpenGL buffer with the the geometry data (positions, normals, texture coordinates, etc.). */
-    GLuint vertex_buffer = 0;
+    /**
+     * The OpenGL buffer with the the geometry data (positions, normals, texture coordinates, etc.). The buffer may be
+     * shared with other geometries, the data start at {@link vertex_buffer_offset}. The buffer and the offsets are
+     * mutable since a derived class may need to refresh them when the data are moved (see {@link validate_vao}).
+     */
+    mutable GLuint vertex_buffer = 0;
+
+    /** The offset (in bytes) of the vertex data within {@link vertex_buffer}. */
+    mutable GLintptr vertex_buffer_offset = 0;
 
     /** The OpenGL buffer with the indices describing the geometry. */
-    GLuint index_buffer = 0;
+    mutable GLuint index_buffer = 0;
+
+    /** The offset (in bytes) of the indices within {@link index_buffer}. */
+    mutable GLintptr index_buffer_offset = 0;
 
     /** The location of position vertex attribute. */
     GLint position_loc = DEFAULT_POSITION_LOC;
@@ -127,8 +214,10 @@ public:
         draw_arrays_count = vertices_count;
     };
 
-    /** 
+    /**
      * Creates a new @link Geometry_Base object. Note that this constructor does not initialize the OpenGL objects, this is left to the child class.
+     * The input data are only read while building {@link interleaved_vertices} whose storage is reserved up front, the
+     * indices are not copied, only their count is stored.
      *
      * @param 	mode	  	The mode that will be used for rendering the geometry.
      * @param 	positions 	The list of vertex positions.
@@ -138,8 +227,8 @@ public:
      * @param 	bitangents	The list of bitangents associated with the vertices.
      * @param 	indices   	The list of indices defining the geometry.
      */
-    Geometry_Base(GLenum mode, std::vector<float> positions, std::vector<float> normals, std::vector<float> tex_coords,
-                  std::vector<float> tangents, std::vector<float> bitangents, std::vector<uint32_t> indices,
+    Geometry_Base(GLenum mode, std::span<const float> positions, std::span<const float> normals, std::span<const float> tex_coords,
+                  std::span<const float> tangents, std::span<const float> bitangents, std::span<const uint32_t> indices,
                   GLint position_loc = DEFAULT_POSITION_LOC, GLint normal_loc = DEFAULT_NORMAL_LOC,
                   GLint tex_coord_loc = DEFAULT_TEX_COORD_LOC, GLint tangent_loc = DEFAULT_TANGENT_LOC,
                   GLint bitangent_loc = DEFAULT_BITANGENT_LOC)
@@ -154,32 +243,24 @@ public:
         const int vertices_count = static_cast<int>(positions.size() / 3);
 
         // Builds the interleaved buffer from the input data.
+        interleaved_vertices.reserve(static_cast<size_t>(vertices_count) * elements_per_vertex);
         for (size_t i = 0; i < positions.size() / 3; i += 1) {
-            interleaved_vertices.push_back(positions[i * 3 + 0]);
-            interleaved_vertices.push_back(positions[i * 3 + 1]);
-            interleaved_vertices.push_back(positions[i * 3 + 2]);
+            interleaved_vertices.insert(interleaved_vertices.end(), positions.begin() + i * 3, positions.begin() + i * 3 + 3);
 
             if (!normals.empty()) {
-                interleaved_vertices.push_back(normals[i * 3 + 0]);
-                interleaved_vertices.push_back(normals[i * 3 + 1]);
-                interleaved_vertices.push_back(normals[i * 3 + 2]);
+                interleaved_vertices.insert(interleaved_vertices.end(), normals.begin() + i * 3, normals.begin() + i * 3 + 3);
             }
 
             if (!tex_coords.empty()) {
-                interleaved_vertices.push_back(tex_coords[i * 2 + 0]);
-                interleaved_vertices.push_back(tex_coords[i * 2 + 1]);
+                interleaved_vertices.insert(interleaved_vertices.end(), tex_coords.begin() + i * 2, tex_coords.begin() + i * 2 + 2);
             }
 
             if (!tangents.empty()) {
-                interleaved_vertices.push_back(tangents[i * 3 + 0]);
-                interleaved_vertices.push_back(tangents[i * 3 + 1]);
-                interleaved_vertices.push_back(tangents[i * 3 + 2]);
+                interleaved_vertices.insert(interleaved_vertices.end(), tangents.begin() + i * 3, tangents.begin() + i * 3 + 3);
             }
 
             if (!bitangents.empty()) {
-                interleaved_vertices.push_back(bitangents[i * 3 + 0]);
-                interleaved_vertices.push_back(bitangents[i * 3 + 1]);
-                interleaved_vertices.push_back(bitangents[i * 3 + 2]);
+                interleaved_vertices.insert(interleaved_vertices.end(), bitangents.begin() + i * 3, bitangents.begin() + i * 3 + 3);
             }
         }
 
@@ -188,11 +269,8 @@ public:
 
         init_patches_count();
 
-        // Sets the number of elements according to the
-        if (!indices.empty()) {
-            draw_elements_count = static_cast<GLsizei>(indices.size());
-        }
-
+        // Sets the number of elements according to the indices (if there are any).
+        draw_elements_count = static_cast<GLsizei>(indices.size());
         draw_arrays_count = vertices_count;
     };
 
@@ -205,7 +283,10 @@ public:
      */
     Geometry_Base(const Geometry_Base& other)
         : mode(other.mode), vertex_buffer_size(other.vertex_buffer_size), vertex_buffer_stride(other.vertex_buffer_stride),
-          interleaved_vertices(other.interleaved_vertices), elements_per_vertex(other.elements_per_vertex),
+          residency(other.residency), interleaved_vertices(other.interleaved_vertices), indices(other.indices),
+          vertex_format(other.vertex_format), index_type(other.index_type), lods(other.lods),
+          submeshes(other.submeshes), materials(other.materials),
+          elements_per_vertex(other.elements_per_vertex),
           draw_arrays_count(other.draw_arrays_count), draw_elements_count(other.draw_elements_count),
           patch_vertices(other.patch_vertices), position_loc(other.position_loc), normal_loc(other.normal_loc),
           tex_coord_loc(other.tex_coord_loc), tangent_loc(other.tangent_loc), bitangent_loc(other.bitangent_loc) {
@@ -225,8 +306,10 @@ public:
         using std::swap;
 
         swap(first.vertex_buffer, second.vertex_buffer);
+        swap(first.vertex_buffer_offset, second.vertex_buffer_offset);
         swap(first.vertex_buffer_size, second.vertex_buffer_size);
         swap(first.index_buffer, second.index_buffer);
+        swap(first.index_buffer_offset, second.index_buffer_offset);
         swap(first.vao, second.vao);
         swap(first.mode, second.mode);
         swap(first.draw_arrays_count, second.draw_arrays_count);
@@ -239,7 +322,14 @@ public:
         swap(first.bitangent_loc, second.bitangent_loc);
         swap(first.elements_per_vertex, second.elements_per_vertex);
         swap(first.vertex_buffer_stride, second.vertex_buffer_stride);
+        swap(first.residency, second.residency);
         swap(first.interleaved_vertices, second.interleaved_vertices);
+        swap(first.indices, second.indices);
+        swap(first.vertex_format, second.vertex_format);
+        swap(first.index_type, second.index_type);
+        swap(first.lods, second.lods);
+        swap(first.submeshes, second.submeshes);
+        swap(first.materials, second.materials);
     }
 
     virtual ~Geometry_Base() {
@@ -257,16 +347,55 @@ public:
         }
     }
 
+    /**
+     * Makes sure that the VAO refers to the current location of the geometry data. The base implementation does
+     * nothing, derived classes whose data may move override it.
+     */
+    virtual void validate_vao() const {}
+
+    /** Releases the CPU copy of the data (including the reserved storage) if the residency does not require it. */
+    void release_cpu_data() {
+        if (residency == Residency::GPU_ONLY) {
+            std::vector<float>().swap(interleaved_vertices);
+            std::vector<uint32_t>().swap(indices);
+        }
+    }
+
     /** Binds the VAO corresponding to this geometry. */
     void bind_vao() const {
+        validate_vao();
         glBindVertexArray(vao);
     }
 
+    /**
+     * Sets the levels of detail of this geometry. The index buffer must already contain the indices of all levels, the
+     * first level becomes the one drawn by default.
+     *
+     * @param 	levels	The levels ordered from the most detailed one.
+     */
+    void set_lods(std::vector<LevelOfDetail> levels) {
+        lods = std::move(levels);
+        if (!lods.empty()) {
+            draw_elements_count = lods[0].index_count;
+        }
+    }
+
+    /** Returns the number of levels of detail (at least 1). */
+    int get_lod_count() const { return lods.empty() ? 1 : static_cast<int>(lods.size()); }
+
+    /** Returns the size (in bytes) of a single index in the GPU buffer. */
+    GLsizeiptr get_index_size() const { return index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t); }
+
     /**
      * Draws the geometry using either glDrawArrays or glDrawElements based on the current values of {@link draw_arrays_count} and
-     * {@link draw_elements_count}.
+     * {@link draw_elements_count}. Geometries with {@link Residency::CPU_ONLY} residency are not drawn.
+     *
+     * @param 	lod	The level of detail to draw (ignored if out of range).
      */
-    void draw() const {
+    void draw(int lod = 0) const {
+        if (residency == Residency::CPU_ONLY) {
+            return;
+        }
         bind_vao();
 
         if (mode == GL_PATCHES) {
@@ -274,19 +403,38 @@ public:
         }
 
         if (draw_elements_count > 0) {
-            glDrawElements(mode, draw_elements_count, GL_UNSIGNED_INT, nullptr);
+            const LevelOfDetail level = get_lod(lod);
+            glDrawElements(mode, level.index_count, index_type, get_index_pointer(level));
+            FrameCounters::count_draw(mode, level.index_count);
         } else {
             glDrawArrays(mode, 0, draw_arrays_count);
+            FrameCounters::count_draw(mode, draw_arrays_count);
         }
     }
 
     /**
-     * Draws multiple instances of the geometry using either glDrawArraysInstanced or glDrawElementsInstanced based on
-     * the current values of {@link draw_arrays_count} and {@link draw_elements_count}.
+     * Draws a single instance of the geometry with a given base instance. The base instance is available in shaders as
+     * gl_BaseInstance (gl_BaseInstanceARB in GLSL 4.50), which is useful for selecting per-draw data from a shader
+     * storage buffer without binding a new buffer range before every draw.
+     *
+     * @param 	base_instance	The base instance, e.g., the index of the per-draw data.
+     * @param 	lod			 	The level of detail to draw (ignored if out of range).
+     */
+    void draw_base_instance(GLuint base_instance, int lod = 0) const { draw_instanced(1, base_instance, lod); }
+
+    /**
+     * Draws multiple instances of the geometry using either glDrawArraysInstancedBaseInstance or
+     * glDrawElementsInstancedBaseInstance based on the current values of {@link draw_arrays_count} and
+     * {@link draw_elements_count}.
      *
-     * @param 	count	The number of instances to render.
+     * @param 	count		 	The number of instances to render.
+     * @param 	base_instance	The base instance for use in fetching instanced vertex attributes.
+     * @param 	lod			 	The level of detail to draw (ignored if out of range).
      */
-    void draw_instanced(int count) const {
+    void draw_instanced(int count, GLuint base_instance = 0, int lod = 0) const {
+        if (residency == Residency::CPU_ONLY) {
+            return;
+        }
         bind_vao();
 
         if (mode == GL_PATCHES) {
@@ -294,9 +442,73 @@ public:
         }
 
         if (draw_elements_count > 0) {
-            glDrawElementsInstanced(mode, draw_elements_count, GL_UNSIGNED_INT, nullptr, count);
+            const LevelOfDetail level = get_lod(lod);
+            glDrawElementsInstancedBaseInstance(mode, level.index_count, index_type, get_index_pointer(level), count,
+                                                base_instance);
+            FrameCounters::count_draw(mode, level.index_count, count);
         } else {
-            glDrawArraysInstanced(mode, 0, draw_arrays_count, count);
+            glDrawArraysInstancedBaseInstance(mode, 0, draw_arrays_count, count, base_instance);
+            FrameCounters::count_draw(mode, draw_arrays_count, count);
         }
     }
+
+    /** Returns the number of submeshes (0 if the geometry can be drawn only as a whole). */
+    size_t get_submesh_count() const { return submeshes.size(); }
+
+    /**
+     * Draws a single submesh of the geometry with a given base instance; the VAO is bound by every call. Use
+     * @link draw_submeshes to draw all submeshes with a single bind.
+     *
+     * @param 	submesh		 	The index of the submesh (ignored if out of range).
+     * @param 	base_instance	The base instance, e.g., the index of the per-draw data.
+     * @param 	lod			 	The level of detail to draw (the most detailed one if out of range).
+     */
+    void draw_submesh(size_t submesh, GLuint base_instance = 0, int lod = 0) const {
+        if (residency == Residency::CPU_ONLY || submesh >= submeshes.size()) {
+            return;
+        }
+        bind_vao();
+        draw_submesh_range(submeshes[submesh], base_instance, lod);
+    }
+
+    /**
+     * Draws all submeshes of the geometry one after another with a single VAO bind. The submesh i is drawn with the
+     * base instance first_base_instance + i, so the shaders can select its material from the per-draw data.
+     *
+     * @param 	first_base_instance	The base instance of the first submesh.
+     * @param 	lod				   	The level of detail to draw (the most detailed one if out of range).
+     */
+    void draw_submeshes(GLuint first_base_instance = 0, int lod = 0) const {
+        if (residency == Residency::CPU_ONLY || submeshes.empty()) {
+            return;
+        }
+        bind_vao();
+        for (size_t s = 0; s < submeshes.size(); s++) {
+            draw_submesh_range(submeshes[s], first_base_instance + static_cast<GLuint>(s), lod);
+        }
+    }
+
+  protected:
+    /** Draws a level of detail of a submesh, the VAO must be bound. */
+    void draw_submesh_range(const Submesh& submesh, GLuint base_instance, int lod) const {
+        if (submesh.lods.empty()) {
+            return;
+        }
+        const LevelOfDetail level = lod > 0 && lod < static_cast<int>(submesh.lods.size()) ? submesh.lods[lod] : submesh.lods[0];
+        glDrawElementsInstancedBaseInstance(mode, level.index_count, index_type, get_index_pointer(level), 1, base_instance);
+        FrameCounters::count_draw(mode, level.index_count);
+    }
+
+    /** Returns the index range of the level of detail, the whole geometry is one level if it has no levels. */
+    LevelOfDetail get_lod(int lod) const {
+        if (lod > 0 && lod < static_cast<int>(lods.size())) {
+            return lods[lod];
+        }
+        return {0, draw_elements_count, 0.0f};
+    }
+
+    /** Returns the offset of the first index of the level in the form expected by the glDrawElements* functions. */
+    const void* get_index_pointer(const LevelOfDetail& level) const {
+        return reinterpret_cast<const void*>(index_buffer_offset + level.first_index * get_index_size());
+    }
 };
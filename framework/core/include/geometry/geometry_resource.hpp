@@ -0,0 +1,82 @@
+#pragma once
+
+#include "buffer_arena.hpp"
+#include "glad.h"
+#include "utils/gl_object_tracker.hpp"
+#include <memory>
+
+/**
+ * The GPU resources of a single mesh: the arena allocations with vertices, indices, and meshlets and the VAO describing
+ * them.
+ * The resource is move-only, it is shared by all copies of a @link Geometry through std::shared_ptr and released when
+ * the last copy is destroyed. Use @link Geometry::clone to obtain an independent copy of the data.
+ */
+class GeometryResource {
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+  public:
+    /** The arena storing the vertices and indices. */
+    std::shared_ptr<BufferArena> arena;
+
+    /** The allocation with the vertices. */
+    BufferArena::Handle vertex_allocation = BufferArena::INVALID_HANDLE;
+
+    /** The allocation with the indices. */
+    BufferArena::Handle index_allocation = BufferArena::INVALID_HANDLE;
+
+    /** The allocation with the @link Meshlet bounds (none if the geometry has no meshlets). */
+    BufferArena::Handle meshlet_allocation = BufferArena::INVALID_HANDLE;
+
+    /** The Vertex Array Object shared by all geometries referring to this resource. */
+    GLuint vao = 0;
+
+    /** The generation of the arena for which the VAO bindings were set up (none yet). */
+    uint64_t arena_generation = UINT64_MAX;
+
+    // ----------------------------------------------------------------------------
+    // Constructors
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Constructs a new @link GeometryResource with a new VAO. The allocations are left to the caller.
+     *
+     * @param 	arena	The arena that will store the data.
+     */
+    explicit GeometryResource(std::shared_ptr<BufferArena> arena) : arena(std::move(arena)) {
+        glCreateVertexArrays(1, &vao);
+        GLObjectTracker::on_create(GLObjectType::VERTEX_ARRAY, vao);
+    }
+
+    GeometryResource(const GeometryResource& other) = delete;
+    GeometryResource& operator=(const GeometryResource& other) = delete;
+
+    GeometryResource(GeometryResource&& other) noexcept { swap(*this, other); }
+
+    GeometryResource& operator=(GeometryResource&& other) noexcept {
+        swap(*this, other);
+        return *this;
+    }
+
+    /** Destroys this @link GeometryResource, returns the data to the arena and deletes the VAO. */
+    ~GeometryResource() {
+        if (arena) {
+            arena->free(vertex_allocation);
+            arena->free(index_allocation);
+            arena->free(meshlet_allocation);
+        }
+        GLObjectTracker::on_delete(GLObjectType::VERTEX_ARRAY, vao);
+        glDeleteVertexArrays(1, &vao);
+    }
+
+    friend void swap(GeometryResource& first, GeometryResource& second) noexcept {
+        using std::swap;
+
+        swap(first.arena, second.arena);
+        swap(first.vertex_allocation, second.vertex_allocation);
+        swap(first.index_allocation, second.index_allocation);
+        swap(first.meshlet_allocation, second.meshlet_allocation);
+        swap(first.vao, second.vao);
+        swap(first.arena_generation, second.arena_generation);
+    }
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * The class providing a collection of static utility methods reordering indexed triangle meshes for faster rendering.
+ * None of the methods changes the rendered image, they only change the order of the triangles or vertices:
+ * - @link optimize_vertex_cache reorders the triangles so that the vertices are reused from the post-transform
+ *   vertex cache (Forsyth's "Linear-Speed Vertex Cache Optimisation"),
+ * - @link optimize_overdraw reorders clusters of the cache-friendly triangle order so that the triangles facing
+ *   outward are drawn first, which lets early depth testing reject more of the hidden fragments,
+ * - @link optimize_vertex_fetch reorders the vertices in the order of their first use, so that the vertex fetches
+ *   access memory mostly sequentially.
+ * The methods should be called in this order.
+ */
+class MeshOptimizer {
+  public:
+    /** The efficiency of the post-transform vertex cache for a triangle order. */
+    struct VertexCacheStatistics {
+        /** The number of transformed vertices. */
+        size_t vertices_transformed = 0;
+        /** The average cache miss ratio, i.e., the number of transformed vertices per triangle (0.5 - 3.0). */
+        float acmr = 0.0f;
+        /** The average transform to vertex ratio, i.e., how many times each vertex is transformed (1.0 is ideal). */
+        float atvr = 0.0f;
+    };
+
+    /**
+     * Simulates a FIFO post-transform vertex cache.
+     *
+     * @param 	indices			The indices of the triangles.
+     * @param 	vertices_count	The number of vertices.
+     * @param 	cache_size		The size of the simulated cache.
+     */
+    static VertexCacheStatistics analyze_vertex_cache(std::span<const uint32_t> indices, size_t vertices_count,
+                                                      size_t cache_size = 16);
+
+    /**
+     * Reorders the triangles for the post-transform vertex cache.
+     *
+     * @param 	indices			[in,out] The indices of the triangles.
+     * @param 	vertices_count	The number of vertices.
+     * @param 	cache		 	[in,out] The vertices in the simulated cache (most recently used first) before the first
+     * 							triangle and after the last one, so that consecutive ranges (e.g., meshlets) can be
+     * 							reordered separately and still reuse the vertices of each other; may be null.
+     */
+    static void optimize_vertex_cache(std::span<uint32_t> indices, size_t vertices_count,
+                                      std::vector<uint32_t>* cache = nullptr);
+
+    /**
+     * Reorders the triangles to reduce overdraw while keeping most of the vertex cache efficiency. The triangles are
+     * split into clusters where the cache-optimized order restarts (all three vertices are cache misses) and the
+     * clusters are sorted so that the ones facing away from the mesh center are drawn first.
+     *
+     * @param 	indices			   	[in,out] The cache-optimized indices of the triangles.
+     * @param 	vertices		   	The interleaved float vertices, the position is the first attribute.
+     * @param 	elements_per_vertex	The number of floats per vertex.
+     */
+    static void optimize_overdraw(std::span<uint32_t> indices, std::span<const float> vertices, int elements_per_vertex);
+
+    /**
+     * Reorders the vertices in the order of their first use and drops the unused ones. All index ranges referring to
+     * the vertices (e.g., all levels of detail) have to be passed at once.
+     *
+     * @param 	vertices		   	[in,out] The interleaved float vertices.
+     * @param 	elements_per_vertex	The number of floats per vertex.
+     * @param 	indices			   	[in,out] The indices referring to the vertices.
+     *
+     * @return	The new number of vertices.
+     */
+    static size_t optimize_vertex_fetch(std::vector<float>& vertices, int elements_per_vertex, std::span<uint32_t> indices);
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "geometry_base.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * The class providing a collection of static utility methods generating simplified versions of indexed triangle meshes.
+ * <p>
+ * The simplification collapses edges in the order of the quadric error metric (Garland & Heckbert). Every edge is
+ * collapsed into one of its end points, so the simplified meshes reuse the original vertices and only their indices
+ * differ; this allows storing all levels of detail in a single index buffer. The topology is simplified on positions,
+ * so vertices split by normal or texture seams move together, and each corner then picks the vertex at the new position
+ * whose attributes match best. Open borders are preserved by additional quadrics and collapses flipping triangles are
+ * rejected.
+ */
+class MeshSimplifier {
+  public:
+    /**
+     * Simplifies an indexed triangle mesh.
+     *
+     * @param 	vertices		   	The interleaved float vertices, the position is the first attribute.
+     * @param 	elements_per_vertex	The number of floats per vertex.
+     * @param 	indices			   	The indices of the triangles.
+     * @param 	target_index_count 	The requested number of indices, the result may be larger if the mesh cannot be
+     * 								simplified further.
+     * @param 	result_error	   	[out] If not null, receives the maximal distance (in object space units) of a
+     * 								collapsed position from the planes of the original triangles and open borders
+     * 								around it.
+     *
+     * @return	The indices of the simplified mesh referring to the same vertices.
+     */
+    static std::vector<uint32_t> simplify(std::span<const float> vertices, int elements_per_vertex,
+                                          std::span<const uint32_t> indices, size_t target_index_count,
+                                          float* result_error = nullptr);
+
+    /**
+     * Generates the levels of detail of a mesh, each level has roughly half of the triangles of the previous one. The
+     * indices of the coarser levels are appended to the indices, the generation stops early once the mesh cannot be
+     * simplified further.
+     *
+     * @param 	vertices		   	The interleaved float vertices, the position is the first attribute.
+     * @param 	elements_per_vertex	The number of floats per vertex.
+     * @param 	indices			   	[in,out] The indices of the mesh, extended by the indices of the coarser levels.
+     * @param 	lod_count		   	The requested number of levels (including the original mesh).
+     *
+     * @return	The levels of detail ordered from the original mesh, the error of each level is the sum of the errors
+     * 			(see @link simplify) of the simplifications leading to it.
+     */
+    static std::vector<LevelOfDetail> build_lods(std::span<const float> vertices, int elements_per_vertex,
+                                                 std::vector<uint32_t>& indices, int lod_count);
+};
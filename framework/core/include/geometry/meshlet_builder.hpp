@@ -0,0 +1,80 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * The small cluster of triangles that is culled as a whole. The triangles of a meshlet form a contiguous range of the
+ * index buffer, so a visible meshlet is drawn by a single draw command. The layout matches the std430 structure in
+ * meshlet_cull.comp.
+ */
+struct Meshlet {
+    /** The center (xyz) and radius (w) of the bounding sphere in object space. */
+    glm::vec4 bounding_sphere = glm::vec4(0.0f);
+    /**
+     * The axis (xyz) of the cone containing the normals of all triangles and the cutoff (w) used for the back-face test,
+     * i.e., the sine of the cone's half-angle. A cutoff of 1 means the meshlet cannot be culled by its normals.
+     */
+    glm::vec4 normal_cone = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    /**
+     * The apex (xyz) of the back-face cone: the meshlet is entirely back-facing for every camera within the cone
+     * with this apex, the axis of the normal cone, and the half-angle whose cosine is the cutoff.
+     */
+    glm::vec4 cone_apex = glm::vec4(0.0f);
+    /** The first index of the meshlet within the index buffer. */
+    uint32_t first_index = 0;
+    /** The number of indices of the meshlet. */
+    uint32_t index_count = 0;
+    /** The number of unique vertices referenced by the meshlet. */
+    uint32_t vertex_count = 0;
+    /** Padding to the 16-byte std430 alignment. */
+    uint32_t padding = 0;
+};
+
+/**
+ * The class providing a static utility method partitioning indexed triangle meshes into meshlets.
+ * <p>
+ * The meshlets are grown greedily over the triangle adjacency: the next triangle is the one adding the fewest new
+ * vertices and deviating the least from the average normal of the meshlet, so the meshlets are compact (small bounding
+ * spheres) and flat (narrow normal cones). The triangles of the partitioned range are reordered so that every meshlet
+ * is a contiguous index range. The order within a meshlet follows the growth, so the triangles of each meshlet should
+ * be reordered for the vertex cache afterwards (see @link MeshOptimizer::optimize_vertex_cache).
+ */
+class MeshletBuilder {
+  public:
+    /** The default maximal number of unique vertices per meshlet. */
+    static const size_t MAX_VERTICES = 64;
+
+    /** The default maximal number of triangles per meshlet. */
+    static const size_t MAX_TRIANGLES = 124;
+
+    /**
+     * Partitions a range of triangles into meshlets and computes their bounding spheres and normal cones.
+     *
+     * @param 	vertices		   	The interleaved float vertices, the position is the first attribute.
+     * @param 	elements_per_vertex	The number of floats per vertex.
+     * @param 	indices			   	[in,out] The indices of the whole mesh, the triangles of the range are reordered.
+     * @param 	first_index		   	The first index of the partitioned range (e.g., of a level of detail).
+     * @param 	index_count		   	The number of indices of the partitioned range.
+     * @param 	max_vertices	   	The maximal number of unique vertices per meshlet.
+     * @param 	max_triangles	   	The maximal number of triangles per meshlet.
+     *
+     * @return	The meshlets covering the range, their index ranges refer to the whole index buffer.
+     */
+    static std::vector<Meshlet> build(std::span<const float> vertices, int elements_per_vertex, std::span<uint32_t> indices,
+                                      size_t first_index, size_t index_count, size_t max_vertices = MAX_VERTICES,
+                                      size_t max_triangles = MAX_TRIANGLES);
+
+    /**
+     * Computes the bounding sphere and the normal cone of a meshlet from its index range.
+     *
+     * @param 	vertices		   	The interleaved float vertices, the position is the first attribute.
+     * @param 	elements_per_vertex	The number of floats per vertex.
+     * @param 	indices			   	The indices of the whole mesh.
+     * @param 	meshlet			   	[in,out] The meshlet whose index range is set.
+     */
+    static void compute_bounds(std::span<const float> vertices, int elements_per_vertex, std::span<const uint32_t> indices,
+                               Meshlet& meshlet);
+};
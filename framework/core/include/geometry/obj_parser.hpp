@@ -0,0 +1,96 @@
+#pragma once
+
+#include "utils/thread_pool.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/** A corner of an OBJ face: the indices into the lists of positions, texture coordinates, and normals (-1 if missing). */
+struct ObjCorner {
+    int32_t position = -1;
+    int32_t tex_coord = -1;
+    int32_t normal = -1;
+};
+
+/** A run of triangles sharing the shape (started by o or g) and the material (set by usemtl). */
+struct ObjGroup {
+    /** The name of the object or group. */
+    std::string object;
+    /** The name of the material, empty if none was set. */
+    std::string material;
+    /** The index of the shape, increased by every o or g statement followed by faces. */
+    size_t shape = 0;
+    /** The first corner of the group in @link ObjData::corners. */
+    size_t first_corner = 0;
+    /** The number of corners of the group (3 per triangle). */
+    size_t corner_count = 0;
+};
+
+/** The contents of an OBJ file, the faces are triangulated. */
+struct ObjData {
+    /** The positions (3 floats each). */
+    std::vector<float> positions;
+    /** The normals (3 floats each). */
+    std::vector<float> normals;
+    /** The texture coordinates (2 floats each). */
+    std::vector<float> tex_coords;
+    /** The corners of the triangles. */
+    std::vector<ObjCorner> corners;
+    /** The non-empty groups in the order of the file. */
+    std::vector<ObjGroup> groups;
+    /** The material library referenced by mtllib (empty if none). */
+    std::string material_library;
+};
+
+/**
+ * The class providing static utility methods loading Wavefront OBJ files.
+ * <p>
+ * The file is memory-mapped and split into line-aligned chunks parsed in parallel. The parsing runs in two passes: the
+ * first pass counts the elements of each chunk, so that the second pass writes directly into the final arrays at the
+ * offsets of the chunk (the relative indices are resolved using the counts of the preceding chunks). The numbers are
+ * parsed by std::from_chars, which avoids the locale handling of the stream based parsers.
+ * <p>
+ * Only the geometry statements (v, vt, vn, f) and the grouping statements (o, g, usemtl, mtllib) are supported,
+ * polygons are triangulated as fans.
+ */
+class ObjParser {
+  public:
+    /**
+     * Parses an OBJ file.
+     *
+     * @param 	path	The path to the file.
+     * @param 	data	[out] The contents of the file.
+     * @param 	pool	The pool parsing the chunks.
+     *
+     * @return	@p true if the file could be read.
+     */
+    static bool parse(const std::filesystem::path& path, ObjData& data, ThreadPool& pool = ThreadPool::get_default());
+
+    /**
+     * Parses the text of an OBJ file.
+     *
+     * @param 	text	The contents of the file.
+     * @param 	data	[out] The parsed data.
+     * @param 	pool	The pool parsing the chunks.
+     */
+    static void parse_text(std::string_view text, ObjData& data, ThreadPool& pool = ThreadPool::get_default());
+
+    /**
+     * Builds an indexed mesh from a range of the triangles. Corners with the same position, texture coordinates, and
+     * normal are welded into a single vertex and the vertices are written interleaved (position, normal, texture
+     * coordinates, i.e., 8 floats per vertex; missing attributes are zero).
+     *
+     * @param 	data		 	The parsed OBJ file.
+     * @param 	first_corner 	The first corner of the range.
+     * @param 	corner_count 	The number of corners of the range.
+     * @param 	fit_unit_box 	If @p true, the positions are centered and scaled to fit into a unit box.
+     * @param 	vertices	 	[out] The interleaved vertices.
+     * @param 	indices		 	[out] The indices of the triangles.
+     * @param 	pool		 	The pool writing the vertices.
+     */
+    static void build_mesh(const ObjData& data, size_t first_corner, size_t corner_count, bool fit_unit_box,
+                           std::vector<float>& vertices, std::vector<uint32_t>& indices,
+                           ThreadPool& pool = ThreadPool::get_default());
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/** The layout of the vertex data stored in the GPU buffers. */
+enum class VertexFormat {
+    /** All attributes are stored as 32-bit floats (up to 56 bytes per vertex). */
+    FLOAT,
+    /**
+     * The compact layout (up to 24 bytes per vertex): positions are 16-bit normalized integers relative to the bounding
+     * box of the mesh, normals, tangents, and bitangents are octahedral 2x16-bit normalized integers, and texture
+     * coordinates are half floats. Indices are stored as 16-bit integers if the number of vertices allows it.
+     */
+    QUANTIZED
+};
+
+/**
+ * The constants needed to decode quantized positions: position = offset + scale * quantized_position. The constants are
+ * stored right after the vertices and fetched by a vertex buffer binding with zero stride, so every vertex of the
+ * geometry reads the same values. The w component of the scale is 0 to let shaders distinguish quantized geometries
+ * from float ones (a disabled attribute reads (0, 0, 0, 1)).
+ */
+struct QuantizationConstants {
+    /** The half size of the bounding box, w is 0. */
+    glm::vec4 scale = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+    /** The center of the bounding box. */
+    glm::vec4 offset = glm::vec4(0.0f);
+};
+
+/**
+ * The class providing a collection of static utility methods converting float vertices into the compact
+ * @link VertexFormat::QUANTIZED layout.
+ * <p>
+ * The attributes of the quantized vertex (in the order of the float layout, each present only if the float layout has
+ * it):
+ * <code>
+ *  position	3x GL_SHORT (normalized) + 2 bytes padding	[ 0 -  8) bytes
+ *  normal		2x GL_SHORT (normalized, octahedral)		[ 8 - 12) bytes
+ *  tex_coord	2x GL_HALF_FLOAT							[12 - 16) bytes
+ *  tangent		2x GL_SHORT (normalized, octahedral)		[16 - 20) bytes
+ *  bitangent	2x GL_SHORT (normalized, octahedral)		[20 - 24) bytes
+ * </code>
+ * The decoding functions for shaders are in quantization.glsl.
+ */
+class VertexQuantization {
+  public:
+    /** The offset (in bytes) of the normal in a quantized vertex. */
+    static const int NORMAL_OFFSET = 8;
+    /** The offset (in bytes) of the texture coordinates in a quantized vertex. */
+    static const int TEX_COORD_OFFSET = 12;
+    /** The offset (in bytes) of the tangent in a quantized vertex. */
+    static const int TANGENT_OFFSET = 16;
+    /** The offset (in bytes) of the bitangent in a quantized vertex. */
+    static const int BITANGENT_OFFSET = 20;
+
+    /**
+     * Returns the size (in bytes) of a quantized vertex.
+     *
+     * @param 	elements_per_vertex	The number of floats per vertex of the float layout (3, 6, 8, 11, or 14).
+     */
+    static int get_stride(int elements_per_vertex);
+
+    /**
+     * Encodes a unit vector into two values in [-1, 1] using the octahedral mapping.
+     *
+     * @param 	direction	The direction to encode (zero vectors are encoded as +Z).
+     */
+    static glm::vec2 octahedral_encode(glm::vec3 direction);
+
+    /**
+     * Decodes a unit vector encoded by @link octahedral_encode.
+     *
+     * @param 	encoded	The encoded direction.
+     */
+    static glm::vec3 octahedral_decode(glm::vec2 encoded);
+
+    /**
+     * Converts interleaved float vertices into the quantized layout. The positions are quantized relative to the
+     * bounding box of all vertices.
+     *
+     * @param 	vertices		   	The interleaved float vertices.
+     * @param 	elements_per_vertex	The number of floats per vertex.
+     * @param 	constants		   	[out] The constants decoding the positions.
+     *
+     * @return	The quantized vertices.
+     */
+    static std::vector<uint8_t> quantize(std::span<const float> vertices, int elements_per_vertex, QuantizationConstants& constants);
+
+    /**
+     * Converts 32-bit indices into 16-bit ones. The caller is responsible for checking that all indices fit.
+     *
+     * @param 	indices	The indices to convert.
+     *
+     * @return	The narrowed indices.
+     */
+    static std::vector<uint16_t> narrow_indices(std::span<const uint32_t> indices);
+};
@@ -2,7 +2,10 @@
 
 #define GLFW_INCLUDE_NONE
 #include "GLFW/glfw3.h"
+#include "frame_capture.hpp"
 #include "iapplication.hpp"
+#include <filesystem>
+#include <memory>
 #include <string>
 
 /**
@@ -28,6 +31,18 @@ class OpenGLManager {
     /** The number of sampling points per fragment, to be used with GLFW_SAMPLES. */
     int samples_per_pixel = 1;
 
+    /** The capture of the rendered frames, @p nullptr if the frames are not captured. */
+    std::unique_ptr<FrameCapture> frame_capture;
+
+    /** The format of the images written by the captures toggled by the F9 key. */
+    CaptureFormat capture_format = CaptureFormat::QOI;
+
+    /** The flag determining if the F9 key was down in the previous frame. */
+    bool capture_key_down = false;
+
+    /** The flag determining if the F10 key was down in the previous frame. */
+    bool profile_key_down = false;
+
     // ----------------------------------------------------------------------------
     // Methods
     // ----------------------------------------------------------------------------
@@ -46,12 +61,50 @@ class OpenGLManager {
     /** This method invokes an infinite loop and renders the provided application every frame. */
     void run(IApplication& application);
 
-    /** Terminates the GLFW and free the allocated resource.  */
+    /** Terminates the GLFW and free the allocated resource (including the default @link BufferArena). */
     void terminate();
 
     /** Prints some basic information about the current HW and loaded OpenGL context. */
     void print_info() const;
 
+    /**
+     * Starts capturing the frames rendered by @link run into a sequence of images (see @link FrameCapture), the
+     * previous capture is stopped. The images contain the rendered scene without the ImGui user interface. The
+     * captures can be also toggled by the F9 key, which writes them into the 'captures' directory in the working
+     * directory.
+     *
+     * @param 	directory	The directory receiving the images.
+     * @param 	format   	The format of the images.
+     */
+    void start_capture(const std::filesystem::path& directory, CaptureFormat format);
+
+    /** Stops capturing the frames, waits until all captured frames are written. */
+    void stop_capture();
+
+    /**
+     * Starts recording the CPU zones of all threads into a Chrome trace (see @link CpuProfiler), the previous session
+     * is ended. The sessions can be also toggled by the F10 key, which writes them into the 'profiles' directory in
+     * the working directory.
+     *
+     * @param 	path	The path of the trace file.
+     */
+    void start_profiling(const std::filesystem::path& path);
+
+    /** Stops recording the CPU zones and writes the rest of the trace. */
+    void stop_profiling();
+
+  protected:
+    /** Toggles the capture when the F9 key is pressed. */
+    void update_capture_key();
+
+    /** Toggles the profiling session when the F10 key is pressed. */
+    void update_profile_key();
+
+    /** Shows the progress of the capture (including the dropped frames) in the corner of the window. */
+    void render_capture_overlay() const;
+
+  public:
+
     /**
      * The OpenGL debug message callback.
      *
@@ -145,4 +198,14 @@ class OpenGLManager {
      * @param 	samples 	The number of sampling points per pixel.
      */
     void set_multisampling_per_pixel(int samples) { samples_per_pixel = samples; }
+
+    /** Checks if the rendered frames are being captured. */
+    bool is_capturing() const { return frame_capture != nullptr; }
+
+    /**
+     * Sets the format of the images written by the captures toggled by the F9 key.
+     *
+     * @param 	format	The format of the images.
+     */
+    void set_capture_format(CaptureFormat format) { capture_format = format; }
 };
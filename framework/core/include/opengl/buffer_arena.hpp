@@ -0,0 +1,232 @@
+#pragma once
+
+#include "glad.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+/**
+ * The sub-allocator of GPU memory. Instead of creating a separate OpenGL buffer for every small piece of data (e.g.,
+ * vertices and indices of each geometry), the arena creates a few large buffers with immutable storage (pages) and
+ * hands out ranges of them.
+ * <p>
+ * Free ranges of each page are kept in an ordered map, so that neighbouring ranges are coalesced when an allocation
+ * is freed. Allocations are served using the best-fit strategy across all pages, a new page is created only when no
+ * free range is large enough.
+ * <p>
+ * The allocations are referred to using handles, since @link BufferArena::defragment may move them. Each
+ * defragmentation increments the arena generation, so users can cheaply detect that they need to query the new
+ * ranges (see @link BufferArena::get_generation).
+ *
+ * Example:
+ * <code>
+ *  BufferArena& arena = BufferArena::get_default();
+ *  BufferArena::Handle handle = arena.allocate(sizeof(float) * vertices.size(), 16, vertices.data());
+ *  BufferArena::Range range = arena.get_range(handle);
+ *  glVertexArrayVertexBuffer(vao, 0, range.buffer, range.offset, stride);
+ *  ...
+ *  arena.free(handle);
+ * </code>
+ */
+class BufferArena {
+    // ----------------------------------------------------------------------------
+    // Types
+    // ----------------------------------------------------------------------------
+  public:
+    /** The identifier of an allocation within the arena. */
+    using Handle = uint32_t;
+
+    /** The value representing no allocation. */
+    static const Handle INVALID_HANDLE = UINT32_MAX;
+
+    /** The range of an OpenGL buffer occupied by an allocation. */
+    struct Range {
+        /** The OpenGL buffer (page) storing the data. */
+        GLuint buffer = 0;
+        /** The offset (in bytes) of the data within the buffer. */
+        GLintptr offset = 0;
+        /** The size (in bytes) of the data. */
+        GLsizeiptr size = 0;
+    };
+
+    /** The usage statistics of the arena. */
+    struct Statistics {
+        /** The number of pages, i.e., the number of OpenGL buffers. */
+        size_t page_count = 0;
+        /** The total size (in bytes) of all pages. */
+        size_t reserved_bytes = 0;
+        /** The number of bytes occupied by allocations (including alignment padding). */
+        size_t used_bytes = 0;
+        /** The number of live allocations. */
+        size_t allocation_count = 0;
+        /** The number of free ranges, a high number indicates fragmentation. */
+        size_t free_block_count = 0;
+        /** The size (in bytes) of the largest free range. */
+        size_t largest_free_block = 0;
+    };
+
+  protected:
+    /** The single large OpenGL buffer that is sub-allocated. */
+    struct Page {
+        /** The OpenGL buffer, 0 if the page was released. */
+        GLuint buffer = 0;
+        /** The size of the buffer in bytes. */
+        GLsizeiptr size = 0;
+        /** The free ranges of the page: offset -> size. */
+        std::map<GLintptr, GLsizeiptr> free_blocks;
+        /** The number of allocations within this page. */
+        size_t allocation_count = 0;
+    };
+
+    /** The information about a single allocation. */
+    struct Allocation {
+        /** The index of the page in @link pages. */
+        uint32_t page = 0;
+        /** The offset of the allocation (aligned). */
+        GLintptr offset = 0;
+        /** The beginning of the occupied range, i.e., the offset before alignment. */
+        GLintptr block_offset = 0;
+        /** The size of the occupied range, i.e., the size including the alignment padding. */
+        GLsizeiptr block_size = 0;
+        /** The requested size. */
+        GLsizeiptr size = 0;
+        /** The requested alignment. */
+        GLsizeiptr alignment = 1;
+        /** The flag determining if the handle is in use. */
+        bool live = false;
+    };
+
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+  protected:
+    /** The size of newly created pages. */
+    GLsizeiptr page_size;
+
+    /** The flags used for glNamedBufferStorage of all pages. */
+    GLbitfield storage_flags;
+
+    /** The pages of the arena. Released pages stay in the list (with buffer set to 0) to keep the indices stable. */
+    std::vector<Page> pages;
+
+    /** All allocations indexed by their handles. */
+    std::vector<Allocation> allocations;
+
+    /** The handles that can be reused. */
+    std::vector<Handle> free_handles;
+
+    /** All free ranges of all pages ordered by their size: size -> (page, offset). Used for the best-fit search. */
+    std::multimap<GLsizeiptr, std::pair<uint32_t, GLintptr>> free_by_size;
+
+    /** The generation that is incremented every time the allocations are moved. */
+    uint64_t generation = 0;
+
+    /** The flag determining if the OpenGL objects were already released. */
+    bool released = false;
+
+    /** The default arena shared by the geometries. */
+    static std::shared_ptr<BufferArena> default_arena;
+
+    // ----------------------------------------------------------------------------
+    // Constructors
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Constructs a new empty @link BufferArena. The pages are created lazily.
+     *
+     * @param 	page_size	 	The size (in bytes) of the pages.
+     * @param 	storage_flags	The flags passed to glNamedBufferStorage, GL_DYNAMIC_STORAGE_BIT is needed for
+     * 							@link upload.
+     */
+    BufferArena(GLsizeiptr page_size = 32 * 1024 * 1024, GLbitfield storage_flags = GL_DYNAMIC_STORAGE_BIT);
+
+    BufferArena(const BufferArena& other) = delete;
+    BufferArena& operator=(const BufferArena& other) = delete;
+
+    /** Destroys this @link BufferArena together with all its pages. */
+    ~BufferArena();
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Allocates a range of GPU memory.
+     *
+     * @param 	size	 	The size of the allocation in bytes.
+     * @param 	alignment	The required alignment of the offset (a power of two).
+     * @param 	data	 	The optional data to upload into the allocated range.
+     *
+     * @return	The handle of the allocation.
+     */
+    Handle allocate(GLsizeiptr size, GLsizeiptr alignment = 16, const void* data = nullptr);
+
+    /**
+     * Frees the allocation. Freeing an invalid handle or freeing after the arena was released does nothing.
+     *
+     * @param 	handle	The handle of the allocation.
+     */
+    void free(Handle handle);
+
+    /**
+     * Uploads data into an allocation.
+     *
+     * @param 	handle	The handle of the allocation.
+     * @param 	offset	The offset (in bytes) relative to the beginning of the allocation.
+     * @param 	size  	The size (in bytes) of the data.
+     * @param 	data  	The data to upload.
+     */
+    void upload(Handle handle, GLintptr offset, GLsizeiptr size, const void* data) const;
+
+    /**
+     * Compacts the allocations of each page into the beginning of the page and releases the pages that are empty. The
+     * allocations keep their handles but their ranges change, so the generation of the arena is incremented.
+     */
+    void defragment();
+
+    /** Deletes all pages. The arena must not be used for allocation afterwards. */
+    void release();
+
+    /** Returns the usage statistics of the arena. */
+    Statistics get_statistics() const;
+
+    /** Returns the default arena (created on the first call). */
+    static std::shared_ptr<BufferArena> get_default();
+
+    /**
+     * Releases the default arena. The method has to be called while the OpenGL context still exists (see
+     * @link OpenGLManager::terminate).
+     */
+    static void release_default();
+
+  protected:
+    /**
+     * Creates a new page.
+     *
+     * @param 	size	The minimal size of the page.
+     *
+     * @return	The index of the page.
+     */
+    uint32_t create_page(GLsizeiptr size);
+
+    /** Adds a free range into the page and coalesces it with its neighbours. */
+    void insert_free_block(uint32_t page, GLintptr offset, GLsizeiptr size);
+
+    /** Removes a free range from the size index. */
+    void erase_from_size_index(uint32_t page, GLintptr offset, GLsizeiptr size);
+
+    // ----------------------------------------------------------------------------
+    // Getters & Setters
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Returns the range occupied by an allocation.
+     *
+     * @param 	handle	The handle of the allocation.
+     */
+    Range get_range(Handle handle) const;
+
+    /** Returns the generation that changes every time the allocations are moved. */
+    uint64_t get_generation() const { return generation; }
+};
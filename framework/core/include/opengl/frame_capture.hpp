@@ -0,0 +1,202 @@
+#pragma once
+
+#include "texture_readback.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** The format of the images written by @link FrameCapture. */
+enum class CaptureFormat {
+    /** The pixels as they are (RGBA8, rows from the top), the fastest to write but the largest. */
+    RAW,
+    /** The PNG images (RGB8), the smallest but the slowest to encode. */
+    PNG,
+    /** The QOI images (RGB8), nearly as small as PNG and an order of magnitude faster to encode. */
+    QOI
+};
+
+/**
+ * The recorder of the rendered frames into a sequence of images. Every frame, @link capture queues an asynchronous
+ * copy of the back buffer (see @link TextureReadback) and collects the copies of the older frames that the GPU has
+ * finished. The collected frames are handed to dedicated encoder threads, which convert them into the selected format
+ * and write them as 'frame_000000.<ext>' into the capture directory. The frames are encoded independently, so a
+ * format too slow for a single thread at the frame rate (e.g., QOI at 1080p60) is spread over several of them.
+ * <p>
+ * Neither the copies nor the encoder queue ever block the rendering: if the GPU still processes too many copies, or
+ * the encoders fall behind and their queue is full, the frame is dropped and counted instead (see
+ * @link get_dropped_count). The numbers of the written files follow the captured frames, so the dropped frames leave
+ * gaps in the sequence.
+ * <p>
+ * All methods must be called from the thread owning the OpenGL context.
+ *
+ * Example:
+ * <code>
+ *  FrameCapture capture("captures/demo", CaptureFormat::QOI);
+ *  ...
+ *  // every frame, after rendering the scene and before drawing the user interface
+ *  capture.capture(width, height);
+ * </code>
+ */
+class FrameCapture {
+    // ----------------------------------------------------------------------------
+    // Types
+    // ----------------------------------------------------------------------------
+  protected:
+    /** A frame waiting for the encoders. */
+    struct Frame {
+        /** The number of the frame since the start of the capture. */
+        uint64_t number = 0;
+        /** The width of the frame. */
+        int width = 0;
+        /** The height of the frame. */
+        int height = 0;
+        /** The RGBA8 pixels of the frame, rows from the bottom as read by OpenGL. */
+        std::vector<uint8_t> pixels;
+    };
+
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+  protected:
+    /** The directory receiving the images. */
+    std::filesystem::path directory;
+
+    /** The format of the images. */
+    CaptureFormat format;
+
+    /** The maximal number of frames copied by the GPU at the same time. */
+    size_t max_pending_copies;
+
+    /** The maximal number of frames waiting for the encoders. */
+    size_t max_queued_frames;
+
+    /** The readback copying the frames. */
+    TextureReadback readback;
+
+    /** The framebuffer resolving the multisampled back buffer, 0 if not needed yet. */
+    GLuint resolve_framebuffer = 0;
+
+    /** The color attachment of the resolve framebuffer. */
+    GLuint resolve_renderbuffer = 0;
+
+    /** The size of the resolve framebuffer. */
+    int resolve_width = 0, resolve_height = 0;
+
+    /** The number of frames passed to @link capture. */
+    uint64_t frame_count = 0;
+
+    /** The number of frames dropped because the GPU or the encoders fell behind. */
+    uint64_t dropped_count = 0;
+
+    /** The mutex guarding the variables shared with the encoder threads (below). */
+    mutable std::mutex mutex;
+
+    /** The condition notifying the encoder threads about new frames. */
+    std::condition_variable condition;
+
+    /** The frames waiting for the encoders. */
+    std::deque<Frame> queue;
+
+    /** The pixel arrays of the written frames, reused by the next frames. */
+    std::vector<std::vector<uint8_t>> free_pixels;
+
+    /** The number of written images. */
+    uint64_t written_count = 0;
+
+    /** The number of images that could not be written. */
+    uint64_t failed_count = 0;
+
+    /** The flag telling the encoder threads to finish once the queue is empty. */
+    bool stopping = false;
+
+    /** The encoder threads. */
+    std::vector<std::thread> encoders;
+
+    // ----------------------------------------------------------------------------
+    // Constructors
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Constructs a new @link FrameCapture, creates the directory and starts the encoder threads.
+     *
+     * @param 	directory         	The directory receiving the images.
+     * @param 	format            	The format of the images.
+     * @param 	encoder_count     	The number of encoder threads.
+     * @param 	max_pending_copies	The maximal number of frames copied by the GPU at the same time.
+     * @param 	max_queued_frames 	The maximal number of frames waiting for the encoders.
+     */
+    FrameCapture(std::filesystem::path directory, CaptureFormat format, size_t encoder_count = 2, size_t max_pending_copies = 3,
+                 size_t max_queued_frames = 8);
+
+    FrameCapture(const FrameCapture& other) = delete;
+    FrameCapture& operator=(const FrameCapture& other) = delete;
+
+    /** Destroys this @link FrameCapture, waits for the pending copies and until the encoders write all queued frames. */
+    ~FrameCapture();
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Queues a copy of the back buffer of the default framebuffer and hands the finished copies to the encoders. Call
+     * once per frame, after rendering the scene and before drawing the user interface (or swapping the buffers).
+     *
+     * @param 	width 	The width of the framebuffer (in pixels).
+     * @param 	height	The height of the framebuffer (in pixels).
+     */
+    void capture(int width, int height);
+
+    /**
+     * Encodes an image into the QOI format (see https://qoiformat.org).
+     *
+     * @param 	rgba  	The RGBA8 pixels, rows from the bottom; the alpha channel is ignored.
+     * @param 	width 	The width of the image.
+     * @param 	height	The height of the image.
+     *
+     * @return	The QOI file with three channels, rows from the top.
+     */
+    static std::vector<uint8_t> encode_qoi(const uint8_t* rgba, int width, int height);
+
+    /** Returns the extension of the files of the format (without the dot). */
+    static const char* get_extension(CaptureFormat format);
+
+  protected:
+    /** Copies a finished frame into the queue of the encoders, or drops it if the queue is full. */
+    void enqueue(uint64_t number, int width, int height, const uint8_t* data, size_t size);
+
+    /** The body of the encoder threads. */
+    void encode_frames();
+
+    /** Writes a frame into its file, returns @p false on failure. */
+    bool write_frame(const Frame& frame) const;
+
+    // ----------------------------------------------------------------------------
+    // Getters & Setters
+    // ----------------------------------------------------------------------------
+  public:
+    /** Returns the directory receiving the images. */
+    const std::filesystem::path& get_directory() const { return directory; }
+
+    /** Returns the format of the images. */
+    CaptureFormat get_format() const { return format; }
+
+    /** Returns the number of frames passed to @link capture. */
+    uint64_t get_frame_count() const { return frame_count; }
+
+    /** Returns the number of frames dropped because the GPU or the encoders fell behind. */
+    uint64_t get_dropped_count() const { return dropped_count; }
+
+    /** Returns the number of frames waiting for the encoders. */
+    size_t get_queued_count() const;
+
+    /** Returns the number of written images. */
+    uint64_t get_written_count() const;
+
+    /** Returns the number of images that could not be written. */
+    uint64_t get_failed_count() const;
+};
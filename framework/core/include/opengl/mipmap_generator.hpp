@@ -0,0 +1,70 @@
+#pragma once
+
+#include "utils/thread_pool.hpp"
+#include <cstdint>
+#include <vector>
+
+/** The filter generating the levels of a mip chain. */
+enum class MipmapFilter {
+    /** The average of the covered pixels (2x2 for even sizes), fast and free of ringing. */
+    BOX,
+    /** The Kaiser-windowed sinc over 8x8 pixels, keeps the distant levels sharper at the cost of a slight ringing. */
+    KAISER
+};
+
+/**
+ * The class providing static utility methods generating mip chains of RGBA8 images on the CPU, so the chains can be
+ * cached with the transcoded textures or uploaded level by level instead of being generated by the driver.
+ * <p>
+ * Every level is filtered from the previous one by a separable filter whose weights are computed once per level. The
+ * rows of a level are distributed over the thread pool, and the pixels are accumulated as four floats in SSE registers
+ * (with a scalar fallback on other platforms).
+ * <p>
+ * Gamma-encoded colors are averaged in linear space: the RGB channels are decoded from sRGB through a table before the
+ * filtering and encoded back afterwards, so the distant levels keep the brightness of the image instead of darkening
+ * its high-contrast details. The alpha channel and the images holding data (e.g., normals or masks) are filtered as
+ * they are.
+ *
+ * Example:
+ * <code>
+ *  std::vector<std::vector<uint8_t>> levels = MipmapGenerator::generate(std::move(rgba), width, height,
+ *                                                                       MipmapGenerator::get_level_count(width, height),
+ *                                                                       MipmapFilter::KAISER, true);
+ * </code>
+ */
+class MipmapGenerator {
+  public:
+    /**
+     * Generates the mip chain of an image.
+     *
+     * @param 	rgba  	The pixels of the image (4 bytes per pixel, rows from the top), moved into the first level.
+     * @param 	width 	The width of the image.
+     * @param 	height	The height of the image.
+     * @param 	levels	The number of levels to generate including the image itself (see @link get_level_count).
+     * @param 	filter	The filter computing the levels.
+     * @param 	srgb  	If @p true, the RGB channels hold sRGB-encoded colors and are averaged in linear space.
+     * @param 	pool  	The pool filtering the rows.
+     *
+     * @return	The levels ordered from the most detailed one, each level is max(1, previous / 2) in both dimensions.
+     */
+    static std::vector<std::vector<uint8_t>> generate(std::vector<uint8_t> rgba, int width, int height, int levels, MipmapFilter filter,
+                                                      bool srgb, ThreadPool& pool = ThreadPool::get_default());
+
+    /**
+     * Downsamples an RGBA8 image to half of its size.
+     *
+     * @param 	rgba  	The pixels of the image (4 bytes per pixel, rows from the top).
+     * @param 	width 	The width of the image.
+     * @param 	height	The height of the image.
+     * @param 	filter	The filter computing the pixels.
+     * @param 	srgb  	If @p true, the RGB channels hold sRGB-encoded colors and are averaged in linear space.
+     * @param 	pool  	The pool filtering the rows.
+     *
+     * @return	The pixels of the downsampled image (max(1, width / 2) x max(1, height / 2)).
+     */
+    static std::vector<uint8_t> downsample(const uint8_t* rgba, int width, int height, MipmapFilter filter, bool srgb,
+                                           ThreadPool& pool = ThreadPool::get_default());
+
+    /** Returns the number of levels of the full mip chain of an image with the given size (down to 1x1). */
+    static int get_level_count(int width, int height);
+};
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include "shader.hpp"
+#include "utils/gl_object_tracker.hpp"
 
 #include <array>
 #include <filesystem>
@@ -70,6 +71,7 @@ class ShaderProgram {
 
     ShaderProgram(const ShaderProgram& other) : shaders(other.shaders) {
         program = glCreateProgram();
+        GLObjectTracker::on_create(GLObjectType::PROGRAM, program);
 
         for (const Shader& shader : other.shaders) {
             add_shader(shader.shader_type, shader.file_path);
@@ -2,17 +2,88 @@
 
 #include "color.hpp"
 #include "opengl_object.hpp"
+#include "texture_readback.hpp"
+#include "utils/frame_counters.hpp"
+#include "utils/gl_object_tracker.hpp"
+#include "utils/thread_pool.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <span>
 #include <vector>
 
+/** The 16-bit floating point value (IEEE 754 binary16) stored by the textures with GL_HALF_FLOAT data. */
+struct Half {
+    /** The bits of the value. */
+    uint16_t bits = 0;
+};
+
+/**
+ * The properties of a type storing the channels of a @link TypedTexture: the OpenGL type of the pixel data and the
+ * conversion from and to the float values used by @link Color (0.0 - 1.0 for normalized types).
+ */
+template <typename T> struct TexelTraits;
+
+template <> struct TexelTraits<float> {
+    static constexpr GLenum type = GL_FLOAT;
+    static float from_float(float value) { return value; }
+    static float to_float(float value) { return value; }
+};
+
+template <> struct TexelTraits<uint8_t> {
+    static constexpr GLenum type = GL_UNSIGNED_BYTE;
+    static uint8_t from_float(float value) { return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f); }
+    static float to_float(uint8_t value) { return value / 255.0f; }
+};
+
+template <> struct TexelTraits<Half> {
+    static constexpr GLenum type = GL_HALF_FLOAT;
+    static Half from_float(float value);
+    static float to_float(Half value);
+};
+
+/**
+ * The class providing static utility methods processing rows of texture data, used by the bulk operations of
+ * @link TypedTexture. The methods use SSE2 where available and plain loops otherwise.
+ */
+class TextureOperations {
+  public:
+    /** Converts the values of one type into another one (see @link TexelTraits). */
+    static void convert(const float* source, float* target, size_t count);
+    static void convert(const float* source, uint8_t* target, size_t count);
+    static void convert(const uint8_t* source, float* target, size_t count);
+    static void convert(const float* source, Half* target, size_t count);
+    static void convert(const Half* source, float* target, size_t count);
+
+    /**
+     * Convolves a row of pixels by a kernel, the pixels outside the row repeat the edge.
+     *
+     * @param 	source  	The values of the row (width * channels floats).
+     * @param 	target  	[out] The convolved values (width * channels floats).
+     * @param 	width   	The number of pixels.
+     * @param 	channels	The number of channels per pixel.
+     * @param 	kernel  	The weights of the kernel (odd length, centered).
+     */
+    static void convolve_row(const float* source, float* target, int width, int channels, std::span<const float> kernel);
+
+    /** Adds the values of the source multiplied by the weight to the target. */
+    static void accumulate(const float* source, float* target, size_t count, float weight);
+};
+
 /**
  * The base class for representing textures.
  * <p>
+ * The CPU copy of the data stores the channels as @p T (float, uint8_t, or @link Half), the number of channels is
+ * given by the format (GL_RED and GL_DEPTH_COMPONENT have 1, GL_RG 2, GL_RGB 3, and GL_RGBA 4). The per-pixel methods
+ * check the coordinates and convert the values on every call; the bulk operations (@link fill, @link copy,
+ * @link convert, @link convolve) process whole rows with SIMD instructions, in parallel over the rows.
+ * <p>
  * Note that this class requires OpenGL 4.5., for older OpenGL versions use the @p Texture_3_3 class available in PB009 module.
  *
  * @author	<a href="mailto:jan.byska@gmail.com">Jan Byška</a>
  */
-class Texture : public OpenGLObject {
+template <typename T> class TypedTexture : public OpenGLObject {
     // ----------------------------------------------------------------------------
     // Variables
     // ----------------------------------------------------------------------------
@@ -29,7 +100,7 @@ class Texture : public OpenGLObject {
     /** The format of the pixel data. */
     GLenum format;
 
-    /** The type of the pixel data. Current implementation supports only GL_FLOAT. */
+    /** The type of the pixel data, given by the storage type (see @link TexelTraits). */
     GLenum type;
 
     /** The number of color channels. */
@@ -42,27 +113,27 @@ class Texture : public OpenGLObject {
      * The array of pixels - the array is organized as list of rows with 'nrChannels' values per pixel. See
      * {@link get_index} method for more details.
      */
-    std::vector<float> texture_data;
+    std::vector<T> texture_data;
 
     // ----------------------------------------------------------------------------
     // Constructors
     // ----------------------------------------------------------------------------
   public:
-     /** Constructs a new @link Texture. */
-     Texture() : Texture(0,0){}
+     /** Constructs a new @link TypedTexture. */
+     TypedTexture() : TypedTexture(0,0){}
 
     /**
-     * Constructs a new @link Texture with specified size and default formats.
+     * Constructs a new @link TypedTexture with specified size and default formats.
      *
      * @param 	width   	The texture width.
      * @param 	height  	The texture height.
      * @param 	cpu_only	The flag determining if the texture will be CPU only (should be @p true for tests as they do
      * 						not have OpenGL context).
      */
-    Texture(int width, int height, bool cpu_only = false) : Texture(width, height, GL_RGBA8, GL_RGBA, cpu_only) {}
+    TypedTexture(int width, int height, bool cpu_only = false) : TypedTexture(width, height, GL_RGBA8, GL_RGBA, cpu_only) {}
 
     /**
-     * Constructs a new custom @link Texture and initialized the OpenGL counterpart.
+     * Constructs a new custom @link TypedTexture and initialized the OpenGL counterpart.
      *
      * @param 	width		   	The texture width.
      * @param 	height		   	The texture height.
@@ -71,33 +142,37 @@ class Texture : public OpenGLObject {
      * @param 	cpu_only	   	The flag determining if the texture will be CPU only (should be @p true for tests as they
      * 							do not have OpenGL context).
      */
-    Texture(int width, int height, GLint internal_format, GLenum format, bool cpu_only = false)
+    TypedTexture(int width, int height, GLint internal_format, GLenum format, bool cpu_only = false)
         : OpenGLObject(GL_TEXTURE_2D), width(width), height(height), internal_format(internal_format), format(format),
-          type(GL_FLOAT), cpu_only(cpu_only) {
-        // Creates the CPU representation of the data.
-        texture_data = std::vector<float>(width * height * nrChannels);
-        for (int x = 0; x < width; x++) {
-            for (int y = 0; y < height; y++) {
-                set_pixel_color(x, y, Color::WHITE);
-            }
-        }
-
+          type(TexelTraits<T>::type), cpu_only(cpu_only) {
         // Determine the number or channels used by the texture based on the specified format.
         switch (format) {
+        case GL_RED:
         case GL_DEPTH_COMPONENT:
             nrChannels = 1;
             break;
+        case GL_RG:
+            nrChannels = 2;
+            break;
+        case GL_RGB:
+            nrChannels = 3;
+            break;
         case GL_RGBA:
             nrChannels = 4;
             break;
         default:
-            std::cout << "The texture class currently supports only GL_DEPTH_COMPONENT and GL_RGBA formats." << std::endl;
+            std::cout << "The texture class currently supports only GL_RED, GL_RG, GL_RGB, GL_RGBA, and GL_DEPTH_COMPONENT formats." << std::endl;
         }
 
+        // Creates the CPU representation of the data, the channel count must be known at this point.
+        texture_data = std::vector<T>(static_cast<size_t>(width) * height * nrChannels);
+        fill(Color::WHITE);
+
         // Creates the GPU representation of the data.
         if (width > 0 && height > 0 && !cpu_only) {
             glCreateTextures(target, 1, &opengl_object);
             glTextureStorage2D(opengl_object, 1, internal_format, width, height);
+            GLObjectTracker::on_create(GLObjectType::TEXTURE, opengl_object, GLObjectTracker::get_texture_size(internal_format, width, height));
         }
     }
 
@@ -106,13 +181,14 @@ class Texture : public OpenGLObject {
      *
      * @param 	other	The other texture to copy from.
      */
-    Texture(const Texture& other)
+    TypedTexture(const TypedTexture& other)
         : OpenGLObject(GL_TEXTURE_2D), width(other.width), height(other.height), internal_format(other.internal_format),
-          format(other.format), type(GL_FLOAT), cpu_only(other.cpu_only), texture_data(other.texture_data) {
+          format(other.format), type(other.type), nrChannels(other.nrChannels), cpu_only(other.cpu_only), texture_data(other.texture_data) {
 
         if (width > 0 && height > 0 && !cpu_only) {
             glCreateTextures(target, 1, &opengl_object);
             glTextureStorage2D(opengl_object, 1, internal_format, width, height);
+            GLObjectTracker::on_create(GLObjectType::TEXTURE, opengl_object, GLObjectTracker::get_texture_size(internal_format, width, height));
             update_opengl_data();
         }
     }
@@ -124,7 +200,7 @@ class Texture : public OpenGLObject {
      *
      * @return	A shallow copy of this object.
      */
-    Texture& operator=(Texture other) {
+    TypedTexture& operator=(TypedTexture other) {
         swap(*this, other);
         return *this;
     }
@@ -135,14 +211,14 @@ class Texture : public OpenGLObject {
      *
      * @param 	other The other texture.
      */
-    Texture(Texture&& other) : Texture(0, 0) { swap(*this, other); }
+    TypedTexture(TypedTexture&& other) : TypedTexture(0, 0) { swap(*this, other); }
 
     /**
      * The custom swap method that exchanges the values of fields of two textures.
      * @param first The first texture.
      * @param second The second texture.
      */
-    friend void swap(Texture& first, Texture& second) noexcept {
+    friend void swap(TypedTexture& first, TypedTexture& second) noexcept {
         using std::swap;
 
         swap(first.opengl_object, second.opengl_object);
@@ -157,10 +233,11 @@ class Texture : public OpenGLObject {
     }
 
     /**
-     * Destroys this @link Texture.
+     * Destroys this @link TypedTexture.
      */
-    virtual ~Texture() {
+    virtual ~TypedTexture() {
         if (!cpu_only) {
+            GLObjectTracker::on_delete(GLObjectType::TEXTURE, opengl_object);
             glDeleteTextures(1, &opengl_object);
         }
     }
@@ -176,27 +253,53 @@ class Texture : public OpenGLObject {
      */
    virtual void bind(GLuint unit) const {
          glBindTextureUnit(unit, opengl_object);
+         FrameCounters::count_texture_binds();
      }
 
     /** @copydoc OpenGLObject::update_opengl_data */
    virtual void update_opengl_data() const override {
         if (opengl_object != 0) {
+            // The rows of 8-bit data are not always aligned to 4 bytes.
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
             glTextureSubImage2D(opengl_object, 0, 0, 0, width, height, format, type, texture_data.data());
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
         } else {
             // fail silently
         }
     }
 
-    /** Copies the data from GPU to CPU. */
+    /**
+     * Copies the data from GPU to CPU. The call waits until the GPU finishes all preceding commands, use
+     * @link update_cpu_data_async in frames that should not stall.
+     */
     void update_cpu_data() const {
         if (opengl_object != 0) {
-            glGetTextureImage(opengl_object, 0, format, type, width * height * nrChannels * sizeof(float),
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glGetTextureImage(opengl_object, 0, format, type, static_cast<GLsizei>(texture_data.size() * sizeof(T)),
                               (void*)&texture_data.data()[0]);
+            glPixelStorei(GL_PACK_ALIGNMENT, 4);
         } else {
             // fail silently
         }
     }
 
+    /**
+     * Queues a copy of the data from GPU to CPU, the data are written into the CPU storage by a later call of
+     * @link TextureReadback::update once the GPU executes the copy. The texture must not be destroyed, moved, or
+     * assigned to while the ticket is pending (see @link TextureReadback::cancel).
+     *
+     * @param 	readback	The readback executing the copy.
+     *
+     * @return	The ticket that becomes ready once the CPU storage holds the data.
+     */
+    TextureReadback::Ticket update_cpu_data_async(TextureReadback& readback) {
+        if (opengl_object == 0) {
+            return TextureReadback::Ticket();
+        }
+        return readback.read(opengl_object, 0, 0, 0, width, height, format, type, texture_data.size() * sizeof(T),
+                             [this](const uint8_t* data, size_t size) { std::memcpy(texture_data.data(), data, size); });
+    }
+
     /**
      * Sets the texture parameters by calling glTextureParameteri.
      *
@@ -216,6 +319,110 @@ class Texture : public OpenGLObject {
         }
     }
 
+    /**
+     * Sets all pixels to the color, the first row is filled pixel by pixel and copied into the others.
+     *
+     * @param 	color	The new color.
+     */
+    void fill(const Color& color) {
+        if (texture_data.empty()) {
+            return;
+        }
+        const T pixel[4] = {TexelTraits<T>::from_float(color.r), TexelTraits<T>::from_float(color.g),
+                            TexelTraits<T>::from_float(color.b), TexelTraits<T>::from_float(color.a)};
+        const std::span<T> first = get_row(0);
+        for (size_t i = 0; i < first.size(); i++) {
+            first[i] = pixel[i % nrChannels];
+        }
+        for_each_row([&](int y) { std::memcpy(get_row(y).data(), first.data(), first.size_bytes()); }, 1);
+    }
+
+    /**
+     * Copies a rectangle of pixels from another texture with the same number of channels, the rectangle is clipped to
+     * both textures.
+     *
+     * @param 	source  	The texture to copy from (may be this texture if the rectangles do not overlap).
+     * @param 	source_x	The X-coordinate of the rectangle in the source texture.
+     * @param 	source_y	The Y-coordinate of the rectangle in the source texture.
+     * @param 	width   	The width of the rectangle.
+     * @param 	height  	The height of the rectangle.
+     * @param 	target_x	The X-coordinate of the rectangle in this texture.
+     * @param 	target_y	The Y-coordinate of the rectangle in this texture.
+     */
+    void copy(const TypedTexture& source, int source_x, int source_y, int width, int height, int target_x, int target_y) {
+        if (source.nrChannels != nrChannels) {
+            std::cout << "The textures have different numbers of channels - nothing was copied." << std::endl;
+            return;
+        }
+        // Clips the rectangle to both textures.
+        const int left = std::max({0, -source_x, -target_x});
+        const int top = std::max({0, -source_y, -target_y});
+        const int right = std::min({width, source.width - source_x, this->width - target_x});
+        const int bottom = std::min({height, source.height - source_y, this->height - target_y});
+        if (left >= right || top >= bottom) {
+            return;
+        }
+        const size_t size = static_cast<size_t>(right - left) * nrChannels * sizeof(T);
+        ThreadPool::get_default().parallel_for(
+            static_cast<size_t>(bottom - top),
+            [&](size_t begin, size_t end) {
+                for (size_t y = begin + top; y < end + top; y++) {
+                    std::memcpy(&texture_data[get_index(target_x + left, target_y + static_cast<int>(y))],
+                                &source.texture_data[source.get_index(source_x + left, source_y + static_cast<int>(y))], size);
+                }
+            },
+            get_min_batch());
+    }
+
+    /**
+     * Converts the data of a texture with a different storage type but the same size and number of channels into this
+     * texture (normalized types map 0.0 - 1.0 to their range).
+     *
+     * @param 	source	The texture to convert.
+     */
+    template <typename U> void convert(const TypedTexture<U>& source) {
+        if (source.get_width() != width || source.get_height() != height || source.get_channel_count() != nrChannels) {
+            std::cout << "The textures have different sizes or numbers of channels - nothing was converted." << std::endl;
+            return;
+        }
+        for_each_row_buffered([&](int y, std::vector<float>& buffer) {
+            TextureOperations::convert(source.get_row(y).data(), buffer.data(), buffer.size());
+            TextureOperations::convert(buffer.data(), get_row(y).data(), buffer.size());
+        });
+    }
+
+    /**
+     * Convolves the texture by a separable kernel, the pixels outside the texture repeat the edge. E.g., the kernel
+     * {0.25, 0.5, 0.25} blurs the texture by a 3x3 tent filter.
+     *
+     * @param 	horizontal	The weights of the horizontal pass (odd length, centered).
+     * @param 	vertical  	The weights of the vertical pass (odd length, centered).
+     */
+    void convolve(std::span<const float> horizontal, std::span<const float> vertical) {
+        if (texture_data.empty() || horizontal.size() % 2 == 0 || vertical.size() % 2 == 0) {
+            return;
+        }
+        const size_t row_size = static_cast<size_t>(width) * nrChannels;
+        std::vector<float> rows(row_size * height);
+        for_each_row_buffered([&](int y, std::vector<float>& buffer) {
+            TextureOperations::convert(get_row(y).data(), buffer.data(), row_size);
+            TextureOperations::convolve_row(buffer.data(), &rows[y * row_size], width, nrChannels, horizontal);
+        });
+
+        const int radius = static_cast<int>(vertical.size() / 2);
+        for_each_row_buffered([&](int y, std::vector<float>& buffer) {
+            std::fill(buffer.begin(), buffer.end(), 0.0f);
+            for (int k = 0; k < static_cast<int>(vertical.size()); k++) {
+                const int row = std::clamp(y + k - radius, 0, height - 1);
+                TextureOperations::accumulate(&rows[row * row_size], buffer.data(), row_size, vertical[k]);
+            }
+            TextureOperations::convert(buffer.data(), get_row(y).data(), row_size);
+        });
+    }
+
+    /** Convolves the texture by a separable kernel used in both directions (see @link convolve). */
+    void convolve(std::span<const float> kernel) { convolve(kernel, kernel); }
+
   private:
     /**
      * Returns the first index (i.e., red channel) of the pixel at x,y in the data array. Use: getIndex(x,y) to get
@@ -227,7 +434,35 @@ class Texture : public OpenGLObject {
      *
      * @return	The corresponding index in the data array.
      */
-    int get_index(int x, int y) const { return (y * width + x) * nrChannels; }
+    size_t get_index(int x, int y) const { return (static_cast<size_t>(y) * width + x) * nrChannels; }
+
+    /** Returns the minimal number of rows processed by a single task of the bulk operations. */
+    size_t get_min_batch() const { return std::max<size_t>(1, 16384 / std::max<size_t>(1, static_cast<size_t>(width) * nrChannels)); }
+
+    /** Calls the function for every row (from the given one) in parallel. */
+    template <typename F> void for_each_row(F&& function, int first = 0) {
+        ThreadPool::get_default().parallel_for(
+            static_cast<size_t>(std::max(height - first, 0)),
+            [&](size_t begin, size_t end) {
+                for (size_t y = begin; y < end; y++) {
+                    function(static_cast<int>(y) + first);
+                }
+            },
+            get_min_batch());
+    }
+
+    /** Calls the function for every row in parallel, with a buffer of one row of floats per task. */
+    template <typename F> void for_each_row_buffered(F&& function) {
+        ThreadPool::get_default().parallel_for(
+            static_cast<size_t>(height),
+            [&](size_t begin, size_t end) {
+                std::vector<float> buffer(static_cast<size_t>(width) * nrChannels);
+                for (size_t y = begin; y < end; y++) {
+                    function(static_cast<int>(y), buffer);
+                }
+            },
+            get_min_batch());
+    }
 
     // ----------------------------------------------------------------------------
     // Getters & Setters
@@ -247,6 +482,23 @@ class Texture : public OpenGLObject {
      */
     int get_height() const { return this->height; }
 
+    /** Returns the number of channels per pixel. */
+    int get_channel_count() const { return nrChannels; }
+
+    /** Returns the data of all pixels, organized as rows with @link get_channel_count values per pixel. */
+    std::span<T> get_data() { return texture_data; }
+
+    /** @copydoc get_data */
+    std::span<const T> get_data() const { return texture_data; }
+
+    /** Returns the values of a row of pixels. */
+    std::span<T> get_row(int y) { return std::span<T>(texture_data).subspan(get_index(0, y), static_cast<size_t>(width) * nrChannels); }
+
+    /** @copydoc get_row */
+    std::span<const T> get_row(int y) const {
+        return std::span<const T>(texture_data).subspan(get_index(0, y), static_cast<size_t>(width) * nrChannels);
+    }
+
     /**
      * Sets the color of a pixel identified by the x (column) and y (row) coordinates.
      *
@@ -261,18 +513,8 @@ class Texture : public OpenGLObject {
         }
 
         const size_t index = this->get_index(x, y);
-
-        if (nrChannels >= 1) {
-            texture_data[index] = color.r;
-        }
-        if (nrChannels >= 2) {
-            texture_data[index + 1] = color.g;
-        }
-        if (nrChannels >= 3) {
-            texture_data[index + 2] = color.b;
-        }
-        if (nrChannels == 4) {
-            texture_data[index + 3] = color.a;
+        for (int c = 0; c < nrChannels; c++) {
+            texture_data[index + c] = TexelTraits<T>::from_float(color[c]);
         }
     }
 
@@ -287,20 +529,15 @@ class Texture : public OpenGLObject {
     void set_pixel_gray_scale(int x, int y, float intensity) {
         if (x < 0 || x >= this->get_width() || y < 0 || y >= this->get_height()) {
             std::cout << "The coordinates " << x << ", " << y << " are out of bounds - the color was not modified." << std::endl;
+            return;
         }
 
         const size_t index = this->get_index(x, y);
-        if (nrChannels >= 1) {
-            texture_data[index] = intensity;
-        }
-        if (nrChannels >= 2) {
-            texture_data[index + 1] = intensity;
-        }
-        if (nrChannels >= 3) {
-            texture_data[index + 2] = intensity;
+        for (int c = 0; c < std::min(nrChannels, 3); c++) {
+            texture_data[index + c] = TexelTraits<T>::from_float(intensity);
         }
         if (nrChannels == 4) {
-            texture_data[index + 3] = 1;
+            texture_data[index + 3] = TexelTraits<T>::from_float(1.0f);
         }
     }
 
@@ -326,26 +563,31 @@ class Texture : public OpenGLObject {
 
     void get_pixel_color_fast(int x, int y, float& r, float& g, float& b, float& a) const {
         const size_t index = this->get_index(x, y);
+        auto value = [&](int channel) { return TexelTraits<T>::to_float(texture_data[index + channel]); };
 
         // TODO consider using format variable instead of nrChannels
         switch (nrChannels) {
         case 1:
-            r = texture_data[index];
-            g = texture_data[index];
-            b = texture_data[index];
+            r = g = b = value(0);
+            a = 1.0;
+            break;
+        case 2:
+            r = value(0);
+            g = value(1);
+            b = 0.0;
             a = 1.0;
             break;
         case 3:
-            r = texture_data[index];
-            g = texture_data[index + 1];
-            b = texture_data[index + 2];
+            r = value(0);
+            g = value(1);
+            b = value(2);
             a = 1.0;
             break;
         case 4:
-            r = texture_data[index];
-            g = texture_data[index + 1];
-            b = texture_data[index + 2];
-            a = texture_data[index + 3];
+            r = value(0);
+            g = value(1);
+            b = value(2);
+            a = value(3);
             break;
         default:
             std::cout << "Cannot retrieve the pixel color, the texture has unsupported number of channels." << std::endl;
@@ -371,3 +613,6 @@ class Texture : public OpenGLObject {
         return (color.r + color.g + color.b) / 3.0f;
     }
 };
+
+/** The texture storing the channels as floats. */
+using Texture = TypedTexture<float>;
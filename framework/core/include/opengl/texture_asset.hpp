@@ -0,0 +1,284 @@
+#pragma once
+
+#include "glad.h"
+#include "texture_compressor.hpp"
+#include "texture_streamer.hpp"
+#include "utils/frame_counters.hpp"
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+/** The parameters determining how an image is loaded into a @link TextureAsset. */
+struct TextureParameters {
+    /** If @p true, the full mip chain is generated and the texture is sampled with trilinear filtering. */
+    bool mipmaps = true;
+
+    /** If @p true, the colors are stored as sRGB (e.g., GL_SRGB8_ALPHA8) and converted to linear values when sampled. */
+    bool srgb = false;
+
+    /** The role of the texture selecting its block-compressed format (see @link TextureCompressor). */
+    TextureRole role = TextureRole::UNCOMPRESSED;
+
+    /** The filter generating the mip chain on the CPU (see @link MipmapGenerator). */
+    MipmapFilter mipmap_filter = MipmapFilter::BOX;
+
+    /** Returns @p true if the image holds gamma-encoded colors, whose mip levels are averaged in linear space. */
+    bool is_gamma_encoded() const { return srgb || role == TextureRole::COLOR || role == TextureRole::COLOR_HIGH_QUALITY; }
+
+    bool operator==(const TextureParameters& other) const = default;
+};
+
+/** The source of a single channel of a packed @link TextureAsset. */
+struct ChannelSource {
+    /** The path to the source image, empty to fill the channel with @link value. */
+    std::filesystem::path path;
+
+    /** The channel of the source image (0 = red, 1 = green, 2 = blue, 3 = alpha). */
+    int channel = 0;
+
+    /** The value of the channel if the path is empty or the image cannot be loaded. */
+    uint8_t value = 255;
+};
+
+/**
+ * The immutable 2D texture loaded from an image file. The texture is created with the storage for the whole mip chain
+ * and released when the object is destroyed; share it through std::shared_ptr (see @link AssetRegistry) instead of
+ * loading the same file several times.
+ * <p>
+ * The mip chain is generated on the CPU (see @link MipmapGenerator), so it does not depend on the driver. Compressed
+ * textures (see @link TextureParameters::role) are transcoded together with their mip chain and uploaded level by
+ * level, the transcoded images are stored in a cache directory and reused until the source image changes.
+ * Single-channel masks are swizzled to (R, R, R, 1), so shaders read them like the original gray images.
+ * <p>
+ * If a @link TextureStreamer is given, the texture is created immediately with a placeholder in its coarsest level,
+ * the format and the size are taken from the cache or the header of the image. The image is decoded (and transcoded)
+ * by a worker thread and the streamer uploads the levels over the following frames.
+ * <p>
+ * If the image cannot be loaded, an error is printed and the asset holds no texture (its OpenGL object is 0). A
+ * streamed image that is found but cannot be decoded keeps the placeholder.
+ * <p>
+ * The most detailed levels can be dropped to save memory and loaded again later (see @link set_resident_level, used by
+ * @link TextureBudget). Since the storage of an immutable texture cannot shrink, the texture is re-allocated with fewer
+ * levels, so its OpenGL object changes; bind the asset instead of keeping its OpenGL object.
+ */
+class TextureAsset {
+    // ----------------------------------------------------------------------------
+    // Types
+    // ----------------------------------------------------------------------------
+  protected:
+    /** The source images of a texture, the functions are called by a worker thread if the texture is streamed or re-loaded. */
+    struct Source {
+        /** The file name of the transcoded image in the cache directory. */
+        std::string cache_name;
+        /** The stamp of the source images (see @link TextureCompressor::get_source_stamp). */
+        uint64_t stamp = 0;
+        /** The number of meaningful channels of the decoded image. */
+        int channels = 4;
+        /** Reads the size and the presence of alpha without decoding the image, returns @p false on failure. */
+        std::function<bool(int& width, int& height, bool& has_alpha)> probe;
+        /** Decodes the RGBA8 pixels, returns @p false on failure. */
+        std::function<bool(std::vector<uint8_t>& rgba, int& width, int& height)> decode;
+    };
+
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+  protected:
+    /** The OpenGL texture, 0 if the image could not be loaded. */
+    GLuint texture = 0;
+
+    /** The width of the most detailed level. */
+    int width = 0;
+
+    /** The height of the most detailed level. */
+    int height = 0;
+
+    /** The number of mip levels. */
+    int levels = 0;
+
+    /** The sized internal format of the texture. */
+    GLenum internal_format = GL_RGBA8;
+
+    /** The size (in bytes) of the resident levels of the texture. */
+    size_t memory_size = 0;
+
+    /** The streamer uploading the levels of the texture, @p nullptr if the texture was loaded synchronously. */
+    TextureStreamer* streamer = nullptr;
+
+    /** The most detailed level held by the texture, i.e., its level 0 is this level of the full mip chain. */
+    int resident_level = 0;
+
+    /** The parameters of the texture. */
+    TextureParameters parameters;
+
+    /** The source images, kept to load the dropped levels again. */
+    Source source;
+
+    /** The path to the transcoded image in the cache directory, empty if the texture is not cached. */
+    std::filesystem::path cache_path;
+
+    // ----------------------------------------------------------------------------
+    // Constructors
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Loads the image and creates the texture.
+     *
+     * @param 	path		   	The path to the image.
+     * @param 	parameters	   	The parameters of the texture.
+     * @param 	cache_directory	The directory with the transcoded images of the compressed textures, empty to transcode
+     * 							them on every load.
+     * @param 	streamer	   	The streamer uploading the texture in the background, @p nullptr to load it immediately.
+     */
+    TextureAsset(const std::filesystem::path& path, const TextureParameters& parameters = {},
+                 const std::filesystem::path& cache_directory = {}, TextureStreamer* streamer = nullptr);
+
+    /**
+     * Loads the images and creates the texture packed from their channels.
+     *
+     * @param 	channels	   	The sources of the channels of the texture (1 to 4), the missing channels are 0 (alpha 1).
+     * @param 	parameters	   	The parameters of the texture, the role should match the packed data (e.g.,
+     * 							@link TextureRole::MASK_PAIR for two masks).
+     * @param 	cache_directory	The directory with the transcoded images of the compressed textures, empty to transcode
+     * 							them on every load.
+     * @param 	streamer	   	The streamer uploading the texture in the background, @p nullptr to load it immediately.
+     */
+    TextureAsset(const std::vector<ChannelSource>& channels, const TextureParameters& parameters = {},
+                 const std::filesystem::path& cache_directory = {}, TextureStreamer* streamer = nullptr);
+
+    TextureAsset(const TextureAsset& other) = delete;
+    TextureAsset& operator=(const TextureAsset& other) = delete;
+
+    /** Destroys this @link TextureAsset and deletes the texture, its streaming is cancelled. */
+    ~TextureAsset();
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Binds the texture to the specified texture unit.
+     *
+     * @param 	unit	The texture unit.
+     */
+    void bind(GLuint unit) const {
+        glBindTextureUnit(unit, texture);
+        FrameCounters::count_texture_binds();
+    }
+
+    /**
+     * Returns the number of mip levels of a texture with the given size (down to 1x1).
+     *
+     * @param 	width 	The width of the most detailed level.
+     * @param 	height	The height of the most detailed level.
+     */
+    static int get_mip_count(int width, int height);
+
+    /**
+     * Re-allocates the texture so that its most detailed level is the given level of the full mip chain. The dropped
+     * levels are released, the levels loaded again are read from the cache or decoded from the source images (in the
+     * background if the texture is streamed). The coarser levels are copied from the old texture.
+     *
+     * @param 	level	The new most detailed level (0 = full resolution), clamped to the mip chain.
+     *
+     * @return	@p false if the texture is invalid or still streamed, so its levels cannot change yet.
+     */
+    bool set_resident_level(int level);
+
+  protected:
+    /**
+     * Creates the texture from the cached transcoded image, or decodes the source images and creates the texture from
+     * them (transcoding them first if the texture is compressed).
+     *
+     * @param 	source		   	The source images.
+     * @param 	parameters	   	The parameters of the texture.
+     * @param 	cache_directory	The directory with the transcoded images, empty if they are not cached.
+     */
+    void create(const Source& source, const TextureParameters& parameters, const std::filesystem::path& cache_directory);
+
+    /**
+     * Creates the texture with a placeholder and passes the decoding of the source images to the worker threads and
+     * the upload of the levels to the @link streamer.
+     *
+     * @param 	source		   	The source images (copied to the worker).
+     * @param 	parameters	   	The parameters of the texture.
+     * @param 	cache_directory	The directory with the transcoded images, empty if they are not cached.
+     */
+    void create_streamed(const Source& source, const TextureParameters& parameters, const std::filesystem::path& cache_directory);
+
+    /** Creates the texture from the RGBA8 levels of the mip chain (stored as R8, RG8, or RGBA8 by the channels). */
+    void create_uncompressed(const std::vector<std::vector<uint8_t>>& chain, int channels, const TextureParameters& parameters);
+
+    /** Creates the storage for all levels and sets the sampling parameters, the format and the size must be set. */
+    void create_storage(const TextureParameters& parameters);
+
+    /** Returns the uncompressed internal format storing the given number of channels. */
+    static GLenum get_uncompressed_format(int channels, bool srgb);
+
+    /** Creates the texture from the compressed levels. */
+    void create_compressed(const CompressedImage& image, const TextureParameters& parameters);
+
+    /** Creates a texture with the storage for the levels from the given one and the sampling parameters of this asset. */
+    GLuint allocate(int first_level) const;
+
+    /**
+     * Loads the levels of the full mip chain from the cache or from the source images, may be called by a worker.
+     *
+     * @param 	source		   	The source images.
+     * @param 	parameters	   	The parameters of the texture.
+     * @param 	cache_path	   	The path to the transcoded image, empty if the texture is not cached.
+     * @param 	internal_format	The internal format of the texture, uncompressed levels are returned as RGBA8.
+     * @param 	width		   	The width of the most detailed level.
+     * @param 	height		   	The height of the most detailed level.
+     * @param 	levels		   	The number of levels.
+     *
+     * @return	The levels ordered from the most detailed one, empty if the images could not be loaded or changed size.
+     */
+    static TextureStreamer::Levels load_levels(const Source& source, const TextureParameters& parameters, const std::filesystem::path& cache_path,
+                                               GLenum internal_format, int width, int height, int levels);
+
+    /**
+     * Returns the file name of the transcoded image in the cache directory.
+     *
+     * @param 	name	  	The readable part of the name (e.g., the name of the source image).
+     * @param 	key		  	The key identifying the source images (e.g., their canonical paths).
+     * @param 	parameters	The parameters of the texture.
+     */
+    static std::string get_cache_name(const std::string& name, const std::string& key, const TextureParameters& parameters);
+
+    // ----------------------------------------------------------------------------
+    // Getters & Setters
+    // ----------------------------------------------------------------------------
+  public:
+    /** Returns the OpenGL texture (0 if the image could not be loaded). */
+    GLuint get_opengl_object() const { return texture; }
+
+    /** Returns @p true if the image was loaded. */
+    bool is_valid() const { return texture != 0; }
+
+    /** Returns the width of the most detailed level. */
+    int get_width() const { return width; }
+
+    /** Returns the height of the most detailed level. */
+    int get_height() const { return height; }
+
+    /** Returns the number of mip levels. */
+    int get_levels() const { return levels; }
+
+    /** Returns the size (in bytes) of the resident levels of the texture. */
+    size_t get_memory_size() const { return memory_size; }
+
+    /**
+     * Returns the size (in bytes) the texture would occupy with the given most detailed level.
+     *
+     * @param 	level	The most detailed resident level.
+     */
+    size_t get_memory_size(int level) const;
+
+    /** Returns the most detailed level held by the texture (0 = full resolution). */
+    int get_resident_level() const { return resident_level; }
+
+    /** Returns the parameters of the texture. */
+    const TextureParameters& get_parameters() const { return parameters; }
+};
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "glad.h"
+#include "mipmap_generator.hpp"
+#include "utils/thread_pool.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// The S3TC formats are not part of the core profile, but every desktop implementation supports them.
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+/** The role of a texture determining its compressed format. */
+enum class TextureRole {
+    /** The texture is not compressed (RGBA8). */
+    UNCOMPRESSED,
+    /** A color map: BC1 if the image is opaque, BC3 if it has an alpha channel. */
+    COLOR,
+    /** A color map with smooth gradients whose BC1 banding would be visible: BC7. */
+    COLOR_HIGH_QUALITY,
+    /** A tangent-space normal map: BC5 storing X and Y, the shader reconstructs Z. */
+    NORMAL,
+    /** A single-channel map (e.g., ambient occlusion, roughness, specular): BC4, read as gray (R, R, R, 1). */
+    MASK,
+    /** Two single-channel maps packed into R and G (see @link ChannelSource): BC5. */
+    MASK_PAIR
+};
+
+/** The block-compressed image with its mip chain. */
+struct CompressedImage {
+    /** The compressed internal format, e.g., GL_COMPRESSED_RED_RGTC1. */
+    GLenum internal_format = 0;
+    /** The width of the most detailed level. */
+    int width = 0;
+    /** The height of the most detailed level. */
+    int height = 0;
+    /** The compressed levels ordered from the most detailed one. */
+    std::vector<std::vector<uint8_t>> levels;
+
+    /** Returns the total size (in bytes) of all levels. */
+    size_t get_memory_size() const {
+        size_t size = 0;
+        for (const std::vector<uint8_t>& level : levels) {
+            size += level.size();
+        }
+        return size;
+    }
+};
+
+/**
+ * The class providing static utility methods transcoding images into block-compressed formats (BC1, BC3, BC4, BC5,
+ * and BC7) on the CPU.
+ * <p>
+ * The mip chain is generated by @link MipmapGenerator and each level is compressed in parallel over the rows of 4x4 blocks. The
+ * S3TC and RGTC blocks are encoded by stb_dxt; BC7 uses only mode 6 (a single RGBA line with 16 weights), whose
+ * endpoints are fitted along the principal axis of the block and refined by least squares.
+ * <p>
+ * Compressing large images takes seconds, so the results are meant to be stored in a cache (see @link save and
+ * @link load) and transcoded only when the source image changes.
+ */
+class TextureCompressor {
+  public:
+    /**
+     * Compresses an image and its mip chain.
+     *
+     * @param 	rgba   	The pixels of the image (4 bytes per pixel, rows from the top).
+     * @param 	width  	The width of the image.
+     * @param 	height 	The height of the image.
+     * @param 	role   	The role of the texture selecting the format (must not be @link TextureRole::UNCOMPRESSED).
+     * @param 	srgb   	If @p true, the color formats are stored as sRGB.
+     * @param 	mipmaps	If @p true, the whole mip chain is generated, otherwise only the image itself is compressed.
+     * @param 	pool   	The pool compressing the blocks.
+     *
+     * @return	The compressed image.
+     */
+    static CompressedImage compress(const uint8_t* rgba, int width, int height, TextureRole role, bool srgb, bool mipmaps,
+                                    ThreadPool& pool = ThreadPool::get_default());
+
+    /**
+     * Compresses an image and its mip chain into the given format, e.g., when the texture storage was created before
+     * the image was decoded.
+     *
+     * @param 	rgba		   	The pixels of the image (4 bytes per pixel, rows from the top).
+     * @param 	width		   	The width of the image.
+     * @param 	height		   	The height of the image.
+     * @param 	internal_format	The compressed format (see @link get_internal_format).
+     * @param 	mipmaps		   	If @p true, the whole mip chain is generated, otherwise only the image itself is compressed.
+     * @param 	pool		   	The pool compressing the blocks.
+     *
+     * @return	The compressed image.
+     */
+    static CompressedImage compress(const uint8_t* rgba, int width, int height, GLenum internal_format, bool mipmaps,
+                                    ThreadPool& pool = ThreadPool::get_default());
+
+    /**
+     * Compresses the levels of a mip chain generated beforehand (see @link MipmapGenerator::generate).
+     *
+     * @param 	levels		   	The RGBA8 levels ordered from the most detailed one.
+     * @param 	width		   	The width of the most detailed level.
+     * @param 	height		   	The height of the most detailed level.
+     * @param 	internal_format	The compressed format (see @link get_internal_format).
+     * @param 	pool		   	The pool compressing the blocks.
+     *
+     * @return	The compressed image.
+     */
+    static CompressedImage compress(const std::vector<std::vector<uint8_t>>& levels, int width, int height, GLenum internal_format,
+                                    ThreadPool& pool = ThreadPool::get_default());
+
+    /** Returns @p true if any pixel of the RGBA8 image is not opaque. */
+    static bool has_alpha(const uint8_t* rgba, int width, int height);
+
+    /** Returns @p true if the format stores sRGB-encoded colors. */
+    static bool is_srgb(GLenum internal_format);
+
+    /**
+     * Returns the internal format used for a texture.
+     *
+     * @param 	role	 	The role of the texture, @link TextureRole::UNCOMPRESSED returns GL_RGBA8 (or GL_SRGB8_ALPHA8).
+     * @param 	srgb	 	If @p true, the colors are stored as sRGB.
+     * @param 	has_alpha	If @p true, the image has a meaningful alpha channel (selects BC3 instead of BC1 for colors).
+     */
+    static GLenum get_internal_format(TextureRole role, bool srgb, bool has_alpha);
+
+    /** Returns the size (in bytes) of a 4x4 block of the compressed format, 0 if the format is not compressed. */
+    static size_t get_block_size(GLenum internal_format);
+
+    /** Returns the size (in bytes) of a level of the given size, uncompressed formats are counted as RGBA8. */
+    static size_t get_level_size(GLenum internal_format, int width, int height);
+
+    /**
+     * Stores a compressed image into a cache file.
+     *
+     * @param 	path 	The path to the cache file (the directory is created if needed).
+     * @param 	image	The compressed image.
+     * @param 	stamp	The stamp of the source image (see @link get_source_stamp).
+     *
+     * @return	@p true if the file was written.
+     */
+    static bool save(const std::filesystem::path& path, const CompressedImage& image, uint64_t stamp);
+
+    /**
+     * Loads a compressed image from a cache file.
+     *
+     * @param 	path	   	The path to the cache file.
+     * @param 	image	   	[out] The compressed image.
+     * @param 	stamp	   	The stamp of the source image, files created from a different version of the image are rejected
+     * 						and all files are rejected if the stamp is 0 (unknown version).
+     * @param 	header_only	If @p true, only the format and the size are read, the levels are left empty.
+     *
+     * @return	@p true if the file exists, is valid, and matches the stamp.
+     */
+    static bool load(const std::filesystem::path& path, CompressedImage& image, uint64_t stamp, bool header_only = false);
+
+    /**
+     * Returns the stamp identifying the version of a source file (derived from its size and modification time), 0 if
+     * either of them cannot be read. The cached images are never used for a zero stamp, so the image is re-encoded.
+     */
+    static uint64_t get_source_stamp(const std::filesystem::path& path);
+
+    /**
+     * Encodes a 4x4 block into BC7 mode 6.
+     *
+     * @param 	rgba 	The 16 pixels of the block (4 bytes each, rows from the top).
+     * @param 	block	[out] The 16 bytes of the encoded block.
+     */
+    static void encode_bc7_block(const uint8_t* rgba, uint8_t* block);
+};
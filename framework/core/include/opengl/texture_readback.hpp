@@ -0,0 +1,188 @@
+#pragma once
+
+#include "glad.h"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * The copier of texture data from the GPU to the CPU that does not stall the pipeline. Unlike glGetTextureImage, which
+ * waits until the GPU finishes all preceding commands, @link read only queues a copy into a pixel pack buffer and a
+ * fence behind it. @link update polls the fences (without waiting) in the following frames, and once the GPU has
+ * executed the copy, hands the data to the callback of the request and marks its ticket as ready.
+ * <p>
+ * The pack buffers are persistently mapped and reused by later requests of the same or smaller size, so steady use
+ * (e.g., a readback of the same target every frame) allocates no GPU memory. A ready result typically arrives one or
+ * two frames after the request.
+ * <p>
+ * All methods must be called from the thread owning the OpenGL context, the callbacks are called from @link update,
+ * @link wait, or @link finish.
+ *
+ * Example:
+ * <code>
+ *  TextureReadback readback;
+ *  Texture target(width, height);
+ *  ...
+ *  TextureReadback::Ticket ticket = target.update_cpu_data_async(readback);
+ *  ...
+ *  // every frame
+ *  readback.update();
+ *  if (ticket.is_ready()) {
+ *      Color color = target.get_pixel_color(x, y);
+ *  }
+ * </code>
+ */
+class TextureReadback {
+    // ----------------------------------------------------------------------------
+    // Types
+    // ----------------------------------------------------------------------------
+  public:
+    /** The function receiving the data of a finished request (the pointer is valid only during the call). */
+    using Callback = std::function<void(const uint8_t* data, size_t size)>;
+
+    /** The future-like handle of a request, the copies of a ticket share its state. */
+    class Ticket {
+      public:
+        /** The state shared by the ticket and the request. */
+        enum class State { PENDING, READY, CANCELLED };
+
+      protected:
+        /** The state of the request, @p nullptr for a ticket not associated with any request. */
+        std::shared_ptr<State> state;
+
+      public:
+        Ticket() = default;
+        explicit Ticket(std::shared_ptr<State> state) : state(std::move(state)) {}
+
+        /** Returns @p true if the ticket is associated with a request. */
+        bool is_valid() const { return state != nullptr; }
+
+        /** Returns @p true if the GPU has executed the copy and the callback was called. */
+        bool is_ready() const { return state && *state == State::READY; }
+
+        /** Returns @p true if the request is still waiting for the GPU. */
+        bool is_pending() const { return state && *state == State::PENDING; }
+
+        friend class TextureReadback;
+    };
+
+  protected:
+    /** A persistently mapped pixel pack buffer. */
+    struct Buffer {
+        /** The OpenGL buffer. */
+        GLuint buffer = 0;
+        /** The size of the buffer in bytes. */
+        size_t size = 0;
+        /** The mapped memory of the buffer. */
+        const uint8_t* mapped = nullptr;
+    };
+
+    /** A copy queued on the GPU. */
+    struct Request {
+        /** The buffer receiving the data. */
+        Buffer buffer;
+        /** The size of the data in bytes. */
+        size_t size = 0;
+        /** The fence signaled once the copy is executed. */
+        GLsync fence = nullptr;
+        /** The function receiving the data. */
+        Callback callback;
+        /** The state shared with the ticket. */
+        std::shared_ptr<Ticket::State> state;
+    };
+
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+  protected:
+    /** The requests in the order of their submission (and thus of their fences). */
+    std::deque<Request> requests;
+
+    /** The buffers that are not used by any request. */
+    std::vector<Buffer> free_buffers;
+
+    // ----------------------------------------------------------------------------
+    // Constructors
+    // ----------------------------------------------------------------------------
+  public:
+    /** Constructs a new @link TextureReadback, the buffers are created by the requests. */
+    TextureReadback() = default;
+
+    TextureReadback(const TextureReadback& other) = delete;
+    TextureReadback& operator=(const TextureReadback& other) = delete;
+
+    /** Destroys this @link TextureReadback, deletes its buffers and cancels the pending requests. */
+    ~TextureReadback();
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Queues a copy of a rectangle of a texture level.
+     *
+     * @param 	texture 	The texture to read.
+     * @param 	level   	The level to read.
+     * @param 	x       	The X-coordinate of the rectangle.
+     * @param 	y       	The Y-coordinate of the rectangle.
+     * @param 	width   	The width of the rectangle.
+     * @param 	height  	The height of the rectangle.
+     * @param 	format  	The format of the pixel data (e.g., GL_RGBA).
+     * @param 	type    	The type of the pixel data (e.g., GL_UNSIGNED_BYTE).
+     * @param 	size    	The size of the pixel data in bytes (rows are tightly packed).
+     * @param 	callback	The function receiving the data once the copy is executed.
+     *
+     * @return	The ticket of the request.
+     */
+    Ticket read(GLuint texture, int level, int x, int y, int width, int height, GLenum format, GLenum type, size_t size,
+                Callback callback);
+
+    /**
+     * Queues a copy of a rectangle of the read buffer of a framebuffer (e.g., the back buffer of the default one).
+     * The framebuffer stays bound to GL_READ_FRAMEBUFFER.
+     *
+     * @param 	framebuffer	The framebuffer to read, 0 for the default one.
+     * @param 	x          	The X-coordinate of the rectangle (from the left).
+     * @param 	y          	The Y-coordinate of the rectangle (from the bottom).
+     * @param 	width      	The width of the rectangle.
+     * @param 	height     	The height of the rectangle.
+     * @param 	format     	The format of the pixel data (e.g., GL_RGBA).
+     * @param 	type       	The type of the pixel data (e.g., GL_UNSIGNED_BYTE).
+     * @param 	size       	The size of the pixel data in bytes (rows are tightly packed, from the bottom).
+     * @param 	callback   	The function receiving the data once the copy is executed.
+     *
+     * @return	The ticket of the request.
+     */
+    Ticket read_framebuffer(GLuint framebuffer, int x, int y, int width, int height, GLenum format, GLenum type, size_t size,
+                            Callback callback);
+
+    /** Finishes the requests whose copies were executed by the GPU, never waits; call once per frame. */
+    void update();
+
+    /** Waits until the GPU executes the copy of the ticket (and all older ones) and finishes them. */
+    void wait(const Ticket& ticket);
+
+    /** Waits for all pending requests and finishes them. */
+    void finish();
+
+    /** Drops the request of the ticket without calling its callback, e.g., before its target is destroyed. */
+    void cancel(const Ticket& ticket);
+
+    /** Returns the number of requests waiting for the GPU. */
+    size_t get_pending_count() const { return requests.size(); }
+
+  protected:
+    /** Creates a request and binds its buffer as the pixel pack buffer, the copy is issued by the caller. */
+    Request begin_request(size_t size, Callback callback);
+
+    /** Unbinds the buffer, fences the copy issued for the request, and queues the request. */
+    Ticket end_request(Request request);
+
+    /** Returns a free buffer of at least the given size, creating a new one if needed. */
+    Buffer acquire_buffer(size_t size);
+
+    /** Calls the callback of the first request, releases its buffer and removes it. */
+    void complete_front();
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "glad.h"
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <vector>
+
+/**
+ * The uploader of textures whose images are decoded in the background. The textures are created immediately with the
+ * storage for all levels and a placeholder in the coarsest one (see @link TextureAsset), their data are decoded (and
+ * compressed) by the workers of the thread pool, and @link update uploads them from the smallest level upward.
+ * <p>
+ * The uploads go through a persistently mapped pixel unpack buffer split into segments, each frame writes into one
+ * segment and fences it. A segment is reused only after its fence is signaled, so the CPU never waits for the GPU; if
+ * the GPU falls behind, the frame simply uploads nothing. The size of a segment caps the data uploaded per frame,
+ * large levels are uploaded in several frames by rows. Once a level is complete, GL_TEXTURE_BASE_LEVEL is lowered to
+ * it, so the texture gets sharper as the levels arrive.
+ * <p>
+ * All methods must be called from the thread owning the OpenGL context.
+ *
+ * Example:
+ * <code>
+ *  TextureStreamer streamer;
+ *  AssetRegistry assets;
+ *  assets.set_texture_streamer(&streamer);
+ *  GLuint wood = assets.load_texture(images_path / "wood.png")->get_opengl_object(); // placeholder until streamed
+ *  ...
+ *  // every frame
+ *  streamer.update();
+ * </code>
+ */
+class TextureStreamer {
+    // ----------------------------------------------------------------------------
+    // Types
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * The data of all levels ordered from the most detailed one, empty if the image could not be decoded. The levels
+     * whose data are empty are not uploaded, the texture must already hold them.
+     */
+    using Levels = std::vector<std::vector<uint8_t>>;
+
+  protected:
+    /** A texture waiting for its data or being uploaded. */
+    struct Job {
+        /** The streamed texture. */
+        GLuint texture = 0;
+        /** The internal format of the texture, uncompressed textures are uploaded as RGBA8. */
+        GLenum internal_format = 0;
+        /** The width of the most detailed level. */
+        int width = 0;
+        /** The height of the most detailed level. */
+        int height = 0;
+        /** The data computed by a worker. */
+        std::future<Levels> future;
+        /** The data taken from the future once it is ready. */
+        Levels levels;
+        /** The level being uploaded, -1 until the data are ready. */
+        int level = -1;
+        /** The first row of the level that was not uploaded yet. */
+        int row = 0;
+    };
+
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+  protected:
+    /** The streamed textures in the order of their requests. */
+    std::deque<Job> jobs;
+
+    /** The persistently mapped pixel unpack buffer. */
+    GLuint buffer = 0;
+
+    /** The mapped memory of the buffer. */
+    uint8_t* mapped = nullptr;
+
+    /** The size (in bytes) of a segment, i.e., the maximal size of the data uploaded per frame. */
+    size_t segment_size;
+
+    /** The fences of the segments, 0 if the segment is not used by the GPU. */
+    std::vector<GLsync> fences;
+
+    /** The segment used by the next frame. */
+    size_t segment = 0;
+
+    /** The size (in bytes) of the data uploaded by the last call of @link update. */
+    size_t last_upload_size = 0;
+
+    // ----------------------------------------------------------------------------
+    // Constructors
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Constructs a new @link TextureStreamer and creates its buffer.
+     *
+     * @param 	upload_budget	The maximal size (in bytes) of the data uploaded per frame.
+     * @param 	segment_count	The number of frames that may use the buffer at the same time.
+     */
+    explicit TextureStreamer(size_t upload_budget = 4 << 20, size_t segment_count = 3);
+
+    TextureStreamer(const TextureStreamer& other) = delete;
+    TextureStreamer& operator=(const TextureStreamer& other) = delete;
+
+    /** Destroys this @link TextureStreamer and deletes its buffer, the pending textures keep their uploaded levels. */
+    ~TextureStreamer();
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Queues a texture for streaming.
+     *
+     * @param 	texture		   	The texture with the storage for all levels.
+     * @param 	internal_format	The internal format of the texture.
+     * @param 	width		   	The width of the most detailed level.
+     * @param 	height		   	The height of the most detailed level.
+     * @param 	levels		   	The future data of the levels (e.g., returned by @link ThreadPool::submit).
+     */
+    void stream(GLuint texture, GLenum internal_format, int width, int height, std::future<Levels> levels);
+
+    /** Stops streaming the texture, must be called before the texture is deleted. */
+    void cancel(GLuint texture);
+
+    /** Returns @p true if the texture is queued for streaming and not fully uploaded. */
+    bool is_pending(GLuint texture) const;
+
+    /** Uploads the data of the decoded textures up to the per-frame budget, call once per frame. */
+    void update();
+
+    /** Returns the number of textures that are not fully uploaded. */
+    size_t get_pending_count() const { return jobs.size(); }
+
+    /** Returns the size (in bytes) of the data uploaded by the last call of @link update. */
+    size_t get_last_upload_size() const { return last_upload_size; }
+
+    /** Returns the maximal size (in bytes) of the data uploaded per frame. */
+    size_t get_upload_budget() const { return segment_size; }
+};
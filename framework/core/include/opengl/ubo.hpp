@@ -2,6 +2,8 @@
 
 #include "glad.h"
 #include "opengl_object.hpp"
+#include "utils/frame_counters.hpp"
+#include "utils/gl_object_tracker.hpp"
 #include <span>
 #include <vector>
 
@@ -42,12 +44,14 @@ template <class T> class UBO : public OpenGLObject {
     UBO(GLbitfield flags = 0) : OpenGLObject(GL_UNIFORM_BUFFER), data(1), flags(flags) {
         glCreateBuffers(1, &opengl_object);
         glNamedBufferStorage(opengl_object, sizeof(T) * data.size(), data.empty() ? nullptr : data.data(), flags);
+        GLObjectTracker::on_create(GLObjectType::BUFFER, opengl_object, sizeof(T) * data.size());
     }
 
     /** Constructs a new @link UBO and initializes the GPU buffer with data. */
     UBO(std::span<T> data, GLbitfield flags = 0) : OpenGLObject(GL_UNIFORM_BUFFER), data(data), flags(flags) {
         glCreateBuffers(1, &opengl_object);
         glNamedBufferStorage(opengl_object, sizeof(T) * data.size(), data.empty() ? nullptr : data.data(), flags);
+        GLObjectTracker::on_create(GLObjectType::BUFFER, opengl_object, sizeof(T) * data.size());
     }
 
     /**
@@ -58,6 +62,7 @@ template <class T> class UBO : public OpenGLObject {
     UBO(const UBO& other) : OpenGLObject(other.target), data(other.data), flags(0) {
         glCreateBuffers(1, &opengl_object);
         glNamedBufferStorage(opengl_object, sizeof(T) * data.size(), data.empty() ? nullptr : data.data(), flags);
+        GLObjectTracker::on_create(GLObjectType::BUFFER, opengl_object, sizeof(T) * data.size());
     }
 
     /**
@@ -91,7 +96,10 @@ template <class T> class UBO : public OpenGLObject {
      * Destroys this @link UBO. Note that we do not delete the OpenGL counterpart in order to avoid problems when
      * the object is copied locally and then it goes out of scope.
      */
-    virtual ~UBO() { glDeleteBuffers(1, &opengl_object); }
+    virtual ~UBO() {
+        GLObjectTracker::on_delete(GLObjectType::BUFFER, opengl_object);
+        glDeleteBuffers(1, &opengl_object);
+    }
 
     // ----------------------------------------------------------------------------
     // Methods
@@ -111,6 +119,7 @@ template <class T> class UBO : public OpenGLObject {
 
         if (!data.empty()) {
             glNamedBufferSubData(opengl_object, 0, sizeof(T) * data.size(), data.data());
+            FrameCounters::count_upload(sizeof(T) * data.size());
         }
     }
 
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "geometry.hpp"
+#include "texture_asset.hpp"
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * The registry of the loaded assets, i.e., the textures and geometries loaded from files. The assets are keyed by the
+ * canonical path and the load parameters, so loading the same file twice (even through a different relative path)
+ * returns the same shared object.
+ * <p>
+ * The registry holds a reference to every asset, so the OpenGL objects returned by the assets stay valid while the
+ * registry exists. The assets no longer used outside the registry are released by @link release_unused; all assets are
+ * released when the registry is destroyed, which must happen while the OpenGL context exists.
+ *
+ * Example:
+ * <code>
+ *  AssetRegistry assets;
+ *  std::shared_ptr<TextureAsset> wood = assets.load_texture(images_path / "wood.png");
+ *  std::shared_ptr<Geometry> chair = assets.load_geometry(objects_path / "chair.obj");
+ *  std::cout << assets.get_memory_size() << " bytes" << std::endl;
+ * </code>
+ */
+class AssetRegistry {
+    // ----------------------------------------------------------------------------
+    // Types
+    // ----------------------------------------------------------------------------
+  public:
+    /** The memory usage of a single asset. */
+    struct AssetUsage {
+        /** The canonical path of the loaded file. */
+        std::string path;
+        /** The type of the asset ("texture" or "geometry"). */
+        const char* type = "";
+        /** The size (in bytes) of the GPU data of the asset. */
+        size_t memory_size = 0;
+        /** The number of references held outside the registry. */
+        long users = 0;
+    };
+
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+  protected:
+    /** The loaded textures keyed by @link make_key. */
+    std::map<std::string, std::shared_ptr<TextureAsset>> textures;
+
+    /** The loaded geometries keyed by @link make_key. */
+    std::map<std::string, std::shared_ptr<Geometry>> geometries;
+
+    /** The directory with the transcoded compressed textures, empty if they are not cached. */
+    std::filesystem::path texture_cache_directory;
+
+    /** The streamer uploading the textures in the background, @p nullptr to load them immediately. */
+    TextureStreamer* texture_streamer = nullptr;
+
+    // ----------------------------------------------------------------------------
+    // Constructors
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Creates an empty registry.
+     *
+     * @param 	texture_cache_directory	The directory with the transcoded compressed textures (see @link TextureAsset),
+     * 									empty to transcode them on every load.
+     */
+    explicit AssetRegistry(std::filesystem::path texture_cache_directory = {})
+        : texture_cache_directory(std::move(texture_cache_directory)) {}
+
+    AssetRegistry(const AssetRegistry& other) = delete;
+    AssetRegistry& operator=(const AssetRegistry& other) = delete;
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Returns the texture loaded from the image, the image is loaded only if it was not loaded with the same parameters
+     * before.
+     *
+     * @param 	path	  	The path to the image.
+     * @param 	parameters	The parameters of the texture.
+     */
+    std::shared_ptr<TextureAsset> load_texture(const std::filesystem::path& path, const TextureParameters& parameters = {});
+
+    /**
+     * Returns the texture packed from the channels of several images (see @link ChannelSource), the images are loaded
+     * only if the same texture was not loaded before.
+     *
+     * @param 	channels  	The sources of the channels of the texture.
+     * @param 	parameters	The parameters of the texture.
+     */
+    std::shared_ptr<TextureAsset> load_packed_texture(const std::vector<ChannelSource>& channels, const TextureParameters& parameters = {});
+
+    /**
+     * Returns the geometry loaded from the file (see @link Geometry::from_file), the file is loaded only if it was not
+     * loaded with the same parameters before. Note that the returned geometry is shared, use @link Geometry::clone
+     * before modifying its data.
+     *
+     * @param 	path		 	The path to the file.
+     * @param 	residency	 	The policy determining where the data are kept (see @link Residency).
+     * @param 	vertex_format	The layout of the vertices in the GPU buffer (see @link VertexFormat).
+     * @param 	lod_count	 	The number of levels of detail to generate.
+     */
+    std::shared_ptr<Geometry> load_geometry(const std::filesystem::path& path, Residency residency = Residency::GPU_ONLY,
+                                            VertexFormat vertex_format = VertexFormat::FLOAT, int lod_count = 1);
+
+    /**
+     * Releases the assets that are not referenced outside the registry.
+     *
+     * @return	The number of released assets.
+     */
+    size_t release_unused();
+
+    /** Returns the memory usage of all assets ordered from the largest one. */
+    std::vector<AssetUsage> get_memory_report() const;
+
+    /** Returns the total size (in bytes) of the GPU data of all assets. */
+    size_t get_memory_size() const;
+
+    /** Sets the directory with the transcoded compressed textures, applies to the textures loaded afterwards. */
+    void set_texture_cache_directory(std::filesystem::path directory) { texture_cache_directory = std::move(directory); }
+
+    /**
+     * Sets the streamer uploading the textures loaded afterwards in the background (see @link TextureStreamer). The
+     * streamer must outlive the registry.
+     */
+    void set_texture_streamer(TextureStreamer* streamer) { texture_streamer = streamer; }
+
+    /** Returns the loaded textures keyed by their paths and parameters. */
+    const std::map<std::string, std::shared_ptr<TextureAsset>>& get_textures() const { return textures; }
+
+    /** Returns the canonical path of a file, or the normalized path if it does not exist. */
+    static std::string get_canonical_path(const std::filesystem::path& path);
+
+    /**
+     * Returns the string identifying the sources of a packed texture, it lists the canonical paths and channels of all
+     * channels, e.g., "a.png#0+b.png#0", and the values of the constant ones, e.g., "=255".
+     *
+     * @param 	channels	The sources of the channels of the texture.
+     */
+    static std::string make_channels_key(const std::vector<ChannelSource>& channels);
+
+  protected:
+    /** Returns the key of a file loaded with the given parameters, the path is made canonical. */
+    static std::string make_key(const std::filesystem::path& path, const std::string& parameters);
+};
@@ -0,0 +1,173 @@
+#pragma once
+
+#include "glad.h"
+#include "glm/glm.hpp"
+#include "utils/frame_counters.hpp"
+#include <functional>
+
+/** The supported shadow quality levels. The level determines the resolution of the shadow maps and the PCF kernel. */
+enum class ShadowQuality { OFF = 0, LOW = 1, MEDIUM = 2, HIGH = 3 };
+
+/**
+ * The shadow map that splits its casters into a static and a dynamic layer. The static layer is rendered only once
+ * (or when it is explicitly invalidated) and cached. Every frame, the cached static layer is copied into the dynamic
+ * layer on the GPU and only the moving casters are rendered on top of it. The dynamic layer is the one that is
+ * sampled in shaders.
+ *
+ * Example:
+ * <code>
+ *  CachedShadowMap sun_shadow(2048);
+ *  sun_shadow.set_light_matrix(CachedShadowMap::directional_matrix(...));
+ *  ...
+ *  sun_shadow.update([&]() { draw_static_casters(); }, [&]() { draw_moving_casters(); });
+ *  sun_shadow.bind(7);
+ * </code>
+ */
+class CachedShadowMap {
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+  protected:
+    /** The resolution (width and height) of both layers. */
+    int resolution = 0;
+
+    /** The depth texture with the cached static casters. */
+    GLuint static_depth = 0;
+
+    /** The depth texture with the static layer composited with the moving casters. */
+    GLuint dynamic_depth = 0;
+
+    /** The framebuffer used for rendering into both layers. */
+    GLuint framebuffer = 0;
+
+    /** The flag determining if the static layer contains up-to-date data. */
+    bool static_valid = false;
+
+    /** The matrix transforming world space positions into the clip space of the light. */
+    glm::mat4 light_matrix = glm::mat4(1.0f);
+
+    // ----------------------------------------------------------------------------
+    // Constructors
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Constructs a new @link CachedShadowMap and allocates both depth layers.
+     *
+     * @param 	resolution	The resolution (width and height) of the shadow map.
+     */
+    CachedShadowMap(int resolution);
+
+    CachedShadowMap(const CachedShadowMap& other) = delete;
+    CachedShadowMap& operator=(const CachedShadowMap& other) = delete;
+
+    /** Destroys this @link CachedShadowMap together with its OpenGL objects. */
+    ~CachedShadowMap();
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Re-creates both layers with a new resolution. The static layer is invalidated.
+     *
+     * @param 	resolution	The new resolution (width and height) of the shadow map.
+     */
+    void resize(int resolution);
+
+    /** Marks the static layer as outdated so that it is rendered again during the next @link update. */
+    void invalidate() { static_valid = false; }
+
+    /**
+     * Renders the shadow map. The static casters are rendered only if the static layer is not valid, the dynamic
+     * casters are rendered every call. The callbacks are invoked with the shadow framebuffer and viewport bound, so
+     * they only need to issue the draw calls. Note that the method leaves the shadow framebuffer bound.
+     *
+     * @param 	draw_static 	The callback rendering the casters that do not move.
+     * @param 	draw_dynamic	The callback rendering the moving casters.
+     */
+    void update(const std::function<void()>& draw_static, const std::function<void()>& draw_dynamic);
+
+    /**
+     * Binds the composited (dynamic) layer to the specified texture unit. The texture is set up for depth
+     * comparison, so it has to be sampled using sampler2DShadow.
+     *
+     * @param 	unit	The texture unit to which the shadow map will be bound to.
+     */
+    void bind(GLuint unit) const {
+        glBindTextureUnit(unit, dynamic_depth);
+        FrameCounters::count_texture_binds();
+    }
+
+    /**
+     * Computes an orthographic light matrix for a directional light (e.g., the sun).
+     *
+     * @param 	light_position	The position of the light, only the direction towards the target is used.
+     * @param 	target		  	The center of the area that should be covered by the shadow map.
+     * @param 	half_extent   	The half size of the covered area.
+     * @param 	depth_range   	The depth range of the light frustum.
+     *
+     * @return	The light matrix (projection * view).
+     */
+    static glm::mat4 directional_matrix(const glm::vec3& light_position, const glm::vec3& target, float half_extent,
+                                        float depth_range);
+
+    /**
+     * Computes a perspective light matrix for a spot (cone) light.
+     *
+     * @param 	position  	The position of the light.
+     * @param 	direction 	The direction of the light.
+     * @param 	cutoff	  	The cosine of the cone half angle.
+     * @param 	near_plane	The near plane of the light frustum.
+     * @param 	far_plane 	The far plane of the light frustum.
+     *
+     * @return	The light matrix (projection * view).
+     */
+    static glm::mat4 spot_matrix(const glm::vec3& position, const glm::vec3& direction, float cutoff, float near_plane,
+                                 float far_plane);
+
+    /**
+     * Returns the shadow map resolution that corresponds to a given quality.
+     *
+     * @param 	quality		   	The requested quality.
+     * @param 	base_resolution	The resolution used for @link ShadowQuality::MEDIUM.
+     */
+    static int resolution_for(ShadowQuality quality, int base_resolution) {
+        switch (quality) {
+        case ShadowQuality::LOW:
+            return base_resolution / 2;
+        case ShadowQuality::HIGH:
+            return base_resolution * 2;
+        default:
+            return base_resolution;
+        }
+    }
+
+  private:
+    /** Creates the depth textures and the framebuffer. */
+    void create();
+
+    /** Deletes the depth textures and the framebuffer. */
+    void destroy();
+
+    // ----------------------------------------------------------------------------
+    // Getters & Setters
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Sets a new light matrix. The static layer is invalidated if the matrix differs from the current one.
+     *
+     * @param 	matrix	The matrix transforming world space positions into the clip space of the light.
+     */
+    void set_light_matrix(const glm::mat4& matrix) {
+        if (matrix != light_matrix) {
+            light_matrix = matrix;
+            invalidate();
+        }
+    }
+
+    /** Returns the matrix transforming world space positions into the clip space of the light. */
+    const glm::mat4& get_light_matrix() const { return light_matrix; }
+
+    /** Returns the resolution (width and height) of the shadow map. */
+    int get_resolution() const { return resolution; }
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "geometry_base.hpp"
+#include "glm/glm.hpp"
+#include <algorithm>
+#include <span>
+
+/**
+ * The selection of levels of detail based on their projected error. The error of each level (see
+ * @link LevelOfDetail::error) is projected onto the screen and the coarsest level whose error stays below the
+ * threshold (in pixels) is used.
+ * <p>
+ * To avoid popping when an object hovers around the switching distance, the selection is stateful: the caller keeps
+ * the level of each object and the selector moves to a coarser level only when its error is clearly below the threshold
+ * and to a finer level only when the current error is clearly above it.
+ *
+ * Example:
+ * <code>
+ *  const float scale = LodSelector::pixels_per_unit(model, radius, camera_position, projection, height);
+ *  lod = selector.select(geometry.lods, lod, scale);
+ *  geometry.draw_base_instance(object_index, lod);
+ * </code>
+ */
+class LodSelector {
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+  public:
+    /** The maximal acceptable projected error in pixels. */
+    float threshold = 1.0f;
+
+    /** The relative width of the band around the threshold in which the current level is kept. */
+    float hysteresis = 0.25f;
+
+    // ----------------------------------------------------------------------------
+    // Constructors
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Constructs a new @link LodSelector.
+     *
+     * @param 	threshold 	The maximal acceptable projected error in pixels.
+     * @param 	hysteresis	The relative width of the band around the threshold in which the current level is kept.
+     */
+    LodSelector(float threshold = 1.0f, float hysteresis = 0.25f) : threshold(threshold), hysteresis(hysteresis) {}
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Selects the level of detail.
+     *
+     * @param 	lods		   	The levels of detail ordered from the most detailed one.
+     * @param 	current		   	The level used in the previous frame.
+     * @param 	pixels_per_unit	The size in pixels of one object space unit (see @link pixels_per_unit).
+     *
+     * @return	The level to use.
+     */
+    int select(std::span<const LevelOfDetail> lods, int current, float pixels_per_unit) const {
+        if (lods.size() <= 1) {
+            return 0;
+        }
+        int level = std::clamp(current, 0, static_cast<int>(lods.size()) - 1);
+        auto projected = [&](int l) { return lods[l].error * pixels_per_unit; };
+
+        // Refines while the error of the current level is visible, then coarsens while the error of the next level is
+        // not. The errors grow with the level, so the two loops cannot undo each other.
+        while (level > 0 && projected(level) > threshold * (1.0f + hysteresis)) {
+            level--;
+        }
+        while (level + 1 < static_cast<int>(lods.size()) && projected(level + 1) < threshold * (1.0f - hysteresis)) {
+            level++;
+        }
+        return level;
+    }
+
+    /**
+     * Computes the size in pixels of one object space unit at the nearest point of the bounding sphere of an object.
+     *
+     * @param 	model		   	The model matrix of the object.
+     * @param 	radius		   	The radius of the bounding sphere (in object space) centered at the origin.
+     * @param 	camera_position	The position of the camera.
+     * @param 	projection	   	The perspective projection matrix.
+     * @param 	viewport_height	The height of the viewport in pixels.
+     */
+    static float pixels_per_unit(const glm::mat4& model, float radius, const glm::vec3& camera_position,
+                                 const glm::mat4& projection, float viewport_height) {
+        const float scale = std::max({glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])),
+                                      glm::length(glm::vec3(model[2]))});
+        const float distance = glm::length(glm::vec3(model[3]) - camera_position) - radius * scale;
+
+        // The camera is inside the bounding sphere, the full detail is needed.
+        if (distance <= 1e-4f) {
+            return INFINITY;
+        }
+        return scale * projection[1][1] * 0.5f * viewport_height / distance;
+    }
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "geometry.hpp"
+#include "glad.h"
+#include "glm/glm.hpp"
+#include "program.hpp"
+#include <array>
+#include <filesystem>
+
+/**
+ * The GPU culling of geometries split into meshlets (see @link MeshletBuilder). A compute pre-pass tests every meshlet
+ * against the view frustum and its normal cone and writes a compacted list of draw commands for the visible meshlets,
+ * which are then drawn by a single indirect draw call. Back-facing and off-screen parts of dense meshes are thus not
+ * processed by the vertex shader at all.
+ * <p>
+ * The number of visible meshlets is read by glMultiDrawElementsIndirectCount when it is available (OpenGL 4.6 or
+ * ARB_indirect_parameters). Otherwise, the commands buffer is cleared every frame and the whole range of the batch is
+ * drawn with glMultiDrawElementsIndirect, the commands of culled meshlets then draw zero indices.
+ * <p>
+ * The culling uses the camera of the frame, so the culled batches must be drawn only in the passes using the same camera
+ * and back-face culling (not, e.g., into shadow maps). The compute pass uses the shader storage bindings 5-7, so it
+ * does not disturb the buffers bound by the application.
+ *
+ * Example:
+ * <code>
+ *  culler.begin(projection * view, camera_position);
+ *  MeshletCuller::Batch batch = culler.cull(geometry, object_index, model);
+ *  ...
+ *  culler.draw(geometry, batch);
+ * </code>
+ */
+class MeshletCuller {
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+  public:
+    /** The commands of a single culled geometry. */
+    struct Batch {
+        /** The first command of the batch in the commands buffer. */
+        GLsizei first_command = 0;
+        /** The number of commands reserved for the batch, 0 if the geometry was not culled. */
+        GLsizei command_count = 0;
+        /** The index of the counter with the number of visible meshlets. */
+        GLuint counter = 0;
+        /** The index of the drawn object, used as the base instance. */
+        GLuint object_index = 0;
+        /** The level of detail drawn if the geometry was not culled. */
+        int lod = 0;
+    };
+
+  protected:
+    /** The compute program culling the meshlets. */
+    ShaderProgram program;
+
+    /** The buffer with the DrawElementsIndirectCommand structures of all batches. */
+    GLuint commands_buffer = 0;
+
+    /** The buffer with the number of visible meshlets of each batch. */
+    GLuint counts_buffer = 0;
+
+    /** The maximal number of commands, i.e., meshlets culled in a single frame. */
+    GLsizei max_commands;
+
+    /** The maximal number of batches, i.e., geometries culled in a single frame. */
+    GLsizei max_batches;
+
+    /** The number of commands reserved in the current frame. */
+    GLsizei used_commands = 0;
+
+    /** The number of batches of the current frame. */
+    GLsizei used_batches = 0;
+
+    /** The flag determining if the commands have to be synchronized with the compute pass before the next draw. */
+    bool barrier_pending = false;
+
+    /** The world space planes of the view frustum of the current frame. */
+    std::array<glm::vec4, 6> frustum_planes;
+
+    /** The camera position of the current frame. */
+    glm::vec3 camera_position = glm::vec3(0.0f);
+
+    // ----------------------------------------------------------------------------
+    // Constructors
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Constructs a new @link MeshletCuller, compiles the culling program, and allocates the buffers.
+     *
+     * @param 	framework_shaders_path	The folder with the framework shaders (containing meshlet_cull.comp).
+     * @param 	max_commands		  	The maximal number of meshlets culled in a single frame.
+     * @param 	max_batches			  	The maximal number of geometries culled in a single frame.
+     */
+    MeshletCuller(const std::filesystem::path& framework_shaders_path, GLsizei max_commands = 16384, GLsizei max_batches = 64);
+
+    MeshletCuller(const MeshletCuller& other) = delete;
+    MeshletCuller& operator=(const MeshletCuller& other) = delete;
+
+    /** Destroys this @link MeshletCuller together with its OpenGL objects. */
+    ~MeshletCuller();
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Starts a new frame: releases the batches of the previous frame and sets the camera used for culling.
+     *
+     * @param 	view_projection	The view-projection matrix of the camera.
+     * @param 	camera_position	The world space position of the camera.
+     */
+    void begin(const glm::mat4& view_projection, const glm::vec3& camera_position);
+
+    /**
+     * Dispatches the culling of the meshlets of a geometry. Geometries without meshlets, coarser levels of detail, and
+     * geometries that do not fit into the buffers are not culled, their batches draw the whole level. Note that the
+     * method leaves the culling program bound.
+     *
+     * @param 	geometry		The geometry to cull.
+     * @param 	object_index	The index of the object in the objects buffer (the base instance of the draws).
+     * @param 	model			The model matrix of the object.
+     * @param 	lod				The level of detail that will be drawn, only the most detailed level has meshlets.
+     *
+     * @return	The batch to pass to @link draw.
+     */
+    Batch cull(const Geometry& geometry, GLuint object_index, const glm::mat4& model, int lod = 0);
+
+    /**
+     * Draws the visible meshlets of a batch using the currently bound program.
+     *
+     * @param 	geometry	The geometry that was culled.
+     * @param 	batch		The batch returned by @link cull in the current frame.
+     */
+    void draw(const Geometry& geometry, const Batch& batch);
+
+    /**
+     * Extracts the world space planes of the view frustum (pointing inside, normalized).
+     *
+     * @param 	view_projection	The view-projection matrix.
+     */
+    static std::array<glm::vec4, 6> extract_frustum_planes(const glm::mat4& view_projection);
+};
@@ -2,43 +2,83 @@
 
 #include "glm/glm.hpp"
 #include "ubo.hpp"
+#include <cstddef>
+#include <span>
 
 /**
- * The structure representing data for a single model/geometry/object. It stores the position of the
- * object in the world via {@link ModelData::model} matrix. The structure also contains derivations of
- * this matrix for convenience.
+ * The structure representing data for a single model/geometry/object, shared by the CPU and the shaders. It stores the
+ * position of the object in the world via {@link ModelData::model_matrix} and the matrices derived from it, so that
+ * vertex shaders do not have to compute them for every vertex:
+ * - the normal matrix (the inverse of the transpose of the top-left part 3x3 of the model matrix) that changes only
+ *   when the model matrix changes,
+ * - the model-view-projection matrix that is recomputed once per frame for all objects using
+ *   {@link ModelData::compute_mvp_matrices}.
+ * The structure also carries the material of the object. Its layout is the same in std140 and std430, so it is used
+ * both by the single-object @link ModelUBO and by shader storage buffers with all objects of a scene, which are bound
+ * once per frame and indexed by the base instance of the draws (see {@link Geometry_Base::draw_base_instance}).
  *
  * @author	<a href="mailto:jan.byska@gmail.com">Jan Byška</a>
  * @author	<a href="mailto:cejka.honza@gmail.com ">Jan Čejka</a>
  */
-struct ModelData {
+struct alignas(16) ModelData {
     // ----------------------------------------------------------------------------
     // Variables
     // ----------------------------------------------------------------------------
-    /** The model matrix.*/
-    glm::mat4 model;
-    /** The inverse of the model matrix. */
-    glm::mat4 model_inv;
-    /**The inverse of the transpose of the top-left part 3x3 of the model matrix.*/
-    glm::mat3x4 model_it;
+    /** The model matrix. */
+    glm::mat4 model_matrix = glm::mat4(1.0f); // [  0 -  64) bytes
+    /** The model-view-projection matrix. */
+    glm::mat4 mvp_matrix = glm::mat4(1.0f); // [ 64 - 128) bytes
+    /** The inverse of the transpose of the top-left part 3x3 of the model matrix (padded as mat3). */
+    glm::mat3x4 normal_matrix = glm::mat3x4(1.0f); // [128 - 176) bytes
+    /** The ambient color of the material. */
+    glm::vec4 ambient_color = glm::vec4(0.0f); // [176 - 192) bytes
+    /** The diffuse color of the material. */
+    glm::vec4 diffuse_color = glm::vec4(1.0f); // [192 - 208) bytes
+    /** The specular color of the material, contains shininess in .w element. */
+    glm::vec4 specular_color = glm::vec4(0.0f); // [208 - 224) bytes
 
     // ----------------------------------------------------------------------------
-    // Constructors
+    // Methods
     // ----------------------------------------------------------------------------
-    /** Constructs a new {@link ModelData} with identity matrix. */
-    ModelData() : ModelData(glm::mat4(1.0f)) {}
-
+  public:
     /**
-     * Constructs a new {@link ModelData} with a custom matrix.
+     * Sets a new model matrix and updates the normal matrix.
      *
-     * @param 	model	The model matrix.
+     * @param 	model	The model matrix to set.
      */
-    ModelData(const glm::mat4& model) : model(model) {
-        model_inv = inverse(model);
-        model_it = glm::mat3x4(transpose(inverse(glm::mat3(model))));
+    void set_model_matrix(const glm::mat4& model) {
+        model_matrix = model;
+        update_normal_matrix();
     }
+
+    /** Recomputes the normal matrix from the current model matrix. */
+    void update_normal_matrix() { normal_matrix = glm::mat3x4(glm::transpose(glm::inverse(glm::mat3(model_matrix)))); }
+
+    /**
+     * Recomputes the normal matrices of all objects.
+     *
+     * @param 	objects	The objects to update.
+     */
+    static void compute_normal_matrices(std::span<ModelData> objects);
+
+    /**
+     * Recomputes the model-view-projection matrices of all objects. The view-projection matrix is kept in registers
+     * and multiplied with all model matrices using SIMD instructions (with a scalar fallback).
+     *
+     * @param 	objects		   	The objects to update.
+     * @param 	view_projection	The view-projection matrix of the camera (projection * view).
+     */
+    static void compute_mvp_matrices(std::span<ModelData> objects, const glm::mat4& view_projection);
 };
 
+// Assert the layout
+static_assert(offsetof(ModelData, model_matrix) == 0, "Incorrect ModelData layout");
+static_assert(offsetof(ModelData, mvp_matrix) == 64, "Incorrect ModelData layout");
+static_assert(offsetof(ModelData, normal_matrix) == 128, "Incorrect ModelData layout");
+static_assert(offsetof(ModelData, ambient_color) == 176, "Incorrect ModelData layout");
+static_assert(offsetof(ModelData, specular_color) == 208, "Incorrect ModelData layout");
+static_assert(sizeof(ModelData) == 224, "Incorrect ModelData layout");
+
 /**
  * Contains the model matrix, which defines the position of the object in the world, and derivations of
  * this matrix.
@@ -47,23 +87,31 @@ struct ModelData {
  * <code>
  * layout (std140) uniform ModelData
  * {
- *  mat4 model;			// The model matrix.
- *  mat4 model_inv;		// The inverse of the model matrix.
- *  mat3 model_it;		// The inverse of the transpose of the top-left part 3x3 of the model matrix.
+ *  mat4 model_matrix;		// The model matrix.
+ *  mat4 mvp_matrix;		// The model-view-projection matrix.
+ *  mat3 normal_matrix;		// The inverse of the transpose of the top-left part 3x3 of the model matrix.
+ *  vec4 ambient_color;
+ *  vec4 diffuse_color;
+ *  vec4 specular_color;	// Contains shininess in .w element.
  * };
  *
- * or a set of multiple objects
+ * or a shader storage buffer with multiple objects
  *
- * struct SingleModelData
+ * struct Object
  * {
- *  mat4 model;			// The model matrix.
- *  mat4 model_inv;		// The inverse of the model matrix.
- *  mat3 model_it;		// The inverse of the transpose of the top-left part 3x3 of the model matrix.
+ *  mat4 model_matrix;
+ *  mat4 mvp_matrix;
+ *  mat3 normal_matrix;
+ *  vec4 ambient_color;
+ *  vec4 diffuse_color;
+ *  vec4 specular_color;
  * };
- * layout (std140) uniform ModelData
+ * layout (binding = 2, std430) readonly buffer Objects
  * {
- *  SingleModelData models[#count];
+ *  Object objects[];
  * };
+ * ...
+ * Object object = objects[gl_BaseInstanceARB];
  * </code>
  */
 class ModelUBO : public UBO<ModelData> {
@@ -72,13 +120,7 @@ class ModelUBO : public UBO<ModelData> {
     // Constructors
     // ----------------------------------------------------------------------------
   public:
-    ModelUBO() : UBO<ModelData>(GL_DYNAMIC_STORAGE_BIT) {
-        // Assert the layout
-        static_assert(offsetof(ModelData, model) == 0, "Incorrect ModelData layout");
-        static_assert(offsetof(ModelData, model_inv) == 64, "Incorrect ModelData layout");
-        static_assert(offsetof(ModelData, model_it) == 128, "Incorrect ModelData layout");
-        static_assert(sizeof(ModelData) == 176, "Incorrect ModelData layout");
-    }
+    ModelUBO() : UBO<ModelData>(GL_DYNAMIC_STORAGE_BIT) {}
 
     // ----------------------------------------------------------------------------
     // Getters & Setters
@@ -96,5 +138,5 @@ class ModelUBO : public UBO<ModelData> {
      * @param 	idx  	Zero-based index of position in the buffer that will be updated.
      * @param 	model	The model matrix to set.
      */
-    void set_matrix(int idx, const glm::mat4& model) { data[idx] = ModelData(model); }
+    void set_matrix(int idx, const glm::mat4& model) { data[idx].set_model_matrix(model); }
 };
\ No newline at end of file
@@ -18,7 +18,7 @@ class SceneObject {
   protected:
     /** The UBO containing the model data. */
     ModelUBO model_ubo;
-    /** The geometry representation of the scene object. */
+    /** The geometry representation of the scene object. The GPU data are shared with other objects using the same mesh. */
     Geometry geometry;
     /** The current color. */
     Color color;
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "asset_registry.hpp"
+#include "textured_material.hpp"
+#include <unordered_map>
+
+/**
+ * The manager keeping the memory of the loaded textures under a budget by clamping their most detailed mip levels. The
+ * renderer reports every textured draw with the projected size of the object (see @link request), from which the
+ * finest level that can be visible is estimated: a texture of N texels drawn over P pixels never samples levels finer
+ * than log2(N / P). The requests are collected over several frames and evaluated by @link update.
+ * <p>
+ * The finer levels are loaded again when a texture needs them and the budget allows it. Under the budget pressure the
+ * textures lose levels greedily, starting with the textures that were not drawn, then the textures holding levels finer
+ * than needed, and at last the visible ones; the largest level is dropped first within each group. Levels are dropped
+ * immediately but loaded only when they are needed by two evaluations in a row, and the number of textures loading
+ * levels per evaluation is limited, so an object crossing the threshold does not make its texture reload repeatedly.
+ *
+ * Example:
+ * <code>
+ *  TextureBudget budget(256 << 20);
+ *  ...
+ *  // every frame
+ *  const float size = LodSelector::pixels_per_unit(model, radius, camera_position, projection, height) * 2.0f * radius;
+ *  budget.request(*wood, size);
+ *  wood->bind(3);
+ *  ...
+ *  budget.update(assets);
+ * </code>
+ */
+class TextureBudget {
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+  public:
+    /** The maximal size (in bytes) of the resident levels of all textures. */
+    size_t budget;
+
+    /** The number of levels kept finer than the estimate, covers textures repeated over their objects. */
+    int bias = 1;
+
+    /** The number of frames over which the requests are collected. */
+    int evaluation_period = 30;
+
+    /** The maximal number of textures loading finer levels per evaluation. */
+    int max_changes = 4;
+
+  protected:
+    /** The finest level requested for each texture since the last evaluation. */
+    std::unordered_map<const TextureAsset*, int> needed_levels;
+
+    /** The number of evaluations in a row that wanted finer levels of each texture. */
+    std::unordered_map<const TextureAsset*, int> raise_votes;
+
+    /** The number of frames since the last evaluation. */
+    int frame = 0;
+
+    /** The size (in bytes) of the resident levels of all textures after the last evaluation. */
+    size_t resident_size = 0;
+
+    /** The number of textures whose most detailed levels are dropped. */
+    size_t clamped_count = 0;
+
+    // ----------------------------------------------------------------------------
+    // Constructors
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Constructs a new @link TextureBudget.
+     *
+     * @param 	budget	The maximal size (in bytes) of the resident levels of all textures.
+     */
+    explicit TextureBudget(size_t budget = 256 << 20) : budget(budget) {}
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Records that the texture is drawn in this frame.
+     *
+     * @param 	texture		  	The drawn texture.
+     * @param 	projected_size	The size (in pixels) of the drawn object on the screen, e.g., the projected diameter of
+     * 							its bounding sphere.
+     */
+    void request(const TextureAsset& texture, float projected_size);
+
+    /** Records that all textures of the material are drawn in this frame (see @link request). */
+    void request(const TexturedMaterial& material, float projected_size);
+
+    /**
+     * Counts the frame and, once per @link evaluation_period frames, changes the resident levels of the textures to fit
+     * the needs and the budget. Call once per frame after all requests.
+     *
+     * @param 	assets	The registry holding the managed textures.
+     */
+    void update(const AssetRegistry& assets);
+
+    /**
+     * Returns the finest level of the texture that can be sampled on an object of the given size.
+     *
+     * @param 	texture		  	The texture.
+     * @param 	projected_size	The size (in pixels) of the drawn object on the screen.
+     */
+    int get_needed_level(const TextureAsset& texture, float projected_size) const;
+
+    // ----------------------------------------------------------------------------
+    // Getters & Setters
+    // ----------------------------------------------------------------------------
+  public:
+    /** Returns the size (in bytes) of the resident levels of all textures after the last evaluation. */
+    size_t get_resident_size() const { return resident_size; }
+
+    /** Returns the number of textures whose most detailed levels are dropped. */
+    size_t get_clamped_count() const { return clamped_count; }
+};
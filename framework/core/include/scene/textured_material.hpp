@@ -0,0 +1,124 @@
+#pragma once
+
+#include "program.hpp"
+#include "texture_asset.hpp"
+#include <array>
+#include <memory>
+
+/**
+ * The material of the textured shader: up to three textures, the channels from which the ambient, diffuse, and
+ * specular colors are read, and an optional normal map. A color may use the RGB of a texture or a single channel
+ * broadcast to gray, so single-channel maps packed together (see @link ChannelSource) are described by the channel
+ * they occupy. The shader samples every used texture once per fragment, no matter how many colors it provides.
+ *
+ * Use this code in shaders:
+ * <code>
+ * layout(location = 3) uniform ivec2 ambient_source = ivec2(-1, 4);	// (texture, channel), -1 = no texture, 4 = RGB
+ * layout(location = 4) uniform ivec2 diffuse_source = ivec2(-1, 4);
+ * layout(location = 5) uniform ivec2 specular_source = ivec2(-1, 4);
+ * layout(location = 6) uniform bool has_normal_texture = false;
+ * layout(binding = 3) uniform sampler2D material_textures[3];
+ * layout(binding = 6) uniform sampler2D normal_texture;
+ * </code>
+ *
+ * Example:
+ * <code>
+ *  TexturedMaterial material;
+ *  material.set_texture(0, assets.load_texture(images_path / "diffuse.jpg"))
+ *          .set_texture(1, assets.load_packed_texture({{images_path / "ao.png"}, {images_path / "specular.png"}}))
+ *          .set_diffuse(0)
+ *          .set_ambient(1, 0)
+ *          .set_specular(1, 1);
+ *  material.bind(program);
+ * </code>
+ */
+class TexturedMaterial {
+    // ----------------------------------------------------------------------------
+    // Types
+    // ----------------------------------------------------------------------------
+  public:
+    /** The channel selecting the RGB of a texture instead of a single channel. */
+    static constexpr int RGB = 4;
+
+    /** The number of textures besides the normal map. */
+    static constexpr int TEXTURE_COUNT = 3;
+
+    /** The texture unit of the first texture, the others follow. */
+    static constexpr GLuint FIRST_UNIT = 3;
+
+    /** The texture unit of the normal map. */
+    static constexpr GLuint NORMAL_UNIT = 6;
+
+    /** The source of a color of the material. */
+    struct Source {
+        /** The index of the texture, -1 if the color is not textured. */
+        int texture = -1;
+        /** The channel of the texture (0 = red, ..., 3 = alpha) read as gray, or @link RGB. */
+        int channel = RGB;
+    };
+
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+  protected:
+    /** The textures of the material. */
+    std::array<std::shared_ptr<TextureAsset>, TEXTURE_COUNT> textures;
+
+    /** The normal map, @p nullptr if the material has none. */
+    std::shared_ptr<TextureAsset> normal_texture;
+
+    /** The source of the ambient color. */
+    Source ambient;
+
+    /** The source of the diffuse color. */
+    Source diffuse;
+
+    /** The source of the specular color. */
+    Source specular;
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Sets a texture of the material.
+     *
+     * @param 	index  	The index of the texture (0 to @link TEXTURE_COUNT - 1).
+     * @param 	texture	The texture.
+     *
+     * @return	This material, so the calls can be chained.
+     */
+    TexturedMaterial& set_texture(int index, std::shared_ptr<TextureAsset> texture);
+
+    /** Sets the normal map (a BC5 or RG map, the shader reconstructs Z). */
+    TexturedMaterial& set_normal_texture(std::shared_ptr<TextureAsset> texture);
+
+    /** Reads the ambient color from the channel of the texture (see @link Source). */
+    TexturedMaterial& set_ambient(int texture, int channel = RGB);
+
+    /** Reads the diffuse color from the channel of the texture (see @link Source). */
+    TexturedMaterial& set_diffuse(int texture, int channel = RGB);
+
+    /** Reads the specular color from the channel of the texture (see @link Source). */
+    TexturedMaterial& set_specular(int texture, int channel = RGB);
+
+    /**
+     * Binds the textures to their units and sets the uniforms describing the channels.
+     *
+     * @param 	program	The textured shader program.
+     */
+    void bind(const ShaderProgram& program) const;
+
+    /** Returns the number of textures sampled per fragment (including the normal map). */
+    int get_fetch_count() const;
+
+    // ----------------------------------------------------------------------------
+    // Getters & Setters
+    // ----------------------------------------------------------------------------
+  public:
+    /** Returns the textures of the material, the missing ones are @p nullptr. */
+    const std::array<std::shared_ptr<TextureAsset>, TEXTURE_COUNT>& get_textures() const { return textures; }
+
+    /** Returns the normal map, @p nullptr if the material has none. */
+    const std::shared_ptr<TextureAsset>& get_normal_texture() const { return normal_texture; }
+};
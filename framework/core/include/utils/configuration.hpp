@@ -51,4 +51,9 @@ public:
     std::filesystem::path get_path(const std::string& key, std::string fallback = "") {
         return toml::find_or<std::string>(configuration, key, fallback);
     }
+
+    /** Retrieves an integer from the TOML variable specified via key, if no such variable is found in the configuration file, the specified fallback is returned instead. */
+    int64_t get_integer(const std::string& key, int64_t fallback = 0) {
+        return toml::find_or<int64_t>(configuration, key, fallback);
+    }
 };
\ No newline at end of file
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * The class providing static utility methods recording the time spent by the CPU in named zones (see
+ * @link ProfileScope) into Chrome trace files, which can be opened by https://ui.perfetto.dev or chrome://tracing.
+ * <p>
+ * Every thread records its zones into its own ring buffer, which only the thread writes and only @link flush reads,
+ * so recording a zone takes two clock reads and a few stores without any locks. Outside of a session the zones are
+ * not recorded at all, so they may stay in the code of release builds. A full ring buffer drops the new zones (see
+ * @link get_dropped_count) instead of blocking the thread; @link OpenGLManager::run flushes the buffers every frame.
+ * <p>
+ * The names of the zones are not copied, they must outlive the session (e.g., string literals).
+ *
+ * Example:
+ * <code>
+ *  CpuProfiler::begin_session("profiles/startup.json");
+ *  {
+ *      ProfileScope zone("load meshes");
+ *      ...
+ *  }
+ *  CpuProfiler::end_session();
+ * </code>
+ */
+class CpuProfiler {
+    // ----------------------------------------------------------------------------
+    // Types
+    // ----------------------------------------------------------------------------
+  public:
+    /** The number of zones held by the ring buffer of a thread. */
+    static const size_t BUFFER_CAPACITY = 1 << 14;
+
+  protected:
+    /** A finished zone. */
+    struct Zone {
+        /** The name of the zone. */
+        const char* name = nullptr;
+        /** The start of the zone (in nanoseconds of the steady clock). */
+        int64_t begin = 0;
+        /** The end of the zone (in nanoseconds of the steady clock). */
+        int64_t end = 0;
+    };
+
+    /** The single-producer single-consumer ring buffer of a thread. */
+    struct ThreadBuffer {
+        /** The identifier of the thread in the trace. */
+        uint32_t id = 0;
+        /** The name of the thread in the trace, empty if not set (guarded by @link mutex). */
+        std::string name;
+        /** The recorded zones, indexed by their number modulo @link BUFFER_CAPACITY. */
+        std::array<Zone, BUFFER_CAPACITY> zones;
+        /** The number of zones written by the thread. */
+        std::atomic<uint64_t> head{0};
+        /** The number of zones read by @link flush. */
+        std::atomic<uint64_t> tail{0};
+    };
+
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+  protected:
+    /** The flag determining if the zones are recorded. */
+    static inline std::atomic<bool> recording{false};
+
+    /** The number of zones dropped because of a full ring buffer in the current session. */
+    static inline std::atomic<uint64_t> dropped_count{0};
+
+    /** The mutex guarding the variables below. */
+    static inline std::mutex mutex;
+
+    /** The buffers of all threads that have recorded a zone; the buffers of finished threads are kept. */
+    static inline std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+    /** The trace file of the current session. */
+    static inline std::ofstream file;
+
+    /** The path of the trace file of the current session. */
+    static inline std::filesystem::path path;
+
+    /** The start of the current session (in nanoseconds of the steady clock), the origin of the trace. */
+    static inline int64_t session_start = 0;
+
+    /** The number of zones written into the trace file of the current session. */
+    static inline uint64_t written_count = 0;
+
+    /** The ring buffer of the calling thread, @p nullptr until it records its first zone. */
+    static inline thread_local ThreadBuffer* thread_buffer = nullptr;
+
+    /** The name of the calling thread set by @link set_thread_name, empty if not set. */
+    static inline thread_local std::string thread_name;
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Starts recording the zones into a new trace file, the current session is ended first.
+     *
+     * @param 	path	The path of the trace file, its directory is created if needed.
+     *
+     * @return	@p false if the file could not be created.
+     */
+    static bool begin_session(const std::filesystem::path& path);
+
+    /** Stops recording the zones, writes the remaining ones and closes the trace file. */
+    static void end_session();
+
+    /** Moves the zones recorded by all threads into the trace file, called once per frame by @link OpenGLManager::run. */
+    static void flush();
+
+    /**
+     * Names the calling thread in the traces (e.g., 'main' or 'worker 3').
+     *
+     * @param 	name	The name of the thread.
+     */
+    static void set_thread_name(const std::string& name);
+
+    /** Returns the current time of the steady clock (in nanoseconds). */
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * Records a finished zone into the ring buffer of the calling thread, called by @link ProfileScope.
+     *
+     * @param 	name 	The name of the zone.
+     * @param 	begin	The start of the zone (in nanoseconds of the steady clock).
+     * @param 	end  	The end of the zone (in nanoseconds of the steady clock).
+     */
+    static void record(const char* name, int64_t begin, int64_t end) {
+        ThreadBuffer* buffer = thread_buffer ? thread_buffer : register_thread();
+        // Only this thread writes the head, the tail is advanced by flush once the zones are read.
+        const uint64_t head = buffer->head.load(std::memory_order_relaxed);
+        if (head - buffer->tail.load(std::memory_order_acquire) >= BUFFER_CAPACITY) {
+            dropped_count.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        buffer->zones[head % BUFFER_CAPACITY] = Zone{name, begin, end};
+        buffer->head.store(head + 1, std::memory_order_release);
+    }
+
+  protected:
+    /** Creates the ring buffer of the calling thread. */
+    static ThreadBuffer* register_thread();
+
+    /** Writes the zones of a buffer into the trace file, the caller holds @link mutex. */
+    static void write_zones(ThreadBuffer& buffer);
+
+    // ----------------------------------------------------------------------------
+    // Getters & Setters
+    // ----------------------------------------------------------------------------
+  public:
+    /** Checks if the zones are being recorded. */
+    static bool is_recording() { return recording.load(std::memory_order_relaxed); }
+
+    /** Returns the path of the trace file of the current (or the last) session. */
+    static std::filesystem::path get_path();
+
+    /** Returns the number of zones dropped because of a full ring buffer in the current (or the last) session. */
+    static uint64_t get_dropped_count() { return dropped_count.load(std::memory_order_relaxed); }
+
+    /** Returns the number of zones written into the trace file of the current (or the last) session. */
+    static uint64_t get_written_count();
+};
+
+/**
+ * The RAII marker of a zone recorded by @link CpuProfiler, the zone spans from the construction to the destruction
+ * of the marker. The zones nest, so a scope inside another one shows up beneath it in the trace.
+ *
+ * Example:
+ * <code>
+ *  void Application::update(float delta) {
+ *      ProfileScope zone("update");
+ *      ...
+ *  }
+ * </code>
+ */
+class ProfileScope {
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+  protected:
+    /** The name of the zone. */
+    const char* name;
+
+    /** The start of the zone, -1 if no session was recording when the zone started. */
+    int64_t begin;
+
+    // ----------------------------------------------------------------------------
+    // Constructors
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Starts a zone.
+     *
+     * @param 	name	The name of the zone, it must outlive the session (e.g., a string literal).
+     */
+    explicit ProfileScope(const char* name) : name(name), begin(CpuProfiler::is_recording() ? CpuProfiler::now() : -1) {}
+
+    ProfileScope(const ProfileScope& other) = delete;
+    ProfileScope& operator=(const ProfileScope& other) = delete;
+
+    /** Ends the zone. */
+    ~ProfileScope() {
+        if (begin >= 0) {
+            CpuProfiler::record(name, begin, CpuProfiler::now());
+        }
+    }
+};
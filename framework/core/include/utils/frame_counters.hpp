@@ -0,0 +1,150 @@
+#pragma once
+
+#include "glad.h"
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+/** The work submitted to OpenGL during a single frame (see @link FrameCounters). */
+struct FrameStatistics {
+    /** The number of draw commands (an indirect multi-draw counts once). */
+    uint64_t draw_calls = 0;
+    /** The number of drawn instances. */
+    uint64_t instances = 0;
+    /** The number of submitted vertices (or indices) of all instances, without the indirect draws. */
+    uint64_t vertices = 0;
+    /** The number of submitted triangles of all instances, without the indirect draws. */
+    uint64_t triangles = 0;
+    /** The number of times a different program was made current. */
+    uint64_t program_switches = 0;
+    /** The number of textures bound to texture units. */
+    uint64_t texture_binds = 0;
+    /** The number of uploads into buffers. */
+    uint64_t buffer_uploads = 0;
+    /** The number of bytes uploaded into buffers. */
+    uint64_t uploaded_bytes = 0;
+    /** The number of created OpenGL objects (buffers, textures, vertex arrays, framebuffers, programs, ...). */
+    uint64_t objects_created = 0;
+};
+
+/**
+ * The class providing static utility methods counting the work submitted to OpenGL per frame. The framework classes
+ * count their draws (@link Geometry_Base), program switches (@link ShaderProgram), texture binds, buffer uploads, and
+ * created objects; the application code calling OpenGL directly counts its calls the same way. Only the reported calls
+ * are counted, e.g., the draws of the ImGui renderer are not. The counters are plain increments, so they can stay
+ * enabled in release builds.
+ * <p>
+ * @link OpenGLManager::run closes every frame by @link end_frame, which keeps the last frame and a short history.
+ * @link render_ui shows them in an ImGui panel and @link to_json dumps them in a machine-readable form; e.g., a number
+ * of objects created in every frame reveals the resources that are recreated (or leaked) while rendering.
+ * <p>
+ * All methods must be called from the thread owning the OpenGL context.
+ *
+ * Example:
+ * <code>
+ *  glNamedBufferSubData(buffer, 0, sizeof(CameraUBO), &camera_ubo);
+ *  FrameCounters::count_upload(sizeof(CameraUBO));
+ *  ...
+ *  FrameCounters::render_ui();
+ * </code>
+ */
+class FrameCounters {
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+  public:
+    /** The number of frames kept in the history. */
+    static const size_t HISTORY_SIZE = 120;
+
+  protected:
+    /** The counters of the current frame. */
+    static inline FrameStatistics current;
+
+    /** The counters of the last finished frames, indexed by the frame number modulo @link HISTORY_SIZE. */
+    static inline std::array<FrameStatistics, HISTORY_SIZE> history;
+
+    /** The number of finished frames. */
+    static inline uint64_t frame_count = 0;
+
+    /** The program made current by the last counted switch, forgotten at the end of every frame. */
+    static inline GLuint current_program = 0;
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Counts a draw command.
+     *
+     * @param 	mode     	The primitive mode of the draw (e.g., GL_TRIANGLES).
+     * @param 	vertices 	The number of vertices (or indices) of a single instance.
+     * @param 	instances	The number of instances.
+     */
+    static void count_draw(GLenum mode, uint64_t vertices, uint64_t instances = 1) {
+        current.draw_calls++;
+        current.instances += instances;
+        current.vertices += vertices * instances;
+        current.triangles += get_triangle_count(mode, vertices) * instances;
+    }
+
+    /** Counts an indirect draw, whose numbers of vertices and instances are known only to the GPU. */
+    static void count_indirect_draw() { current.draw_calls++; }
+
+    /**
+     * Counts a program made current, only a program different from the previous one is counted as a switch. The
+     * programs made current by uncounted calls (e.g., by ImGui) are not known, so the first program of every frame is
+     * always counted.
+     */
+    static void count_program(GLuint program) {
+        if (program != current_program) {
+            current.program_switches++;
+            current_program = program;
+        }
+    }
+
+    /** Counts textures bound to texture units. */
+    static void count_texture_binds(uint64_t count = 1) { current.texture_binds += count; }
+
+    /** Counts an upload of the given number of bytes into a buffer. */
+    static void count_upload(uint64_t bytes) {
+        current.buffer_uploads++;
+        current.uploaded_bytes += bytes;
+    }
+
+    /** Counts created OpenGL objects. */
+    static void count_objects_created(uint64_t count = 1) { current.objects_created += count; }
+
+    /** Finishes the current frame and starts counting the next one, called by @link OpenGLManager::run after the swap. */
+    static void end_frame();
+
+    /** Returns the number of triangles formed by the vertices of a single instance drawn with the mode. */
+    static uint64_t get_triangle_count(GLenum mode, uint64_t vertices);
+
+    /** Returns the counters of the last finished frame. */
+    static const FrameStatistics& get_last_frame();
+
+    /** Returns the averages of the counters over the history (at most @link HISTORY_SIZE frames). */
+    static FrameStatistics get_average();
+
+    /** Returns the minima of the counters over the history (at most @link HISTORY_SIZE frames). */
+    static FrameStatistics get_minimum();
+
+    /** Returns the maxima of the counters over the history (at most @link HISTORY_SIZE frames). */
+    static FrameStatistics get_maximum();
+
+    /** Returns the number of finished frames. */
+    static uint64_t get_frame_count() { return frame_count; }
+
+    /**
+     * Returns the counters as a JSON object with the number of finished frames and the counters of the last frame,
+     * their averages, and their maxima over the history.
+     */
+    static std::string to_json();
+
+    /** Writes @link to_json into the file, returns @p false on failure. */
+    static bool write_json(const std::filesystem::path& path);
+
+    /** Shows the counters in an ImGui window, with a button writing them into 'frame_counters.json'. */
+    static void render_ui();
+};
@@ -0,0 +1,212 @@
+#pragma once
+
+#include "glad.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <source_location>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/** The types of the OpenGL objects tracked by @link GLObjectTracker. */
+enum class GLObjectType { BUFFER, TEXTURE, VERTEX_ARRAY, FRAMEBUFFER, RENDERBUFFER, PROGRAM, SHADER, COUNT };
+
+/** The objects of a single type tracked by @link GLObjectTracker. */
+struct GLObjectStatistics {
+    /** The number of live objects. */
+    uint64_t live_count = 0;
+    /** The memory of the live objects (in bytes). */
+    uint64_t live_bytes = 0;
+    /** The number of created objects. */
+    uint64_t created_count = 0;
+    /** The number of deleted objects. */
+    uint64_t deleted_count = 0;
+    /** The memory allocated by the created (or resized) objects (in bytes). */
+    uint64_t allocated_bytes = 0;
+    /** The memory released by the deleted (or resized) objects (in bytes). */
+    uint64_t released_bytes = 0;
+};
+
+/** The live objects created at a single place of the code (see @link GLObjectTracker::get_sites). */
+struct GLObjectSite {
+    /** The type of the objects. */
+    GLObjectType type;
+    /** The place creating the objects, 'file:line (function)'. */
+    std::string location;
+    /** The number of live objects. */
+    uint64_t count = 0;
+    /** The memory of the live objects (in bytes). */
+    uint64_t bytes = 0;
+};
+
+/**
+ * The class providing static utility methods tracking the lifetime of OpenGL objects. The framework classes creating
+ * OpenGL objects (@link TypedTexture, @link UBO, @link ShaderProgram, @link GeometryResource, @link BufferArena, ...)
+ * report their creation (with the size of their storage) and deletion, the application code calling OpenGL directly
+ * reports its objects the same way. Every created object is also counted by @link FrameCounters.
+ * <p>
+ * The tracker keeps the live objects with the places of the code that created them, so the objects that are never
+ * deleted can be attributed to their source (see @link report). @link end_frame, called by @link OpenGLManager::run,
+ * keeps the numbers of objects created and deleted during the last frame, which reveals the objects recreated in
+ * every frame even if they are not leaked. It also checks the numbers of live objects every @link CHECK_INTERVAL
+ * frames: if the number of objects of a type grows at @link growth_limit checks in a row, the objects are reported
+ * as growing without bound, and the application is optionally aborted (e.g., in automated test runs).
+ * <p>
+ * All methods must be called from the thread owning the OpenGL context.
+ *
+ * Example:
+ * <code>
+ *  glCreateBuffers(1, &buffer);
+ *  glNamedBufferStorage(buffer, size, nullptr, 0);
+ *  GLObjectTracker::on_create(GLObjectType::BUFFER, buffer, size);
+ *  ...
+ *  glDeleteBuffers(1, &buffer);
+ *  GLObjectTracker::on_delete(GLObjectType::BUFFER, buffer);
+ * </code>
+ */
+class GLObjectTracker {
+    // ----------------------------------------------------------------------------
+    // Types
+    // ----------------------------------------------------------------------------
+  public:
+    /** The number of tracked types. */
+    static const size_t TYPE_COUNT = static_cast<size_t>(GLObjectType::COUNT);
+
+    /** The number of frames between two checks of the numbers of live objects. */
+    static const uint64_t CHECK_INTERVAL = 60;
+
+  protected:
+    /** A live object. */
+    struct Record {
+        /** The size of the storage of the object (in bytes). */
+        uint64_t size = 0;
+        /** The place of the code that created the object. */
+        std::source_location location;
+    };
+
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+  protected:
+    /** The live objects, indexed by their types and names (see @link get_key). */
+    static inline std::unordered_map<uint64_t, Record> objects;
+
+    /** The objects of all types since the start of the application. */
+    static inline std::array<GLObjectStatistics, TYPE_COUNT> totals;
+
+    /** The objects created and deleted during the current frame. */
+    static inline std::array<GLObjectStatistics, TYPE_COUNT> current;
+
+    /** The objects created and deleted during the last finished frame, with the live objects at its end. */
+    static inline std::array<GLObjectStatistics, TYPE_COUNT> last_frame;
+
+    /** The number of finished frames. */
+    static inline uint64_t frame_count = 0;
+
+    /** The numbers of live objects at the last check. */
+    static inline std::array<uint64_t, TYPE_COUNT> checked_counts{};
+
+    /** The numbers of checks in a row at which the numbers of live objects grew. */
+    static inline std::array<uint64_t, TYPE_COUNT> growth_streaks{};
+
+    /** The number of checks in a row with a growing number of objects that is considered unbounded. */
+    static inline uint64_t growth_limit = 10;
+
+    /** The flag determining if the application is aborted once the objects grow without bound. */
+    static inline bool abort_on_growth = false;
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Records a created object.
+     *
+     * @param 	type    	The type of the object.
+     * @param 	name    	The name of the object.
+     * @param 	size    	The size of the storage of the object (in bytes), 0 if unknown or without storage.
+     * @param 	location	The place of the code creating the object, the caller by default.
+     */
+    static void on_create(GLObjectType type, GLuint name, uint64_t size = 0,
+                          const std::source_location& location = std::source_location::current());
+
+    /**
+     * Records a new size of the storage of an object (e.g., a buffer whose storage is allocated after its creation).
+     *
+     * @param 	type	The type of the object.
+     * @param 	name	The name of the object.
+     * @param 	size	The new size of the storage of the object (in bytes).
+     */
+    static void on_resize(GLObjectType type, GLuint name, uint64_t size);
+
+    /**
+     * Records a deleted object, the objects named 0 are ignored.
+     *
+     * @param 	type	The type of the object.
+     * @param 	name	The name of the object.
+     */
+    static void on_delete(GLObjectType type, GLuint name);
+
+    /** Finishes the current frame and checks if the objects grow, called by @link OpenGLManager::run after the swap. */
+    static void end_frame();
+
+    /** Returns the live objects grouped by the places that created them, the most numerous first. */
+    static std::vector<GLObjectSite> get_sites();
+
+    /** Writes the live objects of all types and the places that created them. */
+    static void report(std::ostream& stream);
+
+    /** Shows the live objects and the objects created during the last frame in an ImGui window. */
+    static void render_ui();
+
+    /** Returns the name of the type (e.g., 'buffer'). */
+    static const char* get_type_name(GLObjectType type);
+
+    /**
+     * Returns the memory of a texture with the internal format (the formats unknown to the tracker count 4 bytes per
+     * texel).
+     *
+     * @param 	internal_format	The internal format of the texture (e.g., GL_RGBA8).
+     * @param 	width          	The width of the base level.
+     * @param 	height         	The height of the base level.
+     * @param 	levels         	The number of mipmap levels.
+     */
+    static uint64_t get_texture_size(GLenum internal_format, int width, int height, int levels = 1);
+
+  protected:
+    /** Returns the key of an object in @link objects. */
+    static uint64_t get_key(GLObjectType type, GLuint name) { return static_cast<uint64_t>(type) << 32 | name; }
+
+    /** Checks the numbers of live objects, called every @link CHECK_INTERVAL frames. */
+    static void check_growth();
+
+    // ----------------------------------------------------------------------------
+    // Getters & Setters
+    // ----------------------------------------------------------------------------
+  public:
+    /** Returns the objects of the type since the start of the application. */
+    static const GLObjectStatistics& get_totals(GLObjectType type) { return totals[static_cast<size_t>(type)]; }
+
+    /** Returns the objects of the type created and deleted during the last finished frame. */
+    static const GLObjectStatistics& get_last_frame(GLObjectType type) { return last_frame[static_cast<size_t>(type)]; }
+
+    /** Returns the number of live objects of all types. */
+    static size_t get_live_count() { return objects.size(); }
+
+    /** Checks if the number of objects of the type is considered growing without bound. */
+    static bool is_growing(GLObjectType type) { return growth_streaks[static_cast<size_t>(type)] >= growth_limit; }
+
+    /**
+     * Sets when the objects are considered growing without bound, and what happens then.
+     *
+     * @param 	checks	The number of checks in a row (every @link CHECK_INTERVAL frames) at which the number of live
+     * 					objects grew.
+     * @param 	abort 	@p true to abort the application (after printing the report), @p false to only report the objects.
+     */
+    static void set_growth_limit(uint64_t checks, bool abort) {
+        growth_limit = std::max<uint64_t>(checks, 1);
+        abort_on_growth = abort;
+    }
+};
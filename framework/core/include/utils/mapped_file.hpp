@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+/**
+ * The read-only memory mapping of a whole file. The contents are paged in by the operating system on demand, so large
+ * files can be parsed without copying them into memory first. The mapping is released when the object is destroyed.
+ *
+ * Example:
+ * <code>
+ *  MappedFile file(path);
+ *  if (file.is_open()) {
+ *      std::string_view text = file.view();
+ *  }
+ * </code>
+ */
+class MappedFile {
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+  protected:
+    /** The first byte of the mapped file, null if the file is not mapped. */
+    const char* data = nullptr;
+
+    /** The size of the file in bytes. */
+    size_t size = 0;
+
+    /** The flag determining if the file was opened (an empty file is open but not mapped). */
+    bool open = false;
+
+#ifdef _WIN32
+    /** The handle of the file. */
+    void* file_handle = nullptr;
+
+    /** The handle of the file mapping object. */
+    void* mapping_handle = nullptr;
+#endif
+
+    // ----------------------------------------------------------------------------
+    // Constructors
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Maps the file into memory. Check @link is_open to find out if the mapping succeeded.
+     *
+     * @param 	path	The path to the file.
+     */
+    explicit MappedFile(const std::filesystem::path& path);
+
+    MappedFile(const MappedFile& other) = delete;
+    MappedFile& operator=(const MappedFile& other) = delete;
+
+    /** Destroys this @link MappedFile and unmaps the file. */
+    ~MappedFile();
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+  public:
+    /** Returns @p true if the file was opened successfully. */
+    bool is_open() const { return open; }
+
+    /** Returns the contents of the file, valid as long as this object exists. */
+    std::string_view view() const { return data ? std::string_view(data, size) : std::string_view(); }
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * The fixed-size pool of worker threads executing tasks from a shared FIFO queue.
+ * <p>
+ * Besides running individual tasks (@link submit), the pool splits loops into ranges processed in parallel
+ * (@link parallel_for). The calling thread processes the ranges as well and waits only for the ranges, not for the
+ * helper tasks, so parallel loops may be nested inside tasks without deadlocking the pool.
+ * <p>
+ * Use @link get_default to share a single pool among the framework classes (e.g., the mesh loading).
+ *
+ * Example:
+ * <code>
+ *  ThreadPool& pool = ThreadPool::get_default();
+ *  std::future<int> result = pool.submit([]() { return 42; });
+ *  pool.parallel_for(values.size(), [&](size_t begin, size_t end) { ... });
+ * </code>
+ */
+class ThreadPool {
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+  protected:
+    /** The worker threads. */
+    std::vector<std::thread> workers;
+
+    /** The tasks waiting for a worker. */
+    std::deque<std::function<void()>> tasks;
+
+    /** The mutex guarding the queue. */
+    std::mutex mutex;
+
+    /** The condition notifying the workers about new tasks or the shutdown. */
+    std::condition_variable condition;
+
+    /** The flag telling the workers to finish. */
+    bool stopping = false;
+
+    // ----------------------------------------------------------------------------
+    // Constructors
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Constructs a new @link ThreadPool and starts its workers.
+     *
+     * @param 	thread_count	The number of worker threads, 0 means the number of hardware threads.
+     */
+    explicit ThreadPool(size_t thread_count = 0);
+
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+
+    /** Destroys this @link ThreadPool, the queued tasks are finished before the workers are joined. */
+    ~ThreadPool();
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Queues a task for execution by one of the workers.
+     *
+     * @param 	task	The callable object without parameters.
+     *
+     * @return	The future with the result (or the exception) of the task.
+     */
+    template <typename F> std::future<std::invoke_result_t<F>> submit(F&& task) {
+        using Result = std::invoke_result_t<F>;
+        // std::function requires copyable callables, so the packaged task is shared.
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> result = packaged->get_future();
+        enqueue([packaged]() { (*packaged)(); });
+        return result;
+    }
+
+    /**
+     * Splits the range [0, count) into batches and processes them in parallel. Returns once all batches are processed,
+     * the first exception thrown by the body is rethrown.
+     *
+     * @param 	count	 	The number of elements.
+     * @param 	body	 	The function processing the elements in [begin, end).
+     * @param 	min_batch	The minimal number of elements per batch, small loops are processed by the calling thread.
+     */
+    void parallel_for(size_t count, const std::function<void(size_t begin, size_t end)>& body, size_t min_batch = 1);
+
+    /** Returns the number of worker threads. */
+    size_t get_thread_count() const { return workers.size(); }
+
+    /** Returns the pool shared by the framework, created with the first call. */
+    static ThreadPool& get_default();
+
+  protected:
+    /** Adds a task to the queue and wakes up a worker. */
+    void enqueue(std::function<void()> task);
+
+    /** The loop executed by every worker. */
+    void worker_loop();
+};
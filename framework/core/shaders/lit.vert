@@ -14,8 +14,11 @@ uniform mat4 view;			// The view matrix.
 layout (std140, binding = 1) uniform ModelData
   {
    mat4 model;			// The model matrix.
-   mat4 model_inv;		// The inverse of the model matrix.
+   mat4 mvp;			// The model-view-projection matrix (not computed for single objects).
    mat3 model_it;		// The inverse of the transpose of the top-left part 3x3 of the model matrix.
+   vec4 ambient_color;	// The ambient color of the material.
+   vec4 diffuse_color;	// The diffuse color of the material.
+   vec4 specular_color;	// The specular color of the material, contains shininess in .w element.
   };
 
 // ----------------------------------------------------------------------------
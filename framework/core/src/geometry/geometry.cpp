@@ -1,94 +1,229 @@
 #include "geometry.hpp"
-#include <glm/gtx/component_wise.hpp>
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+#include "obj_parser.hpp"
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
-#include <tiny_obj_loader.h>
 
+// The meshlets are bound as a shader storage buffer range, 256 bytes satisfy every GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT.
+static const GLsizeiptr MESHLET_ALIGNMENT = 256;
 
 // ----------------------------------------------------------------------------
 // Constructors
 // ----------------------------------------------------------------------------
 Geometry::Geometry(GLenum mode, int elements_per_vertex, int vertices_count, const float* vertices, int indices_count,
                    const unsigned int* indices, GLint position_loc, GLint normal_loc, GLint tex_coord_loc, GLint tangent_loc,
-                   GLint bitangent_loc)
+                   GLint bitangent_loc, Residency residency, VertexFormat vertex_format)
     : Geometry_Base(mode, elements_per_vertex, vertices_count, indices_count, position_loc, normal_loc, tex_coord_loc,
                     tangent_loc, bitangent_loc) {
+    this->residency = residency;
+    this->vertex_format = vertex_format;
+    init_buffers(vertices, indices);
+}
 
-    // Creates a single buffer for vertex data.
-    glCreateBuffers(1, &vertex_buffer);
-    glNamedBufferStorage(vertex_buffer, vertex_buffer_size, vertices, GL_DYNAMIC_STORAGE_BIT);
+Geometry::Geometry(GLenum mode, int elements_per_vertex, std::vector<float> interleaved_vertices, std::vector<uint32_t> indices,
+                   GLint position_loc, GLint normal_loc, GLint tex_coord_loc, GLint tangent_loc, GLint bitangent_loc,
+                   Residency residency, VertexFormat vertex_format)
+    : Geometry_Base(mode, elements_per_vertex, static_cast<int>(interleaved_vertices.size()) / elements_per_vertex,
+                    static_cast<int>(indices.size()), position_loc, normal_loc, tex_coord_loc, tangent_loc, bitangent_loc) {
+    this->residency = residency;
+    this->vertex_format = vertex_format;
+    this->interleaved_vertices = std::move(interleaved_vertices);
+    this->indices = std::move(indices);
+    init_buffers(this->interleaved_vertices.data(), this->indices.empty() ? nullptr : this->indices.data());
+}
 
-    init_vao();
+Geometry::Geometry(GLenum mode, std::span<const float> positions, std::span<const float> normals, std::span<const float> tex_coords,
+                   std::span<const float> tangents, std::span<const float> bitangents, std::span<const uint32_t> indices,
+                   GLint position_loc, GLint normal_loc, GLint tex_coord_loc, GLint tangent_loc, GLint bitangent_loc,
+                   Residency residency, VertexFormat vertex_format)
+    : Geometry_Base(mode, positions, normals, tex_coords, tangents, bitangents, indices, position_loc, normal_loc, tex_coord_loc,
+                    tangent_loc, bitangent_loc) {
+    this->residency = residency;
+    this->vertex_format = vertex_format;
+    init_buffers(interleaved_vertices.data(), indices.empty() ? nullptr : indices.data());
+}
+
+Geometry::Geometry(const Geometry& other)
+    : Geometry_Base(other), resource(other.resource), arena_generation(other.arena_generation),
+      meshlet_count(other.meshlet_count), vertex_cache_reports(other.vertex_cache_reports) {
+    // The copy refers to the same GPU data.
+    vao = other.vao;
+    vertex_buffer = other.vertex_buffer;
+    vertex_buffer_offset = other.vertex_buffer_offset;
+    index_buffer = other.index_buffer;
+    index_buffer_offset = other.index_buffer_offset;
+}
+
+Geometry::~Geometry() {}
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+Geometry Geometry::clone() const {
+    Geometry copy(*this);
+    if (!resource) {
+        return copy;
+    }
 
-    if (indices && indices_count > 0) {
-        // Creates a buffer for indices.
-        glCreateBuffers(1, &index_buffer);
-        glNamedBufferStorage(index_buffer, indices_count * sizeof(unsigned int), indices, GL_DYNAMIC_STORAGE_BIT);
-        glVertexArrayElementBuffer(vao, index_buffer);
+    // Copies the data on the GPU into new allocations of the same arena.
+    const std::shared_ptr<BufferArena>& arena = resource->arena;
+    copy.resource = std::make_shared<GeometryResource>(arena);
+    if (resource->vertex_allocation != BufferArena::INVALID_HANDLE) {
+        const BufferArena::Range source = arena->get_range(resource->vertex_allocation);
+        copy.resource->vertex_allocation = arena->allocate(source.size);
+        const BufferArena::Range destination = arena->get_range(copy.resource->vertex_allocation);
+        glCopyNamedBufferSubData(source.buffer, destination.buffer, source.offset, destination.offset, source.size);
     }
+    if (resource->index_allocation != BufferArena::INVALID_HANDLE) {
+        const BufferArena::Range source = arena->get_range(resource->index_allocation);
+        copy.resource->index_allocation = arena->allocate(source.size);
+        const BufferArena::Range destination = arena->get_range(copy.resource->index_allocation);
+        glCopyNamedBufferSubData(source.buffer, destination.buffer, source.offset, destination.offset, source.size);
+    }
+    if (resource->meshlet_allocation != BufferArena::INVALID_HANDLE) {
+        const BufferArena::Range source = arena->get_range(resource->meshlet_allocation);
+        copy.resource->meshlet_allocation = arena->allocate(source.size, MESHLET_ALIGNMENT);
+        const BufferArena::Range destination = arena->get_range(copy.resource->meshlet_allocation);
+        glCopyNamedBufferSubData(source.buffer, destination.buffer, source.offset, destination.offset, source.size);
+    }
+    copy.init_vao();
+
+    return copy;
 }
 
-Geometry::Geometry(GLenum mode, int elements_per_vertex, std::vector<float> interleaved_vertices, std::vector<uint32_t> indices,
-                   GLint position_loc, GLint normal_loc, GLint tex_coord_loc, GLint tangent_loc, GLint bitangent_loc)
-    : Geometry(mode, elements_per_vertex, static_cast<int>(interleaved_vertices.size()), interleaved_vertices.data(),
-               static_cast<int>(indices.size()), indices.data(), position_loc, normal_loc, tex_coord_loc, tangent_loc,
-               bitangent_loc) {}
-
-Geometry::Geometry(GLenum mode, std::vector<float> positions, std::vector<float> normals, std::vector<float> tex_coords,
-                   std::vector<float> tangents, std::vector<float> bitangents, std::vector<uint32_t> indices, GLint position_loc,
-                   GLint normal_loc, GLint tex_coord_loc, GLint tangent_loc, GLint bitangent_loc)
-    : Geometry_Base(mode, positions, normals, tex_coords, tangents, bitangents, indices, position_loc, normal_loc, tex_coord_loc,
-                    tangent_loc, bitangent_loc) {
+void Geometry::validate_vao() const {
+    if (resource && arena_generation != resource->arena->get_generation()) {
+        update_bindings();
+    }
+}
 
-    // Creates a single buffer for vertex data.
-    glCreateBuffers(1, &vertex_buffer);
-    glNamedBufferStorage(vertex_buffer, vertex_buffer_size, interleaved_vertices.data(), GL_DYNAMIC_STORAGE_BIT);
+void Geometry::set_meshlets(std::span<const Meshlet> meshlets) {
+    if (!resource) {
+        return;
+    }
 
-    init_vao();
+    resource->arena->free(resource->meshlet_allocation);
+    resource->meshlet_allocation = BufferArena::INVALID_HANDLE;
+    meshlet_count = static_cast<GLsizei>(meshlets.size());
+    if (!meshlets.empty()) {
+        resource->meshlet_allocation = resource->arena->allocate(meshlets.size_bytes(), MESHLET_ALIGNMENT, meshlets.data());
+    }
+}
 
-    if (!indices.empty()) {
-        // Creates a buffer for indices.
-        glCreateBuffers(1, &index_buffer);
-        glNamedBufferStorage(index_buffer, indices.size() * sizeof(uint32_t), indices.data(), GL_DYNAMIC_STORAGE_BIT);
-        glVertexArrayElementBuffer(vao, index_buffer);
+BufferArena::Range Geometry::get_meshlet_range() const {
+    if (!resource || resource->meshlet_allocation == BufferArena::INVALID_HANDLE) {
+        return {};
     }
+    return resource->arena->get_range(resource->meshlet_allocation);
 }
 
-Geometry::Geometry(const Geometry& other) : Geometry_Base(other) {
-    // Creates a single buffer for vertex data.
-    glCreateBuffers(1, &vertex_buffer);
-    glNamedBufferStorage(vertex_buffer, vertex_buffer_size, nullptr, GL_DYNAMIC_STORAGE_BIT);
-    glCopyNamedBufferSubData(other.vertex_buffer, vertex_buffer, 0, 0, vertex_buffer_size);
+GLsizeiptr Geometry::get_memory_size() const {
+    if (!resource) {
+        return 0;
+    }
+    GLsizeiptr size = 0;
+    for (const BufferArena::Handle handle : {resource->vertex_allocation, resource->index_allocation, resource->meshlet_allocation}) {
+        // Missing allocations have empty ranges.
+        size += resource->arena->get_range(handle).size;
+    }
+    return size;
+}
 
-    // Creates a buffer for indices.
-    glCreateBuffers(1, &index_buffer);
-    glNamedBufferStorage(index_buffer, draw_elements_count * sizeof(unsigned int), nullptr, GL_DYNAMIC_STORAGE_BIT);
-    glCopyNamedBufferSubData(other.index_buffer, index_buffer, 0, 0, draw_elements_count * sizeof(unsigned int));
+void Geometry::init_buffers(const float* vertices, const uint32_t* indices) {
+    const size_t values_count = static_cast<size_t>(elements_per_vertex) * draw_arrays_count;
+
+    if (residency != Residency::CPU_ONLY) {
+        const std::shared_ptr<BufferArena> arena = BufferArena::get_default();
+        resource = std::make_shared<GeometryResource>(arena);
+
+        if (vertex_format == VertexFormat::QUANTIZED && vertices && values_count > 0) {
+            // The decoding constants are stored right after the vertices (aligned for the vertex fetch).
+            QuantizationConstants constants;
+            const std::vector<uint8_t> quantized =
+                VertexQuantization::quantize(std::span<const float>(vertices, values_count), elements_per_vertex, constants);
+            vertex_buffer_stride = VertexQuantization::get_stride(elements_per_vertex);
+            vertex_buffer_size = static_cast<GLsizei>(quantized.size());
+
+            const GLsizeiptr constants_offset = get_quantization_constants_offset();
+            resource->vertex_allocation = arena->allocate(constants_offset + sizeof(QuantizationConstants), 16);
+            arena->upload(resource->vertex_allocation, 0, vertex_buffer_size, quantized.data());
+            arena->upload(resource->vertex_allocation, constants_offset, sizeof(QuantizationConstants), &constants);
+        } else if (vertex_buffer_size > 0) {
+            vertex_format = VertexFormat::FLOAT;
+            resource->vertex_allocation = arena->allocate(vertex_buffer_size, 16, vertices);
+        }
 
-    init_vao();
+        if (indices && draw_elements_count > 0) {
+            // Compact geometries use 16-bit indices whenever all vertices can be addressed by them.
+            if (vertex_format == VertexFormat::QUANTIZED && draw_arrays_count <= 65536) {
+                const std::vector<uint16_t> narrowed = VertexQuantization::narrow_indices(std::span<const uint32_t>(indices, draw_elements_count));
+                index_type = GL_UNSIGNED_SHORT;
+                resource->index_allocation = arena->allocate(draw_elements_count * sizeof(uint16_t), 16, narrowed.data());
+            } else {
+                index_type = GL_UNSIGNED_INT;
+                resource->index_allocation = arena->allocate(draw_elements_count * sizeof(uint32_t), 16, indices);
+            }
+        }
 
-    // Sets the mode and the number of vertices to draw.
-    if (mode != GL_PATCHES) {
-        glVertexArrayElementBuffer(vao, index_buffer);
+        init_vao();
     }
+
+    // The data passed as pointers (e.g., the static arrays of the predefined geometries) are copied only if needed.
+    if (residency != Residency::GPU_ONLY) {
+        if (interleaved_vertices.empty() && vertices) {
+            interleaved_vertices.assign(vertices, vertices + values_count);
+        }
+        if (this->indices.empty() && indices) {
+            this->indices.assign(indices, indices + draw_elements_count);
+        }
+    }
+    release_cpu_data();
 }
 
-Geometry::~Geometry() {
-    glDeleteBuffers(1, &vertex_buffer);
-    glDeleteBuffers(1, &index_buffer);
-    glDeleteVertexArrays(1, &vao);
+GLsizeiptr Geometry::get_quantization_constants_offset() const { return (vertex_buffer_size + 15) / 16 * 16; }
+
+void Geometry::update_bindings() const {
+    const BufferArena& arena = *resource->arena;
+    const uint64_t generation = arena.get_generation();
+
+    const BufferArena::Range vertex_range = arena.get_range(resource->vertex_allocation);
+    vertex_buffer = vertex_range.buffer;
+    vertex_buffer_offset = vertex_range.offset;
+
+    const BufferArena::Range index_range = arena.get_range(resource->index_allocation);
+    index_buffer = index_range.buffer;
+    index_buffer_offset = index_range.offset;
+
+    // The VAO is shared, so it is updated only by the first geometry that notices the new generation.
+    if (resource->arena_generation != generation) {
+        glVertexArrayVertexBuffer(vao, 0, vertex_buffer, vertex_buffer_offset, vertex_buffer_stride);
+        if (vertex_format == VertexFormat::QUANTIZED) {
+            // Zero stride, all vertices read the same constants.
+            glVertexArrayVertexBuffer(vao, 1, vertex_buffer, vertex_buffer_offset + get_quantization_constants_offset(), 0);
+        }
+        if (resource->index_allocation != BufferArena::INVALID_HANDLE) {
+            glVertexArrayElementBuffer(vao, index_buffer);
+        }
+        resource->arena_generation = generation;
+    }
+
+    arena_generation = generation;
 }
 
-// ----------------------------------------------------------------------------
-// Methods
-// ----------------------------------------------------------------------------
 void Geometry::init_vao() {
-    // Creates a new VAO.
-    glCreateVertexArrays(1, &vao);
-
-    // Bind the interleaved buffer to the VAO.
-    glVertexArrayVertexBuffer(vao, 0, vertex_buffer, 0, vertex_buffer_stride);
+    // The VAO is owned by the resource.
+    vao = resource->vao;
+    arena_generation = UINT64_MAX;
+    resource->arena_generation = UINT64_MAX;
+    update_bindings();
 
     // Sets the vertex attributes and their parameters.
+    if (vertex_format == VertexFormat::QUANTIZED) {
+        init_quantized_attributes();
+        return;
+    }
     if (elements_per_vertex >= 3 && position_loc >= 0) {
         glEnableVertexArrayAttrib(vao, position_loc);
         glVertexArrayAttribFormat(vao, position_loc, 3, GL_FLOAT, GL_FALSE, 0);
@@ -116,102 +251,195 @@ void Geometry::init_vao() {
     }
 }
 
-Geometry Geometry::from_file(std::filesystem::path path) {
+void Geometry::init_quantized_attributes() {
+    if (elements_per_vertex >= 3 && position_loc >= 0) {
+        glEnableVertexArrayAttrib(vao, position_loc);
+        glVertexArrayAttribFormat(vao, position_loc, 3, GL_SHORT, GL_TRUE, 0);
+        glVertexArrayAttribBinding(vao, position_loc, 0);
+    }
+    if (elements_per_vertex >= 6 && normal_loc >= 0) {
+        glEnableVertexArrayAttrib(vao, normal_loc);
+        glVertexArrayAttribFormat(vao, normal_loc, 2, GL_SHORT, GL_TRUE, VertexQuantization::NORMAL_OFFSET);
+        glVertexArrayAttribBinding(vao, normal_loc, 0);
+    }
+    if (elements_per_vertex >= 8 && tex_coord_loc >= 0) {
+        glEnableVertexArrayAttrib(vao, tex_coord_loc);
+        glVertexArrayAttribFormat(vao, tex_coord_loc, 2, GL_HALF_FLOAT, GL_FALSE, VertexQuantization::TEX_COORD_OFFSET);
+        glVertexArrayAttribBinding(vao, tex_coord_loc, 0);
+    }
+    if (elements_per_vertex >= 11 && tangent_loc >= 0) {
+        glEnableVertexArrayAttrib(vao, tangent_loc);
+        glVertexArrayAttribFormat(vao, tangent_loc, 2, GL_SHORT, GL_TRUE, VertexQuantization::TANGENT_OFFSET);
+        glVertexArrayAttribBinding(vao, tangent_loc, 0);
+    }
+    if (elements_per_vertex >= 14 && bitangent_loc >= 0) {
+        glEnableVertexArrayAttrib(vao, bitangent_loc);
+        glVertexArrayAttribFormat(vao, bitangent_loc, 2, GL_SHORT, GL_TRUE, VertexQuantization::BITANGENT_OFFSET);
+        glVertexArrayAttribBinding(vao, bitangent_loc, 0);
+    }
+
+    // The decoding constants come from the second binding.
+    glEnableVertexArrayAttrib(vao, QUANTIZATION_SCALE_LOC);
+    glVertexArrayAttribFormat(vao, QUANTIZATION_SCALE_LOC, 4, GL_FLOAT, GL_FALSE, offsetof(QuantizationConstants, scale));
+    glVertexArrayAttribBinding(vao, QUANTIZATION_SCALE_LOC, 1);
+    glEnableVertexArrayAttrib(vao, QUANTIZATION_OFFSET_LOC);
+    glVertexArrayAttribFormat(vao, QUANTIZATION_OFFSET_LOC, 4, GL_FLOAT, GL_FALSE, offsetof(QuantizationConstants, offset));
+    glVertexArrayAttribBinding(vao, QUANTIZATION_OFFSET_LOC, 1);
+}
+
+Geometry Geometry::from_file(std::filesystem::path path, Residency residency, VertexFormat vertex_format, int lod_count) {
     const std::string extension = path.extension().generic_string();
 
     if (extension == ".obj") {
-        tinyobj::ObjReader reader;
-
-        if (!reader.ParseFromFile(path.generic_string())) {
-            if (!reader.Error().empty()) {
-                std::cerr << "TinyObjReader: " << reader.Error();
-            }
+        ObjData data;
+        if (!ObjParser::parse(path, data)) {
+            std::cerr << "File " << path.generic_string() << " could not be read" << std::endl;
+            return Geometry{};
         }
-
-        if (!reader.Warning().empty()) {
-            std::cout << "TinyObjReader: " << reader.Warning();
+        if (data.groups.empty()) {
+            std::cerr << "File " << path.generic_string() << " contains no shapes" << std::endl;
+            return Geometry{};
         }
 
-        auto& attrib = reader.GetAttrib();
-        auto& shapes = reader.GetShapes();
-        auto& materials = reader.GetMaterials();
-
-        // Take only the first shape found
-        const tinyobj::shape_t& shape = shapes[0];
-
-        std::vector<float> positions;
-        std::vector<float> normals;
-        std::vector<float> tex_coords;
-
-        glm::vec3 min{INFINITY, INFINITY, INFINITY};
-        glm::vec3 max{-INFINITY, -INFINITY, -INFINITY};
-
-        // Loop over faces(polygon)
-        size_t index_offset = 0;
-        for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
-            // Loop over vertices in the face.
-            for (size_t v = 0; v < 3; v++) {
-                // Access to vertex
-                tinyobj::index_t idx = shape.mesh.indices[index_offset + v];
-
-                tinyobj::real_t vx = attrib.vertices[3 * idx.vertex_index + 0];
-                tinyobj::real_t vy = attrib.vertices[3 * idx.vertex_index + 1];
-                tinyobj::real_t vz = attrib.vertices[3 * idx.vertex_index + 2];
-
-                tinyobj::real_t nx;
-                tinyobj::real_t ny;
-                tinyobj::real_t nz;
-                if (!attrib.normals.empty()) {
-                    nx = attrib.normals[3 * idx.normal_index + 0];
-                    ny = attrib.normals[3 * idx.normal_index + 1];
-                    nz = attrib.normals[3 * idx.normal_index + 2];
-                } else {
-                    nx = 0.0;
-                    ny = 0.0;
-                    nz = 0.0;
+        // Every vertex has a position, a normal, and texture coordinates. The unique combinations of the OBJ indices
+        // become single vertices, centered and scaled to fit into a unit box.
+        const int elements_per_vertex = 8;
+        std::vector<float> vertices;
+        std::vector<uint32_t> indices;
+        ObjParser::build_mesh(data, 0, data.corners.size(), true, vertices, indices);
+
+        // Every group of the file (a run of triangles of one object with one material) becomes a submesh, the groups
+        // cover all triangles in the order of the file.
+        const size_t vertices_count = vertices.size() / elements_per_vertex;
+        std::vector<Submesh> submeshes(data.groups.size());
+        std::vector<std::string> materials;
+        std::vector<std::vector<uint32_t>> part_indices(data.groups.size());
+        std::vector<std::vector<uint32_t>> part_original_indices(data.groups.size());
+        std::vector<std::vector<LevelOfDetail>> part_lods(data.groups.size());
+        std::vector<std::vector<Meshlet>> part_meshlets(data.groups.size());
+        std::vector<uint32_t> local_of(vertices_count, UINT32_MAX);
+        std::vector<uint32_t> vertex_of;
+        std::vector<float> part_vertices;
+        size_t level_count = 1;
+        for (size_t s = 0; s < data.groups.size(); s++) {
+            const ObjGroup& group = data.groups[s];
+            submeshes[s].name = group.object;
+            if (!group.material.empty()) {
+                const auto material = std::find(materials.begin(), materials.end(), group.material);
+                submeshes[s].material_id = static_cast<int>(material - materials.begin());
+                if (material == materials.end()) {
+                    materials.push_back(group.material);
                 }
+            }
 
-                tinyobj::real_t tx;
-                tinyobj::real_t ty;
-                if (!attrib.texcoords.empty()) {
-                    tx = attrib.texcoords[2 * idx.texcoord_index + 0];
-                    ty = attrib.texcoords[2 * idx.texcoord_index + 1];
-                } else {
-                    tx = 0.0;
-                    ty = 0.0;
+            // The submesh is processed on a compact copy of its own vertices, so the simplification, the reordering,
+            // and the meshlet building cost as much as the submesh and not as the whole mesh.
+            std::vector<uint32_t>& part = part_indices[s];
+            part.resize(group.corner_count);
+            vertex_of.clear();
+            part_vertices.clear();
+            for (size_t c = 0; c < group.corner_count; c++) {
+                const uint32_t vertex = indices[group.first_corner + c];
+                if (local_of[vertex] == UINT32_MAX) {
+                    local_of[vertex] = static_cast<uint32_t>(vertex_of.size());
+                    vertex_of.push_back(vertex);
+                    part_vertices.insert(part_vertices.end(), vertices.begin() + vertex * elements_per_vertex,
+                                         vertices.begin() + (vertex + 1) * elements_per_vertex);
                 }
+                part[c] = local_of[vertex];
+            }
 
-                min.x = std::min(min.x, vx);
-                min.y = std::min(min.y, vy);
-                min.z = std::min(min.z, vz);
-                max.x = std::max(max.x, vx);
-                max.y = std::max(max.y, vy);
-                max.z = std::max(max.z, vz);
+            // The coarser levels of detail of the submesh are appended to its indices. Then the triangles of each level
+            // are reordered for the vertex cache and overdraw, and the most detailed level is split into meshlets that
+            // can be culled on the GPU.
+            part_lods[s] = lod_count > 1 ? MeshSimplifier::build_lods(part_vertices, elements_per_vertex, part, lod_count)
+                                         : std::vector<LevelOfDetail>{{0, static_cast<GLsizei>(group.corner_count), 0.0f}};
+            level_count = std::max(level_count, part_lods[s].size());
+            part_original_indices[s] = part;
+            for (const LevelOfDetail& range : part_lods[s]) {
+                const std::span<uint32_t> level = std::span(part).subspan(range.first_index, range.index_count);
+                MeshOptimizer::optimize_vertex_cache(level, vertex_of.size());
+                MeshOptimizer::optimize_overdraw(level, part_vertices, elements_per_vertex);
+            }
+            part_meshlets[s] = MeshletBuilder::build(part_vertices, elements_per_vertex, part, 0, part_lods[s][0].index_count);
+
+            // The meshlets reorder the triangles by their growth, so the triangles of each meshlet are reordered for the
+            // vertex cache again. Every meshlet starts with the cache left by the previous one, which is its neighbor.
+            std::vector<uint32_t> cache;
+            for (const Meshlet& meshlet : part_meshlets[s]) {
+                MeshOptimizer::optimize_vertex_cache(std::span(part).subspan(meshlet.first_index, meshlet.index_count),
+                                                     vertex_of.size(), &cache);
+            }
 
-                positions.insert(positions.end(), {vx, vy, vz});
-                normals.insert(normals.end(), {nx, ny, nz});
-                tex_coords.insert(tex_coords.end(), {tx, ty});
+            // Returns to the vertices of the whole mesh.
+            for (uint32_t& index : part) {
+                index = vertex_of[index];
+            }
+            for (uint32_t& index : part_original_indices[s]) {
+                index = vertex_of[index];
+            }
+            for (uint32_t vertex : vertex_of) {
+                local_of[vertex] = UINT32_MAX;
             }
-            index_offset += 3;
         }
-
-        glm::vec3 diff = max - min;
-        glm::vec3 center = min + 0.5f * diff;
-        min -= center;
-        max -= center;
-        for (int i = 0; i < positions.size(); i += 3) {
-            positions[i + 0] -= center.x;
-            positions[i + 1] -= center.y;
-            positions[i + 2] -= center.z;
-
-            positions[i + 0] /= std::max(std::max(diff.x, diff.y), diff.z);
-            positions[i + 1] /= std::max(std::max(diff.x, diff.y), diff.z);;
-            positions[i + 2] /= std::max(std::max(diff.x, diff.y), diff.z);;
+        data = ObjData{};
+        std::vector<uint32_t>().swap(local_of);
+
+        // Each level stores the submeshes one after another; submeshes that could not be simplified as much as the
+        // others repeat their coarsest level. The meshlets of each submesh are moved to its most detailed level. The
+        // levels are assembled in the original triangle order too, so that the vertex cache efficiency can be compared.
+        std::vector<LevelOfDetail> lods(level_count);
+        std::vector<Meshlet> meshlets;
+        std::vector<uint32_t> original_indices;
+        indices.clear();
+        for (size_t l = 0; l < level_count; l++) {
+            lods[l].first_index = static_cast<GLsizei>(indices.size());
+            for (size_t s = 0; s < submeshes.size(); s++) {
+                const LevelOfDetail& part = part_lods[s][std::min(l, part_lods[s].size() - 1)];
+                submeshes[s].lods.push_back({static_cast<GLsizei>(indices.size()), part.index_count, part.error});
+                if (l == 0) {
+                    for (Meshlet meshlet : part_meshlets[s]) {
+                        meshlet.first_index += static_cast<uint32_t>(indices.size());
+                        meshlets.push_back(meshlet);
+                    }
+                }
+                indices.insert(indices.end(), part_indices[s].begin() + part.first_index,
+                               part_indices[s].begin() + part.first_index + part.index_count);
+                original_indices.insert(original_indices.end(), part_original_indices[s].begin() + part.first_index,
+                                        part_original_indices[s].begin() + part.first_index + part.index_count);
+                lods[l].error = std::max(lods[l].error, part.error);
+            }
+            lods[l].index_count = static_cast<GLsizei>(indices.size()) - lods[l].first_index;
+        }
+        std::vector<std::vector<uint32_t>>().swap(part_indices);
+        std::vector<std::vector<uint32_t>>().swap(part_original_indices);
+
+        // Every level is analyzed in both orders before the vertices are reordered (which may drop unused ones).
+        std::vector<VertexCacheReport> vertex_cache_reports;
+        for (const LevelOfDetail& level : lods) {
+            vertex_cache_reports.push_back(
+                {MeshOptimizer::analyze_vertex_cache(std::span(original_indices).subspan(level.first_index, level.index_count),
+                                                     vertices_count),
+                 MeshOptimizer::analyze_vertex_cache(std::span(indices).subspan(level.first_index, level.index_count),
+                                                     vertices_count)});
+        }
+        std::vector<uint32_t>().swap(original_indices);
+        if (lod_count <= 1) {
+            lods.clear();
         }
 
-        const int elements_per_vertex = 3 + (normals.size() > 0 ? 3 : 0) + (tex_coords.size() > 0 ? 2 : 0);
-
-        return Geometry{GL_TRIANGLES, positions, normals, tex_coords};
+        // The vertices are reordered for fetching once all indices are in place.
+        MeshOptimizer::optimize_vertex_fetch(vertices, elements_per_vertex, indices);
+
+        Geometry geometry{GL_TRIANGLES,         elements_per_vertex, std::move(vertices), std::move(indices),
+                          DEFAULT_POSITION_LOC,  DEFAULT_NORMAL_LOC,  DEFAULT_TEX_COORD_LOC, DEFAULT_TANGENT_LOC,
+                          DEFAULT_BITANGENT_LOC, residency,           vertex_format};
+        geometry.set_lods(std::move(lods));
+        geometry.set_meshlets(meshlets);
+        geometry.vertex_cache_reports = std::move(vertex_cache_reports);
+        geometry.submeshes = std::move(submeshes);
+        geometry.materials = std::move(materials);
+        return geometry;
     }
     std::cerr << "Extension " << extension << " not supported" << std::endl;
 
@@ -0,0 +1,306 @@
+#include "mesh_optimizer.hpp"
+#include "glm/glm.hpp"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+// The parameters of the Forsyth's scoring function.
+static const int CACHE_SIZE = 32;
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+
+/** Computes the score of a vertex from its position in the simulated cache and the number of its remaining triangles. */
+static float vertex_score(int cache_position, uint32_t remaining_triangles) {
+    if (remaining_triangles == 0) {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cache_position >= 0) {
+        if (cache_position < 3) {
+            // The vertices of the last triangle get a fixed score, so that the next triangle does not simply share an edge
+            // with it (which would produce strips with poor cache reuse).
+            score = LAST_TRIANGLE_SCORE;
+        } else {
+            const float scaler = 1.0f / (CACHE_SIZE - 3);
+            score = std::pow(1.0f - (cache_position - 3) * scaler, CACHE_DECAY_POWER);
+        }
+    }
+
+    // Vertices with only a few remaining triangles are preferred, so that they can leave the cache.
+    return score + VALENCE_BOOST_SCALE * std::pow(float(remaining_triangles), -VALENCE_BOOST_POWER);
+}
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+MeshOptimizer::VertexCacheStatistics MeshOptimizer::analyze_vertex_cache(std::span<const uint32_t> indices,
+                                                                         size_t vertices_count, size_t cache_size) {
+    VertexCacheStatistics statistics;
+    if (indices.empty()) {
+        return statistics;
+    }
+
+    // The FIFO cache stores the time stamp at which each vertex entered it.
+    std::vector<size_t> entered(vertices_count, 0);
+    size_t time = cache_size + 1;
+    for (uint32_t index : indices) {
+        if (time - entered[index] > cache_size) {
+            entered[index] = time++;
+            statistics.vertices_transformed++;
+        }
+    }
+
+    size_t used_vertices = 0;
+    std::vector<bool> used(vertices_count, false);
+    for (uint32_t index : indices) {
+        used_vertices += used[index] ? 0 : 1;
+        used[index] = true;
+    }
+
+    statistics.acmr = float(statistics.vertices_transformed) / float(indices.size() / 3);
+    statistics.atvr = float(statistics.vertices_transformed) / float(used_vertices);
+    return statistics;
+}
+
+void MeshOptimizer::optimize_vertex_cache(std::span<uint32_t> indices, size_t vertices_count, std::vector<uint32_t>* cache) {
+    const size_t triangles_count = indices.size() / 3;
+    if (triangles_count == 0) {
+        return;
+    }
+
+    // The lists of triangles using each vertex, the emitted triangles are removed from the lists.
+    std::vector<uint32_t> remaining(vertices_count, 0);
+    for (uint32_t index : indices) {
+        remaining[index]++;
+    }
+    std::vector<uint32_t> offsets(vertices_count + 1, 0);
+    for (size_t v = 0; v < vertices_count; v++) {
+        offsets[v + 1] = offsets[v] + remaining[v];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++) {
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    // The simulated cache starts with the given vertices, most recently used first.
+    std::vector<uint32_t> current_cache;
+    std::vector<int> cache_position(vertices_count, -1);
+    if (cache != nullptr) {
+        for (uint32_t vertex : *cache) {
+            if (vertex < vertices_count && cache_position[vertex] < 0 && current_cache.size() < CACHE_SIZE) {
+                cache_position[vertex] = static_cast<int>(current_cache.size());
+                current_cache.push_back(vertex);
+            }
+        }
+    }
+    std::vector<float> scores(vertices_count);
+    for (size_t v = 0; v < vertices_count; v++) {
+        scores[v] = vertex_score(cache_position[v], remaining[v]);
+    }
+
+    // A triangle scores the sum of its vertex scores. The queue holds the scores of the triangles without cached
+    // vertices, its best triangle starts the next run when the cache has no candidates left.
+    std::vector<float> triangle_scores(triangles_count);
+    std::vector<bool> emitted(triangles_count, false);
+    std::priority_queue<std::pair<float, uint32_t>> outside_cache;
+    for (size_t t = 0; t < triangles_count; t++) {
+        triangle_scores[t] = scores[indices[t * 3 + 0]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+        outside_cache.emplace(triangle_scores[t], static_cast<uint32_t>(t));
+    }
+
+    // Only the triangles around the cache change their scores, the best of them is emitted next.
+    auto best_in_cache = [&]() {
+        uint32_t best = UINT32_MAX;
+        float best_score = -1.0f;
+        for (uint32_t vertex : current_cache) {
+            for (uint32_t i = offsets[vertex]; i < offsets[vertex] + remaining[vertex]; i++) {
+                if (triangle_scores[adjacency[i]] > best_score) {
+                    best_score = triangle_scores[adjacency[i]];
+                    best = adjacency[i];
+                }
+            }
+        }
+        return best;
+    };
+    uint32_t best_triangle = best_in_cache();
+
+    std::vector<uint32_t> order;
+    order.reserve(triangles_count);
+    std::vector<uint32_t> new_cache;
+    size_t next_unemitted = 0;
+
+    while (order.size() < triangles_count) {
+        // Without a candidate in the cache, the best of all remaining triangles is used. None of them has a cached
+        // vertex then, so their scores were pushed to the queue when their last vertex left the cache (or at the
+        // start); the entries of emitted triangles and outdated scores are skipped.
+        while (best_triangle == UINT32_MAX && !outside_cache.empty()) {
+            const auto [score, t] = outside_cache.top();
+            outside_cache.pop();
+            if (!emitted[t] && score == triangle_scores[t]) {
+                best_triangle = t;
+            }
+        }
+        if (best_triangle == UINT32_MAX) {
+            while (emitted[next_unemitted]) {
+                next_unemitted++;
+            }
+            best_triangle = static_cast<uint32_t>(next_unemitted);
+        }
+
+        const uint32_t triangle = best_triangle;
+        order.push_back(triangle);
+        emitted[triangle] = true;
+
+        // Removes the triangle from the lists of its vertices and puts the vertices to the front of the cache.
+        new_cache.clear();
+        for (int k = 0; k < 3; k++) {
+            const uint32_t vertex = indices[triangle * 3 + k];
+            uint32_t* begin = adjacency.data() + offsets[vertex];
+            uint32_t* end = begin + remaining[vertex];
+            std::iter_swap(std::find(begin, end, triangle), end - 1);
+            remaining[vertex]--;
+            new_cache.push_back(vertex);
+        }
+        for (uint32_t vertex : current_cache) {
+            if (std::find(new_cache.begin(), new_cache.begin() + 3, vertex) == new_cache.begin() + 3) {
+                new_cache.push_back(vertex);
+            }
+        }
+
+        // Updates the scores of the vertices in the cache (including those that have just left it) and their triangles.
+        for (size_t i = 0; i < new_cache.size(); i++) {
+            cache_position[new_cache[i]] = i < CACHE_SIZE ? static_cast<int>(i) : -1;
+        }
+        for (uint32_t vertex : new_cache) {
+            const float new_score = vertex_score(cache_position[vertex], remaining[vertex]);
+            const float difference = new_score - scores[vertex];
+            scores[vertex] = new_score;
+            for (uint32_t i = offsets[vertex]; i < offsets[vertex] + remaining[vertex]; i++) {
+                triangle_scores[adjacency[i]] += difference;
+            }
+        }
+        for (size_t c = CACHE_SIZE; c < new_cache.size(); c++) {
+            const uint32_t vertex = new_cache[c];
+            for (uint32_t i = offsets[vertex]; i < offsets[vertex] + remaining[vertex]; i++) {
+                outside_cache.emplace(triangle_scores[adjacency[i]], adjacency[i]);
+            }
+        }
+
+        // A triangle may share several cached vertices, so it is compared only once all of them were updated.
+        new_cache.resize(std::min<size_t>(new_cache.size(), CACHE_SIZE));
+        std::swap(current_cache, new_cache);
+        best_triangle = best_in_cache();
+    }
+    if (cache != nullptr) {
+        *cache = std::move(current_cache);
+    }
+
+    std::vector<uint32_t> reordered(indices.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        std::copy_n(indices.begin() + order[i] * 3, 3, reordered.begin() + i * 3);
+    }
+    std::copy(reordered.begin(), reordered.end(), indices.begin());
+}
+
+void MeshOptimizer::optimize_overdraw(std::span<uint32_t> indices, std::span<const float> vertices, int elements_per_vertex) {
+    const size_t triangles_count = indices.size() / 3;
+    const size_t vertices_count = vertices.size() / elements_per_vertex;
+    if (triangles_count == 0) {
+        return;
+    }
+
+    auto position = [&](uint32_t vertex) {
+        return glm::vec3(vertices[vertex * elements_per_vertex + 0], vertices[vertex * elements_per_vertex + 1],
+                         vertices[vertex * elements_per_vertex + 2]);
+    };
+
+    // Splits the triangles into clusters where the simulated cache misses all three vertices.
+    const size_t cache_size = 16;
+    std::vector<size_t> entered(vertices_count, 0);
+    size_t time = cache_size + 1;
+    std::vector<size_t> cluster_starts;
+    for (size_t t = 0; t < triangles_count; t++) {
+        int misses = 0;
+        for (int k = 0; k < 3; k++) {
+            const uint32_t vertex = indices[t * 3 + k];
+            if (time - entered[vertex] > cache_size) {
+                entered[vertex] = time++;
+                misses++;
+            }
+        }
+        if (t == 0 || misses == 3) {
+            cluster_starts.push_back(t);
+        }
+    }
+    cluster_starts.push_back(triangles_count);
+
+    // The center of the mesh.
+    glm::vec3 mesh_center(0.0f);
+    float mesh_area = 0.0f;
+    for (size_t t = 0; t < triangles_count; t++) {
+        const glm::vec3 a = position(indices[t * 3 + 0]), b = position(indices[t * 3 + 1]), c = position(indices[t * 3 + 2]);
+        const float area = glm::length(glm::cross(b - a, c - a));
+        mesh_center += area * (a + b + c) / 3.0f;
+        mesh_area += area;
+    }
+    mesh_center = mesh_area > 0.0f ? mesh_center / mesh_area : mesh_center;
+
+    // Sorts the clusters by how much they face away from the center.
+    struct Cluster {
+        size_t first;
+        size_t last;
+        float sort_key;
+    };
+    std::vector<Cluster> clusters;
+    for (size_t i = 0; i + 1 < cluster_starts.size(); i++) {
+        glm::vec3 center(0.0f);
+        glm::vec3 normal(0.0f);
+        float area_sum = 0.0f;
+        for (size_t t = cluster_starts[i]; t < cluster_starts[i + 1]; t++) {
+            const glm::vec3 a = position(indices[t * 3 + 0]), b = position(indices[t * 3 + 1]), c = position(indices[t * 3 + 2]);
+            const glm::vec3 n = glm::cross(b - a, c - a);
+            const float area = glm::length(n);
+            center += area * (a + b + c) / 3.0f;
+            normal += n;
+            area_sum += area;
+        }
+        center = area_sum > 0.0f ? center / area_sum : center;
+        const float normal_length = glm::length(normal);
+        const float key = normal_length > 0.0f ? glm::dot(center - mesh_center, normal / normal_length) : 0.0f;
+        clusters.push_back({cluster_starts[i], cluster_starts[i + 1], key});
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sort_key > b.sort_key; });
+
+    std::vector<uint32_t> reordered;
+    reordered.reserve(indices.size());
+    for (const Cluster& cluster : clusters) {
+        reordered.insert(reordered.end(), indices.begin() + cluster.first * 3, indices.begin() + cluster.last * 3);
+    }
+    std::copy(reordered.begin(), reordered.end(), indices.begin());
+}
+
+size_t MeshOptimizer::optimize_vertex_fetch(std::vector<float>& vertices, int elements_per_vertex, std::span<uint32_t> indices) {
+    const size_t vertices_count = vertices.size() / elements_per_vertex;
+
+    std::vector<uint32_t> remap(vertices_count, UINT32_MAX);
+    std::vector<float> reordered;
+    reordered.reserve(vertices.size());
+    uint32_t next = 0;
+    for (uint32_t& index : indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = next++;
+            reordered.insert(reordered.end(), vertices.begin() + size_t(index) * elements_per_vertex,
+                             vertices.begin() + size_t(index + 1) * elements_per_vertex);
+        }
+        index = remap[index];
+    }
+
+    vertices = std::move(reordered);
+    return next;
+}
@@ -0,0 +1,319 @@
+#include "mesh_simplifier.hpp"
+#include "glm/glm.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+
+/** The symmetric 4x4 matrix of a quadric stored as its upper triangle. */
+struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a03 = 0, a11 = 0, a12 = 0, a13 = 0, a22 = 0, a23 = 0, a33 = 0;
+
+    /** Creates the quadric measuring the squared distance from the plane n.x + d = 0 multiplied by the weight. */
+    static Quadric from_plane(const glm::dvec3& n, double d, double weight) {
+        Quadric q;
+        q.a00 = weight * n.x * n.x, q.a01 = weight * n.x * n.y, q.a02 = weight * n.x * n.z, q.a03 = weight * n.x * d;
+        q.a11 = weight * n.y * n.y, q.a12 = weight * n.y * n.z, q.a13 = weight * n.y * d;
+        q.a22 = weight * n.z * n.z, q.a23 = weight * n.z * d;
+        q.a33 = weight * d * d;
+        return q;
+    }
+
+    Quadric& operator+=(const Quadric& other) {
+        a00 += other.a00, a01 += other.a01, a02 += other.a02, a03 += other.a03, a11 += other.a11;
+        a12 += other.a12, a13 += other.a13, a22 += other.a22, a23 += other.a23, a33 += other.a33;
+        return *this;
+    }
+
+    Quadric operator+(const Quadric& other) const { return Quadric(*this) += other; }
+
+    /** Evaluates v^T Q v for v = (p, 1). */
+    double evaluate(const glm::dvec3& p) const {
+        return a00 * p.x * p.x + 2 * a01 * p.x * p.y + 2 * a02 * p.x * p.z + 2 * a03 * p.x + a11 * p.y * p.y +
+               2 * a12 * p.y * p.z + 2 * a13 * p.y + a22 * p.z * p.z + 2 * a23 * p.z + a33;
+    }
+};
+
+/** The candidate collapse of the position 'from' into the position 'to'. */
+struct Collapse {
+    double cost;
+    uint32_t from;
+    uint32_t to;
+    uint32_t from_version;
+    uint32_t to_version;
+
+    bool operator>(const Collapse& other) const { return cost > other.cost; }
+};
+
+/** The key of a position used for merging vertices that differ only in other attributes. */
+struct PositionKey {
+    float x, y, z;
+
+    bool operator==(const PositionKey& other) const { return std::memcmp(this, &other, sizeof(PositionKey)) == 0; }
+};
+
+struct PositionKeyHash {
+    size_t operator()(const PositionKey& key) const {
+        uint32_t bits[3];
+        std::memcpy(bits, &key, sizeof(bits));
+        return (size_t(bits[0]) * 73856093) ^ (size_t(bits[1]) * 19349663) ^ (size_t(bits[2]) * 83492791);
+    }
+};
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+std::vector<uint32_t> MeshSimplifier::simplify(std::span<const float> vertices, int elements_per_vertex,
+                                               std::span<const uint32_t> indices, size_t target_index_count,
+                                               float* result_error) {
+    const size_t vertices_count = vertices.size() / elements_per_vertex;
+    const size_t triangles_count = indices.size() / 3;
+
+    // Merges the vertices with the same position.
+    std::unordered_map<PositionKey, uint32_t, PositionKeyHash> position_ids;
+    position_ids.reserve(vertices_count);
+    std::vector<uint32_t> position_of(vertices_count);
+    std::vector<glm::dvec3> positions;
+    std::vector<std::vector<uint32_t>> vertices_at;
+    for (size_t v = 0; v < vertices_count; v++) {
+        const float* p = vertices.data() + v * elements_per_vertex;
+        const auto [it, inserted] = position_ids.try_emplace(PositionKey{p[0], p[1], p[2]}, static_cast<uint32_t>(positions.size()));
+        if (inserted) {
+            positions.emplace_back(p[0], p[1], p[2]);
+            vertices_at.emplace_back();
+        }
+        position_of[v] = it->second;
+        vertices_at[it->second].push_back(static_cast<uint32_t>(v));
+    }
+    const size_t positions_count = positions.size();
+
+    // The triangles on the positions, degenerate triangles are dropped right away.
+    std::vector<std::array<uint32_t, 3>> triangles(triangles_count);
+    std::vector<bool> alive(triangles_count, false);
+    std::vector<std::vector<uint32_t>> triangles_at(positions_count);
+    size_t alive_count = 0;
+    for (size_t t = 0; t < triangles_count; t++) {
+        triangles[t] = {position_of[indices[t * 3 + 0]], position_of[indices[t * 3 + 1]], position_of[indices[t * 3 + 2]]};
+        const auto& [a, b, c] = triangles[t];
+        if (a == b || b == c || a == c) {
+            continue;
+        }
+        alive[t] = true;
+        alive_count++;
+        for (uint32_t p : triangles[t]) {
+            triangles_at[p].push_back(static_cast<uint32_t>(t));
+        }
+    }
+
+    // Accumulates the quadrics of the triangle planes and counts the triangles sharing each edge. The planes are also
+    // kept unweighted, the error of the result is the distance of the collapsed positions from them.
+    std::vector<Quadric> quadrics(positions_count);
+    std::vector<std::vector<glm::dvec4>> planes_at(positions_count);
+    std::unordered_map<uint64_t, uint32_t> edge_use;
+    edge_use.reserve(alive_count * 3);
+    auto edge_key = [](uint32_t a, uint32_t b) { return (uint64_t(std::min(a, b)) << 32) | std::max(a, b); };
+    for (size_t t = 0; t < triangles_count; t++) {
+        if (!alive[t]) {
+            continue;
+        }
+        const auto& [a, b, c] = triangles[t];
+        const glm::dvec3 normal = glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+        const double length = glm::length(normal);
+        if (length > 0.0) {
+            const glm::dvec3 n = normal / length;
+            const Quadric q = Quadric::from_plane(n, -glm::dot(n, positions[a]), 1.0);
+            quadrics[a] += q, quadrics[b] += q, quadrics[c] += q;
+            const glm::dvec4 plane(n, -glm::dot(n, positions[a]));
+            planes_at[a].push_back(plane), planes_at[b].push_back(plane), planes_at[c].push_back(plane);
+        }
+        edge_use[edge_key(a, b)]++, edge_use[edge_key(b, c)]++, edge_use[edge_key(c, a)]++;
+    }
+
+    // Border edges get a heavily weighted plane perpendicular to the triangle, so that the border does not shrink.
+    for (size_t t = 0; t < triangles_count; t++) {
+        if (!alive[t]) {
+            continue;
+        }
+        const glm::dvec3 normal = glm::cross(positions[triangles[t][1]] - positions[triangles[t][0]],
+                                             positions[triangles[t][2]] - positions[triangles[t][0]]);
+        for (int e = 0; e < 3; e++) {
+            const uint32_t a = triangles[t][e];
+            const uint32_t b = triangles[t][(e + 1) % 3];
+            if (edge_use[edge_key(a, b)] != 1) {
+                continue;
+            }
+            const glm::dvec3 border_normal = glm::cross(positions[b] - positions[a], normal);
+            const double length = glm::length(border_normal);
+            if (length > 0.0) {
+                const glm::dvec3 n = border_normal / length;
+                const Quadric q = Quadric::from_plane(n, -glm::dot(n, positions[a]), 10.0);
+                quadrics[a] += q, quadrics[b] += q;
+                const glm::dvec4 plane(n, -glm::dot(n, positions[a]));
+                planes_at[a].push_back(plane), planes_at[b].push_back(plane);
+            }
+        }
+    }
+
+    // Collects the candidate collapses of all edges.
+    std::vector<uint32_t> versions(positions_count, 0);
+    std::vector<bool> removed(positions_count, false);
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+    auto push_edge = [&](uint32_t a, uint32_t b) {
+        const Quadric q = quadrics[a] + quadrics[b];
+        const double cost_to_b = q.evaluate(positions[b]);
+        const double cost_to_a = q.evaluate(positions[a]);
+        if (cost_to_b <= cost_to_a) {
+            queue.push({cost_to_b, a, b, versions[a], versions[b]});
+        } else {
+            queue.push({cost_to_a, b, a, versions[b], versions[a]});
+        }
+    };
+    for (size_t t = 0; t < triangles_count; t++) {
+        if (alive[t]) {
+            push_edge(triangles[t][0], triangles[t][1]);
+            push_edge(triangles[t][1], triangles[t][2]);
+            push_edge(triangles[t][2], triangles[t][0]);
+        }
+    }
+
+    // Collapses the cheapest edges until the requested size is reached.
+    double max_distance = 0.0;
+    const size_t target_triangles = target_index_count / 3;
+    while (alive_count > target_triangles && !queue.empty()) {
+        const Collapse collapse = queue.top();
+        queue.pop();
+        if (removed[collapse.from] || removed[collapse.to] || versions[collapse.from] != collapse.from_version ||
+            versions[collapse.to] != collapse.to_version) {
+            continue;
+        }
+
+        // Rejects the collapse if any of the remaining triangles would flip or degenerate.
+        bool valid = true;
+        for (uint32_t t : triangles_at[collapse.from]) {
+            const auto& triangle = triangles[t];
+            if (!alive[t] || std::find(triangle.begin(), triangle.end(), collapse.to) != triangle.end()) {
+                continue;
+            }
+            std::array<glm::dvec3, 3> corners = {positions[triangle[0]], positions[triangle[1]], positions[triangle[2]]};
+            const glm::dvec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+            for (int k = 0; k < 3; k++) {
+                if (triangle[k] == collapse.from) {
+                    corners[k] = positions[collapse.to];
+                }
+            }
+            const glm::dvec3 after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+            if (glm::dot(before, after) <= 0.25 * glm::length(before) * glm::length(after) || glm::length(after) == 0.0) {
+                valid = false;
+                break;
+            }
+        }
+        if (!valid) {
+            continue;
+        }
+
+        // Moves the triangles of the removed position to the kept one.
+        for (uint32_t t : triangles_at[collapse.from]) {
+            if (!alive[t]) {
+                continue;
+            }
+            auto& triangle = triangles[t];
+            if (std::find(triangle.begin(), triangle.end(), collapse.to) != triangle.end()) {
+                alive[t] = false;
+                alive_count--;
+                continue;
+            }
+            std::replace(triangle.begin(), triangle.end(), collapse.from, collapse.to);
+            triangles_at[collapse.to].push_back(t);
+        }
+        std::vector<uint32_t>().swap(triangles_at[collapse.from]);
+        std::erase_if(triangles_at[collapse.to], [&](uint32_t t) { return !alive[t]; });
+
+        removed[collapse.from] = true;
+        quadrics[collapse.to] += quadrics[collapse.from];
+        versions[collapse.to]++;
+
+        // The kept position now represents the planes of both, the smaller list is appended to the larger one.
+        if (planes_at[collapse.to].size() < planes_at[collapse.from].size()) {
+            std::swap(planes_at[collapse.to], planes_at[collapse.from]);
+        }
+        planes_at[collapse.to].insert(planes_at[collapse.to].end(), planes_at[collapse.from].begin(), planes_at[collapse.from].end());
+        std::vector<glm::dvec4>().swap(planes_at[collapse.from]);
+        for (const glm::dvec4& plane : planes_at[collapse.to]) {
+            max_distance = std::max(max_distance, std::abs(glm::dot(glm::dvec3(plane), positions[collapse.to]) + plane.w));
+        }
+
+        // Updates the candidates of the edges around the kept position.
+        for (uint32_t t : triangles_at[collapse.to]) {
+            for (uint32_t p : triangles[t]) {
+                if (p != collapse.to) {
+                    push_edge(collapse.to, p);
+                }
+            }
+        }
+    }
+
+    // Each corner keeps its vertex if it did not move, otherwise it uses the vertex at the new position with the most
+    // similar attributes (normal and texture coordinates).
+    auto attribute_distance = [&](uint32_t a, uint32_t b) {
+        float distance = 0.0f;
+        for (int e = 3; e < std::min(elements_per_vertex, 8); e++) {
+            const float d = vertices[a * elements_per_vertex + e] - vertices[b * elements_per_vertex + e];
+            distance += d * d;
+        }
+        return distance;
+    };
+
+    std::vector<uint32_t> result;
+    result.reserve(alive_count * 3);
+    for (size_t t = 0; t < triangles_count; t++) {
+        if (!alive[t]) {
+            continue;
+        }
+        for (int k = 0; k < 3; k++) {
+            const uint32_t vertex = indices[t * 3 + k];
+            const uint32_t position = triangles[t][k];
+            uint32_t best = vertex;
+            if (position_of[vertex] != position) {
+                best = vertices_at[position][0];
+                for (uint32_t candidate : vertices_at[position]) {
+                    if (attribute_distance(vertex, candidate) < attribute_distance(vertex, best)) {
+                        best = candidate;
+                    }
+                }
+            }
+            result.push_back(best);
+        }
+    }
+
+    if (result_error) {
+        *result_error = static_cast<float>(max_distance);
+    }
+    return result;
+}
+
+std::vector<LevelOfDetail> MeshSimplifier::build_lods(std::span<const float> vertices, int elements_per_vertex,
+                                                      std::vector<uint32_t>& indices, int lod_count) {
+    std::vector<LevelOfDetail> lods = {{0, static_cast<GLsizei>(indices.size()), 0.0f}};
+
+    // Each level is simplified from the previous one, which is faster and keeps the errors increasing.
+    std::vector<uint32_t> previous(indices);
+    float error = 0.0f;
+    for (int level = 1; level < lod_count; level++) {
+        float level_error = 0.0f;
+        std::vector<uint32_t> simplified =
+            simplify(vertices, elements_per_vertex, previous, previous.size() / 2, &level_error);
+
+        // Stops if the mesh can no longer be reduced considerably.
+        if (simplified.empty() || simplified.size() > previous.size() * 3 / 4) {
+            break;
+        }
+        error += level_error;
+
+        lods.push_back({static_cast<GLsizei>(indices.size()), static_cast<GLsizei>(simplified.size()), error});
+        indices.insert(indices.end(), simplified.begin(), simplified.end());
+        previous = std::move(simplified);
+    }
+    return lods;
+}
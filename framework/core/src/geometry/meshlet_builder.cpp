@@ -0,0 +1,248 @@
+#include "meshlet_builder.hpp"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+// The cones wider than this (the cosine of the widest angle between a normal and the axis) are never culled.
+static const float MIN_CONE_SPREAD = 0.1f;
+
+// The weight of the normal deviation relative to the number of new vertices when growing a meshlet.
+static const float CONE_WEIGHT = 2.0f;
+
+// The minimal cosine of the angle between the average normal of a meshlet and a non-adjacent triangle joining it.
+static const float SEAM_MIN_DOT = 0.5f;
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+std::vector<Meshlet> MeshletBuilder::build(std::span<const float> vertices, int elements_per_vertex, std::span<uint32_t> indices,
+                                           size_t first_index, size_t index_count, size_t max_vertices, size_t max_triangles) {
+    std::vector<Meshlet> meshlets;
+    const size_t vertices_count = vertices.size() / elements_per_vertex;
+    const size_t triangles_count = index_count / 3;
+    if (triangles_count == 0 || vertices_count == 0) {
+        return meshlets;
+    }
+    const std::span<uint32_t> range = indices.subspan(first_index, triangles_count * 3);
+
+    auto position = [&](uint32_t vertex) {
+        return glm::vec3(vertices[vertex * elements_per_vertex + 0], vertices[vertex * elements_per_vertex + 1],
+                         vertices[vertex * elements_per_vertex + 2]);
+    };
+
+    // The unit normals of the triangles (zero for degenerate ones).
+    std::vector<glm::vec3> normals(triangles_count);
+    for (size_t t = 0; t < triangles_count; t++) {
+        const glm::vec3 a = position(range[t * 3 + 0]), b = position(range[t * 3 + 1]), c = position(range[t * 3 + 2]);
+        const glm::vec3 normal = glm::cross(b - a, c - a);
+        const float length = glm::length(normal);
+        normals[t] = length > 0.0f ? normal / length : glm::vec3(0.0f);
+    }
+
+    // The vertices split by normal or texture seams are merged for the adjacency, so that the meshlets can grow over
+    // the seams (and over faceted surfaces whose triangles share no vertices).
+    std::vector<uint32_t> merged(vertices_count);
+    {
+        auto position_hash = [](const glm::vec3& p) {
+            size_t hash = std::hash<float>{}(p.x);
+            hash = hash * 31 + std::hash<float>{}(p.y);
+            return hash * 31 + std::hash<float>{}(p.z);
+        };
+        std::unordered_map<glm::vec3, uint32_t, decltype(position_hash)> unique_positions(vertices_count, position_hash);
+        for (size_t v = 0; v < vertices_count; v++) {
+            merged[v] = unique_positions.try_emplace(position(static_cast<uint32_t>(v)), static_cast<uint32_t>(v)).first->second;
+        }
+    }
+
+    // The lists of triangles using each (merged) vertex.
+    std::vector<uint32_t> offsets(vertices_count + 1, 0);
+    for (uint32_t index : range) {
+        offsets[merged[index] + 1]++;
+    }
+    for (size_t v = 0; v < vertices_count; v++) {
+        offsets[v + 1] += offsets[v];
+    }
+    std::vector<uint32_t> adjacency(range.size());
+    {
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < range.size(); i++) {
+            adjacency[fill[merged[range[i]]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    // The meshlet in which each vertex was last used and in which each triangle became a candidate, so that the sets do
+    // not have to be cleared.
+    std::vector<uint32_t> vertex_meshlet(vertices_count, UINT32_MAX);
+    std::vector<uint32_t> candidate_meshlet(triangles_count, UINT32_MAX);
+    std::vector<bool> emitted(triangles_count, false);
+    std::vector<uint32_t> order;
+    order.reserve(triangles_count);
+    std::vector<uint32_t> candidates;
+    size_t next_unemitted = 0;
+
+    auto new_vertices = [&](uint32_t triangle, uint32_t meshlet) {
+        return size_t(vertex_meshlet[range[triangle * 3 + 0]] != meshlet) + size_t(vertex_meshlet[range[triangle * 3 + 1]] != meshlet) +
+               size_t(vertex_meshlet[range[triangle * 3 + 2]] != meshlet);
+    };
+
+    while (order.size() < triangles_count) {
+        const uint32_t meshlet_index = static_cast<uint32_t>(meshlets.size());
+        Meshlet meshlet;
+        meshlet.first_index = static_cast<uint32_t>(first_index + order.size() * 3);
+        glm::vec3 normal_sum(0.0f);
+
+        // The meshlet starts from a triangle left adjacent to the previous meshlet, so the neighboring meshlets stay close.
+        uint32_t triangle = UINT32_MAX;
+        for (uint32_t candidate : candidates) {
+            if (!emitted[candidate]) {
+                triangle = candidate;
+                break;
+            }
+        }
+        if (triangle == UINT32_MAX) {
+            while (emitted[next_unemitted]) {
+                next_unemitted++;
+            }
+            triangle = static_cast<uint32_t>(next_unemitted);
+        }
+        candidates.clear();
+
+        while (triangle != UINT32_MAX) {
+            // Adds the triangle and its neighbors as candidates.
+            order.push_back(triangle);
+            emitted[triangle] = true;
+            meshlet.index_count += 3;
+            normal_sum += normals[triangle];
+            for (int k = 0; k < 3; k++) {
+                const uint32_t vertex = range[triangle * 3 + k];
+                if (vertex_meshlet[vertex] != meshlet_index) {
+                    vertex_meshlet[vertex] = meshlet_index;
+                    meshlet.vertex_count++;
+                }
+                for (uint32_t i = offsets[merged[vertex]]; i < offsets[merged[vertex] + 1]; i++) {
+                    const uint32_t neighbor = adjacency[i];
+                    if (!emitted[neighbor] && candidate_meshlet[neighbor] != meshlet_index) {
+                        candidate_meshlet[neighbor] = meshlet_index;
+                        candidates.push_back(neighbor);
+                    }
+                }
+            }
+            if (meshlet.index_count / 3 >= max_triangles) {
+                break;
+            }
+
+            // Picks the candidate adding the fewest vertices while keeping the normal cone narrow.
+            const float axis_length = glm::length(normal_sum);
+            const glm::vec3 axis = axis_length > 0.0f ? normal_sum / axis_length : glm::vec3(0.0f);
+            triangle = UINT32_MAX;
+            float best_score = INFINITY;
+            for (size_t i = 0; i < candidates.size();) {
+                const uint32_t candidate = candidates[i];
+                if (emitted[candidate]) {
+                    candidates[i] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+                const size_t added = new_vertices(candidate, meshlet_index);
+                if (meshlet.vertex_count + added <= max_vertices) {
+                    const float score = float(added) + CONE_WEIGHT * (1.0f - glm::dot(normals[candidate], axis));
+                    if (score < best_score) {
+                        best_score = score;
+                        triangle = candidate;
+                    }
+                }
+                i++;
+            }
+
+            // Without a neighbor (e.g., at a texture seam splitting the vertices), the meshlet continues with the next
+            // triangle of the input order, which is spatially close in a cache-optimized order.
+            if (triangle == UINT32_MAX) {
+                while (next_unemitted < triangles_count && emitted[next_unemitted]) {
+                    next_unemitted++;
+                }
+                if (next_unemitted < triangles_count && meshlet.vertex_count + new_vertices(static_cast<uint32_t>(next_unemitted), meshlet_index) <= max_vertices &&
+                    glm::dot(normals[next_unemitted], axis) >= SEAM_MIN_DOT) {
+                    triangle = static_cast<uint32_t>(next_unemitted);
+                }
+            }
+        }
+
+        meshlets.push_back(meshlet);
+    }
+
+    // Rewrites the range in the order of the meshlets.
+    std::vector<uint32_t> reordered(range.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        std::copy_n(range.begin() + order[i] * 3, 3, reordered.begin() + i * 3);
+    }
+    std::copy(reordered.begin(), reordered.end(), range.begin());
+
+    for (Meshlet& meshlet : meshlets) {
+        compute_bounds(vertices, elements_per_vertex, indices, meshlet);
+    }
+    return meshlets;
+}
+
+void MeshletBuilder::compute_bounds(std::span<const float> vertices, int elements_per_vertex, std::span<const uint32_t> indices,
+                                    Meshlet& meshlet) {
+    auto position = [&](uint32_t vertex) {
+        return glm::vec3(vertices[vertex * elements_per_vertex + 0], vertices[vertex * elements_per_vertex + 1],
+                         vertices[vertex * elements_per_vertex + 2]);
+    };
+    const std::span<const uint32_t> range = indices.subspan(meshlet.first_index, meshlet.index_count);
+
+    // The sphere is centered in the bounding box, which is tight enough for small clusters.
+    glm::vec3 min(INFINITY);
+    glm::vec3 max(-INFINITY);
+    for (uint32_t index : range) {
+        min = glm::min(min, position(index));
+        max = glm::max(max, position(index));
+    }
+    const glm::vec3 center = 0.5f * (min + max);
+    float radius = 0.0f;
+    for (uint32_t index : range) {
+        radius = std::max(radius, glm::length(position(index) - center));
+    }
+    meshlet.bounding_sphere = glm::vec4(center, radius);
+
+    // The axis of the cone is the average normal, its spread is given by the normal deviating the most from it.
+    std::vector<std::pair<glm::vec3, glm::vec3>> planes;
+    planes.reserve(range.size() / 3);
+    glm::vec3 axis(0.0f);
+    for (size_t i = 0; i + 2 < range.size(); i += 3) {
+        const glm::vec3 a = position(range[i + 0]), b = position(range[i + 1]), c = position(range[i + 2]);
+        const glm::vec3 normal = glm::cross(b - a, c - a);
+        const float length = glm::length(normal);
+        // Degenerate triangles are invisible and do not constrain the cone.
+        if (length > 0.0f) {
+            planes.emplace_back(normal / length, a);
+            axis += normal / length;
+        }
+    }
+
+    const float axis_length = glm::length(axis);
+    meshlet.normal_cone = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    meshlet.cone_apex = glm::vec4(center, 0.0f);
+    if (planes.empty() || axis_length == 0.0f) {
+        return;
+    }
+    axis /= axis_length;
+
+    float min_dot = 1.0f;
+    for (const auto& [normal, point] : planes) {
+        min_dot = std::min(min_dot, glm::dot(normal, axis));
+    }
+    if (min_dot <= MIN_CONE_SPREAD) {
+        return;
+    }
+
+    // The apex is the point on the axis behind all triangle planes, every triangle is back-facing for the cameras inside
+    // the cone opened from it. The back-face test accepts the view directions within 90 degrees minus the spread of the
+    // normals around the axis, i.e., the cosine to the axis must exceed the sine of the spread.
+    float apex_distance = 0.0f;
+    for (const auto& [normal, point] : planes) {
+        apex_distance = std::max(apex_distance, glm::dot(center - point, normal) / glm::dot(axis, normal));
+    }
+    meshlet.cone_apex = glm::vec4(center - axis * apex_distance, 0.0f);
+    meshlet.normal_cone = glm::vec4(axis, std::sqrt(1.0f - min_dot * min_dot));
+}
@@ -0,0 +1,364 @@
+#include "obj_parser.hpp"
+#include "utils/mapped_file.hpp"
+#include "glm/glm.hpp"
+#include <glm/gtx/component_wise.hpp>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+// The minimal size of a chunk parsed by a single task, smaller files are parsed by the calling thread.
+static const size_t MIN_CHUNK_SIZE = 256 * 1024;
+
+// The number of chunks per thread, more chunks balance files with unevenly distributed faces better.
+static const size_t CHUNKS_PER_THREAD = 4;
+
+// The minimal number of vertices written by a single task.
+static const size_t MIN_VERTEX_BATCH = 16384;
+
+/** The statement changing the current object, material, or material library. */
+struct Marker {
+    enum class Type { OBJECT, MATERIAL, LIBRARY };
+    Type type;
+    std::string name;
+    /** The global index of the first corner following the statement. */
+    size_t corner;
+};
+
+/** The line-aligned part of the file parsed by a single task. */
+struct Chunk {
+    std::string_view text;
+    // The numbers of elements (counted by the first pass).
+    size_t positions = 0;
+    size_t normals = 0;
+    size_t tex_coords = 0;
+    size_t corners = 0;
+    // The numbers of elements in the preceding chunks.
+    size_t position_base = 0;
+    size_t normal_base = 0;
+    size_t tex_coord_base = 0;
+    size_t corner_base = 0;
+    std::vector<Marker> markers;
+};
+
+static bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+static const char* skip_spaces(const char* p, const char* end) {
+    while (p < end && is_space(*p)) {
+        p++;
+    }
+    return p;
+}
+
+static const char* skip_token(const char* p, const char* end) {
+    while (p < end && !is_space(*p)) {
+        p++;
+    }
+    return p;
+}
+
+/** Calls the function for every line of the text with the pointers to its first character and past its last one. */
+template <typename F> static void for_each_line(std::string_view text, F&& function) {
+    const char* p = text.data();
+    const char* const end = p + text.size();
+    while (p < end) {
+        const char* line_end = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        line_end = line_end ? line_end : end;
+        function(skip_spaces(p, line_end), line_end);
+        p = line_end + 1;
+    }
+}
+
+/** Returns @p true if the line starts with the keyword followed by a space (or the end of the line). */
+static bool starts_with(const char* p, const char* end, std::string_view keyword) {
+    const size_t length = keyword.size();
+    return static_cast<size_t>(end - p) >= length && std::memcmp(p, keyword.data(), length) == 0 &&
+           (p + length == end || is_space(p[length]));
+}
+
+/** Parses the next float of the line, missing or malformed values are zero. */
+static float parse_float(const char*& p, const char* end) {
+    p = skip_spaces(p, end);
+    // std::from_chars does not accept the plus sign.
+    if (p < end && *p == '+') {
+        p++;
+    }
+    float value = 0.0f;
+    const std::from_chars_result result = std::from_chars(p, end, value);
+    p = result.ec == std::errc() ? result.ptr : skip_token(p, end);
+    return result.ec == std::errc() ? value : 0.0f;
+}
+
+/** Parses a (possibly relative) OBJ index and converts it into an absolute zero-based index, -1 if invalid. */
+static int32_t parse_index(const char*& p, const char* end, size_t count) {
+    int32_t value = 0;
+    const std::from_chars_result result = std::from_chars(p, end, value);
+    if (result.ec != std::errc()) {
+        return -1;
+    }
+    p = result.ptr;
+    const int64_t index = value > 0 ? int64_t(value) - 1 : value < 0 ? int64_t(count) + value : -1;
+    return index >= 0 ? static_cast<int32_t>(index) : -1;
+}
+
+/** Returns the rest of the line without the surrounding spaces. */
+static std::string rest_of_line(const char* p, const char* end) {
+    p = skip_spaces(p, end);
+    while (end > p && is_space(end[-1])) {
+        end--;
+    }
+    return std::string(p, end);
+}
+
+/** The first pass: counts the elements of the chunk. */
+static void count_chunk(Chunk& chunk) {
+    for_each_line(chunk.text, [&](const char* p, const char* end) {
+        if (starts_with(p, end, "v")) {
+            chunk.positions++;
+        } else if (starts_with(p, end, "vn")) {
+            chunk.normals++;
+        } else if (starts_with(p, end, "vt")) {
+            chunk.tex_coords++;
+        } else if (starts_with(p, end, "f")) {
+            size_t face_corners = 0;
+            for (p = skip_spaces(p + 1, end); p < end; p = skip_spaces(skip_token(p, end), end)) {
+                face_corners++;
+            }
+            chunk.corners += face_corners >= 3 ? (face_corners - 2) * 3 : 0;
+        }
+    });
+}
+
+/** The second pass: parses the elements of the chunk into their final place. */
+static void parse_chunk(Chunk& chunk, ObjData& data) {
+    size_t position = chunk.position_base;
+    size_t normal = chunk.normal_base;
+    size_t tex_coord = chunk.tex_coord_base;
+    size_t corner = chunk.corner_base;
+    std::vector<ObjCorner> face;
+
+    for_each_line(chunk.text, [&](const char* p, const char* end) {
+        if (starts_with(p, end, "v")) {
+            p += 1;
+            float* destination = &data.positions[position++ * 3];
+            for (int i = 0; i < 3; i++) {
+                destination[i] = parse_float(p, end);
+            }
+        } else if (starts_with(p, end, "vn")) {
+            p += 2;
+            float* destination = &data.normals[normal++ * 3];
+            for (int i = 0; i < 3; i++) {
+                destination[i] = parse_float(p, end);
+            }
+        } else if (starts_with(p, end, "vt")) {
+            p += 2;
+            float* destination = &data.tex_coords[tex_coord++ * 2];
+            for (int i = 0; i < 2; i++) {
+                destination[i] = parse_float(p, end);
+            }
+        } else if (starts_with(p, end, "f")) {
+            // The corners are v, v/vt, v//vn, or v/vt/vn; every token produces a corner, so the count matches the
+            // first pass even for malformed faces.
+            face.clear();
+            for (p = skip_spaces(p + 1, end); p < end; p = skip_spaces(p, end)) {
+                const char* token_end = skip_token(p, end);
+                ObjCorner face_corner;
+                face_corner.position = parse_index(p, token_end, position);
+                if (p < token_end && *p == '/') {
+                    p++;
+                    if (p < token_end && *p != '/') {
+                        face_corner.tex_coord = parse_index(p, token_end, tex_coord);
+                    }
+                    if (p < token_end && *p == '/') {
+                        p++;
+                        face_corner.normal = parse_index(p, token_end, normal);
+                    }
+                }
+                face.push_back(face_corner);
+                p = token_end;
+            }
+            for (size_t i = 2; i < face.size(); i++) {
+                data.corners[corner++] = face[0];
+                data.corners[corner++] = face[i - 1];
+                data.corners[corner++] = face[i];
+            }
+        } else if (starts_with(p, end, "o") || starts_with(p, end, "g")) {
+            chunk.markers.push_back({Marker::Type::OBJECT, rest_of_line(p + 1, end), corner});
+        } else if (starts_with(p, end, "usemtl")) {
+            chunk.markers.push_back({Marker::Type::MATERIAL, rest_of_line(p + 6, end), corner});
+        } else if (starts_with(p, end, "mtllib")) {
+            chunk.markers.push_back({Marker::Type::LIBRARY, rest_of_line(p + 6, end), corner});
+        }
+    });
+}
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+bool ObjParser::parse(const std::filesystem::path& path, ObjData& data, ThreadPool& pool) {
+    const MappedFile file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    parse_text(file.view(), data, pool);
+    return true;
+}
+
+void ObjParser::parse_text(std::string_view text, ObjData& data, ThreadPool& pool) {
+    data = ObjData{};
+
+    // Splits the text into chunks ending at line breaks.
+    const size_t chunk_count =
+        std::clamp(text.size() / MIN_CHUNK_SIZE, size_t(1), (pool.get_thread_count() + 1) * CHUNKS_PER_THREAD);
+    std::vector<Chunk> chunks;
+    size_t begin = 0;
+    for (size_t i = 1; i <= chunk_count && begin < text.size(); i++) {
+        size_t end = text.size();
+        if (i < chunk_count) {
+            end = text.find('\n', std::max(begin, text.size() * i / chunk_count));
+            end = end == std::string_view::npos ? text.size() : end + 1;
+        }
+        chunks.emplace_back().text = text.substr(begin, end - begin);
+        begin = end;
+    }
+
+    pool.parallel_for(chunks.size(), [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            count_chunk(chunks[i]);
+        }
+    });
+
+    // The chunks write to their own parts of the arrays, starting after the elements of the preceding chunks.
+    size_t positions = 0, normals = 0, tex_coords = 0, corners = 0;
+    for (Chunk& chunk : chunks) {
+        chunk.position_base = positions;
+        chunk.normal_base = normals;
+        chunk.tex_coord_base = tex_coords;
+        chunk.corner_base = corners;
+        positions += chunk.positions;
+        normals += chunk.normals;
+        tex_coords += chunk.tex_coords;
+        corners += chunk.corners;
+    }
+    data.positions.resize(positions * 3);
+    data.normals.resize(normals * 3);
+    data.tex_coords.resize(tex_coords * 2);
+    data.corners.resize(corners);
+
+    pool.parallel_for(chunks.size(), [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            parse_chunk(chunks[i], data);
+        }
+    });
+
+    // Splits the triangles into groups at the statements changing the object or the material.
+    ObjGroup group;
+    bool shape_used = false;
+    auto close_group = [&](size_t corner) {
+        if (corner > group.first_corner) {
+            group.corner_count = corner - group.first_corner;
+            data.groups.push_back(group);
+            shape_used = true;
+        }
+        group.first_corner = corner;
+    };
+    for (const Chunk& chunk : chunks) {
+        for (const Marker& marker : chunk.markers) {
+            close_group(marker.corner);
+            switch (marker.type) {
+            case Marker::Type::OBJECT:
+                // A new shape starts only if the previous one has faces.
+                group.shape += shape_used ? 1 : 0;
+                shape_used = false;
+                group.object = marker.name;
+                break;
+            case Marker::Type::MATERIAL:
+                group.material = marker.name;
+                break;
+            case Marker::Type::LIBRARY:
+                data.material_library = data.material_library.empty() ? marker.name : data.material_library;
+                break;
+            }
+        }
+    }
+    close_group(data.corners.size());
+}
+
+void ObjParser::build_mesh(const ObjData& data, size_t first_corner, size_t corner_count, bool fit_unit_box,
+                           std::vector<float>& vertices, std::vector<uint32_t>& indices, ThreadPool& pool) {
+    const size_t positions_count = data.positions.size() / 3;
+    const size_t normals_count = data.normals.size() / 3;
+    const size_t tex_coords_count = data.tex_coords.size() / 2;
+    auto position = [&](int32_t index) {
+        return index >= 0 && size_t(index) < positions_count ? glm::vec3(data.positions[index * 3 + 0], data.positions[index * 3 + 1],
+                                                                         data.positions[index * 3 + 2])
+                                                             : glm::vec3(0.0f);
+    };
+
+    // Welds the corners: the vertices created for each position are linked in a list, which is searched for a vertex
+    // with the same texture coordinates and normal. Positions are rarely shared by more than a few vertices, so this is
+    // much cheaper than hashing the triples.
+    std::vector<uint32_t> heads(positions_count + 1, UINT32_MAX);
+    std::vector<uint32_t> next;
+    std::vector<ObjCorner> unique;
+    next.reserve(positions_count);
+    unique.reserve(positions_count);
+    indices.resize(corner_count);
+
+    glm::vec3 min(INFINITY);
+    glm::vec3 max(-INFINITY);
+    for (size_t i = 0; i < corner_count; i++) {
+        const ObjCorner& corner = data.corners[first_corner + i];
+        const size_t head = corner.position >= 0 && size_t(corner.position) < positions_count ? corner.position : positions_count;
+
+        uint32_t vertex = heads[head];
+        while (vertex != UINT32_MAX && (unique[vertex].tex_coord != corner.tex_coord || unique[vertex].normal != corner.normal)) {
+            vertex = next[vertex];
+        }
+        if (vertex == UINT32_MAX) {
+            vertex = static_cast<uint32_t>(unique.size());
+            unique.push_back(corner);
+            next.push_back(heads[head]);
+            heads[head] = vertex;
+
+            min = glm::min(min, position(corner.position));
+            max = glm::max(max, position(corner.position));
+        }
+        indices[i] = vertex;
+    }
+
+    // The positions are centered and scaled while they are interleaved.
+    glm::vec3 center(0.0f);
+    float scale = 1.0f;
+    if (fit_unit_box && !unique.empty()) {
+        center = 0.5f * (min + max);
+        scale = glm::compMax(max - min);
+        scale = scale > 0.0f ? scale : 1.0f;
+    }
+
+    const int elements_per_vertex = 8;
+    vertices.resize(unique.size() * elements_per_vertex);
+    pool.parallel_for(
+        unique.size(),
+        [&](size_t begin, size_t end) {
+            for (size_t v = begin; v < end; v++) {
+                const ObjCorner& corner = unique[v];
+                float* destination = &vertices[v * elements_per_vertex];
+
+                const glm::vec3 p = (position(corner.position) - center) / scale;
+                destination[0] = p.x;
+                destination[1] = p.y;
+                destination[2] = p.z;
+
+                const bool has_normal = corner.normal >= 0 && size_t(corner.normal) < normals_count;
+                for (int i = 0; i < 3; i++) {
+                    destination[3 + i] = has_normal ? data.normals[corner.normal * 3 + i] : 0.0f;
+                }
+
+                const bool has_tex_coord = corner.tex_coord >= 0 && size_t(corner.tex_coord) < tex_coords_count;
+                for (int i = 0; i < 2; i++) {
+                    destination[6 + i] = has_tex_coord ? data.tex_coords[corner.tex_coord * 2 + i] : 0.0f;
+                }
+            }
+        },
+        MIN_VERTEX_BATCH);
+}
@@ -0,0 +1,112 @@
+#include "vertex_quantization.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glm/gtc/packing.hpp>
+
+/** Converts a value in [-1, 1] into a 16-bit normalized integer. */
+static int16_t to_snorm16(float value) { return static_cast<int16_t>(std::round(std::clamp(value, -1.0f, 1.0f) * 32767.0f)); }
+
+/** Writes an octahedral encoded direction as two 16-bit normalized integers. */
+static void write_direction(uint8_t* destination, const float* direction) {
+    const glm::vec2 encoded = VertexQuantization::octahedral_encode(glm::vec3(direction[0], direction[1], direction[2]));
+    const int16_t values[2] = {to_snorm16(encoded.x), to_snorm16(encoded.y)};
+    std::memcpy(destination, values, sizeof(values));
+}
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+int VertexQuantization::get_stride(int elements_per_vertex) {
+    if (elements_per_vertex >= 14) {
+        return BITANGENT_OFFSET + 4;
+    }
+    if (elements_per_vertex >= 11) {
+        return TANGENT_OFFSET + 4;
+    }
+    if (elements_per_vertex >= 8) {
+        return TEX_COORD_OFFSET + 4;
+    }
+    if (elements_per_vertex >= 6) {
+        return NORMAL_OFFSET + 4;
+    }
+    return NORMAL_OFFSET;
+}
+
+glm::vec2 VertexQuantization::octahedral_encode(glm::vec3 direction) {
+    const float length = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+    if (length == 0.0f) {
+        return glm::vec2(0.0f);
+    }
+    direction /= length;
+
+    // The lower hemisphere is folded over the diagonals.
+    glm::vec2 encoded(direction.x, direction.y);
+    if (direction.z < 0.0f) {
+        encoded = (1.0f - glm::abs(glm::vec2(direction.y, direction.x))) *
+                  glm::vec2(encoded.x >= 0.0f ? 1.0f : -1.0f, encoded.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return encoded;
+}
+
+glm::vec3 VertexQuantization::octahedral_decode(glm::vec2 encoded) {
+    glm::vec3 direction(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+    const float t = std::max(-direction.z, 0.0f);
+    direction.x += direction.x >= 0.0f ? -t : t;
+    direction.y += direction.y >= 0.0f ? -t : t;
+    return glm::normalize(direction);
+}
+
+std::vector<uint8_t> VertexQuantization::quantize(std::span<const float> vertices, int elements_per_vertex,
+                                                  QuantizationConstants& constants) {
+    const size_t vertices_count = vertices.size() / elements_per_vertex;
+    const int stride = get_stride(elements_per_vertex);
+
+    // Computes the bounding box of the positions.
+    glm::vec3 min(INFINITY);
+    glm::vec3 max(-INFINITY);
+    for (size_t v = 0; v < vertices_count; v++) {
+        const glm::vec3 position(vertices[v * elements_per_vertex + 0], vertices[v * elements_per_vertex + 1],
+                                 vertices[v * elements_per_vertex + 2]);
+        min = glm::min(min, position);
+        max = glm::max(max, position);
+    }
+    glm::vec3 half_size = vertices_count > 0 ? 0.5f * (max - min) : glm::vec3(1.0f);
+    const glm::vec3 center = vertices_count > 0 ? min + half_size : glm::vec3(0.0f);
+    // Flat meshes (e.g., planes) have a zero extent along one of the axes.
+    half_size = glm::max(half_size, glm::vec3(1e-8f));
+
+    constants.scale = glm::vec4(half_size, 0.0f);
+    constants.offset = glm::vec4(center, 1.0f);
+
+    std::vector<uint8_t> quantized(vertices_count * stride, 0);
+    for (size_t v = 0; v < vertices_count; v++) {
+        const float* vertex = vertices.data() + v * elements_per_vertex;
+        uint8_t* destination = quantized.data() + v * stride;
+
+        const glm::vec3 position = (glm::vec3(vertex[0], vertex[1], vertex[2]) - center) / half_size;
+        const int16_t values[4] = {to_snorm16(position.x), to_snorm16(position.y), to_snorm16(position.z), 0};
+        std::memcpy(destination, values, sizeof(values));
+
+        if (elements_per_vertex >= 6) {
+            write_direction(destination + NORMAL_OFFSET, vertex + 3);
+        }
+        if (elements_per_vertex >= 8) {
+            const uint32_t tex_coord = glm::packHalf2x16(glm::vec2(vertex[6], vertex[7]));
+            std::memcpy(destination + TEX_COORD_OFFSET, &tex_coord, sizeof(tex_coord));
+        }
+        if (elements_per_vertex >= 11) {
+            write_direction(destination + TANGENT_OFFSET, vertex + 8);
+        }
+        if (elements_per_vertex >= 14) {
+            write_direction(destination + BITANGENT_OFFSET, vertex + 11);
+        }
+    }
+    return quantized;
+}
+
+std::vector<uint16_t> VertexQuantization::narrow_indices(std::span<const uint32_t> indices) {
+    std::vector<uint16_t> narrowed(indices.size());
+    std::transform(indices.begin(), indices.end(), narrowed.begin(), [](uint32_t index) { return static_cast<uint16_t>(index); });
+    return narrowed;
+}
@@ -1,8 +1,13 @@
 #include "manager.hpp"
+#include "buffer_arena.hpp"
+#include "utils/cpu_profiler.hpp"
+#include "utils/frame_counters.hpp"
+#include "utils/gl_object_tracker.hpp"
 #include "GLFW/glfw3.h"
 #include "glad.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
+#include <ctime>
 #include <iostream>
 #include <ostream>
 
@@ -104,32 +109,155 @@ void OpenGLManager::run(IApplication& application) {
     font_path.make_preferred();
     ImFont* font = io.Fonts->AddFontFromFileTTF(font_path.generic_string().c_str(), xscale * 16);
     ImGui::GetStyle().ScaleAllSizes(xscale);
+    CpuProfiler::set_thread_name("main");
 
     while (!glfwWindowShouldClose(window)) {
-        // Measures the elapsed time.
-        const double current_time = glfwGetTime() * 1000.0; // from seconds to milliseconds
-        const double elapsed_time = current_time - last_glfw_time;
-        last_glfw_time = current_time;
+        {
+            ProfileScope frame_zone("frame");
+
+            // Measures the elapsed time.
+            const double current_time = glfwGetTime() * 1000.0; // from seconds to milliseconds
+            const double elapsed_time = current_time - last_glfw_time;
+            last_glfw_time = current_time;
+
+            // Poll for and process events.
+            {
+                ProfileScope zone("glfwPollEvents");
+                glfwPollEvents();
+            }
+            update_capture_key();
+            update_profile_key();
+
+            ImGui_ImplOpenGL3_NewFrame();
+            ImGui_ImplGlfw_NewFrame();
+            ImGui::NewFrame();
+
+            // Application render
+            {
+                ProfileScope zone("update");
+                application.update(static_cast<float>(elapsed_time));
+            }
+            {
+                ProfileScope zone("render");
+                application.render();
+            }
+
+            // Captures the rendered scene before the user interface and the capture overlay are drawn over it.
+            if (frame_capture) {
+                ProfileScope zone("capture");
+                int framebuffer_width, framebuffer_height;
+                glfwGetFramebufferSize(window, &framebuffer_width, &framebuffer_height);
+                frame_capture->capture(framebuffer_width, framebuffer_height);
+            }
+            {
+                ProfileScope zone("render_ui");
+                application.render_ui();
+                if (frame_capture) {
+                    render_capture_overlay();
+                }
+            }
+
+            // Rendering
+            {
+                ProfileScope zone("ImGui::Render");
+                ImGui::Render();
+                ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            }
+
+            // Swap front and back buffers
+            {
+                ProfileScope zone("glfwSwapBuffers");
+                glfwSwapBuffers(window);
+            }
+            FrameCounters::end_frame();
+            GLObjectTracker::end_frame();
+        }
+        // The zones of the finished frame (including the frame itself) are written while the next one starts.
+        CpuProfiler::flush();
+    }
+
+    // The capture needs the context to finish its copies.
+    stop_capture();
+    stop_profiling();
+}
+
+void OpenGLManager::start_capture(const std::filesystem::path& directory, CaptureFormat format) {
+    stop_capture();
+    frame_capture = std::make_unique<FrameCapture>(directory, format);
+    std::cout << "Capturing frames into " << directory << std::endl;
+}
 
-        // Poll for and process events.
-        glfwPollEvents();
+void OpenGLManager::stop_capture() {
+    if (!frame_capture) {
+        return;
+    }
+    const uint64_t dropped = frame_capture->get_dropped_count();
+    const uint64_t frames = frame_capture->get_frame_count();
+    frame_capture.reset();
+    std::cout << "Capture finished: " << frames << " frames, " << dropped << " dropped." << std::endl;
+}
 
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
+void OpenGLManager::start_profiling(const std::filesystem::path& path) {
+    if (CpuProfiler::begin_session(path)) {
+        std::cout << "Profiling into " << path << std::endl;
+    }
+}
 
-        // Application render
-        application.update(static_cast<float>(elapsed_time));
-        application.render();
-        application.render_ui();
+void OpenGLManager::stop_profiling() { CpuProfiler::end_session(); }
+
+void OpenGLManager::update_capture_key() {
+    const bool key_down = glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS;
+    if (key_down && !capture_key_down) {
+        if (frame_capture) {
+            stop_capture();
+        } else {
+            // Every capture gets its own directory named by the local time of its start.
+            char name[32];
+            const std::time_t now = std::time(nullptr);
+            std::strftime(name, sizeof(name), "%Y%m%d_%H%M%S", std::localtime(&now));
+            start_capture(std::filesystem::path("captures") / name, capture_format);
+        }
+    }
+    capture_key_down = key_down;
+}
 
-        // Rendering
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+void OpenGLManager::update_profile_key() {
+    const bool key_down = glfwGetKey(window, GLFW_KEY_F10) == GLFW_PRESS;
+    if (key_down && !profile_key_down) {
+        if (CpuProfiler::is_recording()) {
+            stop_profiling();
+        } else {
+            // Every session gets its own trace named by the local time of its start.
+            char name[32];
+            const std::time_t now = std::time(nullptr);
+            std::strftime(name, sizeof(name), "%Y%m%d_%H%M%S.json", std::localtime(&now));
+            start_profiling(std::filesystem::path("profiles") / name);
+        }
+    }
+    profile_key_down = key_down;
+}
 
-        // Swap front and back buffers
-        glfwSwapBuffers(window);
+void OpenGLManager::render_capture_overlay() const {
+    const ImGuiViewport* viewport = ImGui::GetMainViewport();
+    ImGui::SetNextWindowPos(ImVec2(viewport->WorkPos.x + viewport->WorkSize.x - 10, viewport->WorkPos.y + 10), ImGuiCond_Always,
+                            ImVec2(1, 0));
+    ImGui::SetNextWindowBgAlpha(0.6f);
+    const ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings |
+                                   ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav | ImGuiWindowFlags_NoInputs;
+    if (ImGui::Begin("Capture", nullptr, flags)) {
+        ImGui::TextColored(ImVec4(0.9f, 0.1f, 0.1f, 1.0f), "REC");
+        ImGui::SameLine();
+        ImGui::Text("%s (%s)", frame_capture->get_directory().generic_string().c_str(), FrameCapture::get_extension(frame_capture->get_format()));
+        ImGui::Text("Frames: %llu  Written: %llu  Queued: %zu", static_cast<unsigned long long>(frame_capture->get_frame_count()),
+                    static_cast<unsigned long long>(frame_capture->get_written_count()), frame_capture->get_queued_count());
+        const uint64_t dropped = frame_capture->get_dropped_count();
+        ImGui::TextColored(dropped > 0 ? ImVec4(0.9f, 0.1f, 0.1f, 1.0f) : ImGui::GetStyleColorVec4(ImGuiCol_Text), "Dropped: %llu",
+                           static_cast<unsigned long long>(dropped));
+        if (frame_capture->get_failed_count() > 0) {
+            ImGui::TextColored(ImVec4(0.9f, 0.1f, 0.1f, 1.0f), "Failed to write: %llu", static_cast<unsigned long long>(frame_capture->get_failed_count()));
+        }
     }
+    ImGui::End();
 }
 
 void OpenGLManager::print_info() const {
@@ -142,6 +270,18 @@ void OpenGLManager::print_info() const {
 }
 
 void OpenGLManager::terminate() {
+    stop_capture();
+    stop_profiling();
+
+    // Frees the shared GPU memory while the context still exists.
+    BufferArena::release_default();
+
+    // The objects still alive once the application and the shared resources are freed have never been deleted.
+    if (GLObjectTracker::get_live_count() > 0) {
+        std::cerr << "Leaked OpenGL objects detected." << std::endl;
+        GLObjectTracker::report(std::cerr);
+    }
+
     // Frees allocated resource associated with GLFW.
     glfwTerminate();
 }
@@ -0,0 +1,299 @@
+#include "buffer_arena.hpp"
+#include "utils/frame_counters.hpp"
+#include "utils/gl_object_tracker.hpp"
+#include <algorithm>
+#include <iterator>
+
+std::shared_ptr<BufferArena> BufferArena::default_arena;
+
+/** Rounds the value up to the nearest multiple of the alignment. */
+static GLintptr align_up(GLintptr value, GLsizeiptr alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+// ----------------------------------------------------------------------------
+// Constructors
+// ----------------------------------------------------------------------------
+BufferArena::BufferArena(GLsizeiptr page_size, GLbitfield storage_flags) : page_size(page_size), storage_flags(storage_flags) {}
+
+BufferArena::~BufferArena() { release(); }
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+BufferArena::Handle BufferArena::allocate(GLsizeiptr size, GLsizeiptr alignment, const void* data) {
+    if (size <= 0 || released) {
+        return INVALID_HANDLE;
+    }
+    alignment = std::max<GLsizeiptr>(alignment, 1);
+
+    // Best fit: the smallest free range that can hold the data after aligning its offset.
+    auto fits = [&](const std::pair<const GLsizeiptr, std::pair<uint32_t, GLintptr>>& block) {
+        const GLintptr offset = block.second.second;
+        return align_up(offset, alignment) - offset + size <= block.first;
+    };
+    auto block = std::find_if(free_by_size.lower_bound(size), free_by_size.end(), fits);
+    if (block == free_by_size.end()) {
+        create_page(size + alignment);
+        block = std::find_if(free_by_size.lower_bound(size), free_by_size.end(), fits);
+    }
+
+    const uint32_t page = block->second.first;
+    const GLintptr block_offset = block->second.second;
+    const GLsizeiptr block_size = block->first;
+    free_by_size.erase(block);
+    pages[page].free_blocks.erase(block_offset);
+
+    // The alignment padding stays part of the allocation, the rest of the range is returned to the page.
+    Allocation allocation;
+    allocation.page = page;
+    allocation.offset = align_up(block_offset, alignment);
+    allocation.block_offset = block_offset;
+    allocation.block_size = allocation.offset - block_offset + size;
+    allocation.size = size;
+    allocation.alignment = alignment;
+    allocation.live = true;
+    if (block_size > allocation.block_size) {
+        insert_free_block(page, block_offset + allocation.block_size, block_size - allocation.block_size);
+    }
+    pages[page].allocation_count++;
+
+    Handle handle;
+    if (!free_handles.empty()) {
+        handle = free_handles.back();
+        free_handles.pop_back();
+        allocations[handle] = allocation;
+    } else {
+        handle = static_cast<Handle>(allocations.size());
+        allocations.push_back(allocation);
+    }
+
+    if (data) {
+        upload(handle, 0, size, data);
+    }
+    return handle;
+}
+
+void BufferArena::free(Handle handle) {
+    if (released || handle >= allocations.size() || !allocations[handle].live) {
+        return;
+    }
+
+    Allocation& allocation = allocations[handle];
+    insert_free_block(allocation.page, allocation.block_offset, allocation.block_size);
+    pages[allocation.page].allocation_count--;
+    allocation.live = false;
+    free_handles.push_back(handle);
+}
+
+void BufferArena::upload(Handle handle, GLintptr offset, GLsizeiptr size, const void* data) const {
+    const Range range = get_range(handle);
+    if (range.buffer != 0) {
+        glNamedBufferSubData(range.buffer, range.offset + offset, size, data);
+        FrameCounters::count_upload(size);
+    }
+}
+
+void BufferArena::defragment() {
+    if (released) {
+        return;
+    }
+
+    bool changed = false;
+    for (uint32_t p = 0; p < pages.size(); p++) {
+        Page& page = pages[p];
+        if (page.buffer == 0) {
+            continue;
+        }
+
+        // Removes all free ranges of the page, they are rebuilt below.
+        for (const auto& [offset, size] : page.free_blocks) {
+            erase_from_size_index(p, offset, size);
+        }
+
+        // Empty pages are released.
+        if (page.allocation_count == 0) {
+            GLObjectTracker::on_delete(GLObjectType::BUFFER, page.buffer);
+            glDeleteBuffers(1, &page.buffer);
+            page = Page{};
+            changed = true;
+            continue;
+        }
+
+        // A page is already compact if it has at most a single free range at its end.
+        const bool compact = page.free_blocks.empty() ||
+                             (page.free_blocks.size() == 1 &&
+                              page.free_blocks.begin()->first + page.free_blocks.begin()->second == page.size);
+        if (compact) {
+            for (const auto& [offset, size] : page.free_blocks) {
+                free_by_size.insert({size, {p, offset}});
+            }
+            continue;
+        }
+
+        // Collects the allocations of the page in the order of their offsets.
+        std::vector<Handle> handles;
+        for (Handle h = 0; h < allocations.size(); h++) {
+            if (allocations[h].live && allocations[h].page == p) {
+                handles.push_back(h);
+            }
+        }
+        std::sort(handles.begin(), handles.end(),
+                  [&](Handle a, Handle b) { return allocations[a].block_offset < allocations[b].block_offset; });
+
+        // Copies the allocations tightly into a new buffer (copies within a single buffer must not overlap).
+        GLuint buffer;
+        glCreateBuffers(1, &buffer);
+        glNamedBufferStorage(buffer, page.size, nullptr, storage_flags);
+        GLObjectTracker::on_create(GLObjectType::BUFFER, buffer, page.size);
+
+        GLintptr cursor = 0;
+        for (Handle h : handles) {
+            Allocation& allocation = allocations[h];
+            const GLintptr offset = align_up(cursor, allocation.alignment);
+            glCopyNamedBufferSubData(page.buffer, buffer, allocation.offset, offset, allocation.size);
+            allocation.block_offset = cursor;
+            allocation.offset = offset;
+            allocation.block_size = offset - cursor + allocation.size;
+            cursor = offset + allocation.size;
+        }
+
+        GLObjectTracker::on_delete(GLObjectType::BUFFER, page.buffer);
+        glDeleteBuffers(1, &page.buffer);
+        page.buffer = buffer;
+        page.free_blocks.clear();
+        if (cursor < page.size) {
+            insert_free_block(p, cursor, page.size - cursor);
+        }
+        changed = true;
+    }
+
+    if (changed) {
+        generation++;
+    }
+}
+
+void BufferArena::release() {
+    if (released) {
+        return;
+    }
+
+    for (Page& page : pages) {
+        if (page.buffer != 0) {
+            GLObjectTracker::on_delete(GLObjectType::BUFFER, page.buffer);
+            glDeleteBuffers(1, &page.buffer);
+        }
+    }
+    pages.clear();
+    allocations.clear();
+    free_handles.clear();
+    free_by_size.clear();
+    generation++;
+    released = true;
+}
+
+BufferArena::Statistics BufferArena::get_statistics() const {
+    Statistics statistics;
+    for (const Page& page : pages) {
+        if (page.buffer == 0) {
+            continue;
+        }
+        statistics.page_count++;
+        statistics.reserved_bytes += page.size;
+        statistics.free_block_count += page.free_blocks.size();
+
+        size_t free_bytes = 0;
+        for (const auto& [offset, size] : page.free_blocks) {
+            free_bytes += size;
+            statistics.largest_free_block = std::max(statistics.largest_free_block, size_t(size));
+        }
+        statistics.used_bytes += page.size - free_bytes;
+        statistics.allocation_count += page.allocation_count;
+    }
+    return statistics;
+}
+
+std::shared_ptr<BufferArena> BufferArena::get_default() {
+    if (!default_arena) {
+        default_arena = std::make_shared<BufferArena>();
+    }
+    return default_arena;
+}
+
+void BufferArena::release_default() {
+    if (default_arena) {
+        // Geometries may still hold the arena, the release makes their later calls no-ops.
+        default_arena->release();
+        default_arena.reset();
+    }
+}
+
+uint32_t BufferArena::create_page(GLsizeiptr size) {
+    Page page;
+    page.size = std::max(page_size, size);
+    glCreateBuffers(1, &page.buffer);
+    glNamedBufferStorage(page.buffer, page.size, nullptr, storage_flags);
+    GLObjectTracker::on_create(GLObjectType::BUFFER, page.buffer, page.size);
+
+    // Reuses a slot of a released page if there is one.
+    uint32_t index = static_cast<uint32_t>(pages.size());
+    for (uint32_t p = 0; p < pages.size(); p++) {
+        if (pages[p].buffer == 0) {
+            index = p;
+            break;
+        }
+    }
+    if (index == pages.size()) {
+        pages.push_back(std::move(page));
+    } else {
+        pages[index] = std::move(page);
+    }
+
+    insert_free_block(index, 0, pages[index].size);
+    return index;
+}
+
+void BufferArena::insert_free_block(uint32_t page, GLintptr offset, GLsizeiptr size) {
+    std::map<GLintptr, GLsizeiptr>& blocks = pages[page].free_blocks;
+
+    // Coalesces with the following free range.
+    auto next = blocks.lower_bound(offset);
+    if (next != blocks.end() && offset + size == next->first) {
+        erase_from_size_index(page, next->first, next->second);
+        size += next->second;
+        next = blocks.erase(next);
+    }
+
+    // Coalesces with the preceding free range.
+    if (next != blocks.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset) {
+            erase_from_size_index(page, previous->first, previous->second);
+            offset = previous->first;
+            size += previous->second;
+            blocks.erase(previous);
+        }
+    }
+
+    blocks[offset] = size;
+    free_by_size.insert({size, {page, offset}});
+}
+
+void BufferArena::erase_from_size_index(uint32_t page, GLintptr offset, GLsizeiptr size) {
+    auto [first, last] = free_by_size.equal_range(size);
+    for (auto it = first; it != last; ++it) {
+        if (it->second.first == page && it->second.second == offset) {
+            free_by_size.erase(it);
+            return;
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Getters & Setters
+// ----------------------------------------------------------------------------
+BufferArena::Range BufferArena::get_range(Handle handle) const {
+    if (released || handle >= allocations.size() || !allocations[handle].live) {
+        return {};
+    }
+    const Allocation& allocation = allocations[handle];
+    return {pages[allocation.page].buffer, allocation.offset, allocation.size};
+}
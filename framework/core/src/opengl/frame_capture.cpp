@@ -0,0 +1,291 @@
+#include "frame_capture.hpp"
+#include "utils/gl_object_tracker.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+// The compression level of the PNG images, the default one (8) is several times slower for a few percent smaller files.
+static const int PNG_COMPRESSION_LEVEL = 1;
+
+/** Converts the RGBA8 pixels with rows from the bottom into RGB8 pixels with rows from the top. */
+static std::vector<uint8_t> to_rgb(const uint8_t* rgba, int width, int height) {
+    std::vector<uint8_t> result(static_cast<size_t>(width) * height * 3);
+    for (int y = 0; y < height; y++) {
+        const uint8_t* source = rgba + static_cast<size_t>(height - 1 - y) * width * 4;
+        uint8_t* target = result.data() + static_cast<size_t>(y) * width * 3;
+        for (int x = 0; x < width; x++) {
+            target[x * 3 + 0] = source[x * 4 + 0];
+            target[x * 3 + 1] = source[x * 4 + 1];
+            target[x * 3 + 2] = source[x * 4 + 2];
+        }
+    }
+    return result;
+}
+
+/** Appends a 32-bit big-endian value. */
+static void write_big_endian(std::vector<uint8_t>& data, uint32_t value) {
+    data.push_back(static_cast<uint8_t>(value >> 24));
+    data.push_back(static_cast<uint8_t>(value >> 16));
+    data.push_back(static_cast<uint8_t>(value >> 8));
+    data.push_back(static_cast<uint8_t>(value));
+}
+
+// ----------------------------------------------------------------------------
+// Constructors
+// ----------------------------------------------------------------------------
+FrameCapture::FrameCapture(std::filesystem::path directory, CaptureFormat format, size_t encoder_count, size_t max_pending_copies,
+                           size_t max_queued_frames)
+    : directory(std::move(directory)), format(format), max_pending_copies(std::max<size_t>(max_pending_copies, 1)),
+      max_queued_frames(std::max<size_t>(max_queued_frames, 1)) {
+    std::error_code error;
+    std::filesystem::create_directories(this->directory, error);
+    if (error) {
+        std::cerr << "Failed to create the capture directory " << this->directory << ": " << error.message() << std::endl;
+    }
+    stbi_write_png_compression_level = PNG_COMPRESSION_LEVEL;
+    for (size_t i = 0; i < std::max<size_t>(encoder_count, 1); i++) {
+        encoders.emplace_back(&FrameCapture::encode_frames, this);
+    }
+}
+
+FrameCapture::~FrameCapture() {
+    // The pending copies are waited for, so the capture ends with the last rendered frame.
+    readback.finish();
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    for (std::thread& encoder : encoders) {
+        encoder.join();
+    }
+
+    GLObjectTracker::on_delete(GLObjectType::FRAMEBUFFER, resolve_framebuffer);
+    GLObjectTracker::on_delete(GLObjectType::RENDERBUFFER, resolve_renderbuffer);
+    glDeleteFramebuffers(1, &resolve_framebuffer);
+    glDeleteRenderbuffers(1, &resolve_renderbuffer);
+}
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+void FrameCapture::capture(int width, int height) {
+    readback.update();
+    const uint64_t number = frame_count++;
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    if (readback.get_pending_count() >= max_pending_copies) {
+        dropped_count++;
+        return;
+    }
+
+    // The multisampled back buffer cannot be read directly, it is resolved into a single-sampled framebuffer first.
+    GLuint framebuffer = 0;
+    GLint samples = 0;
+    glGetNamedFramebufferParameteriv(0, GL_SAMPLES, &samples);
+    if (samples > 1) {
+        if (resolve_width != width || resolve_height != height) {
+            GLObjectTracker::on_delete(GLObjectType::FRAMEBUFFER, resolve_framebuffer);
+            GLObjectTracker::on_delete(GLObjectType::RENDERBUFFER, resolve_renderbuffer);
+            glDeleteFramebuffers(1, &resolve_framebuffer);
+            glDeleteRenderbuffers(1, &resolve_renderbuffer);
+            glCreateRenderbuffers(1, &resolve_renderbuffer);
+            glNamedRenderbufferStorage(resolve_renderbuffer, GL_RGBA8, width, height);
+            glCreateFramebuffers(1, &resolve_framebuffer);
+            glNamedFramebufferRenderbuffer(resolve_framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, resolve_renderbuffer);
+            GLObjectTracker::on_create(GLObjectType::RENDERBUFFER, resolve_renderbuffer, static_cast<uint64_t>(width) * height * 4);
+            GLObjectTracker::on_create(GLObjectType::FRAMEBUFFER, resolve_framebuffer);
+            resolve_width = width;
+            resolve_height = height;
+        }
+        glBlitNamedFramebuffer(0, resolve_framebuffer, 0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        framebuffer = resolve_framebuffer;
+    }
+
+    const size_t size = static_cast<size_t>(width) * height * 4;
+    readback.read_framebuffer(framebuffer, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, size,
+                              [this, number, width, height](const uint8_t* data, size_t size) { enqueue(number, width, height, data, size); });
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+void FrameCapture::enqueue(uint64_t number, int width, int height, const uint8_t* data, size_t size) {
+    Frame frame;
+    frame.number = number;
+    frame.width = width;
+    frame.height = height;
+    {
+        std::lock_guard lock(mutex);
+        if (queue.size() >= max_queued_frames) {
+            dropped_count++;
+            return;
+        }
+        if (!free_pixels.empty()) {
+            frame.pixels = std::move(free_pixels.back());
+            free_pixels.pop_back();
+        }
+    }
+
+    // The data are copied out of the mapped buffer outside of the lock, the encoders keep working meanwhile.
+    frame.pixels.resize(size);
+    std::memcpy(frame.pixels.data(), data, size);
+    {
+        std::lock_guard lock(mutex);
+        queue.push_back(std::move(frame));
+    }
+    condition.notify_one();
+}
+
+void FrameCapture::encode_frames() {
+    std::unique_lock lock(mutex);
+    while (true) {
+        condition.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (queue.empty()) {
+            return;
+        }
+        Frame frame = std::move(queue.front());
+        queue.pop_front();
+
+        lock.unlock();
+        const bool written = write_frame(frame);
+        lock.lock();
+
+        (written ? written_count : failed_count)++;
+        if (free_pixels.size() < max_queued_frames) {
+            free_pixels.push_back(std::move(frame.pixels));
+        }
+    }
+}
+
+bool FrameCapture::write_frame(const Frame& frame) const {
+    char name[64];
+    if (format == CaptureFormat::RAW) {
+        std::snprintf(name, sizeof(name), "frame_%06llu_%dx%d.%s", static_cast<unsigned long long>(frame.number), frame.width,
+                      frame.height, get_extension(format));
+    } else {
+        std::snprintf(name, sizeof(name), "frame_%06llu.%s", static_cast<unsigned long long>(frame.number), get_extension(format));
+    }
+    std::ofstream file(directory / name, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    switch (format) {
+    case CaptureFormat::RAW: {
+        const size_t row_size = static_cast<size_t>(frame.width) * 4;
+        for (int y = frame.height - 1; y >= 0; y--) {
+            file.write(reinterpret_cast<const char*>(frame.pixels.data() + y * row_size), static_cast<std::streamsize>(row_size));
+        }
+        break;
+    }
+    case CaptureFormat::PNG: {
+        const std::vector<uint8_t> rgb = to_rgb(frame.pixels.data(), frame.width, frame.height);
+        auto write = [](void* context, void* data, int size) { static_cast<std::ofstream*>(context)->write(static_cast<const char*>(data), size); };
+        if (!stbi_write_png_to_func(write, &file, frame.width, frame.height, 3, rgb.data(), frame.width * 3)) {
+            return false;
+        }
+        break;
+    }
+    case CaptureFormat::QOI: {
+        const std::vector<uint8_t> qoi = encode_qoi(frame.pixels.data(), frame.width, frame.height);
+        file.write(reinterpret_cast<const char*>(qoi.data()), static_cast<std::streamsize>(qoi.size()));
+        break;
+    }
+    }
+    return static_cast<bool>(file);
+}
+
+std::vector<uint8_t> FrameCapture::encode_qoi(const uint8_t* rgba, int width, int height) {
+    std::vector<uint8_t> data;
+    data.reserve(14 + static_cast<size_t>(width) * height + 8);
+    data.insert(data.end(), {'q', 'o', 'i', 'f'});
+    write_big_endian(data, static_cast<uint32_t>(width));
+    write_big_endian(data, static_cast<uint32_t>(height));
+    data.push_back(3); // channels
+    data.push_back(0); // sRGB with linear alpha
+
+    // The previously seen pixels are indexed by a hash of their values, the alpha is always 255 for three channels
+    // while the unused entries of the index hold zeros.
+    uint8_t index[64][4] = {};
+    uint8_t previous[3] = {0, 0, 0};
+    int run = 0;
+    for (int y = height - 1; y >= 0; y--) {
+        const uint8_t* row = rgba + static_cast<size_t>(y) * width * 4;
+        for (int x = 0; x < width; x++) {
+            const uint8_t* pixel = row + x * 4;
+            if (pixel[0] == previous[0] && pixel[1] == previous[1] && pixel[2] == previous[2]) {
+                if (++run == 62) {
+                    data.push_back(static_cast<uint8_t>(0xC0 | (run - 1))); // QOI_OP_RUN
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0) {
+                data.push_back(static_cast<uint8_t>(0xC0 | (run - 1)));
+                run = 0;
+            }
+
+            const int hash = (pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + 255 * 11) % 64;
+            if (std::memcmp(index[hash], pixel, 3) == 0 && index[hash][3] == 255) {
+                data.push_back(static_cast<uint8_t>(hash)); // QOI_OP_INDEX
+            } else {
+                std::memcpy(index[hash], pixel, 3);
+                index[hash][3] = 255;
+                const int dr = static_cast<int8_t>(pixel[0] - previous[0]);
+                const int dg = static_cast<int8_t>(pixel[1] - previous[1]);
+                const int db = static_cast<int8_t>(pixel[2] - previous[2]);
+                const int dr_dg = dr - dg;
+                const int db_dg = db - dg;
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                    data.push_back(static_cast<uint8_t>(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2))); // QOI_OP_DIFF
+                } else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7) {
+                    data.push_back(static_cast<uint8_t>(0x80 | (dg + 32))); // QOI_OP_LUMA
+                    data.push_back(static_cast<uint8_t>((dr_dg + 8) << 4 | (db_dg + 8)));
+                } else {
+                    data.insert(data.end(), {0xFE, pixel[0], pixel[1], pixel[2]}); // QOI_OP_RGB
+                }
+            }
+            std::memcpy(previous, pixel, 3);
+        }
+    }
+    if (run > 0) {
+        data.push_back(static_cast<uint8_t>(0xC0 | (run - 1)));
+    }
+    data.insert(data.end(), {0, 0, 0, 0, 0, 0, 0, 1});
+    return data;
+}
+
+const char* FrameCapture::get_extension(CaptureFormat format) {
+    switch (format) {
+    case CaptureFormat::RAW:
+        return "rgba";
+    case CaptureFormat::PNG:
+        return "png";
+    case CaptureFormat::QOI:
+    default:
+        return "qoi";
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Getters & Setters
+// ----------------------------------------------------------------------------
+size_t FrameCapture::get_queued_count() const {
+    std::lock_guard lock(mutex);
+    return queue.size();
+}
+
+uint64_t FrameCapture::get_written_count() const {
+    std::lock_guard lock(mutex);
+    return written_count;
+}
+
+uint64_t FrameCapture::get_failed_count() const {
+    std::lock_guard lock(mutex);
+    return failed_count;
+}
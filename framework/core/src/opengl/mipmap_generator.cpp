@@ -0,0 +1,246 @@
+#include "mipmap_generator.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define MIPMAP_GENERATOR_SSE
+#include <xmmintrin.h>
+#endif
+
+// The radius of the Kaiser filter in the pixels of the downsampled level, and the shape parameter of its window.
+static const float KAISER_WIDTH = 2.0f;
+static const float KAISER_ALPHA = 4.0f;
+
+// The number of entries of the table encoding linear values into sRGB.
+static const int SRGB_TABLE_SIZE = 16384;
+
+// The number of pixels filtered by a single task (at least one row).
+static const size_t MIN_TASK_PIXELS = 16384;
+
+/** The tables converting between the 8-bit values and the linear values in [0, 1]. */
+struct ColorTables {
+    /** The linear values of 8-bit values: [0] for data, [1] for sRGB-encoded colors. */
+    float to_linear[2][256];
+    /** The sRGB-encoded values of linear values sampled uniformly in [0, 1]. */
+    uint8_t to_srgb[SRGB_TABLE_SIZE];
+
+    ColorTables() {
+        for (int i = 0; i < 256; i++) {
+            const float value = float(i) / 255.0f;
+            to_linear[0][i] = value;
+            to_linear[1][i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i < SRGB_TABLE_SIZE; i++) {
+            const float value = float(i) / float(SRGB_TABLE_SIZE - 1);
+            const float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+            to_srgb[i] = static_cast<uint8_t>(std::clamp(encoded, 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+    }
+
+    /** Returns the shared tables, created with the first call. */
+    static const ColorTables& get() {
+        static const ColorTables tables;
+        return tables;
+    }
+};
+
+/** The source pixels contributing to a single target pixel along one axis. */
+struct Taps {
+    /** The first source pixel. */
+    int first = 0;
+    /** The weights of the source pixels from the first one, they sum to 1. */
+    std::vector<float> weights;
+};
+
+/** Returns the modified Bessel function of the first kind of order zero. */
+static float bessel_i0(float x) {
+    float sum = 1.0f;
+    float term = 1.0f;
+    for (int k = 1; k < 20; k++) {
+        term *= (x / (2.0f * k)) * (x / (2.0f * k));
+        sum += term;
+    }
+    return sum;
+}
+
+/** Returns the value of the filter at the distance (in the pixels of the target level) from the target pixel. */
+static float evaluate(MipmapFilter filter, float distance, float scale) {
+    if (filter == MipmapFilter::BOX) {
+        // The overlap of a source pixel with the footprint of the target pixel, both measured in target pixels.
+        const float half = 0.5f / scale;
+        return std::max(0.0f, std::min(distance + half, 0.5f) - std::max(distance - half, -0.5f));
+    }
+    const float x = std::abs(distance);
+    if (x >= KAISER_WIDTH) {
+        return 0.0f;
+    }
+    const float sinc = x < 1e-5f ? 1.0f : std::sin(3.14159265f * x) / (3.14159265f * x);
+    const float ratio = x / KAISER_WIDTH;
+    return sinc * bessel_i0(KAISER_ALPHA * std::sqrt(1.0f - ratio * ratio)) / bessel_i0(KAISER_ALPHA);
+}
+
+/** Computes the taps of all target pixels along one axis, the pixels outside the source repeat the edge. */
+static std::vector<Taps> compute_taps(MipmapFilter filter, int source_size, int target_size) {
+    const float scale = float(source_size) / float(target_size);
+    const float radius = (filter == MipmapFilter::BOX ? 0.5f : KAISER_WIDTH) * scale;
+    std::vector<Taps> result(target_size);
+    for (int t = 0; t < target_size; t++) {
+        const float center = (float(t) + 0.5f) * scale;
+        const int begin = static_cast<int>(std::floor(center - radius));
+        const int end = static_cast<int>(std::ceil(center + radius));
+        Taps& taps = result[t];
+        taps.first = std::clamp(begin, 0, source_size - 1);
+        taps.weights.assign(std::clamp(end, 1, source_size) - taps.first, 0.0f);
+
+        float sum = 0.0f;
+        for (int s = begin; s < end; s++) {
+            const float weight = evaluate(filter, (float(s) + 0.5f - center) / scale, scale);
+            taps.weights[std::clamp(s, 0, source_size - 1) - taps.first] += weight;
+            sum += weight;
+        }
+        for (float& weight : taps.weights) {
+            weight /= sum;
+        }
+    }
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+// The four channels of a pixel as floats.
+// ----------------------------------------------------------------------------
+#ifdef MIPMAP_GENERATOR_SSE
+using Pixel = __m128;
+static inline Pixel pixel_zero() { return _mm_setzero_ps(); }
+static inline Pixel pixel_load(const float* values) { return _mm_loadu_ps(values); }
+static inline void pixel_store(float* values, Pixel pixel) { _mm_storeu_ps(values, pixel); }
+static inline Pixel pixel_set(float r, float g, float b, float a) { return _mm_set_ps(a, b, g, r); }
+static inline Pixel pixel_add_scaled(Pixel sum, Pixel pixel, float weight) {
+    return _mm_add_ps(sum, _mm_mul_ps(pixel, _mm_set1_ps(weight)));
+}
+static inline Pixel pixel_saturate(Pixel pixel) { return _mm_min_ps(_mm_max_ps(pixel, _mm_setzero_ps()), _mm_set1_ps(1.0f)); }
+static inline Pixel pixel_add(Pixel a, Pixel b) { return _mm_add_ps(a, b); }
+#else
+struct Pixel {
+    float v[4];
+};
+static inline Pixel pixel_zero() { return {{0.0f, 0.0f, 0.0f, 0.0f}}; }
+static inline Pixel pixel_load(const float* values) { return {{values[0], values[1], values[2], values[3]}}; }
+static inline void pixel_store(float* values, Pixel pixel) { std::copy(pixel.v, pixel.v + 4, values); }
+static inline Pixel pixel_set(float r, float g, float b, float a) { return {{r, g, b, a}}; }
+static inline Pixel pixel_add_scaled(Pixel sum, Pixel pixel, float weight) {
+    for (int c = 0; c < 4; c++) {
+        sum.v[c] += pixel.v[c] * weight;
+    }
+    return sum;
+}
+static inline Pixel pixel_saturate(Pixel pixel) {
+    for (float& value : pixel.v) {
+        value = std::clamp(value, 0.0f, 1.0f);
+    }
+    return pixel;
+}
+static inline Pixel pixel_add(Pixel a, Pixel b) {
+    for (int c = 0; c < 4; c++) {
+        a.v[c] += b.v[c];
+    }
+    return a;
+}
+#endif
+
+/** Encodes the linear values of a pixel into 8-bit values. */
+static inline void encode(Pixel pixel, bool srgb, const ColorTables& tables, uint8_t* target) {
+    float values[4];
+    pixel_store(values, pixel_saturate(pixel));
+    for (int c = 0; c < 3; c++) {
+        target[c] = srgb ? tables.to_srgb[static_cast<int>(values[c] * (SRGB_TABLE_SIZE - 1) + 0.5f)] : static_cast<uint8_t>(values[c] * 255.0f + 0.5f);
+    }
+    target[3] = static_cast<uint8_t>(values[3] * 255.0f + 0.5f);
+}
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+std::vector<std::vector<uint8_t>> MipmapGenerator::generate(std::vector<uint8_t> rgba, int width, int height, int levels,
+                                                            MipmapFilter filter, bool srgb, ThreadPool& pool) {
+    std::vector<std::vector<uint8_t>> result;
+    result.reserve(std::max(levels, 1));
+    result.push_back(std::move(rgba));
+    for (int level = 1; level < levels; level++) {
+        const int level_width = std::max(1, width >> (level - 1));
+        const int level_height = std::max(1, height >> (level - 1));
+        result.push_back(downsample(result.back().data(), level_width, level_height, filter, srgb, pool));
+    }
+    return result;
+}
+
+std::vector<uint8_t> MipmapGenerator::downsample(const uint8_t* rgba, int width, int height, MipmapFilter filter, bool srgb,
+                                                 ThreadPool& pool) {
+    const int result_width = std::max(1, width / 2);
+    const int result_height = std::max(1, height / 2);
+    std::vector<uint8_t> result(static_cast<size_t>(result_width) * result_height * 4);
+
+    const ColorTables& tables = ColorTables::get();
+    const float* const to_linear = tables.to_linear[srgb ? 1 : 0];
+    auto decode = [to_linear](const uint8_t* pixel) {
+        return pixel_set(to_linear[pixel[0]], to_linear[pixel[1]], to_linear[pixel[2]], pixel[3] / 255.0f);
+    };
+
+    // The box filter of even sizes averages 2x2 pixels, which needs no weights.
+    if (filter == MipmapFilter::BOX && width % 2 == 0 && height % 2 == 0) {
+        pool.parallel_for(
+            static_cast<size_t>(result_height),
+            [&](size_t begin, size_t end) {
+                for (size_t y = begin; y < end; y++) {
+                    const uint8_t* row0 = rgba + y * 2 * width * 4;
+                    const uint8_t* row1 = row0 + static_cast<size_t>(width) * 4;
+                    uint8_t* target = result.data() + y * result_width * 4;
+                    for (int x = 0; x < result_width; x++) {
+                        const Pixel sum = pixel_add(pixel_add(decode(row0 + x * 8), decode(row0 + x * 8 + 4)),
+                                                    pixel_add(decode(row1 + x * 8), decode(row1 + x * 8 + 4)));
+                        encode(pixel_add_scaled(pixel_zero(), sum, 0.25f), srgb, tables, target + x * 4);
+                    }
+                }
+            },
+            std::max<size_t>(1, MIN_TASK_PIXELS / result_width));
+        return result;
+    }
+
+    const std::vector<Taps> columns = compute_taps(filter, width, result_width);
+    const std::vector<Taps> rows = compute_taps(filter, height, result_height);
+
+    pool.parallel_for(
+        static_cast<size_t>(result_height),
+        [&](size_t begin, size_t end) {
+            // The rows covered by a target row are first filtered vertically into a row of linear values.
+            std::vector<float> filtered(static_cast<size_t>(width) * 4);
+            for (size_t y = begin; y < end; y++) {
+                const Taps& row_taps = rows[y];
+                for (int x = 0; x < width; x++) {
+                    Pixel sum = pixel_zero();
+                    for (size_t i = 0; i < row_taps.weights.size(); i++) {
+                        const uint8_t* pixel = rgba + ((static_cast<size_t>(row_taps.first) + i) * width + x) * 4;
+                        sum = pixel_add_scaled(sum, decode(pixel), row_taps.weights[i]);
+                    }
+                    pixel_store(&filtered[static_cast<size_t>(x) * 4], sum);
+                }
+
+                uint8_t* target = result.data() + y * result_width * 4;
+                for (int x = 0; x < result_width; x++) {
+                    const Taps& column_taps = columns[x];
+                    Pixel sum = pixel_zero();
+                    for (size_t i = 0; i < column_taps.weights.size(); i++) {
+                        sum = pixel_add_scaled(sum, pixel_load(&filtered[(static_cast<size_t>(column_taps.first) + i) * 4]), column_taps.weights[i]);
+                    }
+                    // The negative lobes of the Kaiser filter may leave the range, the encoding clamps the values.
+                    encode(sum, srgb, tables, target + x * 4);
+                }
+            }
+        },
+        std::max<size_t>(1, MIN_TASK_PIXELS / result_width));
+    return result;
+}
+
+int MipmapGenerator::get_level_count(int width, int height) {
+    return static_cast<int>(std::bit_width(static_cast<unsigned int>(std::max({width, height, 1}))));
+}
@@ -1,4 +1,7 @@
 #include "program.hpp"
+#include "utils/cpu_profiler.hpp"
+#include "utils/frame_counters.hpp"
+#include "utils/gl_object_tracker.hpp"
 
 #include <filesystem>
 #include <iostream>
@@ -8,7 +11,10 @@
 // ----------------------------------------------------------------------------
 // Constructors
 // ----------------------------------------------------------------------------
-ShaderProgram::ShaderProgram() : program(0), valid(false) { program = glCreateProgram(); }
+ShaderProgram::ShaderProgram() : program(0), valid(false) {
+    program = glCreateProgram();
+    GLObjectTracker::on_create(GLObjectType::PROGRAM, program);
+}
 
 ShaderProgram::ShaderProgram(const std::filesystem::path& vertex_shader, const std::filesystem::path& fragment_shader)
     : ShaderProgram() {
@@ -19,6 +25,7 @@ ShaderProgram::ShaderProgram(const std::filesystem::path& vertex_shader, const s
 }
 
 ShaderProgram::~ShaderProgram() {
+    GLObjectTracker::on_delete(GLObjectType::PROGRAM, program);
     glDeleteProgram(program);
 }
 
@@ -32,6 +39,7 @@ bool ShaderProgram::link() {
     }
 
     // link program
+    ProfileScope zone("link program");
     glLinkProgram(program);
 
     // link and get errors
@@ -59,6 +67,7 @@ bool ShaderProgram::link() {
 void ShaderProgram::use() const {
     if (is_valid()) {
         glUseProgram(program);
+        FrameCounters::count_program(program);
     } else {
         std::cerr << "The OpenGL program object is invalid (use)." << std::endl;
     }
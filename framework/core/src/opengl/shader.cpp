@@ -1,5 +1,7 @@
 #include "shader.hpp"
 #include "utils.hpp"
+#include "utils/cpu_profiler.hpp"
+#include "utils/gl_object_tracker.hpp"
 #include <iostream>
 #include <string>
 
@@ -7,6 +9,7 @@
 // Constructors
 // ----------------------------------------------------------------------------
 Shader::Shader(GLenum shader_type, const std::filesystem::path& file_path) : shader_type(shader_type), file_path(file_path) {
+    ProfileScope zone("compile shader");
     // Loads the source code file from the disk.
     this->file_path.make_preferred();
     std::string s_source = ShaderUtils::load_shader(this->file_path.generic_string());
@@ -17,6 +20,7 @@ Shader::Shader(GLenum shader_type, const std::filesystem::path& file_path) : sha
 
     // Creates a shader object, sets the source and tries to compile it.
     shader = glCreateShader(shader_type);
+    GLObjectTracker::on_create(GLObjectType::SHADER, shader);
     const char* source = s_source.c_str();
     glShaderSource(shader, 1, &source, nullptr);
     glCompileShader(shader);
@@ -57,6 +61,7 @@ Shader::Shader(GLenum shader_type, const std::filesystem::path& file_path) : sha
         glGetShaderInfoLog(shader, log_len, nullptr, log.get());
         std::cout << log.get() << std::endl;
 
+        GLObjectTracker::on_delete(GLObjectType::SHADER, shader);
         glDeleteShader(shader);
         shader = 0;
     }
@@ -72,4 +77,7 @@ Shader& Shader::operator=(Shader other) {
 
 Shader::Shader(Shader&& other) : Shader() { swap(*this, other); }
 
-Shader::~Shader() { glDeleteShader(shader); }
\ No newline at end of file
+Shader::~Shader() {
+    GLObjectTracker::on_delete(GLObjectType::SHADER, shader);
+    glDeleteShader(shader);
+}
\ No newline at end of file
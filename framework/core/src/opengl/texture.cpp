@@ -0,0 +1,183 @@
+#include "texture.hpp"
+#include <bit>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURE_SSE2
+#include <emmintrin.h>
+#endif
+
+// ----------------------------------------------------------------------------
+// Half
+// ----------------------------------------------------------------------------
+Half TexelTraits<Half>::from_float(float value) {
+    const uint32_t bits = std::bit_cast<uint32_t>(value);
+    const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    const int exponent = static_cast<int>((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    if (exponent >= 31) {
+        // Infinity, NaN, and the values too large for a half (rounded to infinity).
+        const bool nan = ((bits >> 23) & 0xFF) == 0xFF && mantissa != 0;
+        return {static_cast<uint16_t>(sign | 0x7C00 | (nan ? 0x200 : 0))};
+    }
+    if (exponent <= 0) {
+        // Denormalized halfs, or zero for the values too small.
+        if (exponent < -10) {
+            return {sign};
+        }
+        mantissa |= 0x800000;
+        const int shift = 14 - exponent;
+        const uint32_t remainder = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        uint32_t rounded = mantissa >> shift;
+        if (remainder > halfway || (remainder == halfway && (rounded & 1))) {
+            rounded++;
+        }
+        return {static_cast<uint16_t>(sign | rounded)};
+    }
+    // Rounds to the nearest even value, the carry may increase the exponent.
+    const uint32_t rounded = ((static_cast<uint32_t>(exponent) << 23 | mantissa) + 0xFFF + ((mantissa >> 13) & 1)) >> 13;
+    return {static_cast<uint16_t>(sign | std::min<uint32_t>(rounded, 0x7C00))};
+}
+
+float TexelTraits<Half>::to_float(Half value) {
+    const uint32_t sign = static_cast<uint32_t>(value.bits & 0x8000) << 16;
+    const uint32_t exponent = (value.bits >> 10) & 0x1F;
+    const uint32_t mantissa = value.bits & 0x3FF;
+
+    if (exponent == 0) {
+        // Zero and the denormalized values.
+        const float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -magnitude : magnitude;
+    }
+    if (exponent == 31) {
+        return std::bit_cast<float>(sign | 0x7F800000 | (mantissa << 13));
+    }
+    return std::bit_cast<float>(sign | ((exponent - 15 + 127) << 23) | (mantissa << 13));
+}
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+void TextureOperations::convert(const float* source, float* target, size_t count) {
+    if (source != target) {
+        std::memcpy(target, source, count * sizeof(float));
+    }
+}
+
+void TextureOperations::convert(const float* source, uint8_t* target, size_t count) {
+    size_t i = 0;
+#ifdef TEXTURE_SSE2
+    // Sixteen values are clamped, scaled, and packed into bytes at once.
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    auto to_int = [&](const float* values) {
+        const __m128 clamped = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(values), zero), one);
+        return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(clamped, scale), half));
+    };
+    for (; i + 16 <= count; i += 16) {
+        const __m128i low = _mm_packs_epi32(to_int(source + i), to_int(source + i + 4));
+        const __m128i high = _mm_packs_epi32(to_int(source + i + 8), to_int(source + i + 12));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + i), _mm_packus_epi16(low, high));
+    }
+#endif
+    for (; i < count; i++) {
+        target[i] = TexelTraits<uint8_t>::from_float(source[i]);
+    }
+}
+
+void TextureOperations::convert(const uint8_t* source, float* target, size_t count) {
+    size_t i = 0;
+#ifdef TEXTURE_SSE2
+    // Sixteen bytes are widened to floats at once.
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+    for (; i + 16 <= count; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+        const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+        _mm_storeu_ps(target + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), scale));
+        _mm_storeu_ps(target + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), scale));
+        _mm_storeu_ps(target + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), scale));
+        _mm_storeu_ps(target + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), scale));
+    }
+#endif
+    for (; i < count; i++) {
+        target[i] = TexelTraits<uint8_t>::to_float(source[i]);
+    }
+}
+
+void TextureOperations::convert(const float* source, Half* target, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        target[i] = TexelTraits<Half>::from_float(source[i]);
+    }
+}
+
+void TextureOperations::convert(const Half* source, float* target, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        target[i] = TexelTraits<Half>::to_float(source[i]);
+    }
+}
+
+void TextureOperations::convolve_row(const float* source, float* target, int width, int channels, std::span<const float> kernel) {
+    const int radius = static_cast<int>(kernel.size() / 2);
+    const int size = static_cast<int>(kernel.size());
+
+    // The pixels near the edges read clamped neighbours.
+    auto convolve_pixel = [&](int x) {
+        for (int c = 0; c < channels; c++) {
+            float sum = 0.0f;
+            for (int k = 0; k < size; k++) {
+                sum += source[std::clamp(x + k - radius, 0, width - 1) * channels + c] * kernel[k];
+            }
+            target[x * channels + c] = sum;
+        }
+    };
+
+    const int interior_begin = std::min(radius, width);
+    const int interior_end = std::max(interior_begin, width - radius);
+    for (int x = 0; x < interior_begin; x++) {
+        convolve_pixel(x);
+    }
+
+    // The interior values are contiguous, so the neighbours of a value are the values 'channels' apart.
+    size_t i = static_cast<size_t>(interior_begin) * channels;
+    const size_t end = static_cast<size_t>(interior_end) * channels;
+#ifdef TEXTURE_SSE2
+    for (; i + 4 <= end; i += 4) {
+        __m128 sum = _mm_setzero_ps();
+        for (int k = 0; k < size; k++) {
+            const __m128 values = _mm_loadu_ps(source + i + static_cast<ptrdiff_t>(k - radius) * channels);
+            sum = _mm_add_ps(sum, _mm_mul_ps(values, _mm_set1_ps(kernel[k])));
+        }
+        _mm_storeu_ps(target + i, sum);
+    }
+#endif
+    for (; i < end; i++) {
+        float sum = 0.0f;
+        for (int k = 0; k < size; k++) {
+            sum += source[i + static_cast<ptrdiff_t>(k - radius) * channels] * kernel[k];
+        }
+        target[i] = sum;
+    }
+
+    for (int x = interior_end; x < width; x++) {
+        convolve_pixel(x);
+    }
+}
+
+void TextureOperations::accumulate(const float* source, float* target, size_t count, float weight) {
+    size_t i = 0;
+#ifdef TEXTURE_SSE2
+    const __m128 scale = _mm_set1_ps(weight);
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(target + i, _mm_add_ps(_mm_loadu_ps(target + i), _mm_mul_ps(_mm_loadu_ps(source + i), scale)));
+    }
+#endif
+    for (; i < count; i++) {
+        target[i] += source[i] * weight;
+    }
+}
@@ -0,0 +1,423 @@
+#include "texture_asset.hpp"
+#include "asset_registry.hpp"
+#include "utils/cpu_profiler.hpp"
+#include "utils/gl_object_tracker.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <map>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+/** A decoded RGBA8 image. */
+struct DecodedImage {
+    std::vector<uint8_t> pixels;
+    int width = 0;
+    int height = 0;
+};
+
+/** Decodes an image into RGBA8, prints an error and returns an empty image on failure. */
+static DecodedImage decode_image(const std::filesystem::path& path) {
+    ProfileScope zone("decode image");
+    DecodedImage image;
+    int channels;
+    unsigned char* data = stbi_load(path.generic_string().data(), &image.width, &image.height, &channels, 4);
+    if (!data) {
+        std::cerr << "Image " << path.generic_string() << " could not be loaded: " << stbi_failure_reason() << std::endl;
+        return {};
+    }
+    image.pixels.assign(data, data + static_cast<size_t>(image.width) * image.height * 4);
+    stbi_image_free(data);
+    return image;
+}
+
+/** Copies a channel of the source image into a channel of the target image, resampling it bilinearly if the sizes differ. */
+static void copy_channel(const DecodedImage& source, int source_channel, uint8_t* target, int target_channel, int width, int height) {
+    ThreadPool::get_default().parallel_for(
+        static_cast<size_t>(height),
+        [&](size_t begin, size_t end) {
+            const float scale_x = float(source.width) / float(width);
+            const float scale_y = float(source.height) / float(height);
+            for (size_t y = begin; y < end; y++) {
+                const float sy = std::clamp((float(y) + 0.5f) * scale_y - 0.5f, 0.0f, float(source.height - 1));
+                const int y0 = static_cast<int>(sy);
+                const int y1 = std::min(y0 + 1, source.height - 1);
+                const float fy = sy - float(y0);
+                for (int x = 0; x < width; x++) {
+                    const float sx = std::clamp((float(x) + 0.5f) * scale_x - 0.5f, 0.0f, float(source.width - 1));
+                    const int x0 = static_cast<int>(sx);
+                    const int x1 = std::min(x0 + 1, source.width - 1);
+                    const float fx = sx - float(x0);
+                    auto at = [&](int px, int py) { return float(source.pixels[(size_t(py) * source.width + px) * 4 + source_channel]); };
+                    const float value = (at(x0, y0) * (1.0f - fx) + at(x1, y0) * fx) * (1.0f - fy) +
+                                        (at(x0, y1) * (1.0f - fx) + at(x1, y1) * fx) * fy;
+                    target[(y * width + x) * 4 + target_channel] = static_cast<uint8_t>(value + 0.5f);
+                }
+            }
+        },
+        16);
+}
+
+// ----------------------------------------------------------------------------
+// Constructors
+// ----------------------------------------------------------------------------
+TextureAsset::TextureAsset(const std::filesystem::path& path, const TextureParameters& parameters,
+                           const std::filesystem::path& cache_directory, TextureStreamer* streamer)
+    : streamer(streamer), parameters(parameters) {
+    source.cache_name = get_cache_name(path.stem().generic_string(), AssetRegistry::get_canonical_path(path), parameters);
+    source.stamp = TextureCompressor::get_source_stamp(path);
+    source.probe = [path](int& width, int& height, bool& has_alpha) {
+        int channels;
+        if (!stbi_info(path.generic_string().data(), &width, &height, &channels)) {
+            std::cerr << "Image " << path.generic_string() << " could not be loaded: " << stbi_failure_reason() << std::endl;
+            return false;
+        }
+        has_alpha = channels == 2 || channels == 4;
+        return true;
+    };
+    source.decode = [path](std::vector<uint8_t>& rgba, int& width, int& height) {
+        DecodedImage image = decode_image(path);
+        rgba = std::move(image.pixels);
+        width = image.width;
+        height = image.height;
+        return !rgba.empty();
+    };
+
+    if (streamer) {
+        create_streamed(source, parameters, cache_directory);
+    } else {
+        create(source, parameters, cache_directory);
+    }
+}
+
+TextureAsset::TextureAsset(const std::vector<ChannelSource>& channels, const TextureParameters& parameters,
+                           const std::filesystem::path& cache_directory, TextureStreamer* streamer)
+    : streamer(streamer), parameters(parameters) {
+    // The cache entry is identified by all sources, and invalidated when any of them changes. A source without a stamp
+    // leaves the texture without one, so it is re-encoded.
+    std::string name;
+    bool stamped = true;
+    for (const ChannelSource& channel : channels) {
+        if (channel.path.empty()) {
+            continue;
+        }
+        if (name.empty()) {
+            name = channel.path.stem().generic_string() + "_packed";
+        }
+        const uint64_t stamp = TextureCompressor::get_source_stamp(channel.path);
+        stamped = stamped && stamp != 0;
+        source.stamp ^= stamp + 0x9e3779b97f4a7c15ull + (source.stamp << 6) + (source.stamp >> 2);
+    }
+    source.stamp = stamped ? source.stamp : 0;
+    source.cache_name = get_cache_name(name.empty() ? "packed" : name, AssetRegistry::make_channels_key(channels), parameters);
+    source.channels = static_cast<int>(std::min<size_t>(channels.size(), 4));
+
+    source.probe = [channels](int& width, int& height, bool& has_alpha) {
+        has_alpha = channels.size() >= 4 && (!channels[3].path.empty() || channels[3].value != 255);
+        for (const ChannelSource& channel : channels) {
+            int components;
+            if (!channel.path.empty() && stbi_info(channel.path.generic_string().data(), &width, &height, &components)) {
+                return true;
+            }
+        }
+        std::cerr << "None of the images packed into " << (channels.empty() ? "a texture" : channels[0].path.generic_string())
+                  << " could be loaded" << std::endl;
+        return false;
+    };
+    source.decode = [channels](std::vector<uint8_t>& rgba, int& width, int& height) {
+        // Every image is decoded once even if it provides several channels.
+        std::map<std::filesystem::path, DecodedImage> images;
+        width = height = 0;
+        for (const ChannelSource& channel : channels) {
+            if (!channel.path.empty() && !images.contains(channel.path)) {
+                DecodedImage& image = images[channel.path] = decode_image(channel.path);
+                if (width == 0 && !image.pixels.empty()) {
+                    width = image.width;
+                    height = image.height;
+                }
+            }
+        }
+        if (width == 0) {
+            return false;
+        }
+
+        rgba.resize(static_cast<size_t>(width) * height * 4);
+        for (size_t i = 0; i < rgba.size(); i += 4) {
+            rgba[i + 0] = rgba[i + 1] = rgba[i + 2] = 0;
+            rgba[i + 3] = 255;
+        }
+        for (int c = 0; c < static_cast<int>(std::min<size_t>(channels.size(), 4)); c++) {
+            const ChannelSource& channel = channels[c];
+            const DecodedImage* image = channel.path.empty() ? nullptr : &images[channel.path];
+            if (image && !image->pixels.empty()) {
+                copy_channel(*image, std::clamp(channel.channel, 0, 3), rgba.data(), c, width, height);
+            } else {
+                for (size_t i = c; i < rgba.size(); i += 4) {
+                    rgba[i] = channel.value;
+                }
+            }
+        }
+        return true;
+    };
+
+    if (streamer) {
+        create_streamed(source, parameters, cache_directory);
+    } else {
+        create(source, parameters, cache_directory);
+    }
+}
+
+TextureAsset::~TextureAsset() {
+    if (streamer) {
+        streamer->cancel(texture);
+    }
+    GLObjectTracker::on_delete(GLObjectType::TEXTURE, texture);
+    glDeleteTextures(1, &texture);
+}
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+int TextureAsset::get_mip_count(int width, int height) {
+    return MipmapGenerator::get_level_count(width, height);
+}
+
+void TextureAsset::create(const Source& source, const TextureParameters& parameters, const std::filesystem::path& cache_directory) {
+    // The compressed textures are loaded from the cache if the source images did not change.
+    const bool compressed = parameters.role != TextureRole::UNCOMPRESSED;
+    cache_path = compressed && !cache_directory.empty() ? cache_directory / source.cache_name : "";
+    CompressedImage image;
+    if (!cache_path.empty() && TextureCompressor::load(cache_path, image, source.stamp)) {
+        create_compressed(image, parameters);
+        return;
+    }
+
+    std::vector<uint8_t> rgba;
+    if (!source.decode(rgba, width, height)) {
+        width = height = 0;
+        return;
+    }
+
+    const std::vector<std::vector<uint8_t>> chain = MipmapGenerator::generate(
+        std::move(rgba), width, height, parameters.mipmaps ? get_mip_count(width, height) : 1, parameters.mipmap_filter, parameters.is_gamma_encoded());
+    if (compressed) {
+        const bool has_alpha = TextureCompressor::has_alpha(chain[0].data(), width, height);
+        image = TextureCompressor::compress(chain, width, height, TextureCompressor::get_internal_format(parameters.role, parameters.srgb, has_alpha));
+        if (!cache_path.empty() && !TextureCompressor::save(cache_path, image, source.stamp)) {
+            std::cerr << "Texture cache " << cache_path.generic_string() << " could not be written" << std::endl;
+        }
+        create_compressed(image, parameters);
+    } else {
+        create_uncompressed(chain, source.channels, parameters);
+    }
+}
+
+void TextureAsset::create_streamed(const Source& source, const TextureParameters& parameters,
+                                   const std::filesystem::path& cache_directory) {
+    // The storage is created before the image is decoded, so the format and the size are read from the header of the
+    // cache file or of the image (the alpha channel of the image selects BC3 over BC1 even if it is opaque).
+    const bool compressed = parameters.role != TextureRole::UNCOMPRESSED;
+    cache_path = compressed && !cache_directory.empty() ? cache_directory / source.cache_name : "";
+    CompressedImage header;
+    if (!cache_path.empty() && TextureCompressor::load(cache_path, header, source.stamp, true)) {
+        internal_format = header.internal_format;
+        width = header.width;
+        height = header.height;
+        levels = static_cast<int>(header.levels.size());
+    } else {
+        bool has_alpha = true;
+        if (!source.probe(width, height, has_alpha)) {
+            width = height = 0;
+            return;
+        }
+        internal_format = compressed ? TextureCompressor::get_internal_format(parameters.role, parameters.srgb, has_alpha)
+                                     : get_uncompressed_format(source.channels, parameters.srgb);
+        levels = parameters.mipmaps ? get_mip_count(width, height) : 1;
+    }
+    create_storage(parameters);
+
+    // The coarsest level holds a neutral value until the real levels arrive.
+    const uint8_t neutral = parameters.role == TextureRole::MASK || parameters.role == TextureRole::MASK_PAIR ? 255 : 128;
+    const uint8_t placeholder[4] = {neutral, neutral, parameters.role == TextureRole::NORMAL ? uint8_t(255) : neutral, 255};
+    const int last = levels - 1;
+    const int last_width = std::max(1, width >> last);
+    const int last_height = std::max(1, height >> last);
+    std::vector<uint8_t> pixels(static_cast<size_t>(last_width) * last_height * 4);
+    for (size_t i = 0; i < pixels.size(); i++) {
+        pixels[i] = placeholder[i % 4];
+    }
+    if (compressed) {
+        const CompressedImage image = TextureCompressor::compress(pixels.data(), last_width, last_height, internal_format, false);
+        glCompressedTextureSubImage2D(texture, last, 0, 0, last_width, last_height, internal_format,
+                                      static_cast<GLsizei>(image.levels[0].size()), image.levels[0].data());
+    } else {
+        glTextureSubImage2D(texture, last, 0, 0, last_width, last_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    }
+    glTextureParameteri(texture, GL_TEXTURE_BASE_LEVEL, last);
+
+    // The worker produces all levels in the format of the storage; uncompressed levels are uploaded as RGBA8.
+    std::future<TextureStreamer::Levels> future = ThreadPool::get_default().submit(
+        [source = source, parameters = parameters, cache_path = cache_path, format = internal_format, width = width, height = height,
+         levels = levels]() {
+            return load_levels(source, parameters, cache_path, format, width, height, levels);
+        });
+    streamer->stream(texture, internal_format, width, height, std::move(future));
+}
+
+void TextureAsset::create_uncompressed(const std::vector<std::vector<uint8_t>>& chain, int channels, const TextureParameters& parameters) {
+    internal_format = get_uncompressed_format(channels, parameters.srgb);
+    levels = static_cast<int>(chain.size());
+    create_storage(parameters);
+    for (int level = 0; level < levels; level++) {
+        glTextureSubImage2D(texture, level, 0, 0, std::max(1, width >> level), std::max(1, height >> level), GL_RGBA, GL_UNSIGNED_BYTE,
+                            chain[level].data());
+    }
+}
+
+void TextureAsset::create_storage(const TextureParameters& parameters) {
+    this->parameters = parameters;
+    resident_level = 0;
+    texture = allocate(0);
+    memory_size = get_memory_size(0);
+}
+
+GLuint TextureAsset::allocate(int first_level) const {
+    GLuint result;
+    glCreateTextures(GL_TEXTURE_2D, 1, &result);
+    glTextureStorage2D(result, levels - first_level, internal_format, std::max(1, width >> first_level), std::max(1, height >> first_level));
+    GLObjectTracker::on_create(GLObjectType::TEXTURE, result, get_memory_size(first_level));
+    glTextureParameteri(result, GL_TEXTURE_MIN_FILTER, levels - first_level > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTextureParameteri(result, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (parameters.role == TextureRole::MASK || internal_format == GL_R8) {
+        const GLint swizzle[4] = {GL_RED, GL_RED, GL_RED, GL_ONE};
+        glTextureParameteriv(result, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+    return result;
+}
+
+size_t TextureAsset::get_memory_size(int level) const {
+    const size_t pixel_size = internal_format == GL_R8 ? 1 : internal_format == GL_RG8 ? 2 : 4;
+    size_t size = 0;
+    for (int l = std::max(level, 0); l < levels; l++) {
+        const int level_width = std::max(1, width >> l);
+        const int level_height = std::max(1, height >> l);
+        size += TextureCompressor::get_block_size(internal_format) ? TextureCompressor::get_level_size(internal_format, level_width, level_height)
+                                                                   : static_cast<size_t>(level_width) * level_height * pixel_size;
+    }
+    return size;
+}
+
+bool TextureAsset::set_resident_level(int level) {
+    level = std::clamp(level, 0, std::max(levels - 1, 0));
+    if (texture == 0 || level == resident_level) {
+        return texture != 0;
+    }
+    if (streamer && streamer->is_pending(texture)) {
+        return false;
+    }
+
+    // The levels present in both textures are copied on the GPU, whole levels at a time, so compressed levels whose
+    // size is not a multiple of the block size are allowed.
+    const GLuint resized = allocate(level);
+    for (int l = std::max(level, resident_level); l < levels; l++) {
+        glCopyImageSubData(texture, GL_TEXTURE_2D, l - resident_level, 0, 0, 0, resized, GL_TEXTURE_2D, l - level, 0, 0, 0,
+                           std::max(1, width >> l), std::max(1, height >> l), 1);
+    }
+
+    // The finer levels are sampled only once they are loaded, until then the texture starts at the copied levels.
+    const int loaded = resident_level - level;
+    if (loaded > 0) {
+        glTextureParameteri(resized, GL_TEXTURE_BASE_LEVEL, loaded);
+        auto load = [source = source, parameters = parameters, cache_path = cache_path, format = internal_format, width = width,
+                     height = height, levels = levels, level, loaded]() {
+            TextureStreamer::Levels result = load_levels(source, parameters, cache_path, format, width, height, levels);
+            if (result.empty()) {
+                return result;
+            }
+            result.erase(result.begin(), result.begin() + level);
+            for (size_t l = loaded; l < result.size(); l++) {
+                result[l] = {};
+            }
+            return result;
+        };
+
+        if (streamer) {
+            streamer->stream(resized, internal_format, std::max(1, width >> level), std::max(1, height >> level),
+                             ThreadPool::get_default().submit(load));
+        } else {
+            const TextureStreamer::Levels data = load();
+            for (int l = 0; l < static_cast<int>(data.size()) && l < loaded; l++) {
+                const int level_width = std::max(1, width >> (level + l));
+                const int level_height = std::max(1, height >> (level + l));
+                if (TextureCompressor::get_block_size(internal_format)) {
+                    glCompressedTextureSubImage2D(resized, l, 0, 0, level_width, level_height, internal_format,
+                                                  static_cast<GLsizei>(data[l].size()), data[l].data());
+                } else {
+                    glTextureSubImage2D(resized, l, 0, 0, level_width, level_height, GL_RGBA, GL_UNSIGNED_BYTE, data[l].data());
+                }
+            }
+            if (!data.empty()) {
+                glTextureParameteri(resized, GL_TEXTURE_BASE_LEVEL, 0);
+            }
+        }
+    }
+
+    GLObjectTracker::on_delete(GLObjectType::TEXTURE, texture);
+    glDeleteTextures(1, &texture);
+    texture = resized;
+    resident_level = level;
+    memory_size = get_memory_size(level);
+    return true;
+}
+
+TextureStreamer::Levels TextureAsset::load_levels(const Source& source, const TextureParameters& parameters,
+                                                  const std::filesystem::path& cache_path, GLenum internal_format, int width, int height,
+                                                  int levels) {
+    CompressedImage image;
+    if (!cache_path.empty() && TextureCompressor::load(cache_path, image, source.stamp) && image.internal_format == internal_format &&
+        image.width == width && image.height == height && static_cast<int>(image.levels.size()) == levels) {
+        return std::move(image.levels);
+    }
+
+    std::vector<uint8_t> rgba;
+    int decoded_width, decoded_height;
+    if (!source.decode(rgba, decoded_width, decoded_height) || decoded_width != width || decoded_height != height) {
+        return {};
+    }
+    TextureStreamer::Levels chain =
+        MipmapGenerator::generate(std::move(rgba), width, height, levels, parameters.mipmap_filter, parameters.is_gamma_encoded());
+    if (TextureCompressor::get_block_size(internal_format)) {
+        image = TextureCompressor::compress(chain, width, height, internal_format);
+        if (!cache_path.empty() && !TextureCompressor::save(cache_path, image, source.stamp)) {
+            std::cerr << "Texture cache " << cache_path.generic_string() << " could not be written" << std::endl;
+        }
+        return std::move(image.levels);
+    }
+    return chain;
+}
+
+GLenum TextureAsset::get_uncompressed_format(int channels, bool srgb) {
+    return channels == 1 ? GL_R8 : channels == 2 ? GL_RG8 : srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+}
+
+void TextureAsset::create_compressed(const CompressedImage& image, const TextureParameters& parameters) {
+    width = image.width;
+    height = image.height;
+    levels = static_cast<int>(image.levels.size());
+    internal_format = image.internal_format;
+    create_storage(parameters);
+    for (int level = 0; level < levels; level++) {
+        glCompressedTextureSubImage2D(texture, level, 0, 0, std::max(1, width >> level), std::max(1, height >> level),
+                                      internal_format, static_cast<GLsizei>(image.levels[level].size()), image.levels[level].data());
+    }
+}
+
+std::string TextureAsset::get_cache_name(const std::string& name, const std::string& key, const TextureParameters& parameters) {
+    // The name contains the hash of the key and the parameters, so images with the same name do not clash.
+    const std::string full_key = key + "|" + std::to_string(static_cast<int>(parameters.role)) + (parameters.srgb ? ",srgb" : "") +
+                                 (parameters.mipmaps ? ",mipmaps" : "") + (parameters.mipmap_filter == MipmapFilter::KAISER ? ",kaiser" : "");
+    char hash[17];
+    std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(std::hash<std::string>{}(full_key)));
+    return name + "_" + hash + ".ctex";
+}
@@ -0,0 +1,453 @@
+#include "texture_compressor.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+
+#define STB_DXT_IMPLEMENTATION
+#include <stb_dxt.h>
+
+// The identifier and the version of the cache files, increase the version whenever the encoders change.
+static const char CACHE_MAGIC[4] = {'C', 'T', 'E', 'X'};
+static const uint32_t CACHE_VERSION = 2;
+
+// The minimal number of block rows compressed by a single task.
+static const size_t MIN_BLOCK_ROWS = 4;
+
+// The interpolation weights of the 4-bit BC7 indices (in 1/64).
+static const int BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+/** The header of a cache file, followed by the size (uint64_t) and the data of every level. */
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t stamp;
+    uint32_t internal_format;
+    int32_t width;
+    int32_t height;
+    int32_t levels;
+};
+
+/** The BC7 mode 6 endpoints (8-bit values whose lowest bit is the shared p-bit) and the indices of the pixels. */
+struct Bc7Block {
+    std::array<std::array<int, 4>, 2> endpoints;
+    std::array<uint8_t, 16> indices;
+    int error = INT32_MAX;
+};
+
+/** Returns the interpolated value of a BC7 palette entry. */
+static int bc7_interpolate(int e0, int e1, int index) {
+    return ((64 - BC7_WEIGHTS[index]) * e0 + BC7_WEIGHTS[index] * e1 + 32) >> 6;
+}
+
+/**
+ * Quantizes the endpoints to 7 bits plus the p-bits and assigns the closest palette entry to every pixel. The index is
+ * estimated by projecting the pixel onto the line and only the neighboring entries are compared.
+ */
+static Bc7Block bc7_evaluate(const uint8_t* rgba, const float endpoints[2][4], int p0, int p1) {
+    Bc7Block block;
+    const int p[2] = {p0, p1};
+    for (int e = 0; e < 2; e++) {
+        for (int c = 0; c < 4; c++) {
+            const int q = std::clamp(static_cast<int>(std::lround((endpoints[e][c] - p[e]) * 0.5f)), 0, 127);
+            block.endpoints[e][c] = q * 2 + p[e];
+        }
+    }
+
+    int palette[16][4];
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 4; c++) {
+            palette[i][c] = bc7_interpolate(block.endpoints[0][c], block.endpoints[1][c], i);
+        }
+    }
+
+    int axis[4];
+    int axis_length = 0;
+    for (int c = 0; c < 4; c++) {
+        axis[c] = block.endpoints[1][c] - block.endpoints[0][c];
+        axis_length += axis[c] * axis[c];
+    }
+
+    block.error = 0;
+    for (int i = 0; i < 16; i++) {
+        const uint8_t* pixel = rgba + i * 4;
+        int estimate = 0;
+        if (axis_length > 0) {
+            int projection = 0;
+            for (int c = 0; c < 4; c++) {
+                projection += (pixel[c] - block.endpoints[0][c]) * axis[c];
+            }
+            estimate = std::clamp(static_cast<int>(std::lround(15.0f * projection / axis_length)), 0, 15);
+        }
+
+        int best_error = INT32_MAX;
+        for (int index = std::max(0, estimate - 1); index <= std::min(15, estimate + 1); index++) {
+            int error = 0;
+            for (int c = 0; c < 4; c++) {
+                const int difference = pixel[c] - palette[index][c];
+                error += difference * difference;
+            }
+            if (error < best_error) {
+                best_error = error;
+                block.indices[i] = static_cast<uint8_t>(index);
+            }
+        }
+        block.error += best_error;
+    }
+    return block;
+}
+
+/** Returns the best of the four p-bit combinations for the endpoints. */
+static Bc7Block bc7_evaluate_p_bits(const uint8_t* rgba, const float endpoints[2][4]) {
+    Bc7Block best;
+    for (int p = 0; p < 4; p++) {
+        Bc7Block block = bc7_evaluate(rgba, endpoints, p & 1, p >> 1);
+        if (block.error < best.error) {
+            best = block;
+        }
+    }
+    return best;
+}
+
+/** Writes the bits of the value into the block starting at the position, the least significant bit first. */
+static void write_bits(uint8_t* block, int& position, uint32_t value, int bits) {
+    for (int i = 0; i < bits; i++, position++) {
+        if ((value >> i) & 1) {
+            block[position >> 3] |= static_cast<uint8_t>(1 << (position & 7));
+        }
+    }
+}
+
+/** Compresses a single level, the blocks overlapping the border repeat the last row and column. */
+static std::vector<uint8_t> compress_level(const uint8_t* rgba, int width, int height, GLenum internal_format,
+                                           size_t block_size, ThreadPool& pool) {
+    const size_t blocks_x = (static_cast<size_t>(width) + 3) / 4;
+    const size_t blocks_y = (static_cast<size_t>(height) + 3) / 4;
+    std::vector<uint8_t> level(blocks_x * blocks_y * block_size);
+
+    pool.parallel_for(
+        blocks_y,
+        [&](size_t begin, size_t end) {
+            uint8_t pixels[64];
+            uint8_t channels[32];
+            for (size_t by = begin; by < end; by++) {
+                for (size_t bx = 0; bx < blocks_x; bx++) {
+                    for (int i = 0; i < 16; i++) {
+                        const size_t x = std::min(bx * 4 + (i & 3), static_cast<size_t>(width) - 1);
+                        const size_t y = std::min(by * 4 + (i >> 2), static_cast<size_t>(height) - 1);
+                        std::memcpy(pixels + i * 4, rgba + (y * width + x) * 4, 4);
+                    }
+
+                    uint8_t* block = level.data() + (by * blocks_x + bx) * block_size;
+                    switch (internal_format) {
+                    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+                    case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+                        stb_compress_dxt_block(block, pixels, 0, STB_DXT_HIGHQUAL);
+                        break;
+                    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+                    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+                        stb_compress_dxt_block(block, pixels, 1, STB_DXT_HIGHQUAL);
+                        break;
+                    case GL_COMPRESSED_RGBA_BPTC_UNORM:
+                    case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+                        TextureCompressor::encode_bc7_block(pixels, block);
+                        break;
+                    case GL_COMPRESSED_RG_RGTC2:
+                        for (int i = 0; i < 16; i++) {
+                            channels[i * 2 + 0] = pixels[i * 4 + 0];
+                            channels[i * 2 + 1] = pixels[i * 4 + 1];
+                        }
+                        stb_compress_bc5_block(block, channels);
+                        break;
+                    default:
+                        for (int i = 0; i < 16; i++) {
+                            channels[i] = pixels[i * 4];
+                        }
+                        stb_compress_bc4_block(block, channels);
+                        break;
+                    }
+                }
+            }
+        },
+        MIN_BLOCK_ROWS);
+    return level;
+}
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+CompressedImage TextureCompressor::compress(const uint8_t* rgba, int width, int height, TextureRole role, bool srgb,
+                                            bool mipmaps, ThreadPool& pool) {
+    return compress(rgba, width, height, get_internal_format(role, srgb, has_alpha(rgba, width, height)), mipmaps, pool);
+}
+
+CompressedImage TextureCompressor::compress(const uint8_t* rgba, int width, int height, GLenum internal_format, bool mipmaps,
+                                            ThreadPool& pool) {
+    const std::vector<std::vector<uint8_t>> levels =
+        MipmapGenerator::generate(std::vector<uint8_t>(rgba, rgba + static_cast<size_t>(width) * height * 4), width, height,
+                                  mipmaps ? MipmapGenerator::get_level_count(width, height) : 1, MipmapFilter::BOX, is_srgb(internal_format), pool);
+    return compress(levels, width, height, internal_format, pool);
+}
+
+CompressedImage TextureCompressor::compress(const std::vector<std::vector<uint8_t>>& levels, int width, int height, GLenum internal_format,
+                                            ThreadPool& pool) {
+    // stb_dxt initializes its tables on the first use, which must not happen on several threads at once.
+    static std::once_flag stb_dxt_initialized;
+    std::call_once(stb_dxt_initialized, []() {
+        uint8_t pixels[64] = {};
+        uint8_t block[16];
+        stb_compress_dxt_block(block, pixels, 1, STB_DXT_NORMAL);
+    });
+
+    CompressedImage image;
+    const size_t block_size = get_block_size(internal_format);
+    image.internal_format = internal_format;
+    image.width = width;
+    image.height = height;
+    for (size_t level = 0; level < levels.size(); level++) {
+        image.levels.push_back(compress_level(levels[level].data(), std::max(1, width >> level), std::max(1, height >> level),
+                                              internal_format, block_size, pool));
+    }
+    return image;
+}
+
+bool TextureCompressor::has_alpha(const uint8_t* rgba, int width, int height) {
+    for (size_t i = 0; i < static_cast<size_t>(width) * height; i++) {
+        if (rgba[i * 4 + 3] != 255) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TextureCompressor::is_srgb(GLenum internal_format) {
+    switch (internal_format) {
+    case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+    case GL_SRGB8_ALPHA8:
+        return true;
+    default:
+        return false;
+    }
+}
+
+GLenum TextureCompressor::get_internal_format(TextureRole role, bool srgb, bool has_alpha) {
+    switch (role) {
+    case TextureRole::COLOR:
+        if (has_alpha) {
+            return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        }
+        return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case TextureRole::COLOR_HIGH_QUALITY:
+        return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+    case TextureRole::NORMAL:
+    case TextureRole::MASK_PAIR:
+        return GL_COMPRESSED_RG_RGTC2;
+    case TextureRole::MASK:
+        return GL_COMPRESSED_RED_RGTC1;
+    default:
+        return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+    }
+}
+
+size_t TextureCompressor::get_block_size(GLenum internal_format) {
+    switch (internal_format) {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RED_RGTC1:
+        return 8;
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_RGBA_BPTC_UNORM:
+    case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+    case GL_COMPRESSED_RG_RGTC2:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+size_t TextureCompressor::get_level_size(GLenum internal_format, int width, int height) {
+    const size_t block_size = get_block_size(internal_format);
+    if (block_size == 0) {
+        return static_cast<size_t>(width) * height * 4;
+    }
+    return ((static_cast<size_t>(width) + 3) / 4) * ((static_cast<size_t>(height) + 3) / 4) * block_size;
+}
+
+bool TextureCompressor::save(const std::filesystem::path& path, const CompressedImage& image, uint64_t stamp) {
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    CacheHeader header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.stamp = stamp;
+    header.internal_format = image.internal_format;
+    header.width = image.width;
+    header.height = image.height;
+    header.levels = static_cast<int32_t>(image.levels.size());
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const std::vector<uint8_t>& level : image.levels) {
+        const uint64_t size = level.size();
+        file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        file.write(reinterpret_cast<const char*>(level.data()), static_cast<std::streamsize>(size));
+    }
+    return static_cast<bool>(file);
+}
+
+bool TextureCompressor::load(const std::filesystem::path& path, CompressedImage& image, uint64_t stamp, bool header_only) {
+    std::ifstream file(path, std::ios::binary);
+    CacheHeader header{};
+    if (!file || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION ||
+        stamp == 0 || header.stamp != stamp || header.levels <= 0 || header.levels > 32) {
+        return false;
+    }
+
+    image.internal_format = header.internal_format;
+    image.width = header.width;
+    image.height = header.height;
+    image.levels.resize(header.levels);
+    if (header_only) {
+        return true;
+    }
+    for (std::vector<uint8_t>& level : image.levels) {
+        uint64_t size = 0;
+        if (!file.read(reinterpret_cast<char*>(&size), sizeof(size)) || size > (uint64_t(1) << 32)) {
+            return false;
+        }
+        level.resize(size);
+        if (!file.read(reinterpret_cast<char*>(level.data()), static_cast<std::streamsize>(size))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t TextureCompressor::get_source_stamp(const std::filesystem::path& path) {
+    // Each query reports its own error, a later success must not hide an earlier failure.
+    std::error_code size_error;
+    const uint64_t size = std::filesystem::file_size(path, size_error);
+    std::error_code time_error;
+    const std::filesystem::file_time_type time = std::filesystem::last_write_time(path, time_error);
+    if (size_error || time_error) {
+        return 0;
+    }
+    return size * 0x9E3779B97F4A7C15ull ^ static_cast<uint64_t>(time.time_since_epoch().count());
+}
+
+void TextureCompressor::encode_bc7_block(const uint8_t* rgba, uint8_t* block) {
+    // Finds the principal axis of the pixels by the power iteration on their covariance.
+    float mean[4] = {};
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 4; c++) {
+            mean[c] += rgba[i * 4 + c] / 16.0f;
+        }
+    }
+    float covariance[4][4] = {};
+    for (int i = 0; i < 16; i++) {
+        for (int a = 0; a < 4; a++) {
+            for (int b = 0; b < 4; b++) {
+                covariance[a][b] += (rgba[i * 4 + a] - mean[a]) * (rgba[i * 4 + b] - mean[b]);
+            }
+        }
+    }
+    float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[4] = {};
+        float length = 0.0f;
+        for (int a = 0; a < 4; a++) {
+            for (int b = 0; b < 4; b++) {
+                next[a] += covariance[a][b] * axis[b];
+            }
+            length = std::max(length, std::abs(next[a]));
+        }
+        if (length < 1e-6f) {
+            break;
+        }
+        for (int a = 0; a < 4; a++) {
+            axis[a] = next[a] / length;
+        }
+    }
+
+    // The endpoints are the extreme projections of the pixels onto the axis.
+    float axis_length = 0.0f;
+    for (int c = 0; c < 4; c++) {
+        axis_length += axis[c] * axis[c];
+    }
+    float t_min = 0.0f;
+    float t_max = 0.0f;
+    for (int i = 0; i < 16 && axis_length > 0.0f; i++) {
+        float t = 0.0f;
+        for (int c = 0; c < 4; c++) {
+            t += (rgba[i * 4 + c] - mean[c]) * axis[c];
+        }
+        t_min = std::min(t_min, t / axis_length);
+        t_max = std::max(t_max, t / axis_length);
+    }
+    float endpoints[2][4];
+    for (int c = 0; c < 4; c++) {
+        endpoints[0][c] = std::clamp(mean[c] + t_min * axis[c], 0.0f, 255.0f);
+        endpoints[1][c] = std::clamp(mean[c] + t_max * axis[c], 0.0f, 255.0f);
+    }
+    Bc7Block best = bc7_evaluate_p_bits(rgba, endpoints);
+
+    // Refines the endpoints by the least squares fit to the selected weights.
+    for (int iteration = 0; iteration < 2 && best.error > 0; iteration++) {
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ra[4] = {}, rb[4] = {};
+        for (int i = 0; i < 16; i++) {
+            const float w = BC7_WEIGHTS[best.indices[i]] / 64.0f;
+            aa += (1.0f - w) * (1.0f - w);
+            ab += (1.0f - w) * w;
+            bb += w * w;
+            for (int c = 0; c < 4; c++) {
+                ra[c] += (1.0f - w) * rgba[i * 4 + c];
+                rb[c] += w * rgba[i * 4 + c];
+            }
+        }
+        const float determinant = aa * bb - ab * ab;
+        if (std::abs(determinant) < 1e-6f) {
+            break;
+        }
+        for (int c = 0; c < 4; c++) {
+            endpoints[0][c] = std::clamp((ra[c] * bb - rb[c] * ab) / determinant, 0.0f, 255.0f);
+            endpoints[1][c] = std::clamp((rb[c] * aa - ra[c] * ab) / determinant, 0.0f, 255.0f);
+        }
+        const Bc7Block refined = bc7_evaluate_p_bits(rgba, endpoints);
+        if (refined.error >= best.error) {
+            break;
+        }
+        best = refined;
+    }
+
+    // The most significant bit of the first index is implicitly zero, the endpoints are swapped to ensure that.
+    if (best.indices[0] >= 8) {
+        std::swap(best.endpoints[0], best.endpoints[1]);
+        for (uint8_t& index : best.indices) {
+            index = static_cast<uint8_t>(15 - index);
+        }
+    }
+
+    std::memset(block, 0, 16);
+    int position = 0;
+    write_bits(block, position, 1 << 6, 7);
+    for (int c = 0; c < 4; c++) {
+        write_bits(block, position, best.endpoints[0][c] >> 1, 7);
+        write_bits(block, position, best.endpoints[1][c] >> 1, 7);
+    }
+    write_bits(block, position, best.endpoints[0][0] & 1, 1);
+    write_bits(block, position, best.endpoints[1][0] & 1, 1);
+    write_bits(block, position, best.indices[0], 3);
+    for (int i = 1; i < 16; i++) {
+        write_bits(block, position, best.indices[i], 4);
+    }
+}
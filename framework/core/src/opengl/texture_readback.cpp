@@ -0,0 +1,148 @@
+#include "texture_readback.hpp"
+#include "utils/gl_object_tracker.hpp"
+#include <algorithm>
+
+// The granularity of the buffer sizes, so the buffers are reused by requests of similar sizes.
+static const size_t BUFFER_GRANULARITY = 64 << 10;
+
+// The number of nanoseconds waited by a single call of glClientWaitSync in @link TextureReadback::wait.
+static const GLuint64 WAIT_TIMEOUT = 1000000000;
+
+/** Unmaps and deletes a buffer. */
+static void delete_buffer(GLuint buffer) {
+    GLObjectTracker::on_delete(GLObjectType::BUFFER, buffer);
+    glUnmapNamedBuffer(buffer);
+    glDeleteBuffers(1, &buffer);
+}
+
+// ----------------------------------------------------------------------------
+// Constructors
+// ----------------------------------------------------------------------------
+TextureReadback::~TextureReadback() {
+    for (Request& request : requests) {
+        glDeleteSync(request.fence);
+        delete_buffer(request.buffer.buffer);
+        *request.state = Ticket::State::CANCELLED;
+    }
+    for (const Buffer& buffer : free_buffers) {
+        delete_buffer(buffer.buffer);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+TextureReadback::Ticket TextureReadback::read(GLuint texture, int level, int x, int y, int width, int height, GLenum format, GLenum type,
+                                              size_t size, Callback callback) {
+    Request request = begin_request(size, std::move(callback));
+    glGetTextureSubImage(texture, level, x, y, 0, width, height, 1, format, type, static_cast<GLsizei>(size), nullptr);
+    return end_request(std::move(request));
+}
+
+TextureReadback::Ticket TextureReadback::read_framebuffer(GLuint framebuffer, int x, int y, int width, int height, GLenum format,
+                                                          GLenum type, size_t size, Callback callback) {
+    Request request = begin_request(size, std::move(callback));
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glReadnPixels(x, y, width, height, format, type, static_cast<GLsizei>(size), nullptr);
+    return end_request(std::move(request));
+}
+
+void TextureReadback::update() {
+    // The fences are signaled in the order of the requests, so the first unsignaled one ends the polling.
+    while (!requests.empty()) {
+        const GLenum status = glClientWaitSync(requests.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            return;
+        }
+        complete_front();
+    }
+}
+
+void TextureReadback::wait(const Ticket& ticket) {
+    while (ticket.is_pending() && !requests.empty()) {
+        const GLenum status = glClientWaitSync(requests.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT, WAIT_TIMEOUT);
+        if (status == GL_WAIT_FAILED) {
+            return;
+        }
+        if (status != GL_TIMEOUT_EXPIRED) {
+            complete_front();
+        }
+    }
+}
+
+void TextureReadback::finish() {
+    if (!requests.empty()) {
+        wait(Ticket(requests.back().state));
+    }
+}
+
+void TextureReadback::cancel(const Ticket& ticket) {
+    const auto request = std::find_if(requests.begin(), requests.end(), [&](const Request& r) { return r.state == ticket.state; });
+    if (request == requests.end()) {
+        return;
+    }
+    // The GPU executes the copies in order, so the buffer may be reused by a later request before this copy finishes.
+    glDeleteSync(request->fence);
+    free_buffers.push_back(request->buffer);
+    *request->state = Ticket::State::CANCELLED;
+    requests.erase(request);
+}
+
+TextureReadback::Request TextureReadback::begin_request(size_t size, Callback callback) {
+    Request request;
+    request.buffer = acquire_buffer(size);
+    request.size = size;
+    request.callback = std::move(callback);
+    request.state = std::make_shared<Ticket::State>(Ticket::State::PENDING);
+
+    // With a pack buffer bound, the pixels argument is the offset in the buffer and the copy returns immediately.
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, request.buffer.buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    return request;
+}
+
+TextureReadback::Ticket TextureReadback::end_request(Request request) {
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    request.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    Ticket ticket(request.state);
+    requests.push_back(std::move(request));
+    return ticket;
+}
+
+TextureReadback::Buffer TextureReadback::acquire_buffer(size_t size) {
+    // Takes the smallest free buffer that is large enough.
+    auto best = free_buffers.end();
+    for (auto buffer = free_buffers.begin(); buffer != free_buffers.end(); ++buffer) {
+        if (buffer->size >= size && (best == free_buffers.end() || buffer->size < best->size)) {
+            best = buffer;
+        }
+    }
+    if (best != free_buffers.end()) {
+        const Buffer result = *best;
+        free_buffers.erase(best);
+        return result;
+    }
+
+    // The client storage hint keeps the buffer in the system memory, which the CPU reads fastest.
+    Buffer result;
+    result.size = std::max<size_t>((size + BUFFER_GRANULARITY - 1) / BUFFER_GRANULARITY * BUFFER_GRANULARITY, BUFFER_GRANULARITY);
+    const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &result.buffer);
+    glNamedBufferStorage(result.buffer, static_cast<GLsizeiptr>(result.size), nullptr, flags | GL_CLIENT_STORAGE_BIT);
+    GLObjectTracker::on_create(GLObjectType::BUFFER, result.buffer, result.size);
+    result.mapped = static_cast<const uint8_t*>(glMapNamedBufferRange(result.buffer, 0, static_cast<GLsizeiptr>(result.size), flags));
+    return result;
+}
+
+void TextureReadback::complete_front() {
+    Request request = std::move(requests.front());
+    requests.pop_front();
+    glDeleteSync(request.fence);
+    if (request.callback && request.buffer.mapped) {
+        request.callback(request.buffer.mapped, request.size);
+    }
+    *request.state = Ticket::State::READY;
+    free_buffers.push_back(request.buffer);
+}
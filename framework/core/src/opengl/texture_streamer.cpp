@@ -0,0 +1,140 @@
+#include "texture_streamer.hpp"
+#include "texture_compressor.hpp"
+#include "utils/frame_counters.hpp"
+#include "utils/gl_object_tracker.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+// The alignment of the uploaded data in the buffer.
+static const size_t UPLOAD_ALIGNMENT = 16;
+
+// ----------------------------------------------------------------------------
+// Constructors
+// ----------------------------------------------------------------------------
+TextureStreamer::TextureStreamer(size_t upload_budget, size_t segment_count)
+    : segment_size((std::max(upload_budget, size_t(64 << 10)) + UPLOAD_ALIGNMENT - 1) / UPLOAD_ALIGNMENT * UPLOAD_ALIGNMENT),
+      fences(std::max(segment_count, size_t(1)), nullptr) {
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const GLsizeiptr size = static_cast<GLsizeiptr>(segment_size * fences.size());
+    glCreateBuffers(1, &buffer);
+    glNamedBufferStorage(buffer, size, nullptr, flags);
+    GLObjectTracker::on_create(GLObjectType::BUFFER, buffer, static_cast<uint64_t>(size));
+    mapped = static_cast<uint8_t*>(glMapNamedBufferRange(buffer, 0, size, flags));
+}
+
+TextureStreamer::~TextureStreamer() {
+    for (GLsync fence : fences) {
+        glDeleteSync(fence);
+    }
+    GLObjectTracker::on_delete(GLObjectType::BUFFER, buffer);
+    glUnmapNamedBuffer(buffer);
+    glDeleteBuffers(1, &buffer);
+}
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+void TextureStreamer::stream(GLuint texture, GLenum internal_format, int width, int height, std::future<Levels> levels) {
+    Job job;
+    job.texture = texture;
+    job.internal_format = internal_format;
+    job.width = width;
+    job.height = height;
+    job.future = std::move(levels);
+    jobs.push_back(std::move(job));
+}
+
+void TextureStreamer::cancel(GLuint texture) {
+    std::erase_if(jobs, [texture](const Job& job) { return job.texture == texture; });
+}
+
+bool TextureStreamer::is_pending(GLuint texture) const {
+    return std::any_of(jobs.begin(), jobs.end(), [texture](const Job& job) { return job.texture == texture; });
+}
+
+void TextureStreamer::update() {
+    last_upload_size = 0;
+    if (jobs.empty()) {
+        return;
+    }
+
+    // The segment is skipped (and nothing is uploaded) while the GPU still reads the data of an older frame.
+    GLsync& fence = fences[segment];
+    if (fence) {
+        const GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            return;
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    uint8_t* const segment_data = mapped + segment * segment_size;
+    size_t offset = 0;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    for (auto job = jobs.begin(); job != jobs.end() && offset < segment_size;) {
+        if (job->level < 0) {
+            if (job->future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                ++job;
+                continue;
+            }
+            job->levels = job->future.get();
+            job->level = static_cast<int>(job->levels.size()) - 1;
+        }
+
+        // The levels are uploaded from the smallest one, whole rows of blocks at a time.
+        const size_t block_size = TextureCompressor::get_block_size(job->internal_format);
+        while (job->level >= 0) {
+            // The empty levels are already present in the texture (see @link TextureAsset::set_resident_level).
+            if (job->levels[job->level].empty()) {
+                job->level--;
+                continue;
+            }
+            const int level_width = std::max(1, job->width >> job->level);
+            const int level_height = std::max(1, job->height >> job->level);
+            const int row_height = block_size ? 4 : 1;
+            const size_t row_size = TextureCompressor::get_level_size(job->internal_format, level_width, row_height);
+            const std::vector<uint8_t>& data = job->levels[job->level];
+
+            const int rows = std::min(static_cast<int>((segment_size - offset) / row_size), (level_height - job->row + row_height - 1) / row_height);
+            if (rows == 0) {
+                break;
+            }
+            const int height = std::min(rows * row_height, level_height - job->row);
+            const size_t size = std::min(rows * row_size, data.size() - (job->row / row_height) * row_size);
+            std::memcpy(segment_data + offset, data.data() + (job->row / row_height) * row_size, size);
+            FrameCounters::count_upload(size);
+
+            const void* pixels = reinterpret_cast<const void*>(segment * segment_size + offset);
+            if (block_size) {
+                glCompressedTextureSubImage2D(job->texture, job->level, 0, job->row, level_width, height, job->internal_format,
+                                              static_cast<GLsizei>(size), pixels);
+            } else {
+                glTextureSubImage2D(job->texture, job->level, 0, job->row, level_width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+            }
+            offset += (size + UPLOAD_ALIGNMENT - 1) / UPLOAD_ALIGNMENT * UPLOAD_ALIGNMENT;
+            last_upload_size += size;
+
+            job->row += height;
+            if (job->row >= level_height) {
+                glTextureParameteri(job->texture, GL_TEXTURE_BASE_LEVEL, job->level);
+                job->level--;
+                job->row = 0;
+            }
+        }
+
+        // The textures whose images could not be decoded keep the placeholder.
+        if (job->level < 0) {
+            job = jobs.erase(job);
+        } else {
+            break;
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (offset > 0) {
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        segment = (segment + 1) % fences.size();
+    }
+}
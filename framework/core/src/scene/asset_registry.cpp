@@ -0,0 +1,90 @@
+#include "asset_registry.hpp"
+#include <algorithm>
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+std::shared_ptr<TextureAsset> AssetRegistry::load_texture(const std::filesystem::path& path, const TextureParameters& parameters) {
+    const std::string key = make_key(path, std::string(parameters.mipmaps ? "mipmaps" : "") + (parameters.srgb ? ",srgb" : "") +
+                                               "," + std::to_string(static_cast<int>(parameters.role)) + "," +
+                                               std::to_string(static_cast<int>(parameters.mipmap_filter)));
+    std::shared_ptr<TextureAsset>& texture = textures[key];
+    if (!texture) {
+        texture = std::make_shared<TextureAsset>(path, parameters, texture_cache_directory, texture_streamer);
+    }
+    return texture;
+}
+
+std::shared_ptr<TextureAsset> AssetRegistry::load_packed_texture(const std::vector<ChannelSource>& channels,
+                                                                const TextureParameters& parameters) {
+    // The key lists the sources of all channels, the path part of the key reads as "a.png#0+b.png#0".
+    const std::string key = make_channels_key(channels) + "|" + std::string(parameters.mipmaps ? "mipmaps" : "") +
+                            (parameters.srgb ? ",srgb" : "") + "," + std::to_string(static_cast<int>(parameters.role)) + "," +
+                            std::to_string(static_cast<int>(parameters.mipmap_filter));
+    std::shared_ptr<TextureAsset>& texture = textures[key];
+    if (!texture) {
+        texture = std::make_shared<TextureAsset>(channels, parameters, texture_cache_directory, texture_streamer);
+    }
+    return texture;
+}
+
+std::shared_ptr<Geometry> AssetRegistry::load_geometry(const std::filesystem::path& path, Residency residency,
+                                                       VertexFormat vertex_format, int lod_count) {
+    const std::string key = make_key(path, std::to_string(static_cast<int>(residency)) + "," +
+                                               std::to_string(static_cast<int>(vertex_format)) + "," + std::to_string(lod_count));
+    std::shared_ptr<Geometry>& geometry = geometries[key];
+    if (!geometry) {
+        geometry = std::make_shared<Geometry>(Geometry::from_file(path, residency, vertex_format, lod_count));
+    }
+    return geometry;
+}
+
+size_t AssetRegistry::release_unused() {
+    const size_t released = std::erase_if(textures, [](const auto& entry) { return entry.second.use_count() == 1; }) +
+                            std::erase_if(geometries, [](const auto& entry) { return entry.second.use_count() == 1; });
+    return released;
+}
+
+std::vector<AssetRegistry::AssetUsage> AssetRegistry::get_memory_report() const {
+    std::vector<AssetUsage> report;
+    report.reserve(textures.size() + geometries.size());
+    for (const auto& [key, texture] : textures) {
+        report.push_back({key.substr(0, key.rfind('|')), "texture", texture->get_memory_size(), texture.use_count() - 1});
+    }
+    for (const auto& [key, geometry] : geometries) {
+        report.push_back({key.substr(0, key.rfind('|')), "geometry", static_cast<size_t>(geometry->get_memory_size()),
+                          geometry.use_count() - 1});
+    }
+    std::sort(report.begin(), report.end(), [](const AssetUsage& a, const AssetUsage& b) { return a.memory_size > b.memory_size; });
+    return report;
+}
+
+size_t AssetRegistry::get_memory_size() const {
+    size_t size = 0;
+    for (const auto& [key, texture] : textures) {
+        size += texture->get_memory_size();
+    }
+    for (const auto& [key, geometry] : geometries) {
+        size += static_cast<size_t>(geometry->get_memory_size());
+    }
+    return size;
+}
+
+std::string AssetRegistry::make_key(const std::filesystem::path& path, const std::string& parameters) {
+    return get_canonical_path(path) + "|" + parameters;
+}
+
+std::string AssetRegistry::get_canonical_path(const std::filesystem::path& path) {
+    std::error_code error;
+    const std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    return (error ? path.lexically_normal() : canonical).generic_string();
+}
+
+std::string AssetRegistry::make_channels_key(const std::vector<ChannelSource>& channels) {
+    std::string key;
+    for (const ChannelSource& source : channels) {
+        key += (key.empty() ? "" : "+") +
+               (source.path.empty() ? "=" + std::to_string(source.value) : get_canonical_path(source.path) + "#" + std::to_string(source.channel));
+    }
+    return key;
+}
@@ -0,0 +1,110 @@
+#include "cached_shadow_map.hpp"
+#include "utils/gl_object_tracker.hpp"
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+
+// ----------------------------------------------------------------------------
+// Constructors
+// ----------------------------------------------------------------------------
+CachedShadowMap::CachedShadowMap(int resolution) : resolution(resolution) { create(); }
+
+CachedShadowMap::~CachedShadowMap() { destroy(); }
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+void CachedShadowMap::resize(int resolution) {
+    if (resolution == this->resolution) {
+        return;
+    }
+
+    destroy();
+    this->resolution = resolution;
+    create();
+}
+
+void CachedShadowMap::update(const std::function<void()>& draw_static, const std::function<void()>& draw_dynamic) {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, resolution, resolution);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+
+    // Pushes the depth slightly away from the light to avoid shadow acne.
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+
+    const float clear_depth = 1.0f;
+
+    // Renders the static casters only when the cached layer is outdated.
+    if (!static_valid) {
+        glNamedFramebufferTexture(framebuffer, GL_DEPTH_ATTACHMENT, static_depth, 0);
+        glClearNamedFramebufferfv(framebuffer, GL_DEPTH, 0, &clear_depth);
+        draw_static();
+        static_valid = true;
+    }
+
+    // Composites the layers: the cached static depth is copied on the GPU and the moving casters are drawn over it.
+    glCopyImageSubData(static_depth, GL_TEXTURE_2D, 0, 0, 0, 0, dynamic_depth, GL_TEXTURE_2D, 0, 0, 0, 0, resolution,
+                       resolution, 1);
+    glNamedFramebufferTexture(framebuffer, GL_DEPTH_ATTACHMENT, dynamic_depth, 0);
+    draw_dynamic();
+
+    glDisable(GL_POLYGON_OFFSET_FILL);
+}
+
+glm::mat4 CachedShadowMap::directional_matrix(const glm::vec3& light_position, const glm::vec3& target, float half_extent,
+                                              float depth_range) {
+    const glm::vec3 direction = glm::normalize(light_position - target);
+    const glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    const glm::mat4 view = glm::lookAt(target + direction * (0.5f * depth_range), target, up);
+    const glm::mat4 projection = glm::ortho(-half_extent, half_extent, -half_extent, half_extent, 0.0f, depth_range);
+    return projection * view;
+}
+
+glm::mat4 CachedShadowMap::spot_matrix(const glm::vec3& position, const glm::vec3& direction, float cutoff, float near_plane,
+                                       float far_plane) {
+    const glm::vec3 forward = glm::normalize(direction);
+    const glm::vec3 up = std::abs(forward.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    const glm::mat4 view = glm::lookAt(position, position + forward, up);
+    // A small margin keeps the PCF kernel inside the map at the border of the cone.
+    const float fov = 2.0f * std::acos(glm::clamp(cutoff, -1.0f, 1.0f)) + glm::radians(2.0f);
+    const glm::mat4 projection = glm::perspective(fov, 1.0f, near_plane, far_plane);
+    return projection * view;
+}
+
+void CachedShadowMap::create() {
+    for (GLuint* texture : {&static_depth, &dynamic_depth}) {
+        glCreateTextures(GL_TEXTURE_2D, 1, texture);
+        glTextureStorage2D(*texture, 1, GL_DEPTH_COMPONENT32F, resolution, resolution);
+        GLObjectTracker::on_create(GLObjectType::TEXTURE, *texture, GLObjectTracker::get_texture_size(GL_DEPTH_COMPONENT32F, resolution, resolution));
+        glTextureParameteri(*texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTextureParameteri(*texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(*texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTextureParameteri(*texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        // Everything outside of the map is considered lit.
+        const float border[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+        glTextureParameterfv(*texture, GL_TEXTURE_BORDER_COLOR, border);
+        // Enables hardware depth comparison (sampler2DShadow) with bilinear PCF.
+        glTextureParameteri(*texture, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTextureParameteri(*texture, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    }
+
+    glCreateFramebuffers(1, &framebuffer);
+    GLObjectTracker::on_create(GLObjectType::FRAMEBUFFER, framebuffer);
+    glNamedFramebufferDrawBuffer(framebuffer, GL_NONE);
+    glNamedFramebufferReadBuffer(framebuffer, GL_NONE);
+
+    static_valid = false;
+}
+
+void CachedShadowMap::destroy() {
+    GLObjectTracker::on_delete(GLObjectType::FRAMEBUFFER, framebuffer);
+    GLObjectTracker::on_delete(GLObjectType::TEXTURE, static_depth);
+    GLObjectTracker::on_delete(GLObjectType::TEXTURE, dynamic_depth);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteTextures(1, &static_depth);
+    glDeleteTextures(1, &dynamic_depth);
+    framebuffer = 0;
+    static_depth = 0;
+    dynamic_depth = 0;
+}
@@ -0,0 +1,157 @@
+#include "meshlet_culler.hpp"
+#include "utils/frame_counters.hpp"
+#include "utils/gl_object_tracker.hpp"
+#include <iostream>
+
+// The shader storage bindings used by meshlet_cull.comp.
+static const GLuint MESHLETS_BINDING = 5;
+static const GLuint COMMANDS_BINDING = 6;
+static const GLuint COUNTS_BINDING = 7;
+
+// The uniform locations used by meshlet_cull.comp.
+static const GLuint MODEL_LOC = 0;
+static const GLuint CAMERA_POSITION_LOC = 1;
+static const GLuint MESHLET_COUNT_LOC = 2;
+static const GLuint INDEX_BASE_LOC = 3;
+static const GLuint OBJECT_INDEX_LOC = 4;
+static const GLuint FIRST_COMMAND_LOC = 5;
+static const GLuint BATCH_LOC = 6;
+static const GLuint FRUSTUM_PLANES_LOC = 7;
+
+// The local size of meshlet_cull.comp.
+static const GLuint WORKGROUP_SIZE = 64;
+
+/** The layout of the commands read by glMultiDrawElementsIndirect. */
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instance_count;
+    GLuint first_index;
+    GLint base_vertex;
+    GLuint base_instance;
+};
+
+// ----------------------------------------------------------------------------
+// Constructors
+// ----------------------------------------------------------------------------
+MeshletCuller::MeshletCuller(const std::filesystem::path& framework_shaders_path, GLsizei max_commands, GLsizei max_batches)
+    : max_commands(max_commands), max_batches(max_batches) {
+    program.add_compute_shader(framework_shaders_path / "meshlet_cull.comp");
+    program.link();
+
+    glCreateBuffers(1, &commands_buffer);
+    glNamedBufferStorage(commands_buffer, max_commands * sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_STORAGE_BIT);
+    glClearNamedBufferData(commands_buffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glCreateBuffers(1, &counts_buffer);
+    glNamedBufferStorage(counts_buffer, max_batches * sizeof(GLuint), nullptr, GL_DYNAMIC_STORAGE_BIT);
+    GLObjectTracker::on_create(GLObjectType::BUFFER, commands_buffer, max_commands * sizeof(DrawElementsIndirectCommand));
+    GLObjectTracker::on_create(GLObjectType::BUFFER, counts_buffer, max_batches * sizeof(GLuint));
+    glClearNamedBufferData(counts_buffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+    if (!glad_glMultiDrawElementsIndirectCount) {
+        std::cout << "glMultiDrawElementsIndirectCount is not available, the culled meshlets are drawn as empty commands."
+                  << std::endl;
+    }
+}
+
+MeshletCuller::~MeshletCuller() {
+    GLObjectTracker::on_delete(GLObjectType::BUFFER, commands_buffer);
+    GLObjectTracker::on_delete(GLObjectType::BUFFER, counts_buffer);
+    glDeleteBuffers(1, &commands_buffer);
+    glDeleteBuffers(1, &counts_buffer);
+}
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+void MeshletCuller::begin(const glm::mat4& view_projection, const glm::vec3& camera_position) {
+    // Without the draw count, the commands of the culled meshlets must stay empty, so the last frame is cleared.
+    if (!glad_glMultiDrawElementsIndirectCount && used_commands > 0) {
+        glClearNamedBufferSubData(commands_buffer, GL_R32UI, 0, used_commands * sizeof(DrawElementsIndirectCommand),
+                                  GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    }
+    if (used_batches > 0) {
+        glClearNamedBufferSubData(counts_buffer, GL_R32UI, 0, used_batches * sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT,
+                                  nullptr);
+    }
+
+    used_commands = 0;
+    used_batches = 0;
+    frustum_planes = extract_frustum_planes(view_projection);
+    this->camera_position = camera_position;
+}
+
+MeshletCuller::Batch MeshletCuller::cull(const Geometry& geometry, GLuint object_index, const glm::mat4& model, int lod) {
+    Batch batch;
+    batch.object_index = object_index;
+    batch.lod = lod;
+
+    const GLsizei meshlet_count = geometry.get_meshlet_count();
+    if (lod != 0 || meshlet_count == 0 || geometry.residency == Residency::CPU_ONLY ||
+        used_commands + meshlet_count > max_commands || used_batches >= max_batches) {
+        return batch;
+    }
+    batch.first_command = used_commands;
+    batch.command_count = meshlet_count;
+    batch.counter = used_batches;
+    used_commands += meshlet_count;
+    used_batches++;
+
+    // The commands address the indices from the beginning of the buffer, so the offset of the geometry is added.
+    geometry.validate_vao();
+    const BufferArena::Range meshlets = geometry.get_meshlet_range();
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, MESHLETS_BINDING, meshlets.buffer, meshlets.offset, meshlets.size);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMANDS_BINDING, commands_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNTS_BINDING, counts_buffer);
+
+    program.use();
+    program.uniform_matrix(MODEL_LOC, model);
+    program.uniform(CAMERA_POSITION_LOC, camera_position);
+    program.uniform(MESHLET_COUNT_LOC, static_cast<uint32_t>(meshlet_count));
+    program.uniform(INDEX_BASE_LOC, static_cast<uint32_t>(geometry.index_buffer_offset / geometry.get_index_size()));
+    program.uniform(OBJECT_INDEX_LOC, static_cast<uint32_t>(object_index));
+    program.uniform(FIRST_COMMAND_LOC, static_cast<uint32_t>(batch.first_command));
+    program.uniform(BATCH_LOC, static_cast<uint32_t>(batch.counter));
+    program.uniform_array(FRUSTUM_PLANES_LOC, std::span<glm::vec4>(frustum_planes));
+    glDispatchCompute((meshlet_count + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+    barrier_pending = true;
+    return batch;
+}
+
+void MeshletCuller::draw(const Geometry& geometry, const Batch& batch) {
+    if (batch.command_count == 0) {
+        geometry.draw_base_instance(batch.object_index, batch.lod);
+        return;
+    }
+
+    // The commands written by the compute pass must be visible to the indirect draws.
+    if (barrier_pending) {
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+        barrier_pending = false;
+    }
+
+    geometry.bind_vao();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands_buffer);
+    const void* indirect = reinterpret_cast<const void*>(batch.first_command * sizeof(DrawElementsIndirectCommand));
+    if (glad_glMultiDrawElementsIndirectCount) {
+        glBindBuffer(GL_PARAMETER_BUFFER, counts_buffer);
+        glMultiDrawElementsIndirectCount(geometry.mode, geometry.index_type, indirect, batch.counter * sizeof(GLuint),
+                                         batch.command_count, 0);
+        glBindBuffer(GL_PARAMETER_BUFFER, 0);
+    } else {
+        glMultiDrawElementsIndirect(geometry.mode, geometry.index_type, indirect, batch.command_count, 0);
+    }
+    FrameCounters::count_indirect_draw();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+std::array<glm::vec4, 6> MeshletCuller::extract_frustum_planes(const glm::mat4& view_projection) {
+    // The planes are the sums and differences of the fourth row with the other rows (Gribb & Hartmann).
+    auto row = [&](int i) { return glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]); };
+    std::array<glm::vec4, 6> planes = {row(3) + row(0), row(3) - row(0), row(3) + row(1),
+                                       row(3) - row(1), row(3) + row(2), row(3) - row(2)};
+    for (glm::vec4& plane : planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return planes;
+}
@@ -0,0 +1,43 @@
+#include "model_ubo.hpp"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define MODEL_DATA_SSE
+#include <xmmintrin.h>
+#endif
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+void ModelData::compute_normal_matrices(std::span<ModelData> objects) {
+    for (ModelData& object : objects) {
+        object.update_normal_matrix();
+    }
+}
+
+void ModelData::compute_mvp_matrices(std::span<ModelData> objects, const glm::mat4& view_projection) {
+#ifdef MODEL_DATA_SSE
+    // Column j of the result is a linear combination of the columns of VP weighted by column j of the model matrix.
+    const __m128 vp0 = _mm_loadu_ps(&view_projection[0][0]);
+    const __m128 vp1 = _mm_loadu_ps(&view_projection[1][0]);
+    const __m128 vp2 = _mm_loadu_ps(&view_projection[2][0]);
+    const __m128 vp3 = _mm_loadu_ps(&view_projection[3][0]);
+
+    for (ModelData& object : objects) {
+        // ModelData is 16-byte aligned, so the matrices at offsets 0 and 64 are 16-byte aligned as well.
+        const float* model = &object.model_matrix[0][0];
+        float* mvp = &object.mvp_matrix[0][0];
+        for (int column = 0; column < 4; column++) {
+            const float* m = model + column * 4;
+            __m128 result = _mm_mul_ps(vp0, _mm_set1_ps(m[0]));
+            result = _mm_add_ps(result, _mm_mul_ps(vp1, _mm_set1_ps(m[1])));
+            result = _mm_add_ps(result, _mm_mul_ps(vp2, _mm_set1_ps(m[2])));
+            result = _mm_add_ps(result, _mm_mul_ps(vp3, _mm_set1_ps(m[3])));
+            _mm_store_ps(mvp + column * 4, result);
+        }
+    }
+#else
+    for (ModelData& object : objects) {
+        object.mvp_matrix = view_projection * object.model_matrix;
+    }
+#endif
+}
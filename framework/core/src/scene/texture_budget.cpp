@@ -0,0 +1,126 @@
+#include "texture_budget.hpp"
+#include <algorithm>
+#include <cmath>
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+void TextureBudget::request(const TextureAsset& texture, float projected_size) {
+    if (!texture.is_valid()) {
+        return;
+    }
+    const int level = get_needed_level(texture, projected_size);
+    const auto [it, inserted] = needed_levels.try_emplace(&texture, level);
+    if (!inserted) {
+        it->second = std::min(it->second, level);
+    }
+}
+
+void TextureBudget::request(const TexturedMaterial& material, float projected_size) {
+    for (const std::shared_ptr<TextureAsset>& texture : material.get_textures()) {
+        if (texture) {
+            request(*texture, projected_size);
+        }
+    }
+    if (material.get_normal_texture()) {
+        request(*material.get_normal_texture(), projected_size);
+    }
+}
+
+void TextureBudget::update(const AssetRegistry& assets) {
+    if (++frame < evaluation_period) {
+        return;
+    }
+    frame = 0;
+
+    // A managed texture and the level it should hold.
+    struct Entry {
+        TextureAsset* texture;
+        int needed;
+        int target;
+        bool visible;
+    };
+
+    // Without the budget pressure, the visible textures get the levels they need and nothing else changes.
+    std::vector<Entry> entries;
+    size_t total = 0;
+    for (const auto& [key, texture] : assets.get_textures()) {
+        if (!texture->is_valid()) {
+            continue;
+        }
+        const auto needed = needed_levels.find(texture.get());
+        const bool visible = needed != needed_levels.end();
+        const int needed_level = visible ? needed->second : texture->get_levels() - 1;
+        const int target = std::min(texture->get_resident_level(), needed_level);
+        entries.push_back({texture.get(), needed_level, target, visible});
+        total += texture->get_memory_size(target);
+    }
+    needed_levels.clear();
+
+    // Over the budget, the levels are dropped one by one, the groups are: not drawn, finer than needed, visible.
+    while (total > budget) {
+        Entry* best = nullptr;
+        int best_group = 0;
+        size_t best_saving = 0;
+        for (Entry& entry : entries) {
+            if (entry.target >= entry.texture->get_levels() - 1) {
+                continue;
+            }
+            const int group = !entry.visible ? 0 : entry.target < entry.needed ? 1 : 2;
+            const size_t saving = entry.texture->get_memory_size(entry.target) - entry.texture->get_memory_size(entry.target + 1);
+            if (!best || group < best_group || (group == best_group && saving > best_saving)) {
+                best = &entry;
+                best_group = group;
+                best_saving = saving;
+            }
+        }
+        if (!best) {
+            break;
+        }
+        best->target++;
+        total -= best_saving;
+    }
+
+    // The drops release memory at once, the loads wait for a second vote and are limited (largest deficit first).
+    std::vector<Entry*> raises;
+    for (Entry& entry : entries) {
+        if (entry.target > entry.texture->get_resident_level()) {
+            entry.texture->set_resident_level(entry.target);
+        } else if (entry.target < entry.texture->get_resident_level()) {
+            raises.push_back(&entry);
+        }
+    }
+    std::sort(raises.begin(), raises.end(), [](const Entry* a, const Entry* b) {
+        return a->texture->get_resident_level() - a->target > b->texture->get_resident_level() - b->target;
+    });
+
+    std::unordered_map<const TextureAsset*, int> votes;
+    int changes = 0;
+    for (Entry* entry : raises) {
+        const auto previous = raise_votes.find(entry->texture);
+        const int vote = (previous != raise_votes.end() ? previous->second : 0) + 1;
+        if (vote < 2 || changes >= max_changes || !entry->texture->set_resident_level(entry->target)) {
+            votes[entry->texture] = vote;
+            continue;
+        }
+        changes++;
+    }
+    raise_votes = std::move(votes);
+
+    resident_size = 0;
+    clamped_count = 0;
+    for (const Entry& entry : entries) {
+        resident_size += entry.texture->get_memory_size();
+        clamped_count += entry.texture->get_resident_level() > 0 ? 1 : 0;
+    }
+}
+
+int TextureBudget::get_needed_level(const TextureAsset& texture, float projected_size) const {
+    // The level at which one texel covers a pixel, assuming the texture spans the object once.
+    const float texels = static_cast<float>(std::max(texture.get_width(), texture.get_height()));
+    if (!(projected_size > 0.0f)) {
+        return texture.get_levels() - 1;
+    }
+    const float level = std::floor(std::log2(texels / projected_size)) - static_cast<float>(bias);
+    return std::clamp(static_cast<int>(std::max(level, 0.0f)), 0, std::max(texture.get_levels() - 1, 0));
+}
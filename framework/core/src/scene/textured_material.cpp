@@ -0,0 +1,58 @@
+#include "textured_material.hpp"
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+TexturedMaterial& TexturedMaterial::set_texture(int index, std::shared_ptr<TextureAsset> texture) {
+    textures[index] = std::move(texture);
+    return *this;
+}
+
+TexturedMaterial& TexturedMaterial::set_normal_texture(std::shared_ptr<TextureAsset> texture) {
+    normal_texture = std::move(texture);
+    return *this;
+}
+
+TexturedMaterial& TexturedMaterial::set_ambient(int texture, int channel) {
+    ambient = {texture, channel};
+    return *this;
+}
+
+TexturedMaterial& TexturedMaterial::set_diffuse(int texture, int channel) {
+    diffuse = {texture, channel};
+    return *this;
+}
+
+TexturedMaterial& TexturedMaterial::set_specular(int texture, int channel) {
+    specular = {texture, channel};
+    return *this;
+}
+
+void TexturedMaterial::bind(const ShaderProgram& program) const {
+    for (int i = 0; i < TEXTURE_COUNT; i++) {
+        if (textures[i]) {
+            textures[i]->bind(FIRST_UNIT + i);
+        }
+    }
+    if (normal_texture) {
+        normal_texture->bind(NORMAL_UNIT);
+    }
+
+    // The colors whose texture could not be loaded are not textured.
+    auto source = [&](const Source& s) {
+        const bool valid = s.texture >= 0 && s.texture < TEXTURE_COUNT && textures[s.texture] && textures[s.texture]->is_valid();
+        return glm::ivec2(valid ? s.texture : -1, s.channel);
+    };
+    program.uniform("ambient_source", source(ambient));
+    program.uniform("diffuse_source", source(diffuse));
+    program.uniform("specular_source", source(specular));
+    program.uniform("has_normal_texture", normal_texture != nullptr && normal_texture->is_valid());
+}
+
+int TexturedMaterial::get_fetch_count() const {
+    int count = normal_texture ? 1 : 0;
+    for (int i = 0; i < TEXTURE_COUNT; i++) {
+        count += textures[i] && (ambient.texture == i || diffuse.texture == i || specular.texture == i) ? 1 : 0;
+    }
+    return count;
+}
@@ -0,0 +1,149 @@
+#include "utils/cpu_profiler.hpp"
+#include <iostream>
+
+// The process identifier written into the traces, all zones come from this process.
+static const int TRACE_PROCESS_ID = 1;
+
+/** Writes a string as a JSON string literal. */
+static void write_string(std::ostream& stream, const char* text) {
+    stream << '"';
+    for (; *text; text++) {
+        if (*text == '"' || *text == '\\') {
+            stream << '\\' << *text;
+        } else if (static_cast<unsigned char>(*text) >= 0x20) {
+            stream << *text;
+        }
+    }
+    stream << '"';
+}
+
+/** Writes the metadata event naming a thread. */
+static void write_thread_name(std::ostream& stream, uint32_t id, const std::string& name) {
+    stream << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << TRACE_PROCESS_ID << ", \"tid\": " << id << ", \"args\": {\"name\": ";
+    write_string(stream, name.c_str());
+    stream << "}}";
+}
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+bool CpuProfiler::begin_session(const std::filesystem::path& path) {
+    end_session();
+
+    std::lock_guard lock(mutex);
+    std::error_code error;
+    if (path.has_parent_path()) {
+        std::filesystem::create_directories(path.parent_path(), error);
+    }
+    file.open(path);
+    if (!file) {
+        std::cerr << "Failed to create the trace file " << path << std::endl;
+        file = std::ofstream();
+        return false;
+    }
+    CpuProfiler::path = path;
+    session_start = now();
+    written_count = 0;
+    dropped_count = 0;
+
+    // The zones left from the previous session are skipped, and the threads known so far are named right away.
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    file << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << TRACE_PROCESS_ID << ", \"args\": {\"name\": \"CPU\"}}";
+    for (const std::shared_ptr<ThreadBuffer>& buffer : buffers) {
+        buffer->tail.store(buffer->head.load(std::memory_order_acquire), std::memory_order_release);
+        if (!buffer->name.empty()) {
+            write_thread_name(file, buffer->id, buffer->name);
+        }
+    }
+    recording = true;
+    return true;
+}
+
+void CpuProfiler::end_session() {
+    if (!recording.exchange(false)) {
+        return;
+    }
+
+    std::lock_guard lock(mutex);
+    for (const std::shared_ptr<ThreadBuffer>& buffer : buffers) {
+        write_zones(*buffer);
+    }
+    file << "\n]}\n";
+    file.close();
+    if (!file) {
+        std::cerr << "Failed to write the trace file " << path << std::endl;
+    }
+    file = std::ofstream();
+    std::cout << "Profile written into " << path << ": " << written_count << " zones, " << get_dropped_count() << " dropped." << std::endl;
+}
+
+void CpuProfiler::flush() {
+    if (!is_recording()) {
+        return;
+    }
+    std::lock_guard lock(mutex);
+    for (const std::shared_ptr<ThreadBuffer>& buffer : buffers) {
+        write_zones(*buffer);
+    }
+}
+
+void CpuProfiler::set_thread_name(const std::string& name) {
+    // The buffer is created only by the first zone, the threads that never record any zone do not need one.
+    thread_name = name;
+    if (!thread_buffer) {
+        return;
+    }
+    std::lock_guard lock(mutex);
+    thread_buffer->name = name;
+    if (is_recording()) {
+        write_thread_name(file, thread_buffer->id, name);
+    }
+}
+
+CpuProfiler::ThreadBuffer* CpuProfiler::register_thread() {
+    // The registry keeps the buffer alive after the thread finishes, so its last zones are still written.
+    auto buffer = std::make_shared<ThreadBuffer>();
+    buffer->name = thread_name;
+    std::lock_guard lock(mutex);
+    buffer->id = static_cast<uint32_t>(buffers.size() + 1);
+    buffers.push_back(buffer);
+    if (is_recording() && !buffer->name.empty()) {
+        write_thread_name(file, buffer->id, buffer->name);
+    }
+    thread_buffer = buffer.get();
+    return thread_buffer;
+}
+
+void CpuProfiler::write_zones(ThreadBuffer& buffer) {
+    const uint64_t head = buffer.head.load(std::memory_order_acquire);
+    uint64_t tail = buffer.tail.load(std::memory_order_relaxed);
+    for (; tail != head; tail++) {
+        const Zone& zone = buffer.zones[tail % BUFFER_CAPACITY];
+        // The zones started before the session belong to the previous one.
+        if (zone.begin < session_start) {
+            continue;
+        }
+        // The timestamps of the trace are in microseconds.
+        file << ",\n{\"name\": ";
+        write_string(file, zone.name);
+        file << ", \"ph\": \"X\", \"pid\": " << TRACE_PROCESS_ID << ", \"tid\": " << buffer.id
+             << ", \"ts\": " << (zone.begin - session_start) / 1000 << "." << (zone.begin - session_start) % 1000 / 100
+             << ", \"dur\": " << (zone.end - zone.begin) / 1000 << "." << (zone.end - zone.begin) % 1000 / 100 << "}";
+        written_count++;
+    }
+    // The slots are released only after they were read.
+    buffer.tail.store(tail, std::memory_order_release);
+}
+
+// ----------------------------------------------------------------------------
+// Getters & Setters
+// ----------------------------------------------------------------------------
+std::filesystem::path CpuProfiler::get_path() {
+    std::lock_guard lock(mutex);
+    return path;
+}
+
+uint64_t CpuProfiler::get_written_count() {
+    std::lock_guard lock(mutex);
+    return written_count;
+}
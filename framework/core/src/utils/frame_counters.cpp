@@ -0,0 +1,158 @@
+#include "utils/frame_counters.hpp"
+#include "imgui.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+/** The name of a counter and its member in @link FrameStatistics. */
+struct Counter {
+    const char* name;
+    uint64_t FrameStatistics::*member;
+};
+
+// The counters in the order of the panel and the JSON objects.
+static const Counter COUNTERS[] = {
+    {"draw_calls", &FrameStatistics::draw_calls},
+    {"instances", &FrameStatistics::instances},
+    {"vertices", &FrameStatistics::vertices},
+    {"triangles", &FrameStatistics::triangles},
+    {"program_switches", &FrameStatistics::program_switches},
+    {"texture_binds", &FrameStatistics::texture_binds},
+    {"buffer_uploads", &FrameStatistics::buffer_uploads},
+    {"uploaded_bytes", &FrameStatistics::uploaded_bytes},
+    {"objects_created", &FrameStatistics::objects_created},
+};
+
+/** Appends the counters as a JSON object. */
+static void write_counters(std::ostringstream& stream, const FrameStatistics& statistics) {
+    stream << "{";
+    for (size_t i = 0; i < std::size(COUNTERS); i++) {
+        stream << (i > 0 ? ", " : "") << "\"" << COUNTERS[i].name << "\": " << statistics.*COUNTERS[i].member;
+    }
+    stream << "}";
+}
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+void FrameCounters::end_frame() {
+    history[frame_count % HISTORY_SIZE] = current;
+    frame_count++;
+    current = FrameStatistics();
+    current_program = 0;
+}
+
+uint64_t FrameCounters::get_triangle_count(GLenum mode, uint64_t vertices) {
+    switch (mode) {
+    case GL_TRIANGLES:
+        return vertices / 3;
+    case GL_TRIANGLE_STRIP:
+    case GL_TRIANGLE_FAN:
+        return vertices > 2 ? vertices - 2 : 0;
+    case GL_TRIANGLES_ADJACENCY:
+        return vertices / 6;
+    case GL_TRIANGLE_STRIP_ADJACENCY:
+        return vertices > 4 ? (vertices - 4) / 2 : 0;
+    default:
+        // Points, lines, and patches (whose triangles are generated by the tessellation).
+        return 0;
+    }
+}
+
+const FrameStatistics& FrameCounters::get_last_frame() {
+    static const FrameStatistics empty;
+    return frame_count > 0 ? history[(frame_count - 1) % HISTORY_SIZE] : empty;
+}
+
+FrameStatistics FrameCounters::get_average() {
+    const uint64_t count = std::min<uint64_t>(frame_count, HISTORY_SIZE);
+    FrameStatistics result;
+    for (uint64_t i = 0; i < count; i++) {
+        for (const Counter& counter : COUNTERS) {
+            result.*counter.member += history[i].*counter.member;
+        }
+    }
+    for (const Counter& counter : COUNTERS) {
+        result.*counter.member = count > 0 ? (result.*counter.member + count / 2) / count : 0;
+    }
+    return result;
+}
+
+FrameStatistics FrameCounters::get_minimum() {
+    const uint64_t count = std::min<uint64_t>(frame_count, HISTORY_SIZE);
+    FrameStatistics result = count > 0 ? history[0] : FrameStatistics();
+    for (uint64_t i = 1; i < count; i++) {
+        for (const Counter& counter : COUNTERS) {
+            result.*counter.member = std::min(result.*counter.member, history[i].*counter.member);
+        }
+    }
+    return result;
+}
+
+FrameStatistics FrameCounters::get_maximum() {
+    const uint64_t count = std::min<uint64_t>(frame_count, HISTORY_SIZE);
+    FrameStatistics result;
+    for (uint64_t i = 0; i < count; i++) {
+        for (const Counter& counter : COUNTERS) {
+            result.*counter.member = std::max(result.*counter.member, history[i].*counter.member);
+        }
+    }
+    return result;
+}
+
+std::string FrameCounters::to_json() {
+    std::ostringstream stream;
+    stream << "{\n  \"frames\": " << frame_count << ",\n  \"history\": " << std::min<uint64_t>(frame_count, HISTORY_SIZE);
+    stream << ",\n  \"last\": ";
+    write_counters(stream, get_last_frame());
+    stream << ",\n  \"average\": ";
+    write_counters(stream, get_average());
+    stream << ",\n  \"maximum\": ";
+    write_counters(stream, get_maximum());
+    stream << "\n}\n";
+    return stream.str();
+}
+
+bool FrameCounters::write_json(const std::filesystem::path& path) {
+    std::ofstream file(path);
+    file << to_json();
+    if (!file) {
+        std::cerr << "Failed to write the frame counters into " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void FrameCounters::render_ui() {
+    ImGui::Begin("Frame Counters", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+    const FrameStatistics& last = get_last_frame();
+    const FrameStatistics average = get_average();
+    const FrameStatistics maximum = get_maximum();
+    if (ImGui::BeginTable("counters", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) {
+        ImGui::TableSetupColumn("Counter");
+        ImGui::TableSetupColumn("Last");
+        ImGui::TableSetupColumn("Average");
+        ImGui::TableSetupColumn("Maximum");
+        ImGui::TableHeadersRow();
+        for (const Counter& counter : COUNTERS) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(counter.name);
+            for (const FrameStatistics* statistics : {&last, &average, &maximum}) {
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", static_cast<unsigned long long>(statistics->*counter.member));
+            }
+        }
+        ImGui::EndTable();
+    }
+    // The objects created in every frame of the history are most likely recreated resources or leaks.
+    if (get_minimum().objects_created > 0) {
+        ImGui::TextColored(ImVec4(0.9f, 0.1f, 0.1f, 1.0f), "OpenGL objects are created every frame!");
+    }
+    ImGui::TextUnformatted("ImGui and unreported OpenGL calls are not counted.");
+    if (ImGui::Button("Dump JSON")) {
+        write_json("frame_counters.json");
+    }
+    ImGui::End();
+}
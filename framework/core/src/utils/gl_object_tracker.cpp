@@ -0,0 +1,239 @@
+#include "utils/gl_object_tracker.hpp"
+#include "imgui.h"
+#include "texture_compressor.hpp"
+#include "utils/frame_counters.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <map>
+
+// The number of places shown by the panel and the report.
+static const size_t MAX_REPORTED_SITES = 16;
+
+/** Formats a place of the code as 'file:line (function)', only the file name is kept from the path. */
+static std::string format_location(const std::source_location& location) {
+    std::string file = location.file_name();
+    const size_t separator = file.find_last_of("/\\");
+    if (separator != std::string::npos) {
+        file = file.substr(separator + 1);
+    }
+    return file + ":" + std::to_string(location.line()) + " (" + location.function_name() + ")";
+}
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+void GLObjectTracker::on_create(GLObjectType type, GLuint name, uint64_t size, const std::source_location& location) {
+    FrameCounters::count_objects_created();
+    if (name == 0) {
+        return;
+    }
+    // A name still recorded as live was deleted without being reported, its old record is replaced.
+    on_delete(type, name);
+    objects.emplace(get_key(type, name), Record{size, location});
+
+    const size_t t = static_cast<size_t>(type);
+    totals[t].live_count++;
+    for (std::array<GLObjectStatistics, TYPE_COUNT>* statistics : {&totals, &current}) {
+        (*statistics)[t].created_count++;
+        (*statistics)[t].allocated_bytes += size;
+    }
+    totals[t].live_bytes += size;
+}
+
+void GLObjectTracker::on_resize(GLObjectType type, GLuint name, uint64_t size) {
+    const auto object = objects.find(get_key(type, name));
+    if (object == objects.end()) {
+        return;
+    }
+    const size_t t = static_cast<size_t>(type);
+    for (std::array<GLObjectStatistics, TYPE_COUNT>* statistics : {&totals, &current}) {
+        (*statistics)[t].released_bytes += object->second.size;
+        (*statistics)[t].allocated_bytes += size;
+    }
+    totals[t].live_bytes += size - object->second.size;
+    object->second.size = size;
+}
+
+void GLObjectTracker::on_delete(GLObjectType type, GLuint name) {
+    const auto object = objects.find(get_key(type, name));
+    if (name == 0 || object == objects.end()) {
+        return;
+    }
+    const size_t t = static_cast<size_t>(type);
+    for (std::array<GLObjectStatistics, TYPE_COUNT>* statistics : {&totals, &current}) {
+        (*statistics)[t].deleted_count++;
+        (*statistics)[t].released_bytes += object->second.size;
+    }
+    totals[t].live_count--;
+    totals[t].live_bytes -= object->second.size;
+    objects.erase(object);
+}
+
+void GLObjectTracker::end_frame() {
+    for (size_t t = 0; t < TYPE_COUNT; t++) {
+        last_frame[t] = current[t];
+        last_frame[t].live_count = totals[t].live_count;
+        last_frame[t].live_bytes = totals[t].live_bytes;
+        current[t] = GLObjectStatistics();
+    }
+    if (++frame_count % CHECK_INTERVAL == 0) {
+        check_growth();
+    }
+}
+
+void GLObjectTracker::check_growth() {
+    bool growing = false;
+    for (size_t t = 0; t < TYPE_COUNT; t++) {
+        // The streak continues past the limit, so the growing objects are reported only once (unless aborting).
+        growth_streaks[t] = totals[t].live_count > checked_counts[t] ? growth_streaks[t] + 1 : 0;
+        checked_counts[t] = totals[t].live_count;
+        if (growth_streaks[t] == growth_limit || (abort_on_growth && growth_streaks[t] > growth_limit)) {
+            std::cerr << "The number of OpenGL objects of type '" << get_type_name(static_cast<GLObjectType>(t)) << "' has grown for "
+                      << growth_limit * CHECK_INTERVAL << " frames to " << totals[t].live_count << "." << std::endl;
+            growing = true;
+        }
+    }
+    if (growing) {
+        report(std::cerr);
+        if (abort_on_growth) {
+            std::cerr << "Aborting because of the unbounded growth of OpenGL objects." << std::endl;
+            std::abort();
+        }
+    }
+}
+
+std::vector<GLObjectSite> GLObjectTracker::get_sites() {
+    std::map<std::pair<GLObjectType, std::string>, GLObjectSite> sites;
+    for (const auto& [key, record] : objects) {
+        const GLObjectType type = static_cast<GLObjectType>(key >> 32);
+        std::string location = format_location(record.location);
+        GLObjectSite& site = sites[{type, location}];
+        if (site.count == 0) {
+            site.type = type;
+            site.location = std::move(location);
+        }
+        site.count++;
+        site.bytes += record.size;
+    }
+
+    std::vector<GLObjectSite> result;
+    result.reserve(sites.size());
+    for (auto& [key, site] : sites) {
+        result.push_back(std::move(site));
+    }
+    std::stable_sort(result.begin(), result.end(), [](const GLObjectSite& a, const GLObjectSite& b) { return a.count > b.count; });
+    return result;
+}
+
+void GLObjectTracker::report(std::ostream& stream) {
+    stream << "Live OpenGL objects:" << std::endl;
+    for (size_t t = 0; t < TYPE_COUNT; t++) {
+        stream << "  " << get_type_name(static_cast<GLObjectType>(t)) << ": " << totals[t].live_count << " ("
+               << totals[t].live_bytes / 1024 << " KB)" << std::endl;
+    }
+    const std::vector<GLObjectSite> sites = get_sites();
+    for (size_t i = 0; i < std::min(sites.size(), MAX_REPORTED_SITES); i++) {
+        stream << "  " << sites[i].count << "x " << get_type_name(sites[i].type) << " (" << sites[i].bytes / 1024 << " KB) created at "
+               << sites[i].location << std::endl;
+    }
+}
+
+void GLObjectTracker::render_ui() {
+    ImGui::Begin("OpenGL Objects", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+    if (ImGui::BeginTable("types", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) {
+        ImGui::TableSetupColumn("Type");
+        ImGui::TableSetupColumn("Live");
+        ImGui::TableSetupColumn("Memory (MB)");
+        ImGui::TableSetupColumn("Created/frame");
+        ImGui::TableSetupColumn("Allocated/frame (KB)");
+        ImGui::TableHeadersRow();
+        for (size_t t = 0; t < TYPE_COUNT; t++) {
+            const GLObjectType type = static_cast<GLObjectType>(t);
+            const ImVec4 color = is_growing(type) ? ImVec4(0.9f, 0.1f, 0.1f, 1.0f) : ImGui::GetStyleColorVec4(ImGuiCol_Text);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextColored(color, "%s", get_type_name(type));
+            ImGui::TableNextColumn();
+            ImGui::TextColored(color, "%llu", static_cast<unsigned long long>(totals[t].live_count));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", totals[t].live_bytes / (1024.0 * 1024.0));
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu/%llu", static_cast<unsigned long long>(last_frame[t].created_count),
+                        static_cast<unsigned long long>(last_frame[t].deleted_count));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f", last_frame[t].allocated_bytes / 1024.0);
+        }
+        ImGui::EndTable();
+    }
+    if (ImGui::TreeNode("Creation sites")) {
+        const std::vector<GLObjectSite> sites = get_sites();
+        for (size_t i = 0; i < std::min(sites.size(), MAX_REPORTED_SITES); i++) {
+            ImGui::Text("%6llu %-12s %8.1f KB  %s", static_cast<unsigned long long>(sites[i].count), get_type_name(sites[i].type),
+                        sites[i].bytes / 1024.0, sites[i].location.c_str());
+        }
+        ImGui::TreePop();
+    }
+    if (ImGui::Button("Print report")) {
+        report(std::cout);
+    }
+    ImGui::End();
+}
+
+uint64_t GLObjectTracker::get_texture_size(GLenum internal_format, int width, int height, int levels) {
+    uint64_t texel_bytes = 4;
+    switch (internal_format) {
+    case GL_R8:
+        texel_bytes = 1;
+        break;
+    case GL_RG8:
+    case GL_R16F:
+    case GL_DEPTH_COMPONENT16:
+        texel_bytes = 2;
+        break;
+    case GL_RG16F:
+    case GL_R32F:
+        texel_bytes = 4;
+        break;
+    case GL_RGBA16F:
+    case GL_RG32F:
+        texel_bytes = 8;
+        break;
+    case GL_RGB32F:
+        texel_bytes = 12;
+        break;
+    case GL_RGBA32F:
+        texel_bytes = 16;
+        break;
+    }
+
+    uint64_t size = 0;
+    for (int level = 0; level < levels; level++) {
+        const int w = std::max(1, width >> level);
+        const int h = std::max(1, height >> level);
+        // The block-compressed formats are left to the compressor, which knows their block sizes.
+        size += TextureCompressor::get_block_size(internal_format) > 0 ? TextureCompressor::get_level_size(internal_format, w, h)
+                                                                        : w * h * texel_bytes;
+    }
+    return size;
+}
+
+const char* GLObjectTracker::get_type_name(GLObjectType type) {
+    switch (type) {
+    case GLObjectType::BUFFER:
+        return "buffer";
+    case GLObjectType::TEXTURE:
+        return "texture";
+    case GLObjectType::VERTEX_ARRAY:
+        return "vertex array";
+    case GLObjectType::FRAMEBUFFER:
+        return "framebuffer";
+    case GLObjectType::RENDERBUFFER:
+        return "renderbuffer";
+    case GLObjectType::PROGRAM:
+        return "program";
+    case GLObjectType::SHADER:
+        return "shader";
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,121 @@
+#include "utils/thread_pool.hpp"
+#include "utils/cpu_profiler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+// The number of batches per thread created by parallel_for, more batches balance uneven work better.
+static const size_t BATCHES_PER_THREAD = 4;
+
+// ----------------------------------------------------------------------------
+// Constructors
+// ----------------------------------------------------------------------------
+ThreadPool::ThreadPool(size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workers.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; i++) {
+        workers.emplace_back([this, i]() {
+            CpuProfiler::set_thread_name("worker " + std::to_string(i));
+            worker_loop();
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t begin, size_t end)>& body, size_t min_batch) {
+    if (count == 0) {
+        return;
+    }
+    const size_t batch_size = std::max({min_batch, size_t(1), count / (BATCHES_PER_THREAD * (workers.size() + 1))});
+    const size_t batch_count = (count + batch_size - 1) / batch_size;
+    if (batch_count == 1) {
+        body(0, count);
+        return;
+    }
+
+    // The state is shared with the helper tasks, which may start only after the loop has finished. They claim batches
+    // first, so they never touch the body once all batches are claimed.
+    struct State {
+        std::atomic<size_t> next_batch{0};
+        size_t finished_batches = 0;
+        std::exception_ptr exception;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    auto state = std::make_shared<State>();
+    auto run_batches = [state, &body, count, batch_size, batch_count]() {
+        for (size_t batch = state->next_batch++; batch < batch_count; batch = state->next_batch++) {
+            std::exception_ptr exception;
+            try {
+                body(batch * batch_size, std::min(count, (batch + 1) * batch_size));
+            } catch (...) {
+                exception = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (exception && !state->exception) {
+                state->exception = exception;
+            }
+            if (++state->finished_batches == batch_count) {
+                state->done.notify_all();
+            }
+        }
+    };
+
+    const size_t helpers = std::min(workers.size(), batch_count - 1);
+    for (size_t i = 0; i < helpers; i++) {
+        enqueue(run_batches);
+    }
+    run_batches();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&]() { return state->finished_batches == batch_count; });
+    if (state->exception) {
+        std::rethrow_exception(state->exception);
+    }
+}
+
+ThreadPool& ThreadPool::get_default() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    condition.notify_one();
+}
+
+void ThreadPool::worker_loop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        ProfileScope zone("task");
+        task();
+    }
+}
@@ -1,11 +1,13 @@
 #include "application.hpp"
 #include "data.hpp"
+#include "utils/cpu_profiler.hpp"
+#include "utils/frame_counters.hpp"
+#include "utils/gl_object_tracker.hpp"
 #include <math.h>
 #include <vector>
 #include <iostream> 
 #include <memory>
 
-#define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 using std::make_shared;
@@ -14,39 +16,15 @@ float random() { return (float)rand() / ((float)RAND_MAX + 1.0f); }
 float random_neg() { return (float)(rand() / ((float)RAND_MAX + 1.0f) * 2.0f) - 1.0f; }
 
 
-GLuint load_texture_2d(const std::filesystem::path filename) {
-    int width, height, channels;
-    unsigned char* data = stbi_load(filename.generic_string().data(), &width, &height, &channels, 4);
-
-    GLuint texture;
-    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
-
-    glTextureStorage2D(texture, std::log2(width), GL_RGBA8, width, height);
-
-    glTextureSubImage2D(texture,
-                        0,                         //
-                        0, 0,                      //
-                        width, height,             //
-                        GL_RGBA, GL_UNSIGNED_BYTE, //
-                        data);
-
-    stbi_image_free(data);
-
-    glGenerateTextureMipmap(texture);
-
-    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    return texture;
-}
-
 unsigned int loadCubemap(std::vector<std::filesystem::path> faces)
 {
+    ProfileScope zone("loadCubemap");
     GLuint textureID;
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
     int width, height, nrChannels;
+    uint64_t size = 0;
     for (unsigned int i = 0; i < faces.size(); i++)
     {
         unsigned char *data = stbi_load(faces[i].generic_string().data(), &width, &height, &nrChannels, 0);
@@ -55,6 +33,7 @@ unsigned int loadCubemap(std::vector<std::filesystem::path> faces)
             glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 
                          0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data
             );
+            size += GLObjectTracker::get_texture_size(GL_RGB8, width, height);
         }
         else
         {
@@ -67,6 +46,7 @@ unsigned int loadCubemap(std::vector<std::filesystem::path> faces)
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    GLObjectTracker::on_create(GLObjectType::TEXTURE, textureID, size);
 
     return textureID;
 }
@@ -82,52 +62,58 @@ Application::Application(int initial_width, int initial_height, std::vector<std:
     // --------------------------------------------------------------------------
     //  Load/Create Objects
     // --------------------------------------------------------------------------
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "outside.obj")));
+    // The meshes are only drawn, so they use the compact vertex layout and keep no copy of the data in RAM.
+    // The dense meshes that are often seen from far away get coarser levels of detail. The registry loads every file
+    // only once, the objects using the same file share the geometry.
+    auto load_mesh = [&](const std::filesystem::path& file, int lod_count = 1) {
+        return assets.load_geometry(objects_path / file, Residency::GPU_ONLY, VertexFormat::QUANTIZED, lod_count);
+    };
+    geometries.push_back(load_mesh("outside.obj"));
     // You can use from_file function to load a Geometry from .obj file
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "mirror.obj")));
+    geometries.push_back(load_mesh("mirror.obj"));
 
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "dresser.obj")));
+    geometries.push_back(load_mesh("dresser.obj"));
     
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "bedside_table.obj")));
+    geometries.push_back(load_mesh("bedside_table.obj"));
 
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "table_lamp.obj")));
+    geometries.push_back(load_mesh("table_lamp.obj"));
 
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "rug.obj")));
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "chair.obj")));
+    geometries.push_back(load_mesh("rug.obj"));
+    geometries.push_back(load_mesh("chair.obj", 4));
 
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "plant3/plant_base.obj")));
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "plant3/plant_inside.obj")));
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "plant3/plant_outside.obj")));
+    geometries.push_back(load_mesh("plant3/plant_base.obj"));
+    geometries.push_back(load_mesh("plant3/plant_inside.obj"));
+    geometries.push_back(load_mesh("plant3/plant_outside.obj"));
 
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "bed/bed_frame.obj")));
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "bed/bed_part1.obj")));
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "bed/bed_part2.obj")));
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "bed/bed_wrap.obj")));
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "bed/bed_pillow1.obj")));
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "bed/bed_pillow2.obj")));
+    geometries.push_back(load_mesh("bed/bed_frame.obj"));
+    geometries.push_back(load_mesh("bed/bed_part1.obj"));
+    geometries.push_back(load_mesh("bed/bed_part2.obj"));
+    geometries.push_back(load_mesh("bed/bed_wrap.obj"));
+    geometries.push_back(load_mesh("bed/bed_pillow1.obj"));
+    geometries.push_back(load_mesh("bed/bed_pillow2.obj"));
 
     
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "globe/globe_stand.obj")));
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "globe/globe.obj")));
+    geometries.push_back(load_mesh("globe/globe_stand.obj"));
+    geometries.push_back(load_mesh("globe/globe.obj"));
     
     
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "door/door_frame.obj")));
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "door/door_base.obj")));
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "door/door_handle.obj")));
+    geometries.push_back(load_mesh("door/door_frame.obj"));
+    geometries.push_back(load_mesh("door/door_base.obj"));
+    geometries.push_back(load_mesh("door/door_handle.obj"));
     
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "plant_small/pot.obj")));
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "plant_small/leaf.obj")));
+    geometries.push_back(load_mesh("plant_small/pot.obj"));
+    geometries.push_back(load_mesh("plant_small/leaf.obj"));
 
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "lamp8.obj")));
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "lamp8.obj")));
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "lamp7.obj")));
+    geometries.push_back(load_mesh("lamp8.obj"));
+    geometries.push_back(load_mesh("lamp8.obj"));
+    geometries.push_back(load_mesh("lamp7.obj", 4));
 
     geometries.push_back(make_shared<Cube>());
     
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "UFO.obj")));
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "cow.obj")));
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "cone.obj")));
-    geometries.push_back(make_shared<Geometry>(Geometry::from_file(objects_path / "tree.obj")));
+    geometries.push_back(load_mesh("UFO.obj", 4));
+    geometries.push_back(load_mesh("cow.obj", 4));
+    geometries.push_back(load_mesh("cone.obj"));
+    geometries.push_back(load_mesh("tree.obj", 4));
 
     outside = geometries[0];
 
@@ -174,75 +160,122 @@ Application::Application(int initial_width, int initial_height, std::vector<std:
     
 
 
-    wood = load_texture_2d(images_path / "light_wood.png");
-
-    marble_texture = load_texture_2d(images_path / "bunny.jpg");
-    
-    rug_texture = load_texture_2d(images_path / "rug.jpg");
-
-    chair_diffuse_texture= load_texture_2d(images_path / "chair/chair_diffuse.jpg");
-    chair_ambient_texture= load_texture_2d(images_path / "chair/chair_ambient.jpg");
-    chair_specular_texture= load_texture_2d(images_path / "chair/chair_specular.jpg");
-
-    plant3_texture = load_texture_2d(images_path / "plant3/leaf.jpg");
-    plant_pot_inside_texture = load_texture_2d(images_path / "plant3/stone.jpg");
-    plant_pot_outside_texture = load_texture_2d(images_path / "plant3/vase.jpg");
-
-
-    plush_body_ambient_texture = load_texture_2d(images_path / "plush/plush_body/BaseColor.png");
-    plush_body_diffuse_texture = load_texture_2d(images_path / "plush/plush_body/Roughness.png");
-    plush_body_specular_texture = load_texture_2d(images_path / "plush/plush_body/Metallic.png");
-    plush_body_normal_texture = load_texture_2d(images_path / "plush/plush_body/Normal.png");
-
-    white_bed_texture = load_texture_2d(images_path / "bed/white_bed.jpg");
-    yellow_bed_texture = load_texture_2d(images_path / "bed/yellow_bed.jpg");
-    blue_bed_texture = load_texture_2d(images_path / "bed/blue_bed.jpg");
-
-    globe_stand_texture = load_texture_2d(images_path / "globe/globe_frame.png");
-    globe_day_texture = load_texture_2d(images_path / "globe/globe_day.jpg");
-    globe_night_texture = load_texture_2d(images_path / "globe/globe_night.jpg");
-
-    door_frame_texture = load_texture_2d(images_path / "door/door_frame.jpg");
-    door_base_texture = load_texture_2d(images_path / "door/door_base.jpg");
-
-    small_plant_pot_normal_texture = load_texture_2d(images_path / "plant_small/POT_only_plant_Normal.png");
-    small_plant_pot_diffuse_texture = load_texture_2d(images_path / "plant_small/POT_only_plant_BaseColor.png");
-    small_plant_pot_ambient_texture = load_texture_2d(images_path / "plant_small/POT_only_plant_AO.png");
-    small_plant_pot_specular_texture = load_texture_2d(images_path / "plant_small/POT_only_plant_Roughness.png");
+    // The textures are owned by the registry, which keeps them alive for the lifetime of the application. They are
+    // block-compressed according to their role and streamed in the background, the transcoded images are cached between
+    // runs.
+    assets.set_texture_cache_directory(configuration.get_path("texture_cache", ""));
+    assets.set_texture_streamer(&texture_streamer);
+    texture_budget.budget = static_cast<size_t>(configuration.get_integer("texture_budget_mb", 256)) << 20;
+    auto load_asset = [&](const std::filesystem::path& file, TextureRole role = TextureRole::COLOR) {
+        TextureParameters parameters;
+        parameters.role = role;
+        return assets.load_texture(images_path / file, parameters);
+    };
+    // The gray maps of the textured objects are packed: two of them into R and G of a single texture, a lone one into
+    // the alpha channel of the color map. The materials describe which channel holds what.
+    auto load_masks = [&](const std::filesystem::path& first, const std::filesystem::path& second) {
+        TextureParameters parameters;
+        parameters.role = TextureRole::MASK_PAIR;
+        return assets.load_packed_texture({{images_path / first}, {images_path / second}}, parameters);
+    };
+    auto load_color_with_mask = [&](const std::filesystem::path& color, const std::filesystem::path& mask) {
+        TextureParameters parameters;
+        parameters.role = TextureRole::COLOR;
+        return assets.load_packed_texture({{images_path / color, 0},
+                                           {images_path / color, 1},
+                                           {images_path / color, 2},
+                                           mask.empty() ? ChannelSource{} : ChannelSource{images_path / mask}},
+                                          parameters);
+    };
+
+    wood = load_asset("light_wood.png");
+
+    marble_texture = load_asset("bunny.jpg");
     
-    small_plant_leaf_normal_texture = load_texture_2d(images_path / "plant_small/normal_leaf_plant.png");
-    small_plant_leaf_diffuse_texture = load_texture_2d(images_path / "plant_small/texture_of_leaf.png");
-    small_plant_leaf_ambient_texture = load_texture_2d(images_path / "plant_small/opacity_of_leaf.png");
-    small_plant_leaf_specular_texture = load_texture_2d(images_path / "plant_small/specular_of_leaf_copy.png");
-
-    table_lamp_ambient_texture = load_texture_2d(images_path / "table_lamp/lamp_ambient.jpg");
-    table_lamp_diffuse_texture = load_texture_2d(images_path / "table_lamp/lamp_base.jpg");
-    table_lamp_specular_texture = load_texture_2d(images_path / "table_lamp/lamp_specular.jpg");
-    table_lamp_normal_texture = load_texture_2d(images_path / "table_lamp/lamp_normal.jpg");
-
-    dark_wood_texture = load_texture_2d(images_path / "dark_wood.jpg");
-
-    lamp7_ambient_texture = load_texture_2d(images_path / "lamp7/lamp7_ao.jpg");
-    lamp7_diffuse_texture= load_texture_2d(images_path / "lamp7/lamp7_diffuse.jpg");
-
-    room_bot_texture = load_texture_2d(images_path / "ground.jpg");
+    rug_texture = load_asset("rug.jpg");
+
+    chair_diffuse_texture= load_asset("chair/chair_diffuse.jpg");
+    chair_material.set_texture(0, load_asset("bed/yellow_bed.jpg"))
+        .set_texture(1, load_masks("chair/chair_ambient.jpg", "chair/chair_specular.jpg"))
+        .set_ambient(1, 0)
+        .set_diffuse(0)
+        .set_specular(1, 1);
+
+    plant3_texture = load_asset("plant3/leaf.jpg");
+    plant_pot_inside_texture = load_asset("plant3/stone.jpg");
+    plant_pot_outside_texture = load_asset("plant3/vase.jpg");
+
+
+    plush_body_material.set_texture(0, load_asset("plush/plush_body/BaseColor.png"))
+        .set_texture(1, load_masks("plush/plush_body/Roughness.png", "plush/plush_body/Metallic.png"))
+        .set_normal_texture(load_asset("plush/plush_body/Normal.png", TextureRole::NORMAL))
+        .set_ambient(0)
+        .set_diffuse(1, 0)
+        .set_specular(1, 1);
+
+    white_bed_texture = load_asset("bed/white_bed.jpg");
+    yellow_bed_texture = load_asset("bed/yellow_bed.jpg");
+    blue_bed_texture = load_asset("bed/blue_bed.jpg");
+
+    globe_stand_texture = load_asset("globe/globe_frame.png");
+    globe_day_texture = load_asset("globe/globe_day.jpg");
+    globe_night_texture = load_asset("globe/globe_night.jpg");
+
+    door_frame_texture = load_asset("door/door_frame.jpg");
+    door_base_texture = load_asset("door/door_base.jpg");
+
+    small_plant_pot_material.set_texture(0, load_asset("plant_small/POT_only_plant_BaseColor.png"))
+        .set_texture(1, load_masks("plant_small/POT_only_plant_AO.png", "plant_small/POT_only_plant_Roughness.png"))
+        .set_normal_texture(load_asset("plant_small/POT_only_plant_Normal.png", TextureRole::NORMAL))
+        .set_ambient(1, 0)
+        .set_diffuse(0)
+        .set_specular(1, 1);
+
+    // The alpha of the leaf color is not used, dropping it keeps the texture in BC1.
+    small_plant_leaf_material.set_texture(0, load_color_with_mask("plant_small/texture_of_leaf.png", ""))
+        .set_texture(1, load_masks("plant_small/opacity_of_leaf.png", "plant_small/specular_of_leaf_copy.png"))
+        .set_normal_texture(load_asset("plant_small/normal_leaf_plant.png", TextureRole::NORMAL))
+        .set_ambient(1, 0)
+        .set_diffuse(0)
+        .set_specular(1, 1);
+
+    table_lamp_material.set_texture(0, load_asset("table_lamp/lamp_base.jpg"))
+        .set_texture(1, load_masks("table_lamp/lamp_ambient.jpg", "table_lamp/lamp_specular.jpg"))
+        .set_normal_texture(load_asset("table_lamp/lamp_normal.jpg", TextureRole::NORMAL))
+        .set_ambient(0)
+        .set_diffuse(1, 0)
+        .set_specular(1, 1);
+
+    dark_wood_texture = load_asset("dark_wood.jpg");
+
+    // The ambient occlusion has half the resolution of the color map, packing it into the alpha would double its size.
+    lamp7_material.set_texture(0, load_asset("lamp7/lamp7_diffuse.jpg"))
+        .set_texture(1, load_asset("lamp7/lamp7_ao.jpg", TextureRole::MASK))
+        .set_ambient(1, 0)
+        .set_diffuse(0);
+
+    room_bot_texture = load_asset("ground.jpg");
     
-    outside_texture = load_texture_2d(images_path / "mountains.png");
-
-    room_texture = load_texture_2d(images_path / "room.jpg");
-    room_texture_dark = load_texture_2d(images_path / "room_dark.jpg");
-
-    ufo_normal_texture = load_texture_2d(images_path / "UFO/ufo_normal.png");
-    ufo_ambient_texture = load_texture_2d(images_path / "UFO/ufo_ambient.png");
-    ufo_diffuse_texture = load_texture_2d(images_path / "UFO/ufo_diffuse.png");
-    ufo_specular_texture = load_texture_2d(images_path / "UFO/ufo_specular.png");
-
-    cow_normal_texture = load_texture_2d(images_path / "cow/cow_normal.png");
-    cow_ambient_texture = load_texture_2d(images_path / "cow/cow_ambient.jpeg");
-    cow_diffuse_texture = load_texture_2d(images_path / "cow/cow_diffuse.jpg");
-    cow_specular_texture = load_texture_2d(images_path / "cow/cow_specular.jpeg");
+    outside_texture = load_asset("mountains.png", TextureRole::COLOR_HIGH_QUALITY);
+
+    room_texture = load_asset("room.jpg");
+    room_texture_dark = load_asset("room_dark.jpg");
+
+    ufo_material.set_texture(0, load_color_with_mask("UFO/ufo_ambient.png", "UFO/ufo_diffuse.png"))
+        .set_texture(1, load_asset("UFO/ufo_specular.png"))
+        .set_normal_texture(load_asset("UFO/ufo_normal.png", TextureRole::NORMAL))
+        .set_ambient(0)
+        .set_diffuse(0, 3)
+        .set_specular(1);
+
+    cow_material.set_texture(0, load_asset("cow/cow_diffuse.jpg"))
+        .set_texture(1, load_masks("cow/cow_ambient.jpeg", "cow/cow_specular.jpeg"))
+        .set_normal_texture(load_asset("cow/cow_normal.png", TextureRole::NORMAL))
+        .set_ambient(1, 0)
+        .set_diffuse(0)
+        .set_specular(1, 1);
     
-    tree_texture = load_texture_2d(images_path / "tree.jpeg");
+    tree_texture = load_asset("tree.jpeg");
    
     // --------------------------------------------------------------------------
     // Initialize UBO Data
@@ -252,7 +285,7 @@ Application::Application(int initial_width, int initial_height, std::vector<std:
     camera_ubo.view = glm::lookAt(camera.get_eye_position(), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 
     // Stars lights
-    for (size_t i = 0; i < 195; i++) {
+    for (size_t i = 0; i < star_count; i++) {
         lights_night.push_back({
             glm::vec4(random_neg() * 300.0f, 10.0f + random() * 300.0f, random_neg() * 300.0f, 1.0f), // position
             glm::vec4(0.0f),                                                                      // ambient
@@ -707,6 +740,7 @@ Application::Application(int initial_width, int initial_height, std::vector<std:
                                 .diffuse_color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f),
                                 .specular_color = glm::vec4(0.0f)});
     }
+    object_lods.assign(objects_ubos.size(), 0);
     
 
     
@@ -715,13 +749,27 @@ Application::Application(int initial_width, int initial_height, std::vector<std:
 
    
 
+    // The stars are generated from the lights buffer by the vertex shader, so their VAO has no attributes.
+    glCreateVertexArrays(1, &stars_vao);
+    GLObjectTracker::on_create(GLObjectType::VERTEX_ARRAY, stars_vao);
+
     glCreateVertexArrays(1, &skyboxVAO);
     glCreateBuffers(1, &skyboxVBO);
     glNamedBufferStorage(skyboxVBO, sizeof(skyboxVertices), &skyboxVertices, NULL);
+    GLObjectTracker::on_create(GLObjectType::VERTEX_ARRAY, skyboxVAO);
+    GLObjectTracker::on_create(GLObjectType::BUFFER, skyboxVBO, sizeof(skyboxVertices));
     glVertexArrayVertexBuffer(skyboxVAO, 0, skyboxVBO, 0, 3*sizeof(float));
     glEnableVertexArrayAttrib(skyboxVAO, 0);
     glVertexArrayAttribFormat(skyboxVAO, 0, 3, GL_FLOAT, GL_FALSE, 0);
     glVertexArrayAttribBinding(skyboxVAO, 0, 0);
+
+    // Both skies are loaded once, the rendering only picks the current one.
+    skybox_day_texture = loadCubemap({images_path / "skybox/right_day.jpg", images_path / "skybox/left_day.jpg",
+                                      images_path / "skybox/top_day.jpg", images_path / "skybox/bottom_day.jpg",
+                                      images_path / "skybox/front_day.jpg", images_path / "skybox/back_day.jpg"});
+    skybox_night_texture = loadCubemap({images_path / "skybox/right_night.jpg", images_path / "skybox/left_night.jpg",
+                                        images_path / "skybox/top_night.jpg", images_path / "skybox/bottom_night.jpg",
+                                        images_path / "skybox/front_night.jpg", images_path / "skybox/back_night.jpg"});
     
 
 
@@ -730,26 +778,63 @@ Application::Application(int initial_width, int initial_height, std::vector<std:
     // --------------------------------------------------------------------------
     glCreateBuffers(1, &camera_buffer);
     glNamedBufferStorage(camera_buffer, sizeof(CameraUBO), &camera_ubo, GL_DYNAMIC_STORAGE_BIT);
+    GLObjectTracker::on_create(GLObjectType::BUFFER, camera_buffer, sizeof(CameraUBO));
 
     glCreateBuffers(1, &light_buffer);
     glNamedBufferStorage(light_buffer, sizeof(LightUBO), &light_ubo, GL_DYNAMIC_STORAGE_BIT);
+    GLObjectTracker::on_create(GLObjectType::BUFFER, light_buffer, sizeof(LightUBO));
 
+    ModelData::compute_normal_matrices(objects_ubos);
     glCreateBuffers(1, &objects_buffer);
-    glNamedBufferStorage(objects_buffer, sizeof(ObjectUBO) * objects_ubos.size(), objects_ubos.data(), GL_DYNAMIC_STORAGE_BIT);
+    glNamedBufferStorage(objects_buffer, sizeof(ModelData) * objects_ubos.size(), objects_ubos.data(), GL_DYNAMIC_STORAGE_BIT);
+    GLObjectTracker::on_create(GLObjectType::BUFFER, objects_buffer, sizeof(ModelData) * objects_ubos.size());
 
     glCreateBuffers(1, &lights_night_buffer);
     glCreateBuffers(1, &lights_day_buffer);
     glNamedBufferStorage(lights_night_buffer, 200*sizeof(LightUBO), lights_night.data(), GL_DYNAMIC_STORAGE_BIT);
     glNamedBufferStorage(lights_day_buffer, 3*sizeof(LightUBO), lights_day.data(), GL_DYNAMIC_STORAGE_BIT);
+    GLObjectTracker::on_create(GLObjectType::BUFFER, lights_night_buffer, 200 * sizeof(LightUBO));
+    GLObjectTracker::on_create(GLObjectType::BUFFER, lights_day_buffer, 3 * sizeof(LightUBO));
 
     glCreateBuffers(1, &cone_light_buffer);
     glNamedBufferStorage(cone_light_buffer, sizeof(ConeLightUBO), &cone_light_ubo, GL_DYNAMIC_STORAGE_BIT);
+    GLObjectTracker::on_create(GLObjectType::BUFFER, cone_light_buffer, sizeof(ConeLightUBO));
+
+    // --------------------------------------------------------------------------
+    // Shadows
+    // --------------------------------------------------------------------------
+    // The sun covers the room together with the cow, the UFO and the trees outside.
+    shadow_ubo.sun_matrix = CachedShadowMap::directional_matrix(glm::vec3(lights_day.back().position), glm::vec3(12.0f, 0.0f, 0.0f), 45.0f, 200.0f);
+    shadow_ubo.spot_matrix = CachedShadowMap::spot_matrix(glm::vec3(cone_light_ubo.position), cone_light_ubo.direction, cone_light_ubo.cutoff, 0.5f, 40.0f);
+    glCreateBuffers(1, &shadow_buffer);
+    glNamedBufferStorage(shadow_buffer, sizeof(ShadowUBO), &shadow_ubo, GL_DYNAMIC_STORAGE_BIT);
+    GLObjectTracker::on_create(GLObjectType::BUFFER, shadow_buffer, sizeof(ShadowUBO));
+
+    static_casters = {{mirror, 1},          {dresser, 2},           {bedside_table, 3},   {table_lamp, 4},
+                      {rug, 5},             {chair, 6},             {plant3, 7},          {plant_pot_inside, 8},
+                      {plant_pot_outside, 9}, {bed_frame, 10},      {bed_part1, 11},      {bed_part2, 12},
+                      {bed_wrap, 13},       {bed_pillow1, 14},      {bed_pillow2, 15},    {globe_stand, 16},
+                      {door_frame, 18},     {door_base, 19},        {door_handle, 20},    {plant_small_pot, 21},
+                      {plant_small_leaf, 22}, {lamp1, 23},          {lamp2, 24},          {lamp3, 25},
+                      {room, 26},           {room, 28},             {room, 30}};
+    for (GLuint i = 38; i <= 67; i++) {
+        static_casters.push_back({tree, i});
+    }
+    wall_casters = {{room, 27}, {room, 29}, {room, 31}, {room, 32}, {door_frame, 36}};
+    dynamic_casters = {{globe, 17}, {cow, 35}, {ufo, 34}};
+
+    apply_shadow_quality();
+
+    meshlet_culler = std::make_unique<MeshletCuller>(get_framework_shaders_path());
     
     glCreateFramebuffers(1,&framebuffer);
     glCreateTextures(GL_TEXTURE_2D, 1, &framebuffer_color);
     glTextureStorage2D(framebuffer_color, 1, GL_RGBA32F, width, height);
     glCreateTextures(GL_TEXTURE_2D, 1, &framebuffer_depth);
     glTextureStorage2D(framebuffer_depth, 1, GL_DEPTH_COMPONENT32F, width, height);
+    GLObjectTracker::on_create(GLObjectType::FRAMEBUFFER, framebuffer);
+    GLObjectTracker::on_create(GLObjectType::TEXTURE, framebuffer_color, GLObjectTracker::get_texture_size(GL_RGBA32F, width, height));
+    GLObjectTracker::on_create(GLObjectType::TEXTURE, framebuffer_depth, GLObjectTracker::get_texture_size(GL_DEPTH_COMPONENT32F, width, height));
     const GLenum draw_buffers[] = {GL_COLOR_ATTACHMENT0};
     glNamedFramebufferDrawBuffers(framebuffer, 1, draw_buffers);
     glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, framebuffer_color, 0);
@@ -760,24 +845,32 @@ Application::Application(int initial_width, int initial_height, std::vector<std:
 
 Application::~Application() {
     delete_shaders();
+    for (GLuint buffer : {skyboxVBO, camera_buffer, light_buffer, objects_buffer, lights_night_buffer, lights_day_buffer,
+                          cone_light_buffer, shadow_buffer}) {
+        GLObjectTracker::on_delete(GLObjectType::BUFFER, buffer);
+        glDeleteBuffers(1, &buffer);
+    }
+    for (GLuint texture : {skybox_day_texture, skybox_night_texture, framebuffer_color, framebuffer_depth}) {
+        GLObjectTracker::on_delete(GLObjectType::TEXTURE, texture);
+        glDeleteTextures(1, &texture);
+    }
+    GLObjectTracker::on_delete(GLObjectType::VERTEX_ARRAY, skyboxVAO);
     glDeleteVertexArrays (1, &skyboxVAO);
-    glDeleteBuffers(1, &camera_buffer);
-    glDeleteBuffers(1, &light_buffer);
-    glDeleteBuffers(1, &objects_buffer);
-    glDeleteBuffers(1, &lights_night_buffer);
-    glDeleteBuffers(1, &lights_day_buffer);
-    glDeleteBuffers(1, &cone_light_buffer);
-    
+    GLObjectTracker::on_delete(GLObjectType::VERTEX_ARRAY, stars_vao);
+    glDeleteVertexArrays(1, &stars_vao);
+    GLObjectTracker::on_delete(GLObjectType::FRAMEBUFFER, framebuffer);
     glDeleteFramebuffers(1, &framebuffer);
-    glDeleteTextures(1, &framebuffer_color);
-    glDeleteTextures(1, &framebuffer_depth);
 }
 
 void Application::delete_shaders() {
+    GLObjectTracker::on_delete(GLObjectType::PROGRAM, skybox_program);
+    GLObjectTracker::on_delete(GLObjectType::PROGRAM, postprocess_program);
     glDeleteProgram(skybox_program);
+    glDeleteProgram(postprocess_program);
   }
 
 void Application::compile_shaders() {
+    ProfileScope zone("compile_shaders");
     delete_shaders();
     main_program = ShaderProgram{shaders_path / "main.vert", shaders_path / "main.frag"};
     fog_program = ShaderProgram{shaders_path / "fog.vert", shaders_path / "fog.frag"};
@@ -785,25 +878,85 @@ void Application::compile_shaders() {
     mirror_program = ShaderProgram{shaders_path / "mirror.vert", shaders_path / "mirror.frag"};
     draw_light_program = ShaderProgram{shaders_path / "draw_light.vert", shaders_path / "draw_light.frag"};
     reflect_program = ShaderProgram{shaders_path / "reflect.vert", shaders_path / "reflect.frag"};
+    shadow_program = ShaderProgram{shaders_path / "shadow.vert", shaders_path / "shadow.frag"};
     skybox_program = create_program(shaders_path / "skybox.vert", shaders_path / "skybox.frag");
     postprocess_program = create_program(shaders_path / "postprocess.vert", shaders_path / "postprocess.frag");
+    GLObjectTracker::on_create(GLObjectType::PROGRAM, skybox_program);
+    GLObjectTracker::on_create(GLObjectType::PROGRAM, postprocess_program);
 
 }
 
 void Application::render() {
+    // Uploads the next levels of the streamed textures (up to the per-frame budget).
+    {
+        ProfileScope zone("texture streaming");
+        texture_streamer.update();
+    }
+
     // --------------------------------------------------------------------------
     // Update UBOs
     // --------------------------------------------------------------------------
-    // Camera
-    camera_ubo.position = glm::vec4(camera.get_eye_position(), 1.0f);
-    camera_ubo.view = glm::lookAt(camera.get_eye_position(), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    glNamedBufferSubData(camera_buffer, 0, sizeof(CameraUBO), &camera_ubo);
+    {
+        ProfileScope zone("UBO updates");
+        // Camera
+        camera_ubo.position = glm::vec4(camera.get_eye_position(), 1.0f);
+        camera_ubo.view = glm::lookAt(camera.get_eye_position(), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        glNamedBufferSubData(camera_buffer, 0, sizeof(CameraUBO), &camera_ubo);
+        FrameCounters::count_upload(sizeof(CameraUBO));
+
+        // Animated objects
+        time = glfwGetTime();
+        {
+            //globe
+            angle = int(time) % 360 * 2;
+            glm::mat4 transform = glm::mat4(1.0f);
+            transform = glm::scale(transform, glm::vec3(0.4f));
+            transform = glm::translate(transform, glm::vec3(-4.55f, 2.5f, 5.05f));
+            transform = glm::rotate(transform, glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f));
+            objects_ubos[17].set_model_matrix(transform);
+
+            //cow
+            float move = int(time) % 100;
+            angle = int(time) % 360 * 4;
+            transform = glm::mat4(1.0f);
+            transform = glm::translate(transform, glm::vec3(15.0f, 1.0+move/10, 0.0f));
+            transform = glm::scale(transform, glm::vec3(3.0f));
+            transform = glm::rotate(transform, glm::radians(angle), glm::vec3(1.0f, 0.0f, 0.0f));
+            transform = glm::rotate(transform, glm::radians(angle*0.5f), glm::vec3(0.0f, 1.0f, 0.0f));
+            objects_ubos[35].set_model_matrix(transform);
+        }
+
+        // Objects, the model-view-projection matrices are computed once per object so that shaders do not have to.
+        ModelData::compute_mvp_matrices(objects_ubos, camera_ubo.projection * camera_ubo.view);
+        glNamedBufferSubData(objects_buffer, 0, sizeof(ModelData) * objects_ubos.size(), objects_ubos.data());
+        FrameCounters::count_upload(sizeof(ModelData) * objects_ubos.size());
+        // The buffer is bound only once, every draw selects its object using the base instance.
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, objects_buffer);
+    }
+
+    // The dense meshes drawn in full detail are culled per meshlet, their coarser levels are drawn whole.
+    {
+        ProfileScope zone("meshlet culling");
+        meshlet_culler->begin(camera_ubo.projection * camera_ubo.view, glm::vec3(camera_ubo.position));
+        chair_batch = meshlet_culler->cull(*chair, 6, objects_ubos[6].model_matrix, select_lod(*chair, 6));
+        ufo_batch = meshlet_culler->cull(*ufo, 34, objects_ubos[34].model_matrix, select_lod(*ufo, 34));
+    }
+
+    // Shadows
+    render_shadows();
 
     // --------------------------------------------------------------------------
     // Draw scene
     // --------------------------------------------------------------------------
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
     glViewport(0, 0, (GLsizei)this->width, (GLsizei)this->height);
 
+    glBindBufferBase(GL_UNIFORM_BUFFER, 4, shadow_buffer);
+    if (sun_shadow && spot_shadow) {
+        sun_shadow->bind(7);
+        spot_shadow->bind(8);
+    }
+
     // Clear
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -821,60 +974,46 @@ void Application::render() {
 
 
     //skybox
-        
-    if (night)
-    {
-        faces =
-        {
-            images_path / "skybox/right_night.jpg",
-            images_path / "skybox/left_night.jpg",
-            images_path / "skybox/top_night.jpg",
-            images_path / "skybox/bottom_night.jpg",
-            images_path / "skybox/front_night.jpg",
-            images_path / "skybox/back_night.jpg",
-        };
-    }
-    else 
+    cubemapTexture = night ? skybox_night_texture : skybox_day_texture;
     {
-        faces=
-        {
-            images_path / "skybox/right_day.jpg",
-            images_path / "skybox/left_day.jpg",
-            images_path / "skybox/top_day.jpg",
-            images_path / "skybox/bottom_day.jpg",
-            images_path / "skybox/front_day.jpg",
-            images_path / "skybox/back_day.jpg",
-        };
-    }
-
-    unsigned int cubemapTexture = loadCubemap(faces);
-    glDepthFunc(GL_LEQUAL);
-    glUseProgram(skybox_program);
-    fog_program.uniform("toon_shading", toon_shading);
+        ProfileScope zone("skybox");
+        glDepthFunc(GL_LEQUAL);
+        glUseProgram(skybox_program);
+        FrameCounters::count_program(skybox_program);
+        fog_program.uniform("toon_shading", toon_shading);
     
-    int model_loc = glGetUniformLocation(skybox_program, "projection_matrix");
-    glUniformMatrix4fv(model_loc, 1, GL_FALSE, glm::value_ptr(glm::perspective(glm::radians(45.0f), float(width) / float(height), 0.1f, 100.0f)));
-    int view_loc = glGetUniformLocation(skybox_program, "view_matrix");
-    glUniformMatrix4fv(view_loc, 1, GL_FALSE, glm::value_ptr(glm::mat4(glm::mat3(camera_ubo.view))));
-    glBindVertexArray(skyboxVAO);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
-    glDepthFunc(GL_LESS);
+        int model_loc = glGetUniformLocation(skybox_program, "projection_matrix");
+        glUniformMatrix4fv(model_loc, 1, GL_FALSE, glm::value_ptr(glm::perspective(glm::radians(45.0f), float(width) / float(height), 0.1f, 100.0f)));
+        int view_loc = glGetUniformLocation(skybox_program, "view_matrix");
+        glUniformMatrix4fv(view_loc, 1, GL_FALSE, glm::value_ptr(glm::mat4(glm::mat3(camera_ubo.view))));
+        glBindVertexArray(skyboxVAO);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+        FrameCounters::count_texture_binds();
+        FrameCounters::count_draw(GL_TRIANGLES, 36);
+        glBindVertexArray(0);
+        glDepthFunc(GL_LESS);
+    }
 
     // Draw objects
 
 
     //stars
-    if (night) {
-        lights_buffer = &lights_night_buffer;
-        Sphere sphere;
-        draw_light_program.use();
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, lights_night_buffer);
-        sphere.bind_vao();
-        glDrawElementsInstanced(sphere.mode, sphere.draw_elements_count, GL_UNSIGNED_INT , NULL , 195);
-    } else {
-        lights_buffer = &lights_day_buffer;
+    {
+        ProfileScope zone("stars");
+        if (night) {
+            lights_buffer = &lights_night_buffer;
+            // Every star is a camera-facing quad of two triangles read from the lights buffer.
+            draw_light_program.use();
+            draw_light_program.uniform("viewport_height", static_cast<float>(height));
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, lights_night_buffer);
+            glBindVertexArray(stars_vao);
+            glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(6 * star_count));
+            FrameCounters::count_draw(GL_TRIANGLES, static_cast<GLsizei>(6 * star_count));
+            glBindVertexArray(0);
+        } else {
+            lights_buffer = &lights_day_buffer;
+        }
     }
     
 
@@ -891,431 +1030,323 @@ void Application::render() {
     
     //outside
     {
+    ProfileScope zone("outside");
     fog_program.use();
     //main_program.use();
     glBindBufferBase(GL_UNIFORM_BUFFER, 0, camera_buffer);
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, *lights_buffer);
     fog_program.uniform("toon_shading", toon_shading);
-    glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer,  0 * 256, sizeof(ObjectUBO));
     glBindBufferBase(GL_UNIFORM_BUFFER, 3, cone_light_buffer);
 
     fog_program.uniform("night", night);
-    glBindTextureUnit(3, outside_texture);
-    outside->draw();
+    bind_texture(*outside_texture, 3, 0);
+    outside->draw_base_instance(0);
     }
 
 
-    main_program.use();
+    {
+        ProfileScope zone("main objects");
+        main_program.use();
 
-    glBindBufferBase(GL_UNIFORM_BUFFER, 0, camera_buffer);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, *lights_buffer);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 3, cone_light_buffer);
-    main_program.uniform("blend", false);
-    main_program.uniform("toon_shading", toon_shading);
+        glBindBufferBase(GL_UNIFORM_BUFFER, 0, camera_buffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, *lights_buffer);
+        glBindBufferBase(GL_UNIFORM_BUFFER, 3, cone_light_buffer);
+        main_program.uniform("blend", false);
+        main_program.uniform("toon_shading", toon_shading);
 
-    //dresser
-    {
-    glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 2 * 256, sizeof(ObjectUBO));
+        //dresser
+        {
 
-    main_program.uniform("has_texture", true);
-    glBindTextureUnit(3, wood);
-    dresser->draw();
-    }
+        main_program.uniform("has_texture", true);
+        bind_texture(*wood, 3, 2);
+        dresser->draw_base_instance(2);
+        }
 
-    //bedside table
-    {
-    glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 3 * 256, sizeof(ObjectUBO));
+        //bedside table
+        {
 
-    main_program.uniform("has_texture", true);
-    glBindTextureUnit(3, wood);
-    bedside_table->draw();
-    }
+        main_program.uniform("has_texture", true);
+        bind_texture(*wood, 3, 3);
+        bedside_table->draw_base_instance(3);
+        }
     
     
-    //rug1
-    {
-        glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 5 * 256, sizeof(ObjectUBO));
+        //rug1
+        {
 
-        main_program.uniform("has_texture", true);
-        glBindTextureUnit(3, rug_texture);
-        rug->draw();
-    }
+            main_program.uniform("has_texture", true);
+            bind_texture(*rug_texture, 3, 5);
+            rug->draw_base_instance(5);
+        }
 
-    //plant3
-    {
         //plant3
-        glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 7 * 256, sizeof(ObjectUBO));
-
-        main_program.uniform("has_texture", true);
-        glBindTextureUnit(3, plant3_texture);
-        plant3->draw();
-
-        //plant pot inside
-        glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 8 * 256, sizeof(ObjectUBO));
+        {
+            //plant3
 
-        main_program.uniform("has_texture", true);
-        glBindTextureUnit(3, plant_pot_inside_texture);
-        plant_pot_inside->draw();
+            main_program.uniform("has_texture", true);
+            bind_texture(*plant3_texture, 3, 7);
+            plant3->draw_base_instance(7);
 
-        //plant pot outside
-        glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 9 * 256, sizeof(ObjectUBO));
-        main_program.uniform("has_texture", true);
-        glBindTextureUnit(3, plant_pot_outside_texture);
-        plant_pot_outside->draw();
-    }
+            //plant pot inside
 
-    //bed
-    {
-        //bed frame
-        glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 10 * 256, sizeof(ObjectUBO));
-        main_program.uniform("has_texture", true);
-        glBindTextureUnit(3, wood);
-        bed_frame->draw();
+            main_program.uniform("has_texture", true);
+            bind_texture(*plant_pot_inside_texture, 3, 8);
+            plant_pot_inside->draw_base_instance(8);
 
-        //bed part 1
-        glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 11 * 256, sizeof(ObjectUBO));
-        main_program.uniform("has_texture", true);
-        glBindTextureUnit(3, white_bed_texture);
-        bed_part1->draw();
+            //plant pot outside
+            main_program.uniform("has_texture", true);
+            bind_texture(*plant_pot_outside_texture, 3, 9);
+            plant_pot_outside->draw_base_instance(9);
+        }
 
-        //bed part 2
-        glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 12 * 256, sizeof(ObjectUBO));
-        main_program.uniform("has_texture", true);
-        glBindTextureUnit(3, blue_bed_texture);
-        bed_part2->draw();
+        //bed
+        {
+            //bed frame
+            main_program.uniform("has_texture", true);
+            bind_texture(*wood, 3, 10);
+            bed_frame->draw_base_instance(10);
 
-        //bed wrap
-        glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 13 * 256, sizeof(ObjectUBO));
-        main_program.uniform("has_texture", true);
-        glBindTextureUnit(3, yellow_bed_texture);
-        bed_wrap->draw();
+            //bed part 1
+            main_program.uniform("has_texture", true);
+            bind_texture(*white_bed_texture, 3, 11);
+            bed_part1->draw_base_instance(11);
 
+            //bed part 2
+            main_program.uniform("has_texture", true);
+            bind_texture(*blue_bed_texture, 3, 12);
+            bed_part2->draw_base_instance(12);
 
-        //bed pillow1
-        glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 14 * 256, sizeof(ObjectUBO));
-        main_program.uniform("has_texture", true);
-        glBindTextureUnit(3, white_bed_texture);
-        bed_pillow1->draw();
+            //bed wrap
+            main_program.uniform("has_texture", true);
+            bind_texture(*yellow_bed_texture, 3, 13);
+            bed_wrap->draw_base_instance(13);
 
-        //bed pillow2
-        glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 15 * 256, sizeof(ObjectUBO));
-        main_program.uniform("has_texture", true);
-        glBindTextureUnit(3, yellow_bed_texture);
-        bed_pillow2->draw();
-    }
 
-    //globe
-    {
-        glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 16 * 256, sizeof(ObjectUBO));
-        main_program.uniform("has_texture", true);
-        glBindTextureUnit(3, dark_wood_texture);
-        globe_stand->draw();
+            //bed pillow1
+            main_program.uniform("has_texture", true);
+            bind_texture(*white_bed_texture, 3, 14);
+            bed_pillow1->draw_base_instance(14);
 
+            //bed pillow2
+            main_program.uniform("has_texture", true);
+            bind_texture(*yellow_bed_texture, 3, 15);
+            bed_pillow2->draw_base_instance(15);
+        }
 
-        glBindBufferBase(GL_UNIFORM_BUFFER, 0, camera_buffer);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, *lights_buffer);
-        textured_program.uniform("toon_shading", toon_shading);
+        //globe
+        {
+            main_program.uniform("has_texture", true);
+            bind_texture(*dark_wood_texture, 3, 16);
+            globe_stand->draw_base_instance(16);
 
 
-        time = glfwGetTime();
-        glm::mat4 transform = glm::mat4(1.0f);
-        angle = int(time) % 360 * 2;
+            glBindBufferBase(GL_UNIFORM_BUFFER, 0, camera_buffer);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, *lights_buffer);
+            textured_program.uniform("toon_shading", toon_shading);
 
-        ObjectUBO globe_obj;
-        GLuint globe_buffer = 0;
-        transform = glm::mat4(1.0f);
-        transform = glm::scale(transform, glm::vec3(0.4f));
-        transform = glm::translate(transform, glm::vec3(-4.55f, 2.5f, 5.05f));
-        transform = glm::rotate(transform, glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f));
-
-        globe_obj.model_matrix = transform;
-        globe_obj.ambient_color = glm::vec4(0.0f);
-        globe_obj.diffuse_color = glm::vec4(1.0f);
-        globe_obj.specular_color = glm::vec4(0.0f);
-        
-        glCreateBuffers(1, &globe_buffer);
-        glNamedBufferStorage(globe_buffer, sizeof(ObjectUBO), &globe_obj, GL_DYNAMIC_STORAGE_BIT);
+            main_program.uniform("has_texture", true);
+            bind_texture(night ? *globe_night_texture : *globe_day_texture, 3, 17);
+            globe->draw_base_instance(17);
 
-        glBindBufferBase(GL_UNIFORM_BUFFER, 2, globe_buffer);
-        main_program.uniform("has_texture", true);
-        glBindTextureUnit(3, globe_day_texture);
-        if (night) {
-            glBindTextureUnit(3, globe_night_texture);
         }
-        globe->draw();
 
-    }
-
-    //door
-    {
-        glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 18 * 256, sizeof(ObjectUBO));
-        main_program.uniform("has_texture", true);
-        glBindTextureUnit(3, door_frame_texture);
-        door_frame->draw();
+        //door
+        {
+            main_program.uniform("has_texture", true);
+            bind_texture(*door_frame_texture, 3, 18);
+            door_frame->draw_base_instance(18);
         
-        glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 19 * 256, sizeof(ObjectUBO));
-        main_program.uniform("has_texture", true);
-        glBindTextureUnit(3, door_base_texture);
-        door_base->draw();
+            main_program.uniform("has_texture", true);
+            bind_texture(*door_base_texture, 3, 19);
+            door_base->draw_base_instance(19);
         
-        glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 20 * 256, sizeof(ObjectUBO));
-        main_program.uniform("has_texture", false);
-        door_handle->draw();
-    }
+            main_program.uniform("has_texture", false);
+            door_handle->draw_base_instance(20);
+        }
 
 
-    //lamp1
-    glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 23 * 256, sizeof(ObjectUBO));
-    main_program.uniform("has_texture", false);
-    lamp1->draw();
+        //lamp1
+        main_program.uniform("has_texture", false);
+        lamp1->draw_base_instance(23);
 
-    //lamp2
-    glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 24 * 256, sizeof(ObjectUBO));
-    main_program.uniform("has_texture", false);
-    lamp2->draw();
+        //lamp2
+        main_program.uniform("has_texture", false);
+        lamp2->draw_base_instance(24);
 
     
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    //mirror frame
-    {
-        glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 1 * 256, sizeof(ObjectUBO));
-        main_program.uniform("has_texture", true);
-        glBindTextureUnit(3, dark_wood_texture);
-        mirror->draw();
-    }
-
-    //room
-    {
-
-        glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 26 * 256, sizeof(ObjectUBO));
-        main_program.uniform("has_texture", true);
-        glBindTextureUnit(3, room_bot_texture);
-        room->draw();
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        //mirror frame
+        {
+            main_program.uniform("has_texture", true);
+            bind_texture(*dark_wood_texture, 3, 1);
+            mirror->draw_base_instance(1);
+        }
 
-        glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 28 * 256, sizeof(ObjectUBO));
-        main_program.uniform("has_texture", true);
-        glBindTextureUnit(3, room_texture);
-        room->draw();
+        //room
+        {
 
-    
-        if (!walls_off) {
-            glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 27 * 256, sizeof(ObjectUBO));
             main_program.uniform("has_texture", true);
-            glBindTextureUnit(3, room_texture_dark);
-            room->draw();
+            bind_texture(*room_bot_texture, 3, 26);
+            room->draw_base_instance(26);
 
-            glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 29 * 256, sizeof(ObjectUBO));
             main_program.uniform("has_texture", true);
-            glBindTextureUnit(3, room_texture);
-            room->draw();
+            bind_texture(*room_texture, 3, 28);
+            room->draw_base_instance(28);
+
+    
+            if (!walls_off) {
+                main_program.uniform("has_texture", true);
+                bind_texture(*room_texture_dark, 3, 27);
+                room->draw_base_instance(27);
+
+                main_program.uniform("has_texture", true);
+                bind_texture(*room_texture, 3, 29);
+                room->draw_base_instance(29);
             
-            glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 31 * 256, sizeof(ObjectUBO));
-            main_program.uniform("has_texture", true);
-            glBindTextureUnit(3, room_texture);
-            room->draw();
+                main_program.uniform("has_texture", true);
+                bind_texture(*room_texture, 3, 31);
+                room->draw_base_instance(31);
 
-            glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 32 * 256, sizeof(ObjectUBO));
-            main_program.uniform("has_texture", true);
-            glBindTextureUnit(3, room_texture);
-            room->draw();
+                main_program.uniform("has_texture", true);
+                bind_texture(*room_texture, 3, 32);
+                room->draw_base_instance(32);
 
-            //window frame
-            glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 36 * 256, sizeof(ObjectUBO));
-            main_program.uniform("has_texture", true);
-            glBindTextureUnit(3, door_frame_texture);
-            door_frame->draw();
-        }
+                //window frame
+                main_program.uniform("has_texture", true);
+                bind_texture(*door_frame_texture, 3, 36);
+                door_frame->draw_base_instance(36);
+            }
 
-        glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 30 * 256, sizeof(ObjectUBO));
-        main_program.uniform("has_texture", true);
-        glBindTextureUnit(3, room_texture);
-        room->draw();
+            main_program.uniform("has_texture", true);
+            bind_texture(*room_texture, 3, 30);
+            room->draw_base_instance(30);
         
-    }
+        }
 
      
-    for (int i = 0; i <= 29; i++)
-    {
-        glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, (38+i) * 256, sizeof(ObjectUBO));
-        main_program.uniform("has_texture", true);
-        glBindTextureUnit(3, tree_texture);
-        tree->draw();
-    }
-    
-    //textured program
-    textured_program.use();
-    glBindBufferBase(GL_UNIFORM_BUFFER, 0, camera_buffer);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, *lights_buffer);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 3, cone_light_buffer);
-    textured_program.uniform("toon_shading", toon_shading);
-
-    //lamp
-    glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 4 * 256, sizeof(ObjectUBO));
-    textured_program.uniform("has_3texture", true);
-    textured_program.uniform("has_4texture", true);
-    textured_program.uniform("has_5texture", true);
-    textured_program.uniform("has_6texture", true);
-    glBindTextureUnit(4, table_lamp_ambient_texture);
-    glBindTextureUnit(3, table_lamp_diffuse_texture);
-    glBindTextureUnit(5, table_lamp_specular_texture);
-    glBindTextureUnit(6, table_lamp_normal_texture);
-    
-    table_lamp->draw();
-
-    //lamp3
-    glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 25 * 256, sizeof(ObjectUBO));
-    textured_program.uniform("has_3texture", true);
-    textured_program.uniform("has_4texture", true);
-    textured_program.uniform("has_5texture", false);
-    textured_program.uniform("has_6texture", false);
-    glBindTextureUnit(3, lamp7_ambient_texture);
-    glBindTextureUnit(4, lamp7_diffuse_texture);
-    lamp3->draw();
-
-    //plant small
-    {
-        glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 21 * 256, sizeof(ObjectUBO));
-        textured_program.uniform("has_3texture", true);
-        textured_program.uniform("has_4texture", true);
-        textured_program.uniform("has_5texture", true);
-        textured_program.uniform("has_6texture", true);
-        glBindTextureUnit(3, small_plant_pot_ambient_texture);
-        glBindTextureUnit(4, small_plant_pot_diffuse_texture);
-        glBindTextureUnit(5, small_plant_pot_specular_texture);
-        glBindTextureUnit(6, small_plant_pot_normal_texture);
-        plant_small_pot->draw();
-
-        glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 22 * 256, sizeof(ObjectUBO));
-        textured_program.uniform("has_3texture", true);
-        textured_program.uniform("has_4texture", true);
-        textured_program.uniform("has_5texture", true);
-        textured_program.uniform("has_6texture", true);
-        glBindTextureUnit(3, small_plant_leaf_ambient_texture);
-        glBindTextureUnit(4, small_plant_leaf_diffuse_texture);
-        glBindTextureUnit(5, small_plant_leaf_specular_texture);
-        glBindTextureUnit(6, small_plant_leaf_normal_texture);
-        plant_small_leaf->draw();  
+        for (int i = 0; i <= 29; i++)
+        {
+            main_program.uniform("has_texture", true);
+            bind_texture(*tree_texture, 3, 38 + i);
+            tree->draw_base_instance(38+i, select_lod(*tree, 38+i));
+        }
     }
-    //chair
     
-    glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 6 * 256, sizeof(ObjectUBO));
-
-    textured_program.uniform("has_3texture", true);
-    textured_program.uniform("has_4texture", true);
-    textured_program.uniform("has_5texture", true);
-    textured_program.uniform("has_6texture", false);
-    glBindTextureUnit(3, chair_ambient_texture);
-    glBindTextureUnit(4, yellow_bed_texture);
-    glBindTextureUnit(5, chair_specular_texture);
-    chair->draw();
-
-    if (night || !night)
     {
+        ProfileScope zone("textured objects");
+        //textured program
         textured_program.use();
         glBindBufferBase(GL_UNIFORM_BUFFER, 0, camera_buffer);
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, *lights_buffer);
+        glBindBufferBase(GL_UNIFORM_BUFFER, 3, cone_light_buffer);
         textured_program.uniform("toon_shading", toon_shading);
 
-        //UFO
-        if (camouflage)
-        {   
-            reflect_program.use();
-            glBindBufferBase(GL_UNIFORM_BUFFER, 0, camera_buffer);
-            glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 34 * 256, sizeof(ObjectUBO));
-            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);  	
-            ufo->draw();
+        //lamp
+        bind_material(table_lamp_material, 4);
+    
+        table_lamp->draw_base_instance(4);
+
+        //lamp3
+        bind_material(lamp7_material, 25);
+        lamp3->draw_base_instance(25, select_lod(*lamp3, 25));
+
+        //plant small
+        {
+            bind_material(small_plant_pot_material, 21);
+            plant_small_pot->draw_base_instance(21);
+
+            bind_material(small_plant_leaf_material, 22);
+            plant_small_leaf->draw_base_instance(22);  
+        }
+        //chair
+    
+
+        bind_material(chair_material, 6);
+        meshlet_culler->draw(*chair, chair_batch);
+
+        if (night || !night)
+        {
             textured_program.use();
             glBindBufferBase(GL_UNIFORM_BUFFER, 0, camera_buffer);
             glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, *lights_buffer);
             textured_program.uniform("toon_shading", toon_shading);
-        }
-        else
-        {
-            glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 34 * 256, sizeof(ObjectUBO));
-            textured_program.uniform("has_3texture", true);
-            textured_program.uniform("has_4texture", true);
-            textured_program.uniform("has_5texture", true);
-            textured_program.uniform("has_6texture", true);
-            glBindTextureUnit(3, ufo_ambient_texture);
-            glBindTextureUnit(4, ufo_diffuse_texture);
-            glBindTextureUnit(5, ufo_specular_texture);
-            glBindTextureUnit(6, ufo_normal_texture);
-            ufo->draw();
-        }
-
-        //cow
-        glBindBufferBase(GL_UNIFORM_BUFFER, 0, camera_buffer);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, *lights_buffer);
-        textured_program.uniform("toon_shading", toon_shading);
 
-        time = glfwGetTime();
-        glm::mat4 transform = glm::mat4(1.0f);
-        float move = int(time) % 100;
-        angle = int(time) % 360 * 4;
+            //UFO
+            if (camouflage)
+            {   
+                reflect_program.use();
+                glBindBufferBase(GL_UNIFORM_BUFFER, 0, camera_buffer);
+                glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);  	
+                FrameCounters::count_texture_binds();
+                meshlet_culler->draw(*ufo, ufo_batch);
+                textured_program.use();
+                glBindBufferBase(GL_UNIFORM_BUFFER, 0, camera_buffer);
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, *lights_buffer);
+                textured_program.uniform("toon_shading", toon_shading);
+            }
+            else
+            {
+                bind_material(ufo_material, 34);
+                meshlet_culler->draw(*ufo, ufo_batch);
+            }
+
+            //cow
+            glBindBufferBase(GL_UNIFORM_BUFFER, 0, camera_buffer);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, *lights_buffer);
+            textured_program.uniform("toon_shading", toon_shading);
 
-        ObjectUBO cow_obj;
-        GLuint cow_buffer = 0;
-        transform = glm::mat4(1.0f);
-        transform = glm::translate(transform, glm::vec3(15.0f, 1.0+move/10, 0.0f));
-        transform = glm::scale(transform, glm::vec3(3.0f));
-        transform = glm::rotate(transform, glm::radians(angle), glm::vec3(1.0f, 0.0f, 0.0f));
-        transform = glm::rotate(transform, glm::radians(angle*0.5f), glm::vec3(0.0f, 1.0f, 0.0f));
-        cow_obj.model_matrix = transform;
-        cow_obj.ambient_color = glm::vec4(0.0f);
-        cow_obj.diffuse_color = glm::vec4(1.0f);
-        cow_obj.specular_color = glm::vec4(0.0f);
-        
-        glCreateBuffers(1, &cow_buffer);
-        glNamedBufferStorage(cow_buffer, sizeof(ObjectUBO), &cow_obj, GL_DYNAMIC_STORAGE_BIT);
-
-        glBindBufferBase(GL_UNIFORM_BUFFER, 2, cow_buffer);
-        textured_program.uniform("has_3texture", true);
-        textured_program.uniform("has_4texture", true);
-        textured_program.uniform("has_5texture", true);
-        textured_program.uniform("has_6texture", true);
-        glBindTextureUnit(3, cow_ambient_texture);
-        glBindTextureUnit(4, cow_diffuse_texture);
-        glBindTextureUnit(5, cow_specular_texture);
-        glBindTextureUnit(6, cow_normal_texture);
+            bind_material(cow_material, 35);
         
-        cow->draw();
+            cow->draw_base_instance(35, select_lod(*cow, 35));
+        }
     }
 
 
-    main_program.use();
-    
-    //glass window
-    if (!walls_off)
     {
+        ProfileScope zone("transparent objects");
+        main_program.use();
+    
+        //glass window
+        if (!walls_off)
+        {
+            main_program.uniform("toon_shading", toon_shading);
+            glBindBufferBase(GL_UNIFORM_BUFFER, 0, camera_buffer);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, *lights_buffer);
+            glBindBufferBase(GL_UNIFORM_BUFFER, 3, cone_light_buffer);
+            main_program.uniform("has_texture", false);
+            main_program.uniform("blend", true);
+            room->draw_base_instance(33);
+        }
+
+        //cone
         main_program.uniform("toon_shading", toon_shading);
         glBindBufferBase(GL_UNIFORM_BUFFER, 0, camera_buffer);
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, *lights_buffer);
         glBindBufferBase(GL_UNIFORM_BUFFER, 3, cone_light_buffer);
-        glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 33 * 256, sizeof(ObjectUBO));
         main_program.uniform("has_texture", false);
         main_program.uniform("blend", true);
-        room->draw();
+        cone->draw_base_instance(37);
     }
 
-    //cone
-    main_program.uniform("toon_shading", toon_shading);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 0, camera_buffer);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, *lights_buffer);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 3, cone_light_buffer);
-    glBindBufferRange(GL_UNIFORM_BUFFER, 2, objects_buffer, 37 * 256, sizeof(ObjectUBO));
-    main_program.uniform("has_texture", false);
-    main_program.uniform("blend", true);
-    cone->draw();
-
     if (toon_shading && edge_detection)
     {
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
         glClear(GL_COLOR_BUFFER_BIT);
+        ProfileScope zone("postprocess");
         glDisable(GL_DEPTH_TEST);
         glUseProgram(postprocess_program);
         glBindTextureUnit(0,framebuffer_color);
         glDrawArrays( GL_TRIANGLES, 0, 3);
+        FrameCounters::count_program(postprocess_program);
+        FrameCounters::count_texture_binds();
+        FrameCounters::count_draw(GL_TRIANGLES, 3);
+    }
+
+    // All textures drawn in this frame were requested, so the budget evaluates complete frames.
+    {
+        ProfileScope zone("texture budget");
+        texture_budget.update(assets);
     }
 
 
@@ -1334,7 +1365,136 @@ void Application::render() {
 
 }
 
-void Application::render_ui() { const float unit = ImGui::GetFontSize(); }
+void Application::render_shadows() {
+    ProfileScope zone("shadows");
+    // The shader needs to know which of the lights is the sun, the sun is always the last light.
+    shadow_ubo.parameters.w = float((night ? lights_night.size() : lights_day.size()) - 1);
+    glNamedBufferSubData(shadow_buffer, 0, sizeof(ShadowUBO), &shadow_ubo);
+    FrameCounters::count_upload(sizeof(ShadowUBO));
+
+    if (!sun_shadow || !spot_shadow) {
+        return;
+    }
+
+    // The moving casters use the levels of detail selected for the camera in the last frame, the cached static layers
+    // are rendered in full detail since they are reused regardless of the camera position.
+    auto draw_casters = [&](const std::vector<ShadowCaster>& casters, GLuint skip_index, bool use_lods) {
+        for (const ShadowCaster& caster : casters) {
+            if (caster.object_index == skip_index) {
+                continue;
+            }
+            caster.geometry->draw_base_instance(caster.object_index, use_lods ? object_lods[caster.object_index] : 0);
+        }
+    };
+    auto draw_static = [&]() {
+        draw_casters(static_casters, GL_INVALID_INDEX, false);
+        if (!walls_off) {
+            draw_casters(wall_casters, GL_INVALID_INDEX, false);
+        }
+    };
+
+    // Many meshes are not closed, so both sides have to be rendered into the shadow maps.
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_BLEND);
+    shadow_program.use();
+
+    shadow_program.uniform_matrix(0, sun_shadow->get_light_matrix());
+    sun_shadow->update(draw_static, [&]() { draw_casters(dynamic_casters, GL_INVALID_INDEX, true); });
+
+    // The cone light is placed inside the UFO, which therefore cannot cast a shadow from it.
+    shadow_program.uniform_matrix(0, spot_shadow->get_light_matrix());
+    spot_shadow->update(draw_static, [&]() { draw_casters(dynamic_casters, 34, true); });
+}
+
+int Application::select_lod(const Geometry& geometry, GLuint object_index) {
+    object_lods[object_index] = lod_selector.select(geometry.lods, object_lods[object_index], pixels_per_unit(object_index));
+    return object_lods[object_index];
+}
+
+float Application::pixels_per_unit(GLuint object_index) const {
+    // The meshes loaded from files fit into a unit box centered at the origin.
+    const float radius = 0.5f * std::sqrt(3.0f);
+    return LodSelector::pixels_per_unit(objects_ubos[object_index].model_matrix, radius, camera_ubo.position, camera_ubo.projection,
+                                        float(height));
+}
+
+void Application::bind_texture(const TextureAsset& texture, GLuint unit, GLuint object_index) {
+    // The object covers about the projected diameter of its bounding sphere.
+    texture_budget.request(texture, pixels_per_unit(object_index) * std::sqrt(3.0f));
+    texture.bind(unit);
+}
+
+void Application::bind_material(const TexturedMaterial& material, GLuint object_index) {
+    texture_budget.request(material, pixels_per_unit(object_index) * std::sqrt(3.0f));
+    material.bind(textured_program);
+}
+
+void Application::apply_shadow_quality() {
+    if (shadow_quality == ShadowQuality::OFF) {
+        sun_shadow.reset();
+        spot_shadow.reset();
+        shadow_ubo.parameters = glm::vec4(0.0f);
+        return;
+    }
+
+    const int sun_resolution = CachedShadowMap::resolution_for(shadow_quality, 2048);
+    const int spot_resolution = CachedShadowMap::resolution_for(shadow_quality, 512);
+    if (!sun_shadow || !spot_shadow) {
+        sun_shadow = std::make_unique<CachedShadowMap>(sun_resolution);
+        spot_shadow = std::make_unique<CachedShadowMap>(spot_resolution);
+    }
+    sun_shadow->resize(sun_resolution);
+    spot_shadow->resize(spot_resolution);
+    sun_shadow->set_light_matrix(shadow_ubo.sun_matrix);
+    spot_shadow->set_light_matrix(shadow_ubo.spot_matrix);
+
+    shadow_ubo.parameters.x = 0.0005f;
+    shadow_ubo.parameters.y = float(int(shadow_quality) - 1);
+    shadow_ubo.parameters.z = 1.0f;
+}
+
+void Application::render_ui() {
+    const float unit = ImGui::GetFontSize();
+
+    ImGui::Begin("Settings", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+    const char* shadow_qualities[] = {"Off", "Low", "Medium", "High"};
+    int quality = int(shadow_quality);
+    if (ImGui::Combo("Shadows", &quality, shadow_qualities, IM_ARRAYSIZE(shadow_qualities))) {
+        shadow_quality = ShadowQuality(quality);
+        apply_shadow_quality();
+    }
+    ImGui::SliderFloat("LOD error (px)", &lod_selector.threshold, 0.25f, 8.0f);
+    if (ImGui::TreeNode("assets", "Assets (%.1f MB)", assets.get_memory_size() / (1024.0f * 1024.0f))) {
+        for (const AssetRegistry::AssetUsage& asset : assets.get_memory_report()) {
+            ImGui::Text("%8.2f MB  %ldx  %s", asset.memory_size / (1024.0f * 1024.0f), asset.users,
+                        std::filesystem::path(asset.path).filename().generic_string().c_str());
+        }
+        ImGui::TreePop();
+    }
+    if (ImGui::TreeNode("vertex_cache", "Vertex cache (ACMR)")) {
+        for (const auto& [name, geometry] : {std::pair{"chair", chair}, std::pair{"UFO", ufo}}) {
+            const std::span<const Geometry::VertexCacheReport> reports = geometry->get_vertex_cache_reports();
+            for (size_t lod = 0; lod < reports.size(); lod++) {
+                ImGui::Text("%s LOD %zu: %.3f -> %.3f", name, lod, reports[lod].before.acmr, reports[lod].after.acmr);
+            }
+        }
+        ImGui::TreePop();
+    }
+    int budget = static_cast<int>(texture_budget.budget >> 20);
+    if (ImGui::SliderInt("Texture budget (MB)", &budget, 16, 1024)) {
+        texture_budget.budget = static_cast<size_t>(budget) << 20;
+    }
+    ImGui::Text("Textures: %.1f MB, %zu clamped", texture_budget.get_resident_size() / (1024.0f * 1024.0f),
+                texture_budget.get_clamped_count());
+    if (texture_streamer.get_pending_count() > 0) {
+        ImGui::Text("Streaming %zu textures (%.2f MB this frame)", texture_streamer.get_pending_count(),
+                    texture_streamer.get_last_upload_size() / (1024.0f * 1024.0f));
+    }
+    ImGui::End();
+
+    FrameCounters::render_ui();
+    GLObjectTracker::render_ui();
+}
 
 void Application::on_resize(int width, int height) {
     this->width = width;
@@ -1353,6 +1513,11 @@ void Application::on_key_pressed(int key, int scancode, int action, int mods) {
     
     if (key == GLFW_KEY_W && action == GLFW_PRESS)  {
         walls_off = !walls_off;
+        // The walls are part of the cached static layers.
+        if (sun_shadow && spot_shadow) {
+            sun_shadow->invalidate();
+            spot_shadow->invalidate();
+        }
     }
     
     if (key == GLFW_KEY_T && action == GLFW_PRESS)  {
@@ -1,10 +1,17 @@
 #pragma once
 
+#include "asset_registry.hpp"
+#include "cached_shadow_map.hpp"
 #include "camera.hpp"
 #include "cube.hpp"
+#include "lod_selector.hpp"
+#include "meshlet_culler.hpp"
+#include "model_ubo.hpp"
 #include "pv112_application.hpp"
 #include "sphere.hpp"
 #include "teapot.hpp"
+#include "texture_budget.hpp"
+#include "textured_material.hpp"
 
 
 // ----------------------------------------------------------------------------
@@ -32,13 +39,17 @@ struct ConeLightUBO {
     float cutoff;
 };
 
-struct alignas(256) ObjectUBO {
-    glm::mat4 model_matrix;  // [  0 -  64) bytes
-    glm::vec4 ambient_color; // [ 64 -  80) bytes
-    glm::vec4 diffuse_color; // [ 80 -  96) bytes
+struct ShadowUBO {
+    glm::mat4 sun_matrix;
+    glm::mat4 spot_matrix;
+    // x = depth bias, y = PCF radius in texels, z = 1.0 if shadows are enabled, w = index of the sun in the lights
+    glm::vec4 parameters;
+};
 
-    // Contains shininess in .w element
-    glm::vec4 specular_color; // [ 96 - 112) bytes
+/** The shadow caster, i.e., a geometry together with the index of its object in the objects buffer. */
+struct ShadowCaster {
+    std::shared_ptr<Geometry> geometry;
+    GLuint object_index;
 };
 
 // Constants
@@ -76,6 +87,44 @@ class Application : public PV112Application {
     /** @copydoc PV112Application::on_key_pressed */
     void on_key_pressed(int key, int scancode, int action, int mods) override;
 
+    /** Updates the sun and cone light shadow maps. Only the moving casters are rendered unless the static layer is outdated. */
+    void render_shadows();
+
+    /** Re-creates the shadow maps for the current @link shadow_quality and invalidates their static layers. */
+    void apply_shadow_quality();
+
+    /**
+     * Selects the level of detail of an object for the current camera and remembers it for the next frame.
+     *
+     * @param 	geometry	The geometry of the object.
+     * @param 	object_index	The index of the object in the objects buffer.
+     */
+    int select_lod(const Geometry& geometry, GLuint object_index);
+
+    /**
+     * Computes the size in pixels of one object space unit of an object for the current camera.
+     *
+     * @param 	object_index	The index of the object in the objects buffer.
+     */
+    float pixels_per_unit(GLuint object_index) const;
+
+    /**
+     * Binds the texture and reports its use by the object to the texture budget.
+     *
+     * @param 	texture	The texture of the object.
+     * @param 	unit	The texture unit.
+     * @param 	object_index	The index of the object in the objects buffer.
+     */
+    void bind_texture(const TextureAsset& texture, GLuint unit, GLuint object_index);
+
+    /**
+     * Binds the material and reports the use of its textures by the object to the texture budget.
+     *
+     * @param 	material	The material of the object.
+     * @param 	object_index	The index of the object in the objects buffer.
+     */
+    void bind_material(const TexturedMaterial& material, GLuint object_index);
+
   private:
     size_t width;
     size_t height;
@@ -90,9 +139,19 @@ class Application : public PV112Application {
     ShaderProgram mirror_program;
     ShaderProgram draw_light_program;
     ShaderProgram reflect_program;
+    ShaderProgram shadow_program;
     GLuint skybox_program = 0;
     GLuint postprocess_program = 0;
 
+    // Uploads the textures in the background, so the first frame does not wait for the images to be decoded.
+    TextureStreamer texture_streamer;
+
+    // The textures and geometries loaded from files, each file is loaded only once.
+    AssetRegistry assets;
+
+    // Drops the mip levels of the textures that are far away or not drawn when their memory exceeds the budget.
+    TextureBudget texture_budget;
+
     // List of geometries used in the project
     std::vector<std::shared_ptr<Geometry>> geometries;
     // Shared pointers are pointers that automatically count how many times they are used. When there are 0 pointers to the object pointed by shared_ptrs, the object is automatically deallocated.
@@ -164,7 +223,16 @@ class Application : public PV112Application {
     LightUBO light_ubo;
 
     GLuint objects_buffer = 0;
-    std::vector<ObjectUBO> objects_ubos;
+    std::vector<ModelData> objects_ubos;
+
+    // The levels of detail selected in the last frame (indexed like objects_ubos).
+    std::vector<int> object_lods;
+    LodSelector lod_selector;
+
+    // The GPU culling of the meshlets of the dense meshes (chair, UFO), the batches are culled once per frame.
+    std::unique_ptr<MeshletCuller> meshlet_culler;
+    MeshletCuller::Batch chair_batch;
+    MeshletCuller::Batch ufo_batch;
 
     // Lights
     GLuint *lights_buffer;
@@ -174,11 +242,30 @@ class Application : public PV112Application {
     
     std::vector<LightUBO> lights_night;
     GLuint lights_night_buffer = 0;
+    // The number of stars at the start of lights_night, each is drawn as a billboard.
+    size_t star_count = 195;
+    // The empty VAO of the star billboards.
+    GLuint stars_vao = 0;
 
     //1 cone light - ufo
     GLuint cone_light_buffer = 0;
     ConeLightUBO cone_light_ubo;
 
+    // Shadows
+    GLuint shadow_buffer = 0;
+    ShadowUBO shadow_ubo;
+
+    ShadowQuality shadow_quality = ShadowQuality::MEDIUM;
+    std::unique_ptr<CachedShadowMap> sun_shadow;
+    std::unique_ptr<CachedShadowMap> spot_shadow;
+
+    // Casters that never move, they are rendered into the cached static layers only.
+    std::vector<ShadowCaster> static_casters;
+    // Walls that cast shadows only when they are visible (see walls_off).
+    std::vector<ShadowCaster> wall_casters;
+    // Casters that move every frame (globe, cow, UFO).
+    std::vector<ShadowCaster> dynamic_casters;
+
     //framebuffers
     GLuint framebuffer_mirror;
     GLuint framebuffer_color_mirror;
@@ -188,74 +275,52 @@ class Application : public PV112Application {
     GLuint framebuffer_color;
     GLuint framebuffer_depth;
 
-    // Textures
-    GLuint marble_texture = 0;
-    GLuint plant3_texture = 0;
-    GLuint plant_pot_inside_texture = 0;
-    GLuint plant_pot_outside_texture = 0;
-    GLuint wood = 0;
-    GLuint rug_texture = 0;
-    GLuint plush_body_ambient_texture = 0;
-    GLuint plush_body_diffuse_texture = 0;
-    GLuint plush_body_specular_texture = 0;
-    GLuint plush_body_normal_texture = 0;
-
-    //GLuint grey_wood_texture = 0;
-    GLuint yellow_bed_texture = 0;
-    GLuint blue_bed_texture = 0;
-    GLuint white_bed_texture = 0;
-
-    GLuint chair_diffuse_texture = 0;
-    GLuint chair_ambient_texture = 0;
-    GLuint chair_specular_texture = 0;
-
-
-    GLuint globe_stand_texture = 0;
-    GLuint globe_day_texture = 0;
-    GLuint globe_night_texture = 0;
-    GLuint globe_stand_normal_texture = 0;
-    GLuint globe_normal_texture = 0;
-
-    GLuint door_frame_texture = 0;
-    GLuint door_base_texture = 0;
-
-    GLuint small_plant_pot_normal_texture = 0;
-    GLuint small_plant_pot_diffuse_texture = 0;
-    GLuint small_plant_pot_ambient_texture = 0;
-    GLuint small_plant_pot_specular_texture = 0;
-    
-    GLuint small_plant_leaf_normal_texture = 0;
-    GLuint small_plant_leaf_diffuse_texture = 0;
-    GLuint small_plant_leaf_ambient_texture = 0;
-    GLuint small_plant_leaf_specular_texture = 0;
+    // Textures, bound through their assets since the texture budget may re-allocate them
+    std::shared_ptr<TextureAsset> marble_texture;
+    std::shared_ptr<TextureAsset> plant3_texture;
+    std::shared_ptr<TextureAsset> plant_pot_inside_texture;
+    std::shared_ptr<TextureAsset> plant_pot_outside_texture;
+    std::shared_ptr<TextureAsset> wood;
+    std::shared_ptr<TextureAsset> rug_texture;
+    TexturedMaterial plush_body_material;
 
-    GLuint table_lamp_ambient_texture = 0;
-    GLuint table_lamp_diffuse_texture = 0;
-    GLuint table_lamp_specular_texture = 0;
-    GLuint table_lamp_normal_texture = 0;
+    //std::shared_ptr<TextureAsset> grey_wood_texture;
+    std::shared_ptr<TextureAsset> yellow_bed_texture;
+    std::shared_ptr<TextureAsset> blue_bed_texture;
+    std::shared_ptr<TextureAsset> white_bed_texture;
 
-    GLuint dark_wood_texture = 0;
-    
-    GLuint lamp7_ambient_texture = 0;
-    GLuint lamp7_diffuse_texture = 0;
+    std::shared_ptr<TextureAsset> chair_diffuse_texture;
+    TexturedMaterial chair_material;
+
+
+    std::shared_ptr<TextureAsset> globe_stand_texture;
+    std::shared_ptr<TextureAsset> globe_day_texture;
+    std::shared_ptr<TextureAsset> globe_night_texture;
+    std::shared_ptr<TextureAsset> globe_stand_normal_texture;
+    std::shared_ptr<TextureAsset> globe_normal_texture;
 
-    GLuint room_bot_texture = 0;
+    std::shared_ptr<TextureAsset> door_frame_texture;
+    std::shared_ptr<TextureAsset> door_base_texture;
+
+    TexturedMaterial small_plant_pot_material;
+    TexturedMaterial small_plant_leaf_material;
+
+    TexturedMaterial table_lamp_material;
+
+    std::shared_ptr<TextureAsset> dark_wood_texture;
+    
+    TexturedMaterial lamp7_material;
 
-    GLuint outside_texture = 0;
-    GLuint room_texture = 0;
-    GLuint room_texture_dark = 0;
+    std::shared_ptr<TextureAsset> room_bot_texture;
 
-    GLuint ufo_normal_texture = 0;
-    GLuint ufo_ambient_texture = 0;
-    GLuint ufo_diffuse_texture = 0;
-    GLuint ufo_specular_texture = 0;
+    std::shared_ptr<TextureAsset> outside_texture;
+    std::shared_ptr<TextureAsset> room_texture;
+    std::shared_ptr<TextureAsset> room_texture_dark;
 
-    GLuint cow_normal_texture = 0;
-    GLuint cow_ambient_texture = 0;
-    GLuint cow_diffuse_texture = 0;
-    GLuint cow_specular_texture = 0;
+    TexturedMaterial ufo_material;
+    TexturedMaterial cow_material;
 
-    GLuint tree_texture = 0;
+    std::shared_ptr<TextureAsset> tree_texture;
 
     bool night = false;
     bool walls_off = false;
@@ -265,8 +330,10 @@ class Application : public PV112Application {
 
   	GLuint skyboxVAO;
     GLuint skyboxVBO;
+    GLuint skybox_day_texture = 0;
+    GLuint skybox_night_texture = 0;
+    // The cube map of the current sky.
     unsigned int cubemapTexture;
-    std::vector<std::filesystem::path> faces;
     float prev_angle = 0;
 
     Cube cube;
@@ -1,10 +1,12 @@
 #define GLFW_INCLUDE_NONE
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
 #include "application.hpp"
 #include "manager.hpp"
+#include "utils/gl_object_tracker.hpp"
 
 int main(int argc, char** argv) {
     int initial_width = 1280;
@@ -12,6 +14,11 @@ int main(int argc, char** argv) {
 
     std::vector<std::string> arguments(argv, argv + argc);
 
+    // Automated runs fail as soon as the OpenGL objects keep growing, instead of slowly running out of memory.
+    if (std::find(arguments.begin(), arguments.end(), "--abort-on-gl-growth") != arguments.end()) {
+        GLObjectTracker::set_growth_limit(10, true);
+    }
+
     OpenGLManager manager;
     manager.init(initial_width, initial_height, "PV112 LTemplate", 4, 5);
     if(!manager.is_fail()) 
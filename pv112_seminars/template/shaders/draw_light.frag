@@ -1,14 +1,21 @@
 #version 450
 
 
-layout(location = 0) in vec3 fs_position;
+layout(location = 0) in vec2 fs_corner;
 layout(location = 1) in vec3 fs_color;
 
 layout(location = 0) out vec4 final_color;
 
 void main()
 {
+	// The quad is cut into a disc, its edge is smoothed over a single pixel.
+	float distance = length(fs_corner);
+	float coverage = clamp((1.0 - distance) / max(fwidth(distance), 1e-4), 0.0, 1.0);
+	if (coverage <= 0.0) {
+		discard;
+	}
+
     vec3 result = fs_color / (fs_color + 1.0); // tone mapping
     result = pow(result, vec3(1.0 / 2.2));     // gamma correction
-	final_color = vec4(result, 1.0);
+	final_color = vec4(result, coverage);
 }
@@ -13,23 +13,37 @@ struct Light {
 	vec4 specular_color;
 };
 
-layout(binding = 1, std430) buffer Lights {
+layout(binding = 1, std430) readonly buffer Lights {
 	Light lights[];
 };
 
+// The world space radius of a light.
+layout(location = 0) uniform float radius = 0.5;
+// The minimal radius of a light on the screen (in pixels), so the far lights do not flicker between pixels.
+layout(location = 1) uniform float min_pixel_radius = 1.0;
+// The height of the viewport (in pixels).
+layout(location = 2) uniform float viewport_height = 1.0;
 
-layout(location = 0) in vec3 position;
+// The corners of the camera-facing quad, two triangles per light.
+const vec2 corners[6] = vec2[](vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0));
 
-
-layout(location = 0) out vec3 fs_position;
+layout(location = 0) out vec2 fs_corner;
 layout(location = 1) out vec3 fs_color;
 
+// Draws every light as a view-aligned quad generated from gl_VertexID, no vertex attributes are needed.
 void main()
 {
-	vec3 light_position = lights[gl_InstanceID].position.xyz;
+	Light light = lights[gl_VertexID / 6];
+	vec2 corner = corners[gl_VertexID % 6];
+
+	// The quad is expanded in the view space, its size in pixels is radius * projection[1][1] * viewport_height / (2 * depth).
+	vec4 view_position = camera.view * vec4(light.position.xyz, 1.0);
+	float depth = max(-view_position.z, 1e-4);
+	float scale = max(radius, 2.0 * min_pixel_radius * depth / (camera.projection[1][1] * viewport_height));
+	view_position.xy += corner * scale;
 
-	fs_position = position * 0.5 + light_position;
-	fs_color = lights[gl_InstanceID].diffuse_color.rgb;
+	fs_corner = corner;
+	fs_color = light.diffuse_color.rgb;
 
-    gl_Position = camera.projection * camera.view * vec4(fs_position, 1.0);
+	gl_Position = camera.projection * view_position;
 }
@@ -19,14 +19,7 @@ layout(binding = 1, std430) buffer Lights {
 };
 
 
-layout(binding = 2, std140) uniform Object {
-    mat4 model_matrix;
-
-    vec4 ambient_color;
-    vec4 diffuse_color;
-    vec4 specular_color;
-}
-object;
+#pragma include object.glsl
 
 struct FogParameters
 {
@@ -49,6 +42,8 @@ layout(binding = 3, std140) uniform Cone_light {
 }
 cone_light;
 
+#pragma include shadows.glsl
+
 layout(location = 3) uniform bool night = false;
 layout(location = 4) uniform bool toon_shading = false;
 
@@ -58,10 +53,13 @@ layout(location = 0) in vec3 fs_position;
 layout(location = 1) in vec3 fs_normal;
 layout(location = 2) in vec2 fs_texture_coordinate;
 layout(location = 3) in float visibility;
+layout(location = 5) flat in int fs_object_index;
 
 layout(location = 0) out vec4 final_color;
 
 void main() {
+    Object object = objects[fs_object_index];
+
     vec3 color_sum = vec3(0.0);
     for (int i = 0; i < lights.length(); i++)
     {
@@ -87,7 +85,8 @@ void main() {
 
         vec3 specular = object.specular_color.rgb * light.specular_color.rgb;
 
-        vec3 color = ambient.rgb + NdotL * diffuse.rgb + pow(NdotH, object.specular_color.w) * specular;
+        float shadow = i == int(shadows.parameters.w) ? sun_shadow(fs_position) : 1.0;
+        vec3 color = ambient.rgb + shadow * (NdotL * diffuse.rgb + pow(NdotH, object.specular_color.w) * specular);
 
         if (light.position.w == 1.0) {
             color /= (dot(light_vector, light_vector));
@@ -126,7 +125,7 @@ void main() {
             }
 
             specular = object.specular_color.rgb * cone_light.specular_color.rgb;
-            color = ambient.rgb + NdotL * diffuse.rgb + pow(NdotH, object.specular_color.w) * specular;
+            color = ambient.rgb + spot_shadow(fs_position) * (NdotL * diffuse.rgb + pow(NdotH, object.specular_color.w) * specular);
         } 
         
         else 
@@ -28,14 +28,7 @@ layout(binding = 1, std430) buffer Lights {
 	Light lights[];
 };
 
-layout(binding = 2, std140) uniform Object {
-    mat4 model_matrix;
-
-    vec4 ambient_color;
-    vec4 diffuse_color;
-    vec4 specular_color;
-}
-object;
+#pragma include object.glsl
 
 
 layout(binding = 3, std140) uniform Cone_light {
@@ -48,6 +41,8 @@ layout(binding = 3, std140) uniform Cone_light {
 }
 cone_light;
 
+#pragma include shadows.glsl
+
 layout(location = 3) uniform bool has_texture = false;
 layout(location = 4) uniform bool toon_shading = false;
 layout(location = 5) uniform bool blend = false;
@@ -57,10 +52,13 @@ layout(binding = 3) uniform sampler2D albedo_texture;
 layout(location = 0) in vec3 fs_position;
 layout(location = 1) in vec3 fs_normal;
 layout(location = 2) in vec2 fs_texture_coordinate;
+layout(location = 5) flat in int fs_object_index;
 
 layout(location = 0) out vec4 final_color;
 
 void main() {
+    Object object = objects[fs_object_index];
+
     vec3 color_sum = vec3(0.0);
     for (int i = 0; i < lights.length(); i++)
     {
@@ -79,7 +77,8 @@ void main() {
                     light.diffuse_color.rgb;
         vec3 specular = object.specular_color.rgb * light.specular_color.rgb;
         
-        vec3 color = ambient.rgb + NdotL * diffuse.rgb + pow(NdotH, object.specular_color.w) * specular;
+        float shadow = i == int(shadows.parameters.w) ? sun_shadow(fs_position) : 1.0;
+        vec3 color = ambient.rgb + shadow * (NdotL * diffuse.rgb + pow(NdotH, object.specular_color.w) * specular);
 
         if (light.position.w == 1.0) {
             color /= (dot(light_vector, light_vector));
@@ -111,7 +110,7 @@ void main() {
                     cone_light.diffuse_color.rgb;
         specular = object.specular_color.rgb * cone_light.specular_color.rgb;
         
-        color = ambient.rgb + NdotL * diffuse.rgb + pow(NdotH, object.specular_color.w) * specular;
+        color = ambient.rgb + spot_shadow(fs_position) * (NdotL * diffuse.rgb + pow(NdotH, object.specular_color.w) * specular);
     } 
     else 
     {
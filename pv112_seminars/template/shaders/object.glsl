@@ -0,0 +1,15 @@
+// The per-object data, see ModelData in the framework. Both derived matrices are precomputed on the CPU.
+// All objects are stored in one buffer, the vertex shader selects the object using the base instance of the draw.
+struct Object {
+    mat4 model_matrix;
+    mat4 mvp_matrix;
+    mat3 normal_matrix;
+
+    vec4 ambient_color;
+    vec4 diffuse_color;
+    vec4 specular_color;
+};
+
+layout(binding = 2, std430) readonly buffer Objects {
+    Object objects[];
+};
@@ -0,0 +1,27 @@
+// Decoding of the compact vertex layout (see VertexFormat::QUANTIZED in the framework).
+// Quantized geometries provide the decoding constants in two extra attributes read with zero stride (the same
+// values for all vertices), float geometries leave them disabled so they read the default (0, 0, 0, 1).
+layout(location = 6) in vec4 quantization_scale;
+layout(location = 7) in vec4 quantization_offset;
+
+bool is_quantized() {
+	return quantization_scale.w == 0.0;
+}
+
+// Decodes a unit vector stored using the octahedral mapping.
+vec3 octahedral_decode(vec2 encoded) {
+	vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float t = max(-direction.z, 0.0);
+	direction.xy += vec2(direction.x >= 0.0 ? -t : t, direction.y >= 0.0 ? -t : t);
+	return normalize(direction);
+}
+
+// Returns the position in the object space.
+vec3 decode_position(vec3 position) {
+	return is_quantized() ? quantization_offset.xyz + quantization_scale.xyz * position : position;
+}
+
+// Returns the normal (tangent, bitangent) in the object space.
+vec3 decode_direction(vec3 direction) {
+	return is_quantized() ? octahedral_decode(direction.xy) : direction;
+}
@@ -1,4 +1,5 @@
 #version 450
+#extension GL_ARB_shader_draw_parameters : require
 
 layout(binding = 0, std140) uniform Camera {
 	mat4 projection;
@@ -6,15 +7,11 @@ layout(binding = 0, std140) uniform Camera {
 	vec3 position;
 } camera;
 
-layout(binding = 2, std140) uniform Object {
-	mat4 model_matrix;
-	vec4 ambient_color;
-	vec4 diffuse_color;
-	vec4 specular_color;
-} object;
+#pragma include object.glsl
+#pragma include quantization.glsl
 
-layout(location = 0) in vec3 position;
-layout(location = 1) in vec3 normal;
+layout(location = 0) in vec3 in_position;
+layout(location = 1) in vec3 in_normal;
 layout(location = 2) in vec2 texture_coordinate;
 
 layout(location = 0) out vec3 fs_position;
@@ -23,8 +20,12 @@ layout(location = 2) out vec2 fs_texture_coordinate;
 
 void main()
 {
+    Object object = objects[gl_BaseInstanceARB];
+    vec3 position = decode_position(in_position);
+    vec3 normal = decode_direction(in_normal);
+
 	fs_position = vec3(object.model_matrix * vec4(position, 1.0));
-	fs_normal = transpose(inverse(mat3(object.model_matrix))) * normal;
+	fs_normal = object.normal_matrix * normal;
 
-    gl_Position = camera.projection * camera.view * object.model_matrix * vec4(position, 1.0);
+    gl_Position = object.mvp_matrix * vec4(position, 1.0);
 }
@@ -0,0 +1,4 @@
+#version 450
+
+// Only the depth is written into the shadow map.
+void main() {}
@@ -0,0 +1,17 @@
+#version 450
+#extension GL_ARB_shader_draw_parameters : require
+
+#pragma include object.glsl
+#pragma include quantization.glsl
+
+layout(location = 0) uniform mat4 light_matrix;
+
+layout(location = 0) in vec3 in_position;
+
+void main()
+{
+    Object object = objects[gl_BaseInstanceARB];
+    vec3 position = decode_position(in_position);
+
+    gl_Position = light_matrix * object.model_matrix * vec4(position, 1.0);
+}
@@ -0,0 +1,40 @@
+// Shadow maps shared by all lit shaders. The maps are produced by CachedShadowMap: the sun uses an orthographic map,
+// the cone light uses a small perspective (spot) map.
+layout(binding = 4, std140) uniform Shadows {
+    mat4 sun_matrix;
+    mat4 spot_matrix;
+    // x = depth bias, y = PCF radius in texels, z = 1.0 if shadows are enabled, w = index of the sun in the lights
+    vec4 parameters;
+}
+shadows;
+
+layout(binding = 7) uniform sampler2DShadow sun_shadow_map;
+layout(binding = 8) uniform sampler2DShadow spot_shadow_map;
+
+// Returns the fraction of the light that reaches the position (1.0 = fully lit).
+float shadow_factor(sampler2DShadow shadow_map, mat4 light_matrix, vec3 position) {
+    if (shadows.parameters.z == 0.0) {
+        return 1.0;
+    }
+
+    vec4 light_position = light_matrix * vec4(position, 1.0);
+    vec3 coords = light_position.xyz / light_position.w * 0.5 + 0.5;
+    if (coords.z > 1.0) {
+        return 1.0;
+    }
+
+    // Percentage-closer filtering, each tap is additionally filtered bilinearly by the hardware.
+    int radius = int(shadows.parameters.y);
+    vec2 texel = 1.0 / vec2(textureSize(shadow_map, 0));
+    float lit = 0.0;
+    for (int x = -radius; x <= radius; x++) {
+        for (int y = -radius; y <= radius; y++) {
+            lit += texture(shadow_map, vec3(coords.xy + vec2(x, y) * texel, coords.z - shadows.parameters.x));
+        }
+    }
+    return lit / float((2 * radius + 1) * (2 * radius + 1));
+}
+
+float sun_shadow(vec3 position) { return shadow_factor(sun_shadow_map, shadows.sun_matrix, position); }
+
+float spot_shadow(vec3 position) { return shadow_factor(spot_shadow_map, shadows.spot_matrix, position); }
@@ -29,14 +29,7 @@ layout(binding = 1, std430) buffer Lights {
 };
 
 
-layout(binding = 2, std140) uniform Object {
-    mat4 model_matrix;
-
-    vec4 ambient_color;
-    vec4 diffuse_color;
-    vec4 specular_color;
-}
-object;
+#pragma include object.glsl
 
 
 layout(binding = 3, std140) uniform Cone_light {
@@ -49,16 +42,18 @@ layout(binding = 3, std140) uniform Cone_light {
 }
 cone_light;
 
+#pragma include shadows.glsl
 
-layout(location = 3) uniform bool has_3texture = false;
-layout(location = 4) uniform bool has_4texture = false;
-layout(location = 5) uniform bool has_5texture = false;
-layout(location = 6) uniform bool has_6texture = false;
+
+// The material (see TexturedMaterial): each color is read from a channel of one of the textures (-1 = no texture),
+// channels 0-3 are single packed maps read as gray, channel 4 is the RGB of the texture.
+layout(location = 3) uniform ivec2 ambient_source = ivec2(-1, 4);
+layout(location = 4) uniform ivec2 diffuse_source = ivec2(-1, 4);
+layout(location = 5) uniform ivec2 specular_source = ivec2(-1, 4);
+layout(location = 6) uniform bool has_normal_texture = false;
 layout(location = 7) uniform bool toon_shading = false;
 
-layout(binding = 3) uniform sampler2D ambient_texture;
-layout(binding = 4) uniform sampler2D diffuse_texture;
-layout(binding = 5) uniform sampler2D specular_texture;
+layout(binding = 3) uniform sampler2D material_textures[3];
 layout(binding = 6) uniform sampler2D normal_texture;
 
 
@@ -66,6 +61,7 @@ layout(location = 0) in vec3 fs_position;
 layout(location = 1) in vec3 fs_normal;
 layout(location = 2) in vec2 fs_texture_coordinate;
 layout(location = 3) in vec3 fs_view;
+layout(location = 5) flat in int fs_object_index;
 
 layout(location = 0) out vec4 final_color;
 
@@ -98,33 +94,56 @@ mat3 cotangent_frame( vec3 N, vec3 p, vec2 uv )
 
 
 
+vec3 material_color(ivec2 source, vec4 samples[3])
+{
+    if (source.x < 0)
+        return vec3(1.0);
+    vec4 value = samples[source.x];
+    return source.y == 4 ? value.rgb : vec3(value[source.y]);
+}
+
+
 void main() {
+    Object object = objects[fs_object_index];
+
+    // Every texture used by the material is sampled once, even if several colors are packed in it.
+    vec4 samples[3];
+    for (int t = 0; t < 3; t++)
+    {
+        bool used = ambient_source.x == t || diffuse_source.x == t || specular_source.x == t;
+        samples[t] = used ? texture(material_textures[t], fs_texture_coordinate) : vec4(1.0);
+    }
+    vec3 ambient_texel = material_color(ambient_source, samples);
+    vec3 diffuse_texel = material_color(diffuse_source, samples);
+    vec3 specular_texel = material_color(specular_source, samples);
+
+    vec3 N = normalize(fs_normal);
+    if (has_normal_texture) {
+        // The normal maps are compressed to two channels (BC5), Z is reconstructed from the unit length.
+        vec2 xy = texture(normal_texture, fs_texture_coordinate).rg * 255./127. - 128./127.;
+        vec3 map = vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+        mat3 TBN = cotangent_frame( N, -fs_view, fs_texture_coordinate );
+        N = normalize( TBN * map );
+    }
+
     vec3 color_sum = vec3(0.0);
     for (int i = 0; i < lights.length(); i++ )
     {
         Light light = lights[i];
         vec3 light_vector = light.position.xyz - fs_position * light.position.w;
         vec3 L = normalize(light_vector);
-        vec3 N = normalize(fs_normal);
-
-        if (has_6texture) {
-            vec3 map = (has_6texture ? texture(normal_texture, fs_texture_coordinate).rgb : vec3(1.0));
-            map = map * 255./127. - 128./127.;
-            mat3 TBN = cotangent_frame( N, -fs_view, fs_texture_coordinate );
-            N = normalize( TBN * map );
-        }
         vec3 E = normalize(camera.position - fs_position);
         vec3 H = normalize(L + E);
 
         float NdotL = max(dot(N, L), 0.0);
         float NdotH = max(dot(N, H), 0.0001);
 
-        vec3 ambient = object.ambient_color.rgb * (has_3texture ? texture(ambient_texture, fs_texture_coordinate).rgb : vec3(1.0)) * light.ambient_color.rgb;
-        vec3 diffuse = object.diffuse_color.rgb * (has_4texture ? texture(diffuse_texture, fs_texture_coordinate).rgb : vec3(1.0)) *
-                    light.diffuse_color.rgb;
-        vec3 specular = object.specular_color.rgb * (has_5texture ? texture(specular_texture, fs_texture_coordinate).rgb : vec3(1.0)) * light.specular_color.rgb;
+        vec3 ambient = object.ambient_color.rgb * ambient_texel * light.ambient_color.rgb;
+        vec3 diffuse = object.diffuse_color.rgb * diffuse_texel * light.diffuse_color.rgb;
+        vec3 specular = object.specular_color.rgb * specular_texel * light.specular_color.rgb;
 
-        vec3 color = ambient.rgb + NdotL * diffuse.rgb + pow(NdotH, object.specular_color.w) * specular;
+        float shadow = i == int(shadows.parameters.w) ? sun_shadow(fs_position) : 1.0;
+        vec3 color = ambient.rgb + shadow * (NdotL * diffuse.rgb + pow(NdotH, object.specular_color.w) * specular);
 
         if (light.position.w == 1.0) {
             color /= (dot(light_vector, light_vector));
@@ -136,7 +155,7 @@ void main() {
     //cone light
     vec3 cone_light_vector = cone_light.position.xyz - fs_position * cone_light.position.w;
     vec3 L = normalize(cone_light_vector);
-    vec3 N = normalize(fs_normal);
+    N = normalize(fs_normal);
     vec3 E = normalize(camera.position - fs_position);
     vec3 H = normalize(L + E);
 
@@ -151,12 +170,11 @@ void main() {
 
     if(theta > cone_light.cutoff) 
     {       
-        ambient = object.ambient_color.rgb * (has_3texture ? texture(ambient_texture, fs_texture_coordinate).rgb : vec3(1.0)) * cone_light.ambient_color.rgb;
-        diffuse = object.diffuse_color.rgb * (has_4texture ? texture(diffuse_texture, fs_texture_coordinate).rgb : vec3(1.0)) *
-                    cone_light.diffuse_color.rgb;
-        specular = object.specular_color.rgb * (has_5texture ? texture(specular_texture, fs_texture_coordinate).rgb : vec3(1.0)) * cone_light.specular_color.rgb;
+        ambient = object.ambient_color.rgb * ambient_texel * cone_light.ambient_color.rgb;
+        diffuse = object.diffuse_color.rgb * diffuse_texel * cone_light.diffuse_color.rgb;
+        specular = object.specular_color.rgb * specular_texel * cone_light.specular_color.rgb;
 
-        color = ambient.rgb + NdotL * diffuse.rgb + pow(NdotH, object.specular_color.w) * specular;
+        color = ambient.rgb + spot_shadow(fs_position) * (NdotL * diffuse.rgb + pow(NdotH, object.specular_color.w) * specular);
     } 
         
     else 
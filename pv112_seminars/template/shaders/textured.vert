@@ -1,4 +1,5 @@
 #version 450
+#extension GL_ARB_shader_draw_parameters : require
 
 layout(binding = 0, std140) uniform Camera {
 	mat4 projection;
@@ -13,28 +14,30 @@ layout(binding = 1, std140) uniform Light {
 	vec4 specular_color;
 } light;
 
-layout(binding = 2, std140) uniform Object {
-	mat4 model_matrix;
-	vec4 ambient_color;
-	vec4 diffuse_color;
-	vec4 specular_color;
-} object;
+#pragma include object.glsl
+#pragma include quantization.glsl
 
-layout(location = 0) in vec3 position;
-layout(location = 1) in vec3 normal;
+layout(location = 0) in vec3 in_position;
+layout(location = 1) in vec3 in_normal;
 layout(location = 2) in vec2 texture_coordinate;
 
 layout(location = 0) out vec3 fs_position;
 layout(location = 1) out vec3 fs_normal;
 layout(location = 2) out vec2 fs_texture_coordinate;
 layout(location = 3) out vec3 fs_view;
+layout(location = 5) flat out int fs_object_index;
 
 void main()
 {
+    Object object = objects[gl_BaseInstanceARB];
+    vec3 position = decode_position(in_position);
+    vec3 normal = decode_direction(in_normal);
+    fs_object_index = gl_BaseInstanceARB;
+
 	fs_position = vec3(object.model_matrix * vec4(position, 1.0));
-	fs_normal = transpose(inverse(mat3(object.model_matrix))) * normal;
+	fs_normal = object.normal_matrix * normal;
 	fs_texture_coordinate = texture_coordinate;
 	fs_view = camera.position.xyz - position;
 
-    gl_Position = camera.projection * camera.view * object.model_matrix * vec4(position, 1.0);
+    gl_Position = object.mvp_matrix * vec4(position, 1.0);
 }